@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * Background anti-entropy for HyDFS
+ * Periodically runs a sync round: the node compares the Merkle tree of the ring
+ * range it coordinates with each co-replica and merges the files that diverged
+ * (e.g. after a lost REPLICATE_BLOCK). Traffic grows with the differences, not
+ * with the number of files.
+ */
+class AntiEntropyService {
+ public:
+  // Runs one sync round and returns the number of files repaired
+  using SyncRound = std::function<size_t()>;
+
+  explicit AntiEntropyService(SyncRound sync_round,
+                              std::chrono::milliseconds interval = std::chrono::seconds(30));
+  ~AntiEntropyService();
+
+  // Start and stop the background thread
+  void start();
+  void stop();
+
+  // Run a single sync round now
+  size_t runOnce();
+
+ private:
+  void run();
+
+  SyncRound sync_round_;
+  std::chrono::milliseconds interval_;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
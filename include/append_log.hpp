@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "file_block.hpp"
+#include "file_metadata.hpp"
+
+/**
+ * Per-file log sequence numbers for the appends this node coordinates
+ * Each committed group is stamped with consecutive LSNs that run on from the file's
+ * previous group. The IDs of the most recent blocks are kept, so a replica that lost a
+ * batch can be sent just the missing range from the local store.
+ */
+class AppendLog {
+ public:
+  explicit AppendLog(size_t max_ids_per_file = 1024);
+
+  // Stamp a group of blocks appended to a file; returns the LSN of the first block
+  uint64_t stamp(FileId file_id, const std::vector<FileBlock>& blocks);
+
+  // IDs of the blocks stamped [from_lsn, to_lsn); false if the log no longer reaches back
+  // to from_lsn or hasn't reached to_lsn yet
+  bool range(FileId file_id, uint64_t from_lsn, uint64_t to_lsn,
+             std::vector<uint64_t>& block_ids) const;
+
+ private:
+  struct FileLog {
+    uint64_t next_lsn = 1;
+    std::deque<uint64_t> recent;  // block IDs of the LSNs just before next_lsn
+  };
+
+  size_t max_ids_per_file_;
+  std::unordered_map<FileId, FileLog> logs_;
+  mutable std::mutex mtx_;
+};
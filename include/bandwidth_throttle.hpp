@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * Paces bulk traffic to a bandwidth cap
+ * Each caller reserves the bytes it is about to send and waits for its slot, so
+ * everyone sharing one throttle stays under the cap together. Shared by the
+ * rebalancer and the handler's file transfers, so moving files to a joining node
+ * and re-replicating never add up to more than the cap.
+ */
+class BandwidthThrottle {
+ public:
+  explicit BandwidthThrottle(uint64_t bytes_per_sec = 1024 * 1024);
+
+  BandwidthThrottle(const BandwidthThrottle&) = delete;
+  BandwidthThrottle& operator=(const BandwidthThrottle&) = delete;
+
+  // Wait until `bytes` more fit under the cap; false once stopped
+  bool acquire(size_t bytes);
+
+  // Wake every waiter and fail all later acquires
+  void stop();
+  bool stopped() const;
+
+  // Cap the traffic (0 = unlimited)
+  void setBandwidthCap(uint64_t bytes_per_sec) { bytes_per_sec_ = bytes_per_sec; }
+  uint64_t getBandwidthCap() const { return bytes_per_sec_; }
+
+ private:
+  std::atomic<uint64_t> bytes_per_sec_;
+  std::chrono::steady_clock::time_point next_send_;  // earliest start of the next send
+  bool stopped_ = false;
+  mutable std::mutex mtx_;
+  std::condition_variable cv_;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "file_store.hpp"
+
+/**
+ * Background compactor for HyDFS
+ * Periodically folds runs of small, stable blocks in every local file into
+ * large extents so read assembly and metadata scale with bytes, not appends
+ */
+class BlockCompactor {
+ public:
+  BlockCompactor(FileStore& file_store, const CompactionPolicy& policy = {},
+                 std::chrono::milliseconds interval = std::chrono::seconds(10));
+  ~BlockCompactor();
+
+  // Start and stop the background thread
+  void start();
+  void stop();
+
+  // Run a single compaction pass over all local files
+  // Returns the number of blocks folded away
+  size_t runOnce();
+
+ private:
+  void run();
+
+  FileStore& file_store_;
+  CompactionPolicy policy_;
+  std::chrono::milliseconds interval_;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
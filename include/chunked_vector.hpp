@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Persistent append-only vector (a 32-way trie of chunks plus a tail chunk)
+ * Elements live in fixed chunks of kWidth values. Full chunks are immutable and
+ * shared between copies, so copying a ChunkedVector costs O(1) (one root pointer
+ * and at most kWidth tail values) and push_back is O(1) amortized. Old copies
+ * are snapshots: appending to one copy never changes another. dropFront() removes a
+ * prefix in O(log n) and releases every chunk that lies wholly inside it.
+ *
+ * Chunks are shared read-only, so distinct copies may be used from different threads.
+ */
+template <typename T>
+class ChunkedVector {
+ public:
+  static constexpr size_t kBits = 5;
+  static constexpr size_t kWidth = size_t(1) << kBits;
+  static constexpr size_t kMask = kWidth - 1;
+
+  using value_type = T;
+  using size_type = size_t;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return chunk_[index_ & kMask]; }
+    pointer operator->() const { return &chunk_[index_ & kMask]; }
+
+    const_iterator& operator++() {
+      ++index_;
+      if ((index_ & kMask) == 0 && index_ < vec_->size_) {
+        chunk_ = vec_->chunkFor(index_);
+      }
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+    bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+   private:
+    friend class ChunkedVector;
+    const_iterator(const ChunkedVector* vec, size_t index) : vec_(vec), index_(index) {
+      if (index_ < vec_->size_) {
+        chunk_ = vec_->chunkFor(index_);
+      }
+    }
+
+    const ChunkedVector* vec_ = nullptr;
+    size_t index_ = 0;
+    const T* chunk_ = nullptr;  // start of the chunk holding index_
+  };
+
+  ChunkedVector() = default;
+  ChunkedVector(std::initializer_list<T> values) {
+    for (const auto& value : values) push_back(value);
+  }
+  explicit ChunkedVector(const std::vector<T>& values) {
+    for (const auto& value : values) push_back(value);
+  }
+
+  size_t size() const { return size_ - start_; }
+  bool empty() const { return size_ == start_; }
+
+  const T& operator[](size_t i) const {
+    i += start_;
+    size_t tail_offset = tailOffset();
+    if (i >= tail_offset) return tail_[i - tail_offset];
+    return leafFor(i)[i & kMask];
+  }
+  const T& back() const { return tail_.back(); }
+
+  const_iterator begin() const { return const_iterator(this, start_); }
+  const_iterator end() const { return const_iterator(this, size_); }
+
+  // Iterate starting at element i
+  const_iterator iteratorAt(size_t i) const {
+    return const_iterator(this, std::min(i + start_, size_));
+  }
+
+  void push_back(T value) {
+    if (tail_.size() == kWidth) {
+      pushTailIntoTrie();
+    }
+    tail_.push_back(std::move(value));
+    ++size_;
+  }
+
+  // Append a contiguous run of values
+  void append(const T* values, size_t count) {
+    for (size_t i = 0; i < count; ++i) push_back(values[i]);
+  }
+
+  void clear() {
+    root_.reset();
+    tail_.clear();
+    size_ = 0;
+    start_ = 0;
+    released_ = 0;
+    shift_ = kBits;
+  }
+
+  // Remove the first count elements; indices of the rest shift down by count
+  void dropFront(size_t count) {
+    start_ += std::min(count, size());
+    if (start_ == size_) {
+      clear();
+      return;
+    }
+
+    // Release the trie leaves that now lie wholly before the front
+    size_t limit = std::min(start_ & ~kMask, tailOffset());
+    if (root_ && limit > released_) {
+      root_ = releaseBefore(shift_, root_, 0, limit);
+      released_ = limit;
+    }
+  }
+
+  // Call fn(const T* values, size_t count) for each chunk, front to back
+  template <typename Fn>
+  void forEachChunk(Fn&& fn) const {
+    for (size_t start = start_; start < size_;) {
+      size_t offset = start & kMask;
+      size_t count = std::min(kWidth - offset, size_ - start);
+      fn(chunkFor(start) + offset, count);
+      start += count;
+    }
+  }
+
+  // Call fn(const T* values, size_t count) for each chunk, back to front,
+  // stopping early once fn returns false
+  template <typename Fn>
+  void forEachChunkReverse(Fn&& fn) const {
+    if (empty()) return;
+    for (size_t start = tailOffset();; start -= kWidth) {
+      size_t skip = start_ > start ? start_ - start : 0;
+      if (!fn(chunkFor(start) + skip, std::min(kWidth, size_ - start) - skip) ||
+          start <= start_) {
+        return;
+      }
+    }
+  }
+
+  std::vector<T> toVector() const {
+    std::vector<T> out;
+    out.reserve(size());
+    forEachChunk(
+        [&](const T* values, size_t count) { out.insert(out.end(), values, values + count); });
+    return out;
+  }
+
+  bool operator==(const ChunkedVector& other) const {
+    return size() == other.size() && std::equal(begin(), end(), other.begin());
+  }
+  bool operator!=(const ChunkedVector& other) const { return !(*this == other); }
+
+ private:
+  // Inner nodes use children, leaves use values (always exactly kWidth of them)
+  struct Node {
+    std::vector<std::shared_ptr<const Node>> children;
+    std::vector<T> values;
+  };
+  using NodePtr = std::shared_ptr<const Node>;
+
+  NodePtr root_;          // trie of full chunks; null until the first chunk fills
+  std::vector<T> tail_;   // last, partially filled chunk (owned, not shared)
+  size_t size_ = 0;       // elements ever pushed, including dropped ones
+  size_t start_ = 0;      // index of the first element not dropped
+  size_t released_ = 0;   // leaves before this index have been released
+  size_t shift_ = kBits;  // bits consumed below the root
+
+  size_t tailOffset() const { return size_ - tail_.size(); }
+
+  const T* leafFor(size_t i) const {
+    const Node* node = root_.get();
+    for (size_t level = shift_; level > 0; level -= kBits) {
+      node = node->children[(i >> level) & kMask].get();
+    }
+    return node->values.data();
+  }
+
+  const T* chunkFor(size_t i) const { return i >= tailOffset() ? tail_.data() : leafFor(i); }
+
+  // Move the full tail into the trie as a new shared leaf
+  void pushTailIntoTrie() {
+    auto leaf = std::make_shared<Node>();
+    leaf->values = std::move(tail_);
+    tail_.clear();
+    tail_.reserve(kWidth);
+
+    size_t index = size_ - kWidth;  // position of the leaf's first element
+    if (!root_) {
+      auto root = std::make_shared<Node>();
+      root->children.push_back(std::move(leaf));
+      root_ = std::move(root);
+      shift_ = kBits;
+    } else if (index == (size_t(1) << (shift_ + kBits))) {
+      // Root is full: grow the trie by one level
+      auto root = std::make_shared<Node>();
+      root->children.push_back(root_);
+      root->children.push_back(newPath(shift_, std::move(leaf)));
+      root_ = std::move(root);
+      shift_ += kBits;
+    } else {
+      root_ = pushLeaf(shift_, root_, index, std::move(leaf));
+    }
+  }
+
+  // Chain of single-child inner nodes from `level` down to the leaf
+  static NodePtr newPath(size_t level, NodePtr leaf) {
+    if (level == 0) return leaf;
+    auto node = std::make_shared<Node>();
+    node->children.push_back(newPath(level - kBits, std::move(leaf)));
+    return node;
+  }
+
+  // Copy of the subtree covering [base, ...) with every leaf wholly before limit released
+  static NodePtr releaseBefore(size_t level, const NodePtr& node, size_t base, size_t limit) {
+    auto copy = std::make_shared<Node>(*node);
+    for (size_t i = 0; i < copy->children.size(); ++i) {
+      size_t child_base = base + (i << level);
+      if (child_base + (size_t(1) << level) <= limit) {
+        copy->children[i].reset();
+        continue;
+      }
+      if (child_base < limit && level > kBits && copy->children[i]) {
+        copy->children[i] = releaseBefore(level - kBits, copy->children[i], child_base, limit);
+      }
+      break;
+    }
+    return copy;
+  }
+
+  // Copy the path to `index` and hang the leaf off it; untouched subtrees stay shared
+  static NodePtr pushLeaf(size_t level, const NodePtr& node, size_t index, NodePtr leaf) {
+    auto copy = std::make_shared<Node>(*node);
+    size_t sub = (index >> level) & kMask;
+    if (level == kBits) {
+      copy->children.push_back(std::move(leaf));
+    } else if (sub < copy->children.size()) {
+      copy->children[sub] = pushLeaf(level - kBits, copy->children[sub], index, std::move(leaf));
+    } else {
+      copy->children.push_back(newPath(level - kBits, std::move(leaf)));
+    }
+    return copy;
+  }
+};
@@ -3,9 +3,12 @@
 #include <cstdint>
 #include <shared_mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+#include "file_block.hpp"
+#include "file_metadata.hpp"
+#include "flat_hash_map.hpp"
+
 /**
  * Tracks client operations for read-my-writes consistency
  * Maintains which blocks each client has successfully appended
@@ -15,28 +18,35 @@ class ClientTracker {
   ClientTracker() = default;
 
   // Record a successful append by a client
-  void recordAppend(const std::string& client_id, const std::string& filename,
-                    uint64_t block_id);
+  void recordAppend(const std::string& client_id, FileId file_id, uint64_t block_id,
+                    uint32_t sequence_num);
 
   // Get all block IDs that a client has appended to a file
-  std::vector<uint64_t> getClientAppends(const std::string& client_id,
-                                         const std::string& filename) const;
+  std::vector<uint64_t> getClientAppends(const std::string& client_id, FileId file_id) const;
 
   // Check if a file version satisfies read-my-writes for a client
-  bool satisfiesReadMyWrites(const std::string& client_id, const std::string& filename,
-                            const std::vector<uint64_t>& file_block_ids) const;
+  // An append counts as present if its block ID is listed or a compacted range covers it.
+  // Recent appends sit near the end of the file, so the block list is scanned from the tail
+  bool satisfiesReadMyWrites(const std::string& client_id, FileId file_id,
+                            const BlockIdList& file_block_ids,
+                            const std::vector<BlockRange>& compacted_ranges = {}) const;
 
   // Clear all tracking for a client
   void clearClient(const std::string& client_id);
 
   // Clear all tracking for a file
-  void clearFile(const std::string& filename);
+  void clearFile(FileId file_id);
 
  private:
-  // client_id -> (filename -> list of block_ids)
-  std::unordered_map<std::string,
-                     std::unordered_map<std::string, std::vector<uint64_t>>>
-      client_appends;
+  // An append this client made, identified both by block ID and by sequence number
+  // (the latter survives compaction of the block into an extent)
+  struct ClientAppend {
+    uint64_t block_id;
+    uint32_t sequence_num;
+  };
+
+  // client_id -> (file_id -> list of appends)
+  FlatHashMap<std::string, FlatHashMap<FileId, std::vector<ClientAppend>>> client_appends;
 
   mutable std::shared_mutex mtx;  // thread safety
 };
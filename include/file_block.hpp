@@ -4,25 +4,80 @@
 #include <string>
 #include <vector>
 
+/**
+ * Provenance for a run of appends folded into a compacted extent
+ * One range covers consecutive sequence numbers appended by a single client
+ */
+struct BlockRange {
+  std::string client_id;    // who appended the run
+  uint32_t first_sequence;  // first sequence number in the run
+  uint32_t last_sequence;   // last sequence number in the run (inclusive)
+  uint64_t offset;          // byte offset of the run inside the extent
+  uint64_t length;          // number of bytes covered by the run
+  std::vector<uint32_t> sizes;  // bytes of each append in the run, in sequence order
+
+  // Check if this range contains a given append
+  bool covers(const std::string& client, uint32_t sequence) const {
+    return client == client_id && sequence >= first_sequence && sequence <= last_sequence;
+  }
+
+  // Byte offset inside the extent just past a given append of the run
+  uint64_t endOf(uint32_t sequence) const {
+    uint64_t end = offset;
+    for (uint32_t seq = first_sequence; seq <= sequence; seq++) {
+      end += sizes[seq - first_sequence];
+    }
+    return end;
+  }
+};
+
 /**
  * Represents a single block of data in HyDFS
- * Each append operation creates a new block
+ * Each append operation creates a new block; the compactor may later fold
+ * runs of small blocks into one extent that records their provenance in ranges
  */
 struct FileBlock {
-  uint64_t block_id;        // unique ID (hash of client_id + timestamp + sequence)
-  std::string client_id;    // who appended this (NodeId as string)
-  uint32_t sequence_num;    // order within this client's appends
-  uint64_t timestamp;       // when the append occurred
-  std::vector<char> data;   // actual block data
-  size_t size;              // size of data
+  uint64_t block_id;               // unique ID (hash of client_id + timestamp + sequence)
+  std::string client_id;           // who appended this (NodeId as string)
+  uint32_t sequence_num;           // order within this client's appends
+  uint64_t timestamp;              // when the append occurred
+  std::vector<char> data;          // actual block data
+  size_t size;                     // size of data
+  std::vector<BlockRange> ranges;  // provenance of folded appends (empty unless an extent)
+
+  // True if this block is a compacted extent of several appends
+  bool isExtent() const { return !ranges.empty(); }
+
+  // ID of the last append the block holds: its own, or the last one folded into an
+  // extent (an extent is stamped with its last append's time). Pollers resume from it
+  uint64_t lastAppendId() const;
 
   // Serialize block to buffer for network transmission
   size_t serialize(char* buffer, size_t buffer_size) const;
 
+  // Number of bytes serialize() will write for this block
+  size_t serializedSize() const;
+
   // Deserialize block from buffer
   static FileBlock deserialize(const char* buffer, size_t buffer_size);
 
   // Generate unique block ID
   static uint64_t generateBlockId(const std::string& client_id, uint64_t timestamp,
                                    uint32_t sequence_num);
+
+  // Generate ID for an extent spanning the given first and last blocks
+  static uint64_t generateExtentId(uint64_t first_block_id, uint64_t last_block_id);
+};
+
+/**
+ * Compact description of a block (no payload), enough to order and deduplicate
+ * it when merging replicas
+ */
+struct BlockDigest {
+  uint64_t block_id;
+  std::string client_id;
+  uint32_t sequence_num;
+  uint64_t timestamp;
+  uint32_t size;
+  std::vector<BlockRange> ranges;  // provenance if the block is a compacted extent
 };
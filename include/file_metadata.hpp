@@ -4,7 +4,15 @@
 #include <string>
 #include <vector>
 
+#include "chunked_vector.hpp"
 #include "file_block.hpp"
+#include "message.hpp"
+
+// Stable 64-bit handle for a hydfs filename (see InternTable)
+using FileId = uint64_t;
+
+// Ordered block IDs of a file; copies share all full chunks
+using BlockIdList = ChunkedVector<uint64_t>;
 
 /**
  * Metadata for a file stored in HyDFS
@@ -14,7 +22,7 @@ struct FileMetadata {
   std::string hydfs_filename;           // name of file in HyDFS
   uint64_t file_id;                     // hash of filename
   size_t total_size;                    // total size of all blocks
-  std::vector<uint64_t> block_ids;      // ordered list of block IDs
+  BlockIdList block_ids;                // ordered list of block IDs
   uint32_t version;                     // version for merge conflict resolution
   uint64_t created_timestamp;           // when file was created
   uint64_t last_modified_timestamp;     // last modification time
@@ -22,13 +30,51 @@ struct FileMetadata {
   // Serialize metadata to buffer
   size_t serialize(char* buffer, size_t buffer_size) const;
 
+  // Number of bytes serialize() will write for this metadata
+  size_t serializedSize() const;
+
   // Deserialize metadata from buffer
   static FileMetadata deserialize(const char* buffer, size_t buffer_size);
 
   // Generate file ID from filename
-  static uint64_t generateFileId(const std::string& filename);
+  static FileId generateFileId(const std::string& filename);
 };
 
+/**
+ * How many replicas an append or get waits for before it returns
+ * ONE answers from a single replica, QUORUM from a majority of the replica set,
+ * ALL from every replica. Writes and reads at QUORUM always overlap in one replica
+ */
+enum class ConsistencyLevel : uint8_t { ONE, QUORUM, ALL };
+
+// Replicas that must take part at a level, out of a replica set of replica_count
+inline size_t requiredReplicas(ConsistencyLevel level, size_t replica_count) {
+  switch (level) {
+    case ConsistencyLevel::QUORUM:
+      return replica_count / 2 + 1;
+    case ConsistencyLevel::ALL:
+      return replica_count > 0 ? replica_count : 1;
+    case ConsistencyLevel::ONE:
+    default:
+      return 1;
+  }
+}
+
+inline const char* to_string(ConsistencyLevel level) {
+  switch (level) {
+    case ConsistencyLevel::ONE:
+      return "ONE";
+    case ConsistencyLevel::QUORUM:
+      return "QUORUM";
+    case ConsistencyLevel::ALL:
+      return "ALL";
+  }
+  return "UNKNOWN";
+}
+
+// Parse "one", "quorum" or "all" (any case); false leaves level unchanged
+bool parseConsistencyLevel(const std::string& text, ConsistencyLevel& level);
+
 /**
  * Message types for HyDFS file operations
  * NOTE: Values start at 100 to distinguish from membership MessageType (0-5)
@@ -46,8 +92,9 @@ enum class FileMessageType : uint8_t {
 
   // Replication operations
   REPLICATE_FILE,           // Replicate file to a node
-  REPLICATE_BLOCK,          // Replicate a block to a node
-  REPLICATE_ACK,            // Acknowledgement of replication
+  REPLICATE_BLOCKS,         // Appended blocks of one or more files, in order
+  REPLICATE_BLOCKS_ACK,     // High-water mark of the blocks a replica stored
+  REPLICATE_GAP_REQUEST,    // Ask the head again for a file's missing LSN range
 
   // Query operations
   LS_REQUEST,               // Request to list file locations
@@ -64,8 +111,30 @@ enum class FileMessageType : uint8_t {
   MERGE_UPDATE_ACK,         // Acknowledgement of merge update
 
   // Failure handling
-  TRANSFER_FILES,           // Transfer files to new replica during failure recovery
-  DELETE_FILE,              // Delete a file from a node
+  TRANSFER_FILES,           // Copy a file to a new replica (MergeUpdateMessage pages)
+  DELETE_FILE,              // Drop a file from a node that is no longer its replica
+
+  // Incremental reads
+  GET_SINCE_REQUEST,        // Request blocks appended after a timestamp or block
+  GET_SINCE_RESPONSE,       // Response with only the newer blocks
+
+  // Retention
+  TRUNCATE_FILE,            // Drop a file's blocks up to a truncation point
+  TRUNCATE_FILE_ACK,        // Acknowledgement of a truncation point
+
+  // Anti-entropy
+  MERKLE_REQUEST,           // Ask a co-replica for Merkle hashes of a ring range
+  MERKLE_RESPONSE,          // Hashes (and leaf files) of the requested tree nodes
+
+  // Hinted handoff
+  HINT_BATCH,               // Blocks a replica missed while unreachable, in order
+  HINT_BATCH_ACK,           // Acknowledgement of a hint batch
+
+  // Read leases
+  LEASE_INVALIDATE,         // A leased file changed; drop it from the read cache
+
+  // Hedged reads
+  GET_CANCEL,               // A hedged GET was answered elsewhere; don't send the file
 
   // Error responses
   ERROR_FILE_EXISTS,        // File already exists (create failed)
@@ -82,6 +151,8 @@ struct CreateFileRequest {
   uint64_t client_id;
   std::vector<char> data;
   size_t data_size;
+  std::string creator_id;    // client ID of the first block, the same on every replica
+  uint64_t timestamp = 0;    // creator's timestamp of the first block
 
   size_t serialize(char* buffer, size_t buffer_size) const;
   static CreateFileRequest deserialize(const char* buffer, size_t buffer_size);
@@ -107,6 +178,7 @@ struct GetFileRequest {
   std::string local_filename;
   uint64_t client_id;
   uint32_t last_known_sequence;  // For read-my-writes consistency
+  uint64_t request_id;           // echoed in the response (0 = not a quorum read)
 
   size_t serialize(char* buffer, size_t buffer_size) const;
   static GetFileRequest deserialize(const char* buffer, size_t buffer_size);
@@ -117,6 +189,8 @@ struct GetFileRequest {
  */
 struct GetFileResponse {
   bool success;
+  uint64_t request_id;
+  uint32_t lease_ms;  // how long the reader may cache this copy (0 = no lease)
   std::string error_message;
   FileMetadata metadata;
   std::vector<FileBlock> blocks;
@@ -125,6 +199,38 @@ struct GetFileResponse {
   static GetFileResponse deserialize(const char* buffer, size_t buffer_size);
 };
 
+/**
+ * Request for the blocks of a file appended after a given block or timestamp
+ * since_block_id takes precedence; since_timestamp is used if it is 0 or unknown.
+ * With since_timestamp set to that block's own stamp, a block since compacted into an
+ * extent is still found and only the bytes after it are returned
+ */
+struct GetSinceRequest {
+  std::string hydfs_filename;
+  std::string local_filename;
+  uint64_t since_timestamp;      // ms since epoch; blocks stamped after this are returned
+  uint64_t since_block_id;       // last block the requester has seen, 0 if none
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static GetSinceRequest deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Response with the blocks appended since the requested point
+ */
+struct GetSinceResponse {
+  bool success;
+  std::string error_message;
+  std::string hydfs_filename;
+  uint32_t version;
+  bool anchor_found;             // since_block_id was found; otherwise filtered by timestamp
+  bool more;                     // blocks were left out to fit the reply; poll again
+  std::vector<FileBlock> blocks;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static GetSinceResponse deserialize(const char* buffer, size_t buffer_size);
+};
+
 /**
  * Request to append to a file in HyDFS
  */
@@ -135,6 +241,8 @@ struct AppendFileRequest {
   uint32_t sequence_num;
   std::vector<char> data;
   size_t data_size;
+  uint64_t request_id;           // echoed in the response
+  ConsistencyLevel consistency;  // replicas that must store the block before the reply
 
   size_t serialize(char* buffer, size_t buffer_size) const;
   static AppendFileRequest deserialize(const char* buffer, size_t buffer_size);
@@ -147,6 +255,8 @@ struct AppendFileResponse {
   bool success;
   std::string error_message;
   uint64_t block_id;
+  uint64_t request_id;
+  uint32_t acks;                 // replicas known to hold the block, coordinator included
 
   size_t serialize(char* buffer, size_t buffer_size) const;
   static AppendFileResponse deserialize(const char* buffer, size_t buffer_size);
@@ -246,46 +356,268 @@ struct FileExistsResponse {
 };
 
 /**
- * Message to replicate a file block to a replica
+ * Chain replication: where the tail sends the APPEND_RESPONSE for a block
+ * (port 0 = the head already answered the client)
+ */
+struct ChainReply {
+  uint32_t client_ip = 0;    // host byte order
+  uint16_t client_port = 0;  // host byte order
+  uint64_t request_id = 0;   // the client's request
+  uint8_t needed = 0;        // copies the write's consistency level asks for
+};
+
+/**
+ * The blocks of one file in a replication batch, in append order
  */
-struct ReplicateBlockMessage {
+struct ReplicatedFile {
   std::string hydfs_filename;
-  FileBlock block;
+  uint64_t lsn = 0;  // head's LSN of the first block (0 = unsequenced); with no blocks,
+                     // the head skips the stream ahead to it
+  std::vector<FileBlock> blocks;
+  std::vector<ChainReply> replies;  // chain mode: one per block
+};
+
+/**
+ * Replication of appended blocks to a replica: the groups of one or more files, packed
+ * into one datagram. The replica applies the files in order, skips blocks it already
+ * holds, and stops at the first file it can't store
+ */
+struct ReplicateBlocksMessage {
+  uint64_t request_id;  // echoed in the ack (0 = a gap fill, not acked)
+  std::vector<ReplicatedFile> files;
+
+  NodeId head{};  // coordinator that numbered the blocks (and gets the tail's ack)
+
+  // Chain mode: each replica stores the batch and forwards it to the next hop; the tail
+  // answers the clients and acks the head. In star mode the receiver acks the sender
+  bool chained = false;
+  std::vector<NodeId> chain;   // hops still to forward to, the last one is the tail
+  uint32_t stored_by = 0;      // replicas that stored the batch before this hop
+
+  // Number of blocks across all files
+  size_t blockCount() const;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static ReplicateBlocksMessage deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Replica's acknowledgement of a replication batch
+ * Carries a high-water mark instead of the blocks: the replica holds the first
+ * `applied` blocks of the batch, counted across its files in order
+ */
+struct ReplicateBlocksAck {
+  uint64_t request_id;
+  uint32_t applied;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static ReplicateBlocksAck deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Replica's request to a head for the blocks of a file it never received, by LSN
+ * The head answers with REPLICATE_BLOCKS gap fills, or skips the stream past the range
+ * once it no longer has those blocks
+ */
+struct ReplicateGapRequest {
+  std::string hydfs_filename;
+  uint64_t from_lsn;   // first missing LSN
+  uint64_t to_lsn;     // LSN of the first block the replica already holds
 
   size_t serialize(char* buffer, size_t buffer_size) const;
-  static ReplicateBlockMessage deserialize(const char* buffer, size_t buffer_size);
+  static ReplicateGapRequest deserialize(const char* buffer, size_t buffer_size);
 };
 
 /**
- * Request for replica to send its blocks during merge
+ * Merge coordinator's request to a replica
+ * Asks for a summary of the replica's block list, one page of its block digest,
+ * or (if wanted_block_ids is non-empty) the payloads of specific blocks
  */
 struct CollectBlocksRequest {
   std::string hydfs_filename;
+  uint64_t request_id;                     // echoed in the response
+  bool summary_only;                       // only block count and list hash
+  uint32_t digest_from;                    // first block of the digest page
+  std::vector<uint64_t> wanted_block_ids;  // blocks to ship instead of a digest
 
   size_t serialize(char* buffer, size_t buffer_size) const;
   static CollectBlocksRequest deserialize(const char* buffer, size_t buffer_size);
 };
 
 /**
- * Response with blocks from replica during merge
+ * Replica's reply during merge: summary, plus a digest page or requested blocks
  */
 struct CollectBlocksResponse {
   std::string hydfs_filename;
-  std::vector<FileBlock> blocks;
+  uint64_t request_id;
+  bool found;                       // the replica holds the file
   uint32_t version;
+  uint32_t total_blocks;            // blocks in the replica's file
+  uint64_t list_hash;               // order-dependent hash of its block ID list
+  uint32_t digest_from;             // position of digests[0] in the file
+  std::vector<BlockDigest> digests;
+  std::vector<FileBlock> blocks;
 
   size_t serialize(char* buffer, size_t buffer_size) const;
   static CollectBlocksResponse deserialize(const char* buffer, size_t buffer_size);
 };
 
 /**
- * Coordinator sends merged block list to replicas
+ * Coordinator sends the merged block list to a replica, along with the blocks it lacks
+ * Large updates span several numbered pages with the same request_id; the replica
+ * stages them in any order and, on a commit page, either applies the merge or asks
+ * for the pages it is still missing
  */
 struct MergeUpdateMessage {
   std::string hydfs_filename;
-  std::vector<uint64_t> merged_block_ids;
+  uint64_t request_id;                     // echoed in the ack
   uint32_t new_version;
+  uint32_t page;                           // position of this page in the update
+  uint32_t page_count;
+  std::vector<uint64_t> merged_block_ids;  // this page's stretch of the merged list
+  std::vector<FileBlock> blocks;           // blocks of the merge the replica lacks
+  bool commit;                             // last page of a send: apply or report gaps
 
   size_t serialize(char* buffer, size_t buffer_size) const;
   static MergeUpdateMessage deserialize(const char* buffer, size_t buffer_size);
 };
+
+/**
+ * Replica's acknowledgement that it applied (or failed to apply) a merge update
+ * A replica still missing pages lists them (up to a cap) so only those are resent
+ */
+struct MergeUpdateAck {
+  std::string hydfs_filename;
+  uint64_t request_id;
+  bool success;
+  std::vector<uint32_t> missing_pages;     // empty unless pages are still owed
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static MergeUpdateAck deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Truncation point of a file whose expired prefix the coordinator dropped
+ * Receivers drop the leading blocks stamped at or before through_timestamp, which
+ * finds the cut however each replica compacted its blocks, and ack by request_id
+ */
+struct TruncateFileMessage {
+  std::string hydfs_filename;
+  uint64_t request_id;
+  uint64_t through_timestamp;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static TruncateFileMessage deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Replica's acknowledgement of a truncation point
+ */
+struct TruncateFileAck {
+  uint64_t request_id;
+  bool success;  // false if the replica doesn't hold the file
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static TruncateFileAck deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Sent by a replica to the holders of a live read lease when its copy of the file changes
+ */
+struct LeaseInvalidateMessage {
+  std::string hydfs_filename;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static LeaseInvalidateMessage deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Sent by a reader to the replicas that lost a hedged GET of a file; a replica that hasn't
+ * started on the request yet drops it instead of building and sending the file
+ */
+struct GetCancelMessage {
+  std::string hydfs_filename;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static GetCancelMessage deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Tells a node that left a file's replica set (e.g. after a join) to drop its copy
+ * The receiver keeps the file if its own ring view still makes it a replica
+ */
+struct DeleteFileMessage {
+  std::string hydfs_filename;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static DeleteFileMessage deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Anti-entropy: ask a co-replica for the Merkle hashes of one ring range
+ * Returns the hashes of nodes `indices` at `level`; with want_files (leaf level
+ * only) it also lists the files in those leaves
+ */
+struct MerkleRequest {
+  uint64_t request_id;               // echoed in the response
+  uint64_t range_start;              // ring range (range_start, range_end]
+  uint64_t range_end;
+  uint8_t level;                     // 0 is the root
+  bool want_files;
+  std::vector<uint32_t> indices;     // nodes within the level
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static MerkleRequest deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Digest of one file in a Merkle leaf (see FileVersion::digest)
+ */
+struct MerkleFileDigest {
+  std::string hydfs_filename;
+  uint64_t digest;
+};
+
+/**
+ * Co-replica's Merkle hashes for a MerkleRequest
+ */
+struct MerkleResponse {
+  uint64_t request_id;
+  std::vector<uint64_t> hashes;         // one per requested index
+  uint32_t leaves_complete;             // leading leaves whose files are all listed
+  std::vector<MerkleFileDigest> files;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static MerkleResponse deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * One block a replica missed, replayed by hinted handoff
+ */
+struct HintEntry {
+  std::string hydfs_filename;
+  FileBlock block;
+};
+
+/**
+ * Hinted handoff: a batch of blocks for a replica that was unreachable when they
+ * were appended, oldest first. Receivers skip blocks they already hold
+ */
+struct HintBatchMessage {
+  uint64_t request_id;             // echoed in the ack
+  std::vector<HintEntry> hints;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static HintBatchMessage deserialize(const char* buffer, size_t buffer_size);
+};
+
+/**
+ * Replica's acknowledgement of a hint batch
+ */
+struct HintBatchAck {
+  uint64_t request_id;
+  bool success;
+
+  size_t serialize(char* buffer, size_t buffer_size) const;
+  static HintBatchAck deserialize(const char* buffer, size_t buffer_size);
+};
@@ -1,19 +1,38 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <string>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
+#include "append_log.hpp"
+#include "bandwidth_throttle.hpp"
 #include "client_tracker.hpp"
 #include "consistent_hash_ring.hpp"
 #include "file_metadata.hpp"
+#include "file_sequencer.hpp"
 #include "file_store.hpp"
+#include "group_commit.hpp"
+#include "hinted_handoff.hpp"
+#include "intern_table.hpp"
+#include "latency_tracker.hpp"
 #include "logger.hpp"
+#include "merkle_tree.hpp"
 #include "message.hpp"
+#include "read_cache.hpp"
+#include "reorder_buffer.hpp"
+#include "replica_selector.hpp"
 #include "socket.hpp"
+#include "task_executor.hpp"
 
 /**
  * Handles all file operations for HyDFS
@@ -23,36 +42,108 @@ class FileOperationsHandler {
  public:
   FileOperationsHandler(FileStore& file_store, ConsistentHashRing& hash_ring,
                         const NodeId& self_id, Logger& logger, UDPSocketConnection& socket);
+  ~FileOperationsHandler();
 
   // Core file operations (called from CLI)
   bool createFile(const std::string& local_filename, const std::string& hydfs_filename);
-  bool getFile(const std::string& hydfs_filename, const std::string& local_filename);
-  bool appendFile(const std::string& local_filename, const std::string& hydfs_filename);
+  // ONE reads a single replica (this node's copy first); QUORUM and ALL wait for that many
+  // replicas and keep the union of their copies
+  bool getFile(const std::string& hydfs_filename, const std::string& local_filename,
+               ConsistencyLevel level = ConsistencyLevel::ONE);
+  bool getFileSince(const std::string& hydfs_filename, const std::string& local_filename,
+                    uint64_t since_timestamp, uint64_t since_block_id);
+  // ONE returns once the request is sent; QUORUM and ALL wait for the coordinator to report
+  // that many replicas hold the block
+  bool appendFile(const std::string& local_filename, const std::string& hydfs_filename,
+                  ConsistencyLevel level = ConsistencyLevel::ONE);
   bool mergeFile(const std::string& hydfs_filename);
 
   // Response handlers
   void handleGetResponse(const GetFileResponse& resp, const std::string& local_filename);
+  void handleGetSinceResponse(const GetSinceResponse& resp, const std::string& local_filename);
 
   // Query operations
   void listFileLocations(const std::string& hydfs_filename);
   void listLocalFiles();
   void catLocalFile(const std::string& local_filename);
+  // vm_address is host:port, or "best" for the replica expected to answer fastest
   bool getFileFromReplica(const std::string& vm_address, const std::string& hydfs_filename,
                           const std::string& local_filename);
 
+  // Store image operations (empty path means the store's default image)
+  void saveStoreImage(const std::string& image_path);
+  void loadStoreImage(const std::string& image_path);
+
+  // Retention (empty prefix means every file)
+  void setRetentionPolicy(const std::string& prefix, const RetentionPolicy& policy);
+  void listRetentionPolicies() const;
+
+  // Send a local truncation point to the other replicas if we coordinate the file,
+  // resending it in the background to replicas that don't ack
+  void propagateTruncation(const std::string& hydfs_filename, uint64_t cut_timestamp);
+
+  // Copy a local file to a replica that lacks it (re-replication); true once it acked
+  bool transferFile(const std::string& hydfs_filename, const NodeId& target);
+
+  // Tell a node that is no longer a replica of a file to drop its copy (rebalancing)
+  void dropReplica(const std::string& hydfs_filename, const NodeId& target);
+
+  // Queue writes for unreachable replicas here (set once, before messages flow)
+  void setHintedHandoff(HintedHandoff* hints) { hints_ = hints; }
+
+  // Pace merge and transfer pages through a throttle shared with the rebalancer (set once,
+  // before messages flow; null sends unpaced)
+  void setTransferThrottle(std::shared_ptr<BandwidthThrottle> throttle) {
+    transfer_throttle_ = std::move(throttle);
+  }
+
+  // Hedged GETs: ask a second replica once the first is slower than this percentile of
+  // recent GET latency (0 disables hedging)
+  void setHedgePercentile(double percentile) { hedge_percentile_ = percentile; }
+  double getHedgePercentile() const { return hedge_percentile_; }
+
+  // Chain replication of appends: this node, as head, forwards each group to the second
+  // replica, which forwards it to the tail; the tail answers QUORUM and ALL appends and
+  // serves this node's single-replica reads first. Off means star replication
+  void setChainReplication(bool enabled) { chain_replication_ = enabled; }
+  bool isChainReplication() const { return chain_replication_; }
+
+  // Per-peer latency estimates that order replicas for reads (also fed by ping/ack RTTs)
+  ReplicaSelector& getReplicaSelector() { return replica_selector_; }
+
+  ReadCache::Stats getReadCacheStats() const { return read_cache_.stats(); }
+
+  // Send a batch of hinted blocks to a replica that is reachable again; true once it acked
+  bool replayHints(const NodeId& target, const std::vector<HintedHandoff::Hint>& hints);
+
+  // Anti-entropy round: compare the ring range we coordinate with each co-replica's
+  // Merkle tree and merge every file that differs. Returns the number of files repaired
+  size_t runAntiEntropy();
+
+  // Fail the QUORUM and ALL appends whose replica acks did not arrive in time; run
+  // periodically so the client hears back on time. Returns the number failed
+  size_t expireWrites();
+
   // Message handlers (called when receiving network messages)
   void handleCreateRequest(const CreateFileRequest& req, const struct sockaddr_in& sender);
   void handleGetRequest(const GetFileRequest& req, const struct sockaddr_in& sender);
+  void handleGetCancel(const GetCancelMessage& msg, const struct sockaddr_in& sender);
+  void handleGetSinceRequest(const GetSinceRequest& req, const struct sockaddr_in& sender);
   void handleAppendRequest(const AppendFileRequest& req, const struct sockaddr_in& sender);
   void handleMergeRequest(const MergeFileRequest& req, const struct sockaddr_in& sender);
   void handleLsRequest(const LsFileRequest& req, const struct sockaddr_in& sender);
   void handleListStoreRequest(const ListStoreRequest& req, const struct sockaddr_in& sender);
   void handleFileExistsRequest(const FileExistsRequest& req, const struct sockaddr_in& sender);
   void handleFileExistsResponse(const FileExistsResponse& resp);
-  void handleReplicateBlock(const ReplicateBlockMessage& msg, const struct sockaddr_in& sender);
+  void handleReplicateBlocks(const ReplicateBlocksMessage& msg, const struct sockaddr_in& sender);
+  void handleGapRequest(const ReplicateGapRequest& req, const struct sockaddr_in& sender);
   void handleCollectBlocksRequest(const CollectBlocksRequest& req,
                                   const struct sockaddr_in& sender);
-  void handleMergeUpdate(const MergeUpdateMessage& msg);
+  void handleMergeUpdate(const MergeUpdateMessage& msg, const struct sockaddr_in& sender);
+  void handleTruncateFile(const TruncateFileMessage& msg, const struct sockaddr_in& sender);
+  void handleMerkleRequest(const MerkleRequest& req, const struct sockaddr_in& sender);
+  void handleDeleteFile(const DeleteFileMessage& msg);
+  void handleHintBatch(const HintBatchMessage& msg, const struct sockaddr_in& sender);
 
   // Dispatch incoming file operation messages
   void handleFileMessage(FileMessageType type, const char* buffer, size_t buffer_size,
@@ -65,6 +156,9 @@ class FileOperationsHandler {
   Logger& logger_;
   UDPSocketConnection& socket_;
   ClientTracker client_tracker_;
+  InternTable& file_names_;  // the store's filename <-> FileId handles, for all maps below
+  HintedHandoff* hints_ = nullptr;  // owned by the node; null disables hinted handoff
+  std::shared_ptr<BandwidthThrottle> transfer_throttle_;
 
   // Helper: Load all files from test_files directory into local cache
   void loadTestFiles();
@@ -78,12 +172,104 @@ class FileOperationsHandler {
   // Helper: Get client ID string from NodeId
   std::string getClientId() const;
 
-  // Helper: Get next sequence number for this client
-  uint32_t getNextSequenceNum(const std::string& hydfs_filename);
+  // Helper: Handle of a filename we interned before (e.g. when sending a request), 0 if
+  // we never did; replies are matched with this so peers can't add names
+  FileId knownFileId(const std::string& hydfs_filename) const;
+
+  // Helper: Store the blocks of a GET_SINCE reply locally and print the next cursor
+  void storeBlocksSince(const std::string& local_filename, const std::vector<FileBlock>& blocks,
+                        bool anchor_found, bool more);
+
+  // The groups of one group-commit flush: each file commits on its own sequencer, and the
+  // last one to finish sends each replica the groups it holds in shared messages
+  struct CommitRound {
+    struct Committed {
+      std::vector<NodeId> others;  // replicas to send to; in chain mode the last is the tail
+      ReplicatedFile file;
+      std::vector<uint64_t> write_ids;  // per block, the write its ack counts toward
+    };
+    std::vector<Committed> files;  // in flush order
+    size_t remaining = 0;          // files still committing
+    bool chained = false;
+    std::mutex mtx;
+  };
+
+  // Helper: Queue each flushed group on its file's sequencer (called by the group committer)
+  void dispatchGroups(std::vector<GroupCommitter::Group>& groups);
+
+  // Helper: Commit one group: store it as one version, stamp its LSNs and answer the ONE
+  // appends; the replication is left in `committed`
+  void commitGroup(const GroupCommitter::Group& group, bool chained,
+                   CommitRound::Committed& committed);
+
+  // Helper: Send each replica (or chain) the committed groups it holds, packed together
+  void replicateRound(CommitRound& round);
+
+  // Helper: Send appended blocks to a replica, packed into messages that fit a datagram;
+  // write_ids holds, per block in order, the write its ack counts toward (0 = none). In
+  // chain mode hops is the whole chain, the first reachable hop gets the blocks and the
+  // tail acks; otherwise it holds the one replica
+  void replicateBlocks(const std::vector<NodeId>& hops, const std::vector<ReplicatedFile>& files,
+                       const std::vector<uint64_t>& write_ids, bool chained);
+
+  // Helper: Store a replication batch released in LSN order, skipping the blocks an
+  // earlier copy delivered, then ack it or pass it on
+  void applyReplicatedBatch(const ReorderBuffer::Batch& batch);
+
+  // Helper: Ask heads for the LSN ranges that held batches are waiting on
+  void requestGaps();
+
+  // Helper: Merge a file whose gap we could not resend, once per file at a time
+  void scheduleGapMerge(FileId file_id, const std::string& hydfs_filename);
+
+  // Helper: Chain mode: pass a stored batch to the next hop, or as the tail answer the
+  // clients and ack the head
+  void forwardChain(const ReplicateBlocksMessage& msg, uint32_t applied);
+
+  // Helper: Whether blocks can go to a replica now; false means they must become hints
+  bool canSendTo(const NodeId& replica) const;
+  void hintBlocks(const NodeId& replica, const std::vector<ReplicatedFile>& files);
+
+  // Helper: Count a replica's ack toward the writes of the first `applied` blocks it
+  // carried, answering each client once enough replicas hold its block
+  void recordWriteAck(uint64_t request_id, size_t applied = SIZE_MAX);
+
+  // Helper: Answer the clients of finished writes (success or not)
+  struct FinishedWrite;
+  void answerWrites(const std::vector<FinishedWrite>& finished);
+
+  // Helper: Send APPEND_RESPONSE to the client of an append
+  void sendAppendResponse(const struct sockaddr_in& client, uint64_t request_id, bool success,
+                          uint64_t block_id, uint32_t acks, const std::string& error);
+
+  // Helper: Time GET requests per replica; a reply is matched by sender address and file,
+  // and requests unanswered past the GET timeout count as slow replies
+  void trackGetSent(const NodeId& peer, const struct sockaddr_in& dest, FileId file_id);
+  void trackGetReply(const struct sockaddr_in& sender, FileId file_id);
+
+  // Helper: Drop a file's GETs still in flight once the read has its answer, so the losers
+  // of a hedge stop counting as outstanding, and tell their replicas not to send the file
+  void cancelGets(const std::string& hydfs_filename, FileId file_id);
+
+  // Helper: True if the requester cancelled its GET of a file after the GET arrived here
+  bool getCancelled(const struct sockaddr_in& requester, FileId file_id,
+                    std::chrono::steady_clock::time_point arrived);
+
+  // Helper: Check a GET reply against read-my-writes and store its data locally; a leased
+  // reply to a read sent at issued_at also goes into the read cache
+  bool storeGetResponse(const GetFileResponse& resp, const std::string& local_filename,
+                        std::chrono::steady_clock::time_point issued_at);
 
-  // Helper: Replicate block to successor nodes
-  bool replicateBlock(const std::string& hydfs_filename, const FileBlock& block,
-                      const std::vector<NodeId>& replicas);
+  // Helper: Lease a file we serve to a reader; returns the lease length in ms
+  uint32_t grantLease(FileId file_id, const struct sockaddr_in& reader);
+
+  // Helper: Tell the live lease holders of a file that changed here to drop their copies;
+  // safe to call under the store lock, as the messages go out later from the file's sequencer
+  void revokeLeases(const std::string& hydfs_filename);
+
+  // Helper: Read a file from enough replicas for the level and keep the union of their copies
+  bool getFileQuorum(const std::string& hydfs_filename, const std::string& local_filename,
+                     ConsistencyLevel level);
 
   // Helper: Send file message to a node
   bool sendFileMessage(FileMessageType type, const char* buffer, size_t buffer_size,
@@ -92,17 +278,89 @@ class FileOperationsHandler {
   // Helper: Am I the coordinator for this file?
   bool isCoordinator(const std::string& hydfs_filename) const;
 
-  // Tracking sequence numbers per file
-  std::unordered_map<std::string, uint32_t> sequence_numbers_;
-  std::mutex seq_mtx_;
+  // Helper: Merge the replicas of a file (run on the coordinator, never on the receive thread)
+  bool coordinateMerge(const std::string& hydfs_filename, uint32_t& new_version);
+
+  // Helper: Send COLLECT_BLOCKS_REQUEST to a replica and wait for its response
+  bool requestCollect(const NodeId& replica, CollectBlocksRequest& req,
+                      CollectBlocksResponse& resp);
+
+  // Helper: Fetch the digests of every block of a replica's copy, page by page
+  bool collectDigests(const NodeId& replica, const std::string& hydfs_filename,
+                      uint32_t total_blocks, std::vector<BlockDigest>& digests);
+
+  // Helper: Fetch blocks by ID from a replica
+  bool fetchBlocks(const NodeId& replica, const std::string& hydfs_filename,
+                   const std::vector<uint64_t>& block_ids, std::vector<FileBlock>& blocks);
+
+  // Helper: Send MERKLE_REQUEST to a co-replica and wait for its response
+  bool requestMerkle(const NodeId& peer, MerkleRequest& req, MerkleResponse& resp);
+
+  // Helper: Descend the Merkle trees of a ring range with a co-replica and collect the
+  // files whose digests differ
+  bool diffRange(const NodeId& peer, const RingRange& range, std::set<std::string>& differing);
+
+  // Helper: Send a merged block list (and the blocks it lacks) to a replica, wait for its ack
+  // and resend the pages it reports missing (TRANSFER_FILES carries the same pages when the
+  // replica is new to the file)
+  bool sendMergeUpdate(const NodeId& replica, const std::string& hydfs_filename,
+                       uint32_t new_version, const std::vector<uint64_t>& block_ids,
+                       const std::vector<FileBlock>& blocks,
+                       FileMessageType type = FileMessageType::MERGE_UPDATE);
 
-  // Tracking pending get requests (hydfs_filename -> local_filename)
-  std::unordered_map<std::string, std::string> pending_gets_;
+  // Helper: Queue a read repair of a file from a copy a read just returned, at most once
+  // per file every few seconds
+  void scheduleReadRepair(const std::string& hydfs_filename, uint32_t version,
+                          std::vector<FileBlock> blocks);
+
+  // Helper: Send each replica that lags a freshly read copy the blocks it lacks
+  // Returns the number of replicas repaired
+  size_t readRepair(const std::string& hydfs_filename, uint32_t version,
+                    const std::vector<FileBlock>& blocks);
+
+  // Tracking pending get requests (file_id -> local_filename)
+  std::unordered_map<FileId, std::string> pending_gets_;
   std::mutex pending_gets_mtx_;
   std::condition_variable get_cv_;
 
-  // Results of get requests (hydfs_filename -> success flag)
-  std::unordered_map<std::string, bool> get_results_;
+  // Results of get requests (file_id -> success flag)
+  std::unordered_map<FileId, bool> get_results_;
+
+  // When each pending get was sent, so a leased reply is cached for no longer than its lease
+  std::unordered_map<FileId, std::chrono::steady_clock::time_point> get_started_;
+
+  // Files read from other replicas, served locally while their leases hold
+  ReadCache read_cache_;
+
+  // Readers holding a lease on a file we serve (file_id -> holders)
+  struct LeaseHolder {
+    struct sockaddr_in reader;
+    std::chrono::steady_clock::time_point expiry;
+  };
+  std::unordered_map<FileId, std::vector<LeaseHolder>> leases_;
+  std::mutex leases_mtx_;
+
+  // Latency of recent remote GETs, for the hedge delay
+  LatencyTracker get_latency_;
+  std::atomic<double> hedge_percentile_{95.0};
+  std::atomic<bool> chain_replication_{false};
+
+  // GET requests awaiting a reply, for per-replica RTTs
+  struct InFlightGet {
+    NodeId peer;
+    in_addr_t ip;
+    in_port_t port;
+    FileId file_id;
+    std::chrono::steady_clock::time_point sent;
+  };
+  std::vector<InFlightGet> inflight_gets_;
+  std::mutex inflight_mtx_;
+  ReplicaSelector replica_selector_;
+
+  // When each requester last cancelled a GET of a file, by requester address and file
+  std::map<std::tuple<in_addr_t, in_port_t, FileId>, std::chrono::steady_clock::time_point>
+      cancelled_gets_;
+  std::mutex cancelled_gets_mtx_;
 
   // Tracking pending ls requests
   struct LsRequestState {
@@ -111,11 +369,87 @@ class FileOperationsHandler {
     std::unordered_map<std::string, FileExistsResponse> responses;  // vm_address -> response
     std::chrono::steady_clock::time_point start_time;
   };
-  std::unordered_map<std::string, LsRequestState> pending_ls_;  // hydfs_filename -> state
+  std::unordered_map<FileId, LsRequestState> pending_ls_;  // file_id -> state
   std::mutex pending_ls_mtx_;
   std::condition_variable ls_cv_;
 
   // Local file cache (files retrieved via 'get' or loaded from test_files/)
   std::unordered_map<std::string, std::vector<char>> local_file_cache_;
   std::mutex local_cache_mtx_;
+
+  // Merge, anti-entropy, hint replay and truncation exchanges: replies by request ID, empty
+  // until they arrive
+  std::atomic<uint64_t> next_request_id_{1};
+  std::unordered_map<uint64_t, std::optional<CollectBlocksResponse>> pending_collects_;
+  std::unordered_map<uint64_t, std::optional<bool>> pending_merge_acks_;
+  std::unordered_map<uint64_t, std::optional<MergeUpdateAck>> pending_merge_updates_;
+  std::unordered_map<uint64_t, std::optional<MerkleResponse>> pending_merkle_;
+  std::unordered_map<uint64_t, std::optional<AppendFileResponse>> pending_appends_;
+  std::unordered_map<uint64_t, std::vector<GetFileResponse>> pending_reads_;  // every reply
+  std::mutex merge_mtx_;
+  std::condition_variable merge_cv_;
+
+  // Merge updates being received page by page, in any order (file_id -> state)
+  struct StagedMerge {
+    uint64_t request_id = 0;
+    uint32_t page_count = 0;
+    std::map<uint32_t, std::vector<uint64_t>> block_ids;  // page -> its stretch of the list
+    std::vector<FileBlock> blocks;
+  };
+  std::unordered_map<FileId, StagedMerge> staged_merges_;
+  std::mutex staged_mtx_;
+
+  // Appends this node coordinates at QUORUM or ALL, waiting on replica acks (write ID -> state)
+  struct PendingWrite {
+    struct sockaddr_in client;
+    uint64_t client_request_id = 0;
+    uint64_t block_id = 0;
+    uint32_t needed = 0;
+    uint32_t acks = 0;
+    bool tail_replies = false;  // chain mode: the tail answers the client on success
+    std::chrono::steady_clock::time_point deadline;
+    std::vector<uint64_t> requests;  // replication requests carrying its block
+  };
+  struct FinishedWrite {
+    PendingWrite write;
+    bool success = false;
+  };
+  std::unordered_map<uint64_t, PendingWrite> pending_writes_;
+  // Replication request ID -> per block it carried, the write waiting on it (0 = none)
+  std::unordered_map<uint64_t, std::vector<uint64_t>> write_of_request_;
+  std::mutex writes_mtx_;
+
+  // Helper: Take a write out of pending_writes_ along with its routes; caller holds
+  // writes_mtx_
+  FinishedWrite finishWrite(std::unordered_map<uint64_t, PendingWrite>::iterator it,
+                            bool success);
+
+  // When each file was last read-repaired (file_id -> time)
+  std::unordered_map<FileId, std::chrono::steady_clock::time_point> last_read_repair_;
+  std::mutex read_repair_mtx_;
+
+  // Digests of the files we store, by ring position; kept current by the store
+  MerkleTree merkle_tree_;
+
+  // LSNs of the appends we coordinate, and the order we apply replicated batches in
+  AppendLog append_log_;
+  ReorderBuffer reorder_buffer_;
+  // Files merged because a replica's gap could no longer be resent (queued or running)
+  std::unordered_set<FileId> gap_merges_;
+  std::mutex gap_merges_mtx_;
+
+  // Batches concurrent appends into one store mutation and replication message per file
+  GroupCommitter group_commit_;
+
+  // Per-file mailboxes for appends and our own sequence numbers: a file's appends run in
+  // order, different files run in parallel on every core
+  TaskExecutor sequencer_executor_;
+  FileSequencer sequencer_;
+
+  // Serves GETs off the receive thread, so a cancel from the requester can overtake one
+  // still queued
+  TaskExecutor get_executor_;
+
+  // Runs merge coordination off the receive thread; declared last so it stops first
+  TaskExecutor executor_;
 };
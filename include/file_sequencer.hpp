@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "file_metadata.hpp"
+#include "task_executor.hpp"
+
+/**
+ * Per-file sequencers on a shared executor
+ * Each file gets a mailbox of tasks that run one at a time in the order they were
+ * posted, so work on one file stays strictly ordered. Mailboxes of different files
+ * drain on the executor's workers in parallel. A mailbox yields its worker after a
+ * budget of tasks so one hot file can't starve the others. Mailboxes are spread over
+ * lock shards by file ID, so posting never takes a global lock. A mailbox is dropped
+ * once it runs dry, so only files with work in flight hold one.
+ */
+class FileSequencer {
+ public:
+  using Task = std::function<void()>;
+
+  struct Stats {
+    size_t files = 0;    // files with queued or running tasks
+    size_t queued = 0;   // tasks waiting in mailboxes
+    size_t tasks = 0;    // tasks run
+    size_t drains = 0;   // times a mailbox was scheduled on the executor
+  };
+
+  explicit FileSequencer(TaskExecutor& executor, size_t shard_count = 16, size_t budget = 32);
+
+  FileSequencer(const FileSequencer&) = delete;
+  FileSequencer& operator=(const FileSequencer&) = delete;
+
+  // Queue a task behind the file's earlier tasks; runs it inline once the executor has
+  // shut down
+  void post(FileId file_id, Task task);
+
+  // Next sequence number of this node's own appends to the file
+  uint32_t nextSequence(FileId file_id);
+
+  Stats stats() const;
+
+ private:
+  struct Mailbox {
+    std::deque<Task> tasks;
+    bool scheduled = false;  // a drain is queued or running
+  };
+
+  struct Shard {
+    std::unordered_map<FileId, Mailbox> mailboxes;
+    std::unordered_map<FileId, uint32_t> next_sequence;  // outlives the file's mailbox
+    size_t tasks = 0;
+    size_t drains = 0;
+    mutable std::mutex mtx;
+  };
+
+  Shard& shardOf(FileId file_id) const;
+
+  // Run the file's queued tasks in order until the mailbox is empty or the budget is spent
+  void drain(FileId file_id);
+
+  // Queue a drain of the file's mailbox; false once the executor has shut down
+  bool resubmit(FileId file_id);
+
+  TaskExecutor& executor_;
+  size_t budget_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
@@ -1,12 +1,206 @@
 #pragma once
 
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+#include "chunked_vector.hpp"
 #include "file_block.hpp"
 #include "file_metadata.hpp"
+#include "flat_hash_map.hpp"
+#include "intern_table.hpp"
+
+/**
+ * Tuning knobs for folding small blocks into extents
+ */
+struct CompactionPolicy {
+  size_t small_block_bytes = 4096;       // blocks below this size are candidates
+  size_t max_extent_bytes = 1 << 20;     // never grow an extent past this size
+  uint64_t min_age_ms = 5000;            // only blocks older than this are stable
+  size_t min_run_blocks = 4;             // shortest run worth folding
+};
+
+/**
+ * Caps on how much of an append-only file a node keeps; 0 means no cap
+ * Once any cap is exceeded, whole blocks are dropped from the front of the file
+ */
+struct RetentionPolicy {
+  uint64_t max_age_ms = 0;  // drop blocks older than this
+  size_t max_bytes = 0;     // keep at most this many bytes
+  size_t max_blocks = 0;    // keep at most this many blocks
+
+  bool unlimited() const { return max_age_ms == 0 && max_bytes == 0 && max_blocks == 0; }
+};
+
+/**
+ * Fixed-size summary of a file, cheap to copy (no block list)
+ */
+struct FileStat {
+  uint64_t file_id = 0;
+  size_t total_size = 0;
+  uint32_t version = 0;
+  size_t block_count = 0;
+  uint64_t created_timestamp = 0;
+  uint64_t last_modified_timestamp = 0;
+};
+
+/**
+ * Small append packed into a file's inline arena instead of its own FileBlock
+ */
+struct InlineBlock {
+  uint64_t block_id;
+  uint64_t timestamp;
+  uint32_t sequence_num;
+  uint32_t client;  // index into FileVersion::clients
+  uint32_t chunk;   // index into FileVersion::chunks, counting dropped chunks
+  uint32_t offset;  // start of the payload within the chunk
+  uint32_t size;
+};
+
+/**
+ * Read-only view of one block of a version, whether standalone or inline
+ */
+struct BlockView {
+  uint64_t block_id;
+  const std::string* client_id;
+  uint32_t sequence_num;
+  uint64_t timestamp;
+  const char* data;
+  size_t size;
+  const FileBlock* block;  // the full block if stored standalone, nullptr if inline
+};
+
+/**
+ * Immutable snapshot of one version of a file
+ * Writers publish a new version instead of editing in place, so a reader that
+ * pinned a version can keep reading it without holding the store lock.
+ * Block lists are ChunkedVectors, so deriving the next version copies O(1) state
+ * no matter how many appends the file has.
+ *
+ * Inline payloads live back to back in fixed-capacity arena chunks shared between
+ * versions; a writer only fills bytes past `arena_used` of the last chunk, which
+ * no published version references, so readers never see a write.
+ */
+struct FileVersion {
+  static constexpr size_t INLINE_MAX_BYTES = 1024;            // payloads up to this size go inline
+  static constexpr size_t INLINE_MAX_CHUNK_BYTES = 64 * 1024;  // chunks double up to this size
+  static constexpr uint64_t LIST_HASH_SEED = 14695981039346656037ULL;  // FNV-1a offset basis
+  static constexpr uint64_t LIST_HASH_BASE = 1099511628211ULL;         // FNV prime
+
+  FileMetadata metadata;
+  ChunkedVector<std::shared_ptr<const FileBlock>> blocks;   // standalone blocks
+  ChunkedVector<InlineBlock> inline_blocks;                 // small appends
+  ChunkedVector<uint32_t> order;                            // file order, see INLINE_SLOT
+  ChunkedVector<std::shared_ptr<char[]>> chunks;            // inline payload arena
+  uint32_t arena_capacity = 0;                              // size of the last arena chunk
+  uint32_t arena_used = 0;                                  // bytes of it this version uses
+  ChunkedVector<uint64_t> time_index;  // running max block timestamp, in file order
+  uint32_t blocks_base = 0;            // slots dropped from the front of blocks
+  uint32_t inline_base = 0;            // slots dropped from the front of inline_blocks
+  uint32_t chunks_base = 0;            // chunks dropped from the front of chunks
+  uint64_t list_hash = 0;              // running hash of the block ID list, see listHash()
+  uint64_t content_hash = 0;           // hash of the appends it holds, see contentHash()
+  uint64_t truncated_through = 0;      // retention dropped the blocks stamped at or before
+  std::shared_ptr<const std::vector<std::string>> clients;  // client ids of inline blocks
+
+  // Add a block at the end, packing it inline if its payload is small
+  // Returns the stored block if it stayed standalone, nullptr if it went inline
+  std::shared_ptr<const FileBlock> appendBlock(FileBlock block);
+
+  // Add an already shared standalone block at the end
+  void appendShared(std::shared_ptr<const FileBlock> block);
+
+  // Add the i-th block of another version of the file at the end without copying its
+  // payload; an inline block keeps pointing into the arena chunk it was packed in
+  void carryOver(const FileVersion& from, size_t i);
+
+  // Drop the first count blocks in file order, releasing their storage once no
+  // other version shares it
+  void dropFront(size_t count);
+
+  // Number of blocks in file order
+  size_t blockCount() const { return order.size(); }
+
+  // View the i-th block in file order without copying it
+  BlockView blockAt(size_t i) const;
+
+  // Copy the i-th block in file order out of the snapshot
+  FileBlock copyBlock(size_t i) const;
+
+  // Describe the i-th block in file order without its payload
+  BlockDigest digestAt(size_t i) const;
+
+  // Order-dependent hash of the block ID list; equal lists hash equal. It is a polynomial
+  // in the mixed block IDs, so dropping a prefix subtracts just the dropped terms
+  uint64_t listHash() const { return list_hash; }
+
+  // List hash of a block ID list extended by one block (the empty list hashes to 0)
+  static uint64_t extendListHash(uint64_t hash, uint64_t block_id);
+
+  // Order-independent hash of the appends this version holds: the sum of one term per
+  // (client, sequence number), with an extent counting every append it folded. Equal
+  // however the blocks were compacted, so replicas with the same appends agree on it
+  uint64_t contentHash() const { return content_hash; }
+
+  // Content hash term of a block: its own append, or every append of an extent
+  static uint64_t appendsHash(const FileBlock& block);
+  static uint64_t appendsHash(const std::string& client_id, uint32_t sequence_num);
+
+  // Hash of file and content; replicas holding the same appends agree on it whatever
+  // their version numbers and however each compacted its blocks
+  uint64_t digest() const;
+
+  // The i-th block in file order if it is standalone, nullptr if inline
+  std::shared_ptr<const FileBlock> sharedAt(size_t i) const;
+
+  // Assemble the file contents from the blocks of this version
+  std::vector<char> assemble() const;
+
+  // Copy the blocks of this version out of the snapshot
+  std::vector<FileBlock> copyBlocks() const;
+
+  // True if retention already cut this file past a block stamped at timestamp, so merges
+  // and repairs must not bring the block back
+  bool truncatedAway(uint64_t timestamp) const {
+    return truncated_through > 0 && timestamp <= truncated_through;
+  }
+
+  // Position of the first block that is, or is followed by, a block stamped after timestamp;
+  // every block before it is stamped at or before timestamp
+  size_t firstAfter(uint64_t timestamp) const;
+
+  // Find the position of a block by ID, scanning from the most recent block
+  bool findBlock(uint64_t block_id, size_t& position) const;
+
+  // Blocks appended after since_block_id, stamped since_timestamp. If that append was
+  // folded into an extent, only the part of the extent after it comes first. If it isn't
+  // in this version at all (sets anchor_found = false), the blocks stamped after
+  // since_timestamp
+  std::vector<FileBlock> blocksSince(uint64_t since_timestamp, uint64_t since_block_id,
+                                     bool& anchor_found) const;
+
+  // Provenance ranges of all compacted extents in this version
+  std::vector<BlockRange> compactedRanges() const;
+
+  // Summary of this version
+  FileStat stat() const;
+
+ private:
+  static constexpr uint32_t INLINE_SLOT = 0x80000000u;  // order entry refers to inline_blocks
+
+  // Index of a client id in `clients`, adding it on first use
+  uint32_t internClient(const std::string& client_id);
+
+  // Extend the time index, the list hash and the content hash with the next block
+  void indexBlock(uint64_t block_id, uint64_t timestamp, uint64_t appends_hash);
+};
+
+using FileSnapshot = std::shared_ptr<const FileVersion>;
 
 /**
  * Local file storage for HyDFS
@@ -17,11 +211,17 @@ class FileStore {
   explicit FileStore(const std::string& storage_dir);
 
   // Create a new file with initial data
+  // Replicas of one CREATE pass the creator's timestamp (0 = now) so the first block gets
+  // the same ID everywhere and merges see one block, not one per replica
   bool createFile(const std::string& filename, const std::vector<char>& data,
-                  const std::string& client_id);
+                  const std::string& client_id, uint64_t timestamp = 0);
 
   // Append a block to an existing file
   bool appendBlock(const std::string& filename, const FileBlock& block);
+  bool appendBlock(FileId file_id, const FileBlock& block);
+
+  // Append several blocks in order as one new version (group commit)
+  bool appendBlocks(FileId file_id, const std::vector<FileBlock>& group);
 
   // Get entire file contents (assembled from blocks)
   std::vector<char> getFile(const std::string& filename) const;
@@ -32,29 +232,135 @@ class FileStore {
   // Get metadata for a file
   FileMetadata getFileMetadata(const std::string& filename) const;
 
+  // Pin the current version of a file (nullptr if the file doesn't exist)
+  // This is the "open" call: the snapshot is a handle for reads and stat()
+  FileSnapshot pinFile(const std::string& filename) const;
+  FileSnapshot pinFile(FileId file_id) const;
+
+  // Look up size, version, block count and timestamps with one lookup
+  bool statFile(const std::string& filename, FileStat& stat) const;
+  bool statFile(FileId file_id, FileStat& stat) const;
+
+  // Stat every file stored locally under a single lock
+  std::vector<std::pair<std::string, FileStat>> listFileStats() const;
+
+  // Get file contents as of an older version, if some reader still pins it
+  bool getFileAtVersion(const std::string& filename, uint32_t version,
+                        std::vector<char>& data) const;
+
+  // Forget retired versions that no reader holds any more
+  // Returns the number of versions dropped
+  size_t collectGarbage();
+
   // Check if file exists
   bool hasFile(const std::string& filename) const;
 
   // Get list of all files stored locally
   std::vector<std::string> listFiles() const;
 
+  // Local handles of the file names this store has seen; the FileId overloads take these
+  InternTable& fileNames() { return file_names; }
+
   // Merge file blocks from multiple replicas
   bool mergeFile(const std::string& filename, std::vector<FileBlock>& all_blocks);
 
+  // Install the merged block order of a file, taking blocks from the current version
+  // or from incoming. Blocks appended since the merge was planned that aren't in the
+  // list (and aren't covered by a merged extent) stay at the end. Creates the file if
+  // needed; fails without changing anything if a listed block is unavailable
+  bool applyMerge(const std::string& filename, const std::vector<uint64_t>& block_ids,
+                  const std::vector<FileBlock>& incoming, uint32_t version);
+
   // Delete a file and all its blocks
   bool deleteFile(const std::string& filename);
 
   // Delete all files (used when node rejoins)
   void clearAllFiles();
 
-  // Store a complete file (metadata + blocks) - used for replication
+  // Store a complete file (metadata + blocks) - used for replication. Blocks the metadata
+  // lists but doesn't ship must be in the current version; the store fails otherwise
   bool storeFile(const FileMetadata& metadata, const std::vector<FileBlock>& blocks);
 
+  // Fold runs of small, stable adjacent blocks of a file into extents
+  // Returns the number of blocks that were folded away
+  size_t compactFile(const std::string& filename, const CompactionPolicy& policy);
+
+  // Set the retention rule for files whose name starts with prefix ("" matches every file);
+  // the longest matching prefix wins, and an unlimited policy removes the rule
+  void setRetentionPolicy(const std::string& prefix, const RetentionPolicy& policy);
+
+  // Retention rule that applies to a file (unlimited if none matches)
+  RetentionPolicy getRetentionPolicy(const std::string& filename) const;
+
+  // All retention rules, keyed by prefix
+  std::map<std::string, RetentionPolicy> listRetentionPolicies() const;
+
+  // Drop the prefix of a file that its retention rule expires as of now_ms
+  // Returns the number of blocks dropped and sets the timestamp the cut was made at
+  size_t applyRetention(const std::string& filename, uint64_t now_ms, uint64_t& cut_timestamp);
+
+  // Drop the leading blocks stamped at or before timestamp (a truncation point from the
+  // coordinator) and remember the cut so merges don't restore them
+  // Returns the number of blocks dropped
+  size_t truncateThrough(const std::string& filename, uint64_t timestamp);
+
+  // Get provenance ranges of all compacted extents in a file
+  std::vector<BlockRange> getCompactedRanges(const std::string& filename) const;
+
+  // Dump every file into one checksummed image (point-in-time across the store)
+  bool saveImage(const std::string& path) const;
+
+  // Replace the store contents with the files in an image written by saveImage
+  bool loadImage(const std::string& path);
+
+  // Image path the node seeds itself from at startup
+  std::string getImagePath() const;
+
+  // Called with a file's new current version whenever it changes, or nullptr once the
+  // file is gone. Runs under the store lock, so it must not call back into the store
+  using ChangeListener = std::function<void(const std::string&, const FileSnapshot&)>;
+  void setChangeListener(ChangeListener listener);
+
  private:
-  std::string storage_dir;                                    // directory for file storage
-  std::unordered_map<std::string, FileMetadata> files;        // filename -> metadata
-  std::unordered_map<uint64_t, FileBlock> blocks;             // block_id -> block
-  mutable std::shared_mutex mtx;                              // thread safety
+  /**
+   * Current version of a file plus the retired versions readers may still pin
+   */
+  struct FileEntry {
+    FileSnapshot current;
+    std::map<uint32_t, std::weak_ptr<const FileVersion>> retired;  // version -> snapshot
+  };
+
+  std::string storage_dir;                                         // directory for file storage
+  InternTable file_names;                                          // filename <-> file_id
+  FlatHashMap<FileId, FileEntry> files;                            // file_id -> versions
+  FlatHashMap<uint64_t, std::shared_ptr<const FileBlock>> blocks;  // block_id -> block
+  std::map<std::string, RetentionPolicy> retention_rules;         // prefix -> policy
+  mutable std::shared_mutex mtx;  // guards the indexes; held only to pin or publish
+  // Writers of a file hold its stripe while they build the next version, so writers of
+  // different files run in parallel; whole-store changes hold every stripe
+  std::array<std::mutex, 64> write_mtx;
+  ChangeListener on_change;       // guarded by mtx
+
+  // Helper: writer lock stripe of a file
+  std::mutex& writerOf(FileId file_id);
+
+  // Helper: hold every writer stripe
+  std::vector<std::unique_lock<std::mutex>> lockAllWriters();
+
+  // Helper: drop the removed blocks from the block index and add the new ones, leaving the
+  // blocks both versions share alone (caller holds mtx)
+  using SharedBlocks = std::vector<std::shared_ptr<const FileBlock>>;
+  void reindexBlocks(const SharedBlocks& removed, const SharedBlocks& added);
+
+  // Helper: install a new current version, retiring the previous one (caller holds mtx)
+  void publishVersion(FileEntry& entry, FileSnapshot next);
+
+  // Helper: publish a version without the first count blocks, cut through timestamp
+  // (caller holds the writer lock)
+  size_t dropPrefix(const FileSnapshot& current, size_t count, uint64_t timestamp);
+
+  // Helper: drop retired versions nobody pins any more (caller holds mtx)
+  static size_t pruneRetired(FileEntry& entry);
 
   // Helper: persist metadata to disk
   void persistMetadata(const std::string& filename);
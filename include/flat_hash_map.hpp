@@ -0,0 +1,409 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Open-addressing hash map in the style of Swiss tables
+ * Entries live inline in one flat slot array. A parallel array of one-byte
+ * control tags (7 bits of the hash, or empty/deleted) is probed a group of
+ * 16 slots at a time, so most lookups touch one cache line of tags and one slot.
+ *
+ * Iterators and references are invalidated by any insertion that grows the table.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class FlatHashMap {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<const K, V>;
+  using size_type = size_t;
+
+ private:
+  using ctrl_t = int8_t;
+
+  static constexpr ctrl_t kEmpty = -128;   // 0b10000000
+  static constexpr ctrl_t kDeleted = -2;   // 0b11111110
+  static constexpr ctrl_t kSentinel = -1;  // never stored, only used for comparisons
+  static constexpr size_t kGroupWidth = 16;
+  static constexpr size_t kMinCapacity = 16;
+
+  // A window of kGroupWidth control bytes, matched with SSE2 when available
+  struct Group {
+    explicit Group(const ctrl_t* pos) {
+#if defined(__SSE2__)
+      ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+#else
+      std::memcpy(ctrl, pos, kGroupWidth);
+#endif
+    }
+
+    // Bitmask of slots whose tag equals h2
+    uint32_t match(ctrl_t h2) const {
+#if defined(__SSE2__)
+      return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+#else
+      uint32_t mask = 0;
+      for (size_t i = 0; i < kGroupWidth; ++i) {
+        if (ctrl[i] == h2) mask |= (1u << i);
+      }
+      return mask;
+#endif
+    }
+
+    uint32_t matchEmpty() const { return match(kEmpty); }
+
+    // Bitmask of slots that can take a new entry (empty or tombstone)
+    uint32_t matchEmptyOrDeleted() const {
+#if defined(__SSE2__)
+      return static_cast<uint32_t>(
+          _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(kSentinel), ctrl)));
+#else
+      uint32_t mask = 0;
+      for (size_t i = 0; i < kGroupWidth; ++i) {
+        if (ctrl[i] < kSentinel) mask |= (1u << i);
+      }
+      return mask;
+#endif
+    }
+
+#if defined(__SSE2__)
+    __m128i ctrl;
+#else
+    ctrl_t ctrl[kGroupWidth];
+#endif
+  };
+
+  static int lowestBit(uint32_t mask) { return __builtin_ctz(mask); }
+  static bool isFull(ctrl_t c) { return c >= 0; }
+
+  // Finalizer from MurmurHash3 so weak std::hash values (identity on integers)
+  // still spread over both the probe start (h1) and the tag (h2)
+  static size_t mix(size_t h) {
+    uint64_t x = static_cast<uint64_t>(h);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return static_cast<size_t>(x);
+  }
+  static size_t h1(size_t hash) { return hash >> 7; }
+  static ctrl_t h2(size_t hash) { return static_cast<ctrl_t>(hash & 0x7F); }
+
+  template <bool Const>
+  class Iter {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = FlatHashMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<Const, const value_type&, value_type&>;
+    using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+    Iter() = default;
+
+    // Allow iterator -> const_iterator conversion
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    Iter(const Iter<false>& other) : ctrl_(other.ctrl_), slot_(other.slot_), end_(other.end_) {}
+
+    reference operator*() const { return *slot_; }
+    pointer operator->() const { return slot_; }
+
+    Iter& operator++() {
+      ++ctrl_;
+      ++slot_;
+      skipEmpty();
+      return *this;
+    }
+    Iter operator++(int) {
+      Iter tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    friend bool operator==(const Iter& a, const Iter& b) { return a.ctrl_ == b.ctrl_; }
+    friend bool operator!=(const Iter& a, const Iter& b) { return a.ctrl_ != b.ctrl_; }
+
+   private:
+    friend class FlatHashMap;
+    template <bool>
+    friend class Iter;
+
+    Iter(const ctrl_t* ctrl, pointer slot, const ctrl_t* end) : ctrl_(ctrl), slot_(slot), end_(end) {
+      skipEmpty();
+    }
+
+    void skipEmpty() {
+      while (ctrl_ != end_ && !isFull(*ctrl_)) {
+        ++ctrl_;
+        ++slot_;
+      }
+    }
+
+    const ctrl_t* ctrl_ = nullptr;
+    pointer slot_ = nullptr;
+    const ctrl_t* end_ = nullptr;
+  };
+
+ public:
+  using iterator = Iter<false>;
+  using const_iterator = Iter<true>;
+
+  FlatHashMap() = default;
+
+  FlatHashMap(const FlatHashMap& other) {
+    reserve(other.size_);
+    for (const auto& entry : other) emplace(entry.first, entry.second);
+  }
+
+  FlatHashMap(FlatHashMap&& other) noexcept { swap(other); }
+
+  FlatHashMap& operator=(const FlatHashMap& other) {
+    if (this != &other) {
+      FlatHashMap tmp(other);
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  FlatHashMap& operator=(FlatHashMap&& other) noexcept {
+    if (this != &other) {
+      clear();
+      swap(other);
+    }
+    return *this;
+  }
+
+  ~FlatHashMap() { destroyAll(); }
+
+  void swap(FlatHashMap& other) noexcept {
+    std::swap(ctrl_, other.ctrl_);
+    std::swap(slots_, other.slots_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(size_, other.size_);
+    std::swap(growth_left_, other.growth_left_);
+  }
+
+  // ===== Iteration =====
+  iterator begin() { return iterator(ctrl_, slots_, ctrl_ + capacity_); }
+  iterator end() { return iterator(ctrl_ + capacity_, slots_ + capacity_, ctrl_ + capacity_); }
+  const_iterator begin() const { return const_iterator(ctrl_, slots_, ctrl_ + capacity_); }
+  const_iterator end() const {
+    return const_iterator(ctrl_ + capacity_, slots_ + capacity_, ctrl_ + capacity_);
+  }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  // ===== Capacity =====
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+
+  void reserve(size_t count) {
+    size_t needed = capacityFor(count);
+    if (needed > capacity_) rehash(needed);
+  }
+
+  void clear() {
+    destroyAll();
+    ctrl_ = nullptr;
+    slots_ = nullptr;
+    capacity_ = 0;
+    size_ = 0;
+    growth_left_ = 0;
+  }
+
+  // ===== Lookup =====
+  iterator find(const K& key) {
+    size_t idx = findIndex(key);
+    return idx == npos ? end() : iteratorAt(idx);
+  }
+
+  const_iterator find(const K& key) const {
+    size_t idx = findIndex(key);
+    return idx == npos ? end() : const_iterator(ctrl_ + idx, slots_ + idx, ctrl_ + capacity_);
+  }
+
+  bool contains(const K& key) const { return findIndex(key) != npos; }
+  size_t count(const K& key) const { return contains(key) ? 1 : 0; }
+
+  V& operator[](const K& key) { return try_emplace(key).first->second; }
+
+  // ===== Modifiers =====
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+    size_t hash = mix(Hash{}(key));
+    size_t idx = findIndex(key, hash);
+    if (idx != npos) return {iteratorAt(idx), false};
+
+    idx = prepareInsert(hash);
+    ::new (static_cast<void*>(slots_ + idx))
+        value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+    return {iteratorAt(idx), true};
+  }
+
+  template <typename KeyArg, typename ValueArg>
+  std::pair<iterator, bool> emplace(KeyArg&& key, ValueArg&& value) {
+    return try_emplace(K(std::forward<KeyArg>(key)), std::forward<ValueArg>(value));
+  }
+
+  std::pair<iterator, bool> insert(const value_type& entry) {
+    return try_emplace(entry.first, entry.second);
+  }
+
+  template <typename ValueArg>
+  std::pair<iterator, bool> insert_or_assign(const K& key, ValueArg&& value) {
+    auto result = try_emplace(key, std::forward<ValueArg>(value));
+    if (!result.second) result.first->second = std::forward<ValueArg>(value);
+    return result;
+  }
+
+  size_t erase(const K& key) {
+    size_t idx = findIndex(key);
+    if (idx == npos) return 0;
+    eraseAt(idx);
+    return 1;
+  }
+
+  iterator erase(const_iterator pos) {
+    size_t idx = static_cast<size_t>(pos.ctrl_ - ctrl_);
+    eraseAt(idx);
+    return iterator(ctrl_ + idx + 1, slots_ + idx + 1, ctrl_ + capacity_);
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+ private:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  // Keep the table at most 7/8 full
+  static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+  static size_t capacityFor(size_t count) {
+    size_t capacity = kMinCapacity;
+    while (maxLoad(capacity) < count) capacity *= 2;
+    return capacity;
+  }
+
+  iterator iteratorAt(size_t idx) { return iterator(ctrl_ + idx, slots_ + idx, ctrl_ + capacity_); }
+
+  // Write a control byte, keeping the cloned tail in sync so that a group
+  // starting near the end of the table can be loaded without wrapping
+  void setCtrl(size_t idx, ctrl_t value) {
+    ctrl_[idx] = value;
+    if (idx < kGroupWidth) ctrl_[capacity_ + idx] = value;
+  }
+
+  size_t findIndex(const K& key) const { return findIndex(key, mix(Hash{}(key))); }
+
+  size_t findIndex(const K& key, size_t hash) const {
+    if (capacity_ == 0) return npos;
+    const size_t mask = capacity_ - 1;
+    size_t offset = h1(hash) & mask;
+    size_t step = 0;
+    const ctrl_t tag = h2(hash);
+    while (true) {
+      Group group(ctrl_ + offset);
+      for (uint32_t bits = group.match(tag); bits != 0; bits &= bits - 1) {
+        size_t idx = (offset + lowestBit(bits)) & mask;
+        if (Eq{}(slots_[idx].first, key)) return idx;
+      }
+      if (group.matchEmpty() != 0) return npos;
+      step += kGroupWidth;
+      offset = (offset + step) & mask;
+    }
+  }
+
+  // First slot on the probe sequence that is empty or a tombstone
+  size_t findFirstNonFull(size_t hash) const {
+    const size_t mask = capacity_ - 1;
+    size_t offset = h1(hash) & mask;
+    size_t step = 0;
+    while (true) {
+      Group group(ctrl_ + offset);
+      uint32_t bits = group.matchEmptyOrDeleted();
+      if (bits != 0) return (offset + lowestBit(bits)) & mask;
+      step += kGroupWidth;
+      offset = (offset + step) & mask;
+    }
+  }
+
+  // Reserve a slot for a key known to be absent and tag it
+  size_t prepareInsert(size_t hash) {
+    if (capacity_ == 0) rehash(kMinCapacity);
+    size_t idx = findFirstNonFull(hash);
+    if (growth_left_ == 0 && ctrl_[idx] != kDeleted) {
+      // Out of empty slots: purge tombstones in place if that frees enough
+      // room, otherwise double
+      rehash(size_ * 2 < maxLoad(capacity_) ? capacity_ : capacity_ * 2);
+      idx = findFirstNonFull(hash);
+    }
+    if (ctrl_[idx] == kEmpty) --growth_left_;
+    setCtrl(idx, h2(hash));
+    ++size_;
+    return idx;
+  }
+
+  void eraseAt(size_t idx) {
+    slots_[idx].~value_type();
+    setCtrl(idx, kDeleted);
+    --size_;
+  }
+
+  void rehash(size_t new_capacity) {
+    ctrl_t* old_ctrl = ctrl_;
+    value_type* old_slots = slots_;
+    size_t old_capacity = capacity_;
+
+    ctrl_ = new ctrl_t[new_capacity + kGroupWidth];
+    std::memset(ctrl_, kEmpty, new_capacity + kGroupWidth);
+    slots_ = std::allocator<value_type>().allocate(new_capacity);
+    capacity_ = new_capacity;
+    growth_left_ = maxLoad(new_capacity);
+    size_ = 0;
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+      if (!isFull(old_ctrl[i])) continue;
+      size_t hash = mix(Hash{}(old_slots[i].first));
+      size_t idx = findFirstNonFull(hash);
+      setCtrl(idx, h2(hash));
+      ::new (static_cast<void*>(slots_ + idx)) value_type(std::move(old_slots[i]));
+      old_slots[i].~value_type();
+      --growth_left_;
+      ++size_;
+    }
+
+    if (old_ctrl != nullptr) {
+      delete[] old_ctrl;
+      std::allocator<value_type>().deallocate(old_slots, old_capacity);
+    }
+  }
+
+  void destroyAll() {
+    if (ctrl_ == nullptr) return;
+    for (size_t i = 0; i < capacity_; ++i) {
+      if (isFull(ctrl_[i])) slots_[i].~value_type();
+    }
+    delete[] ctrl_;
+    std::allocator<value_type>().deallocate(slots_, capacity_);
+  }
+
+  ctrl_t* ctrl_ = nullptr;        // capacity_ + kGroupWidth control bytes
+  value_type* slots_ = nullptr;   // capacity_ slots, constructed only where ctrl is full
+  size_t capacity_ = 0;           // always 0 or a power of two >= kMinCapacity
+  size_t size_ = 0;               // number of live entries
+  size_t growth_left_ = 0;        // empty slots left before the next rehash
+};
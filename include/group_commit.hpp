@@ -0,0 +1,104 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "file_block.hpp"
+#include "file_metadata.hpp"
+
+/**
+ * Coordinator-side group commit of appends
+ * Appends to one file that arrive within a short window are collected into a group and
+ * committed together: one store mutation and one replication message per replica
+ * instead of one of each per append. A group is flushed once its window has passed or
+ * it reaches the size cap; the groups of all files that are due flush together, so
+ * their replication can share datagrams. Due groups are handed to the flush function
+ * one flush at a time, oldest first, so a file's groups reach it in the order their
+ * appends arrived; the flush function only queues the commits (e.g. on per-file
+ * sequencers), so different files commit in parallel.
+ */
+class GroupCommitter {
+ public:
+  struct Append {
+    FileBlock block;
+    struct sockaddr_in client;
+    uint64_t request_id = 0;  // the client's request, echoed in its APPEND_RESPONSE
+    ConsistencyLevel consistency = ConsistencyLevel::ONE;
+  };
+
+  struct Group {
+    std::string hydfs_filename;
+    FileId file_id = 0;
+    std::vector<Append> appends;  // in arrival order
+  };
+
+  // Hand off the groups that are due, oldest first; flushes hand off one at a time, so it
+  // should only queue the commits, not run them
+  using FlushFn = std::function<void(std::vector<Group>&)>;
+
+  struct Stats {
+    size_t groups = 0;   // groups flushed
+    size_t appends = 0;  // appends flushed
+  };
+
+  // Encoded block bytes per group, so a group fits one replication datagram
+  static constexpr size_t kGroupBytes = 6000;
+
+  GroupCommitter(FlushFn flush,
+                 std::chrono::microseconds window = std::chrono::milliseconds(2),
+                 size_t max_bytes = kGroupBytes, size_t max_appends = 64);
+  ~GroupCommitter();
+
+  // Start and stop the background flusher; stop() flushes the groups still queued
+  void start();
+  void stop();
+
+  // Queue an append behind the file's earlier appends
+  void add(const std::string& hydfs_filename, FileId file_id, Append append);
+
+  // Flush the groups that are due (all of them if `all`)
+  // Returns the number of appends flushed
+  size_t runOnce(bool all = false);
+
+  Stats stats() const;
+
+ private:
+  struct Pending {
+    Group group;
+    size_t bytes = 0;
+    std::chrono::steady_clock::time_point deadline;
+    bool sealed = false;  // full: flush without waiting for the window
+  };
+
+  void run();
+
+  FlushFn flush_;
+  std::chrono::microseconds window_;
+  size_t max_bytes_;
+  size_t max_appends_;
+
+  std::list<Pending> groups_;  // oldest first
+  std::unordered_map<FileId, std::list<Pending>::iterator> open_;  // file -> group taking appends
+  bool sealed_ = false;  // some queued group is full
+  std::mutex handoff_mtx_;  // one hand-off at a time, so a file's groups are queued in order
+
+  std::atomic<size_t> groups_flushed_{0};
+  std::atomic<size_t> appends_flushed_{0};
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  mutable std::mutex mtx_;  // guards groups_, open_ and sealed_
+  std::condition_variable cv_;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "file_block.hpp"
+#include "message.hpp"
+
+/**
+ * Hinted handoff for appends a replica missed while it was unreachable
+ * The coordinator keeps each block it could not deliver in a queue for that replica,
+ * appended to a log under hint_dir so the hints survive a restart. A block sent to a
+ * live replica that is not acknowledged in time becomes a hint too, and new blocks
+ * queue behind existing hints so the replica receives them in order. Once the replica
+ * is reachable again its hints are replayed oldest first, in batches that fit one
+ * datagram, paced to a bandwidth cap.
+ */
+class HintedHandoff {
+ public:
+  struct Hint {
+    std::string hydfs_filename;
+    FileBlock block;
+  };
+
+  // Deliver a batch of hints to a replica in order; true once it applied all of them
+  using DeliverFn = std::function<bool(const NodeId&, const std::vector<Hint>&)>;
+  // Whether a replica is reachable (alive and not suspected)
+  using LivenessFn = std::function<bool(const NodeId&)>;
+  // Run on every pass once expired acks have become hints
+  using ExpireFn = std::function<void()>;
+
+  struct Progress {
+    size_t pending = 0;       // hints waiting for their replica
+    size_t awaiting_ack = 0;  // blocks sent but not yet acknowledged
+    size_t replayed = 0;
+    size_t dropped = 0;       // over the queue cap or too large to replay
+  };
+
+  // Encoded size of the hints in one replay batch (fits an 8 KB datagram)
+  static constexpr size_t kBatchBytes = 7000;
+
+  HintedHandoff(const std::string& hint_dir, DeliverFn deliver, LivenessFn is_alive,
+                uint64_t bytes_per_sec = 1024 * 1024,
+                std::chrono::milliseconds interval = std::chrono::seconds(1),
+                std::chrono::milliseconds ack_timeout = std::chrono::seconds(2),
+                size_t max_queue_bytes = 64 * 1024 * 1024);
+  ~HintedHandoff();
+
+  // Start and stop the background replay thread
+  void start();
+  void stop();
+
+  bool isAlive(const NodeId& replica) const { return is_alive_(replica); }
+
+  // True if the replica has hints queued (new blocks must queue behind them)
+  bool hasHints(const NodeId& replica) const;
+
+  // Queue a block for a replica that can't take it now; false if it was dropped
+  bool addHint(const NodeId& replica, const std::string& hydfs_filename, const FileBlock& block);
+
+  // Track blocks sent to a replica under the request ID their ack will carry; they become
+  // hints unless acknowledge(request_id) is called within the ack timeout
+  void expectAck(uint64_t request_id, const NodeId& replica, std::vector<Hint> hints);
+  // The replica stored the first `applied` blocks; the rest become hints now
+  void acknowledge(uint64_t request_id, size_t applied = SIZE_MAX);
+
+  // Also run `on_expire` on every pass, e.g. to fail the writes that waited on the acks;
+  // set it before start()
+  void setOnExpire(ExpireFn on_expire) { on_expire_ = std::move(on_expire); }
+
+  // Forget the hints of a replica that left the ring (re-replication takes over)
+  void discard(const NodeId& replica);
+
+  // Turn expired acks into hints and replay the hints of every reachable replica
+  // Returns the number of hints replayed
+  size_t runOnce();
+
+  // Cap replay traffic (0 = unlimited)
+  void setBandwidthCap(uint64_t bytes_per_sec) { bytes_per_sec_ = bytes_per_sec; }
+  uint64_t getBandwidthCap() const { return bytes_per_sec_; }
+
+  Progress progress() const;
+
+ private:
+  struct Queue {
+    std::deque<Hint> hints;
+    std::deque<size_t> sizes;  // encoded size of each hint
+    size_t bytes = 0;
+    std::ofstream log;
+  };
+
+  struct AwaitingAck {
+    NodeId replica;
+    std::vector<Hint> hints;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  void run();
+
+  // Replay one replica's hints until its queue is empty or a batch fails
+  size_t replay(const NodeId& replica);
+
+  // Wait until `bytes` more fit under the cap; false if stopping
+  bool throttle(size_t bytes);
+
+  // Append a hint to the queue and its log; caller holds queue_mtx_
+  bool enqueue(const NodeId& replica, const Hint& hint);
+
+  // Rewrite a replica's log to hold exactly its queued hints; caller holds queue_mtx_
+  void rewriteLog(const NodeId& replica, Queue& queue);
+
+  std::string logPath(const NodeId& replica) const;
+  void loadLogs();
+
+  std::string hint_dir_;
+  DeliverFn deliver_;
+  LivenessFn is_alive_;
+  ExpireFn on_expire_;
+  std::atomic<uint64_t> bytes_per_sec_;
+  std::chrono::milliseconds interval_;
+  std::chrono::milliseconds ack_timeout_;
+  size_t max_queue_bytes_;
+
+  std::unordered_map<NodeId, Queue> queues_;
+  std::unordered_map<uint64_t, AwaitingAck> awaiting_acks_;  // request ID -> sent blocks
+  mutable std::mutex queue_mtx_;
+  std::mutex replay_mtx_;  // one replay pass at a time, so batches stay in order
+
+  std::atomic<size_t> replayed_{0};
+  std::atomic<size_t> dropped_{0};
+
+  std::chrono::steady_clock::time_point next_send_;  // earliest start of the next batch
+  bool stopping_ = false;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "file_metadata.hpp"
+#include "flat_hash_map.hpp"
+
+/**
+ * Interned hydfs filenames
+ * Gives each filename a dense FileId (1, 2, ...) in the order names are first seen, so
+ * internal maps can key on the handle instead of re-hashing and comparing strings. Names
+ * are compared exactly, so distinct filenames never share a handle even if they hash
+ * alike. Handles are local to this node and never go on the wire; peers name files
+ */
+template <typename NameHash = std::hash<std::string>>
+class BasicInternTable {
+ public:
+  BasicInternTable() = default;
+
+  // Resolve a filename to its handle, registering the name on first use
+  FileId intern(const std::string& filename) {
+    FileId file_id = 0;
+    if (find(filename, file_id)) {
+      return file_id;  // Common case: already interned
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    auto [it, inserted] = ids.try_emplace(filename, names.size() + 1);
+    if (inserted) {
+      names.push_back(filename);
+    }
+    return it->second;
+  }
+
+  // Resolve a filename interned earlier without registering it; false if it never was
+  bool find(const std::string& filename, FileId& file_id) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto it = ids.find(filename);
+    if (it == ids.end()) {
+      return false;
+    }
+    file_id = it->second;
+    return true;
+  }
+
+  // Look up the filename behind a handle
+  bool lookup(FileId file_id, std::string& filename) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    if (file_id == 0 || file_id > names.size()) {
+      return false;
+    }
+    filename = names[file_id - 1];
+    return true;
+  }
+
+  // Filename behind a handle, or an empty string if it was never interned
+  std::string name(FileId file_id) const {
+    std::string filename;
+    lookup(file_id, filename);
+    return filename;
+  }
+
+  // Number of interned filenames
+  size_t size() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return names.size();
+  }
+
+ private:
+  FlatHashMap<std::string, FileId, NameHash> ids;  // filename -> file_id
+  std::vector<std::string> names;                  // file_id - 1 -> filename
+  mutable std::shared_mutex mtx;                   // thread safety
+};
+
+using InternTable = BasicInternTable<>;
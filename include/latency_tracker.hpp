@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * Sliding window of recent request latencies
+ * Keeps the last `window` samples and answers percentile queries over them, so a caller
+ * can derive a timeout from what the cluster has been doing lately (e.g. when to hedge)
+ */
+class LatencyTracker {
+ public:
+  explicit LatencyTracker(size_t window = 128);
+
+  void record(std::chrono::microseconds latency);
+
+  // Latency at or below which `percentile` percent of the recent samples fall
+  // Returns fallback until min_samples samples have been recorded
+  std::chrono::microseconds percentile(double percentile, std::chrono::microseconds fallback,
+                                       size_t min_samples = 1) const;
+
+  size_t samples() const;
+
+ private:
+  std::vector<std::chrono::microseconds> samples_;  // ring buffer, oldest at next_ once full
+  size_t next_ = 0;
+  size_t window_;
+  mutable std::mutex mtx_;
+};
@@ -3,9 +3,9 @@
 #include <cstdint>
 #include <random>
 #include <shared_mutex>
-#include <unordered_map>
 #include <vector>
 
+#include "flat_hash_map.hpp"
 #include "logger.hpp"
 #include "message.hpp"
 #include "shared.hpp"
@@ -23,6 +23,7 @@ class MembershipList {
   void incrementIncarnation(const NodeId& node_id);
   void updateMode(const NodeId& node_id, FailureDetectionMode new_mode);
   MembershipInfo getNodeInfo(const NodeId& node_id);
+  bool isAlive(const NodeId& node_id) const;  // known and not suspected, dead or left
 
   std::vector<MembershipInfo> selectKRandom(unsigned int k, const NodeId& self_node_id) const;
   std::vector<MembershipInfo> copy() const {
@@ -38,7 +39,7 @@ class MembershipList {
 
  private:
   mutable Logger logger;
-  std::unordered_map<NodeId, MembershipInfo> mem_list;
+  FlatHashMap<NodeId, MembershipInfo> mem_list;
 
   mutable std::shared_mutex mtx;  // allows multiple readers, single writer
   
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "file_block.hpp"
+
+/**
+ * Outcome of merging the block lists of several replicas of one file
+ */
+struct MergePlan {
+  std::vector<uint64_t> block_ids;             // merged file, in order
+  std::vector<std::vector<uint64_t>> missing;  // per replica: merged blocks it doesn't hold
+  std::vector<bool> in_sync;                   // per replica: already holds exactly the merge
+  size_t covered = 0;                          // blocks left out because another carries them
+  size_t expired = 0;                          // blocks left out because retention cut them
+};
+
+// Union of the replicas' blocks in a deterministic order: client, sequence number,
+// timestamp, then block ID. A block whose appends another block of the union already
+// covers (it was folded into an extent on some replica) is left out so no data
+// appears twice, and so is a copy of an append that replicas stored under different
+// block IDs (the one with the lowest ID stays). Blocks stamped at or before
+// truncated_through (the coordinator's retention cut, 0 for none) are left out too, so
+// a replica that missed the truncation doesn't bring them back
+MergePlan planMerge(const std::vector<std::vector<BlockDigest>>& replicas,
+                    uint64_t truncated_through = 0);
+
+// Blocks of a freshly read copy (fresh_ids, in file order) that a lagging replica
+// lacks. Empty if the replica already holds them all, or if it holds a block the
+// fresh copy doesn't: it diverged rather than lagged, and that takes a merge
+std::vector<uint64_t> planReadRepair(const std::vector<uint64_t>& fresh_ids,
+                                     const std::vector<BlockDigest>& replica);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Arc of the hash ring: positions in (start, end], wrapping past zero
+ * start == end means the whole ring
+ */
+struct RingRange {
+  uint64_t start;
+  uint64_t end;
+
+  bool contains(uint64_t position) const {
+    if (start < end) return position > start && position <= end;
+    if (start > end) return position > start || position <= end;
+    return true;
+  }
+};
+
+/**
+ * Merkle tree over the files a node stores, keyed by ring position
+ * Leaves bucket files by the top bits of their position and hash to the XOR of
+ * their files' digests; inner nodes XOR their children, so changing one digest
+ * updates a single root-to-leaf path. Hashes can be restricted to a ring range:
+ * two replicas of a range compare only the files both are responsible for, even
+ * though each also stores other ranges.
+ *
+ * Thread-safe.
+ */
+class MerkleTree {
+ public:
+  static constexpr size_t kFanoutBits = 4;
+  static constexpr size_t kFanout = size_t(1) << kFanoutBits;
+  static constexpr size_t kDepth = 3;  // levels below the root; leaves sit at kDepth
+  static constexpr size_t kLeaves = size_t(1) << (kFanoutBits * kDepth);
+
+  struct Entry {
+    std::string name;
+    uint64_t position;
+    uint64_t digest;
+  };
+
+  MerkleTree();
+
+  // Set the digest of a named entry at a ring position; digest 0 removes the entry
+  void update(const std::string& name, uint64_t position, uint64_t digest);
+
+  // Remove every entry
+  void clear();
+
+  // Hash of the node at index within level (0 = root), counting only entries in range
+  uint64_t hash(size_t level, size_t index, const RingRange& range) const;
+
+  // Entries of a leaf that lie in range
+  std::vector<Entry> leafEntries(size_t leaf, const RingRange& range) const;
+
+  // Number of nodes at a level
+  static size_t levelWidth(size_t level) { return size_t(1) << (kFanoutBits * level); }
+
+  // Leaf that holds a ring position
+  static size_t leafOf(uint64_t position) { return position >> (64 - kFanoutBits * kDepth); }
+
+ private:
+  std::vector<std::vector<uint64_t>> levels_;  // levels_[level][index], XOR of the subtree
+  std::vector<std::vector<Entry>> leaves_;     // entries bucketed by leaf
+  mutable std::mutex mtx_;
+
+  // XOR a value into a leaf and every node above it
+  void apply(size_t leaf, uint64_t value);
+
+  uint64_t hashLocked(size_t level, size_t index, const RingRange& range) const;
+};
@@ -2,11 +2,14 @@
 
 #include <netinet/in.h>
 
+#include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string_view>
+#include <unordered_map>
 #include <random>
 
 #include "logger.hpp"
@@ -17,6 +20,12 @@
 #include "consistent_hash_ring.hpp"
 #include "file_store.hpp"
 #include "file_operations_handler.hpp"
+#include "block_compactor.hpp"
+#include "retention_reaper.hpp"
+#include "anti_entropy.hpp"
+#include "re_replicator.hpp"
+#include "rebalancer.hpp"
+#include "hinted_handoff.hpp"
 
 #define HEARTBEAT_FREQ 1  // seconds
 #define PING_FREQ 1       // seconds
@@ -82,6 +91,10 @@ class Node {
 
   // File operations
   FileOperationsHandler* getFileHandler() { return file_handler_.get(); }
+  AntiEntropyService* getAntiEntropy() { return anti_entropy_.get(); }
+  ReReplicator* getReReplicator() { return rereplicator_.get(); }
+  Rebalancer* getRebalancer() { return rebalancer_.get(); }
+  HintedHandoff* getHintedHandoff() { return hinted_handoff_.get(); }
 
  private:
   void handleJoin(std::array<char, UDPSocketConnection::BUFFER_LEN>& buffer,
@@ -107,6 +120,12 @@ class Node {
 
   void handleSwitch(const Message& message);
 
+  // MP3: Add a node to the ring and move it the files it now replicates
+  void addToRing(const NodeId& node_id);
+
+  // MP3: Remove a node from the ring and restore the replicas it held
+  void removeFromRing(const NodeId& node_id);
+
   std::string modePrefix(FailureDetectionMode mode);
 
   UDPSocketConnection socket;
@@ -118,7 +137,18 @@ class Node {
   bool left = false, introducer_alive = false;
   float drop_rate = 0.0f;
 
+  // When each outstanding ping was sent, for RTT samples (pings go out on the outgoing
+  // thread, acks arrive on the incoming one)
+  std::unordered_map<NodeId, std::chrono::steady_clock::time_point> ping_sent_;
+  std::mutex ping_mtx_;
+
   // MP3: File system components
   std::unique_ptr<FileStore> file_store_;
   std::unique_ptr<FileOperationsHandler> file_handler_;
+  std::unique_ptr<BlockCompactor> compactor_;
+  std::unique_ptr<RetentionReaper> reaper_;
+  std::unique_ptr<AntiEntropyService> anti_entropy_;
+  std::unique_ptr<ReReplicator> rereplicator_;
+  std::unique_ptr<Rebalancer> rebalancer_;
+  std::unique_ptr<HintedHandoff> hinted_handoff_;
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "consistent_hash_ring.hpp"
+#include "file_store.hpp"
+#include "message.hpp"
+#include "task_executor.hpp"
+
+/**
+ * Restores the replication factor after a node leaves the ring
+ * Each local file the departed node replicated now has a new successor in its
+ * replica set; the first surviving replica streams the file to it. Every survivor
+ * runs the same computation, so exactly one of them sends each file. Transfers run
+ * in parallel on a bounded worker pool and report their progress.
+ */
+class ReReplicator {
+ public:
+  // Send one file to a new replica; true once the replica has stored it
+  using TransferFn = std::function<bool(const std::string&, const NodeId&)>;
+
+  struct Progress {
+    size_t pending = 0;    // queued or in flight
+    size_t completed = 0;
+    size_t failed = 0;
+  };
+
+  ReReplicator(FileStore& file_store, const ConsistentHashRing& hash_ring, const NodeId& self_id,
+               TransferFn transfer, size_t max_parallel = 4, int replication_factor = 3);
+
+  // Queue the transfers owed after a node was removed from the ring
+  // Returns the number of transfers queued
+  size_t onNodeRemoved(const NodeId& removed);
+
+  // Files this node must send now that `removed` is gone (file, new replica)
+  std::vector<std::pair<std::string, NodeId>> planTransfers(const NodeId& removed) const;
+
+  Progress progress() const;
+
+ private:
+  void runTransfer(const std::string& filename, const NodeId& target);
+
+  FileStore& file_store_;
+  const ConsistentHashRing& hash_ring_;
+  NodeId self_id_;
+  TransferFn transfer_;
+  int replication_factor_;
+
+  std::atomic<size_t> pending_{0};
+  std::atomic<size_t> completed_{0};
+  std::atomic<size_t> failed_{0};
+
+  // Transfers queued or running ("file@host:port"), so repeated removals don't duplicate them
+  std::unordered_set<std::string> in_flight_;
+  std::mutex in_flight_mtx_;
+
+  // Declared last so queued transfers finish before the members they use go away
+  TaskExecutor executor_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "file_block.hpp"
+#include "file_metadata.hpp"
+
+/**
+ * Client-side cache of files read from HyDFS
+ * Each entry holds one version of a file under a lease from the replica that served it.
+ * The replica pushes an invalidation when its copy changes while the lease is live, so
+ * until the lease runs out a hit is as fresh as a read from that replica would be. An
+ * entry whose lease ran out is never returned. Entries are evicted least recently used
+ * first once the cached bytes exceed the capacity.
+ */
+class ReadCache {
+ public:
+  struct Entry {
+    uint32_t version = 0;
+    BlockIdList block_ids;               // for the read-my-writes check on a hit
+    std::vector<BlockRange> compacted;   // provenance of compacted extents
+    std::vector<char> data;
+    std::chrono::steady_clock::time_point lease_expiry;
+  };
+
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t invalidations = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+  };
+
+  explicit ReadCache(size_t capacity_bytes = 64 * 1024 * 1024);
+
+  // Copy out a file's entry if its lease still holds
+  bool get(FileId file_id, Entry& entry,
+           std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+  // Cache the result of a read issued at `issued_at`; refused if the file was invalidated
+  // after the read went out (the reply may predate the change) or it exceeds the capacity
+  bool put(FileId file_id, Entry entry, std::chrono::steady_clock::time_point issued_at);
+
+  // Drop a file's entry and refuse replies to reads issued before now
+  void invalidate(FileId file_id);
+
+  Stats stats() const;
+
+ private:
+  struct Slot {
+    Entry entry;
+    std::list<FileId>::iterator lru;
+  };
+
+  void erase(FileId file_id);  // caller holds mtx_
+
+  size_t capacity_;
+  size_t bytes_ = 0;
+  std::unordered_map<FileId, Slot> slots_;
+  std::list<FileId> lru_;  // most recently used first
+  // When each file was last invalidated; pruned once no lease could predate it
+  std::unordered_map<FileId, std::chrono::steady_clock::time_point> invalidated_at_;
+  Stats stats_;
+  mutable std::mutex mtx_;
+};
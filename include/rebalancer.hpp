@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bandwidth_throttle.hpp"
+#include "consistent_hash_ring.hpp"
+#include "file_store.hpp"
+#include "message.hpp"
+#include "task_executor.hpp"
+
+/**
+ * Moves files to a node that joined the ring
+ * The new node takes a place in the replica set of the files in the ranges it now
+ * covers, pushing out the node that used to be last. For each such file the first
+ * old replica streams it to the new node and then tells the pushed-out node to
+ * drop its stale copy. Only files whose replica set changed move, one at a time.
+ * The transfer paces its pages through the rebalancer's bandwidth throttle, so
+ * scaling out doesn't saturate the network.
+ */
+class Rebalancer {
+ public:
+  // Send one file to a node; true once the node has stored it
+  using TransferFn = std::function<bool(const std::string&, const NodeId&)>;
+  // Tell a node that is no longer a replica to drop its copy of a file
+  using DropFn = std::function<void(const std::string&, const NodeId&)>;
+
+  struct Move {
+    std::string filename;
+    NodeId target;           // the node that joined
+    bool displaced_valid;    // false when the ring is too small to push anyone out
+    NodeId displaced;        // replica that left the file's replica set
+    size_t bytes;            // file size, for progress
+  };
+
+  struct Progress {
+    size_t pending = 0;      // queued or in flight
+    size_t moved = 0;
+    size_t failed = 0;
+    uint64_t bytes_moved = 0;
+  };
+
+  Rebalancer(FileStore& file_store, const ConsistentHashRing& hash_ring, const NodeId& self_id,
+             TransferFn transfer, DropFn drop, uint64_t bytes_per_sec = 1024 * 1024,
+             int replication_factor = 3);
+  ~Rebalancer();
+
+  // Queue the moves owed after a node was added to the ring
+  // Returns the number of files queued
+  size_t onNodeAdded(const NodeId& added);
+
+  // Files this node must move now that `added` is in the ring
+  std::vector<Move> planMoves(const NodeId& added) const;
+
+  // Cap migration traffic (0 = unlimited)
+  void setBandwidthCap(uint64_t bytes_per_sec) { throttle_->setBandwidthCap(bytes_per_sec); }
+  uint64_t getBandwidthCap() const { return throttle_->getBandwidthCap(); }
+
+  // The cap's throttle, for transfers to pace their pages through; outlives the rebalancer
+  std::shared_ptr<BandwidthThrottle> throttle() const { return throttle_; }
+
+  Progress progress() const;
+
+ private:
+  void runMove(const Move& move);
+
+  FileStore& file_store_;
+  const ConsistentHashRing& hash_ring_;
+  NodeId self_id_;
+  TransferFn transfer_;
+  DropFn drop_;
+  int replication_factor_;
+  std::shared_ptr<BandwidthThrottle> throttle_;
+
+  std::atomic<size_t> pending_{0};
+  std::atomic<size_t> moved_{0};
+  std::atomic<size_t> failed_{0};
+  std::atomic<uint64_t> bytes_moved_{0};
+
+  // One worker: moves run one at a time under the cap
+  TaskExecutor executor_{1};
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "file_metadata.hpp"
+#include "message.hpp"
+
+/**
+ * Replica-side ordering of replication batches by per-file LSN
+ * The head stamps each file's blocks with consecutive LSNs. A batch is released for
+ * applying once every file in it continues that file's stream from its head; a batch
+ * that arrives early is held until the gap before it is filled, so every replica applies
+ * a file's blocks in the head's order. Gaps are reported as the missing LSN range only.
+ * A batch held past the hold limit, or beyond the buffer cap, is released anyway and
+ * its stream skips ahead; anti-entropy then repairs what was lost. A batch resent after
+ * its first copy was released is marked with how many of each file's blocks were already
+ * delivered, so the replica skips them without searching the file.
+ */
+class ReorderBuffer {
+ public:
+  struct Batch {
+    ReplicateBlocksMessage msg;
+    struct sockaddr_in sender;
+    std::vector<size_t> delivered;  // per file of msg: leading blocks released before
+  };
+
+  // LSNs [from_lsn, to_lsn) of a file that its head should send again
+  struct Gap {
+    NodeId head;
+    std::string hydfs_filename;
+    uint64_t from_lsn;
+    uint64_t to_lsn;
+  };
+
+  struct Stats {
+    size_t held = 0;
+    size_t reordered = 0;  // batches held until their gap was filled
+    size_t skipped = 0;    // batches released with their gap still open
+  };
+
+  ReorderBuffer(std::chrono::milliseconds gap_retry = std::chrono::milliseconds(200),
+                std::chrono::milliseconds max_hold = std::chrono::seconds(2),
+                size_t max_held = 256);
+
+  // Add an arriving batch; returns the batches now ready to apply, in order
+  std::vector<Batch> offer(Batch batch);
+
+  // Release the batches held past the hold limit, in arrival order, with any batches
+  // that can follow them
+  std::vector<Batch> releaseStale();
+
+  // Gaps to request now; each file's gap is reported at most once per retry interval
+  std::vector<Gap> gaps();
+
+  Stats stats() const;
+
+ private:
+  struct Stream {
+    NodeId head{};
+    uint64_t next_lsn = 1;
+    std::chrono::steady_clock::time_point last_request;
+  };
+
+  struct Held {
+    Batch batch;
+    std::chrono::steady_clock::time_point arrived;
+  };
+
+  // Start a new stream when a file's blocks come from a new head; caller holds mtx_
+  void track(const ReplicateBlocksMessage& msg);
+
+  // Whether every file in the batch continues its stream; caller holds mtx_
+  bool ready(const ReplicateBlocksMessage& msg) const;
+
+  // Mark the blocks of a released batch its streams already passed, then move the streams
+  // past its blocks; caller holds mtx_
+  void advance(Batch& batch);
+
+  // Release held batches that became ready, until none does; caller holds mtx_
+  void drain(std::vector<Batch>& released);
+
+  // Release held batches older than the hold limit; caller holds mtx_
+  void releaseExpired(std::vector<Batch>& released);
+
+  std::chrono::milliseconds gap_retry_;
+  std::chrono::milliseconds max_hold_;
+  size_t max_held_;
+
+  std::unordered_map<std::string, Stream> streams_;  // by hydfs filename
+  std::list<Held> held_;  // in arrival order
+  size_t reordered_ = 0;
+  size_t skipped_ = 0;
+  mutable std::mutex mtx_;
+};
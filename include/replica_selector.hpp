@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "message.hpp"
+
+/**
+ * Latency-aware replica choice for reads
+ * Keeps an exponentially weighted moving average of each peer's round-trip time, fed by
+ * file request replies and ping/ack exchanges, plus the number of requests still
+ * outstanding at it. A peer's expected latency is its RTT scaled by its queue. Reads pick
+ * a replica by power of two choices: two random candidates, the one expected to be
+ * faster wins, so a slow or busy replica is avoided without every client herding onto
+ * the single fastest one.
+ */
+class ReplicaSelector {
+ public:
+  explicit ReplicaSelector(double alpha = 0.3,
+                           std::chrono::microseconds initial_rtt = std::chrono::milliseconds(1));
+
+  // A request was sent to a peer / its reply arrived after rtt / it never came
+  void onSend(const NodeId& peer);
+  void onReply(const NodeId& peer, std::chrono::microseconds rtt);
+  void onTimeout(const NodeId& peer, std::chrono::microseconds waited);
+
+  // A request to a peer was abandoned (a hedge's loser): it no longer counts as
+  // outstanding, and its RTT is never learned
+  void onCancel(const NodeId& peer);
+
+  // An RTT measured outside a tracked request (e.g. a ping answered by an ack)
+  void observeRtt(const NodeId& peer, std::chrono::microseconds rtt);
+
+  // RTT estimate times (outstanding requests + 1), in microseconds
+  double expectedLatency(const NodeId& peer) const;
+
+  // The order to ask candidates in: the power-of-two-choices winner first, then the rest
+  // by expected latency (fallbacks for hedging and retries)
+  std::vector<NodeId> order(const std::vector<NodeId>& candidates);
+
+  // Drop what we know about a peer that left the ring
+  void forget(const NodeId& peer);
+
+ private:
+  struct PeerStats {
+    double rtt_us = 0;
+    uint32_t outstanding = 0;
+  };
+
+  // Fold a sample into a peer's average; caller holds mtx_
+  void sample(PeerStats& stats, std::chrono::microseconds rtt);
+  double expected(const NodeId& peer) const;  // caller holds mtx_
+
+  double alpha_;
+  double initial_rtt_us_;
+  std::unordered_map<NodeId, PeerStats> peers_;
+  std::mt19937 rng_{std::random_device{}()};
+  mutable std::mutex mtx_;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "file_store.hpp"
+
+/**
+ * Background reaper for HyDFS retention rules
+ * Periodically drops the expired prefix of every local file that has a rule and
+ * reports each truncation point so it can be propagated to the other replicas
+ */
+class RetentionReaper {
+ public:
+  // Called with the file and the timestamp it was cut at
+  using TruncateCallback = std::function<void(const std::string&, uint64_t)>;
+
+  RetentionReaper(FileStore& file_store, TruncateCallback on_truncate = {},
+                  std::chrono::milliseconds interval = std::chrono::seconds(5));
+  ~RetentionReaper();
+
+  // Start and stop the background thread
+  void start();
+  void stop();
+
+  // Run a single retention pass over all local files
+  // Returns the number of blocks dropped
+  size_t runOnce();
+
+ private:
+  void run();
+
+  FileStore& file_store_;
+  TruncateCallback on_truncate_;
+  std::chrono::milliseconds interval_;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::mutex mtx_;
+  std::condition_variable cv_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed pool of worker threads running queued tasks in FIFO order
+ * Used for work that blocks on replies from peers (e.g. merge coordination) so it
+ * never runs on the thread that receives those replies
+ */
+class TaskExecutor {
+ public:
+  explicit TaskExecutor(size_t worker_count = 2);
+  ~TaskExecutor();
+
+  TaskExecutor(const TaskExecutor&) = delete;
+  TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+  // Queue a task; returns false once the executor is shutting down
+  bool submit(std::function<void()> task);
+
+  // Finish queued tasks and join the workers
+  void shutdown();
+
+ private:
+  void workerLoop();
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+};
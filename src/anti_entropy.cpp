@@ -0,0 +1,54 @@
+#include "anti_entropy.hpp"
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+AntiEntropyService::AntiEntropyService(SyncRound sync_round, std::chrono::milliseconds interval)
+    : sync_round_(std::move(sync_round)), interval_(interval) {}
+
+AntiEntropyService::~AntiEntropyService() { stop(); }
+
+void AntiEntropyService::start() {
+  if (running_.exchange(true)) {
+    return;  // Already running
+  }
+  thread_ = std::thread(&AntiEntropyService::run, this);
+}
+
+void AntiEntropyService::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!running_.exchange(false)) {
+      return;
+    }
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+size_t AntiEntropyService::runOnce() {
+  try {
+    return sync_round_();
+  } catch (const std::exception& e) {
+    std::cout << "[ANTI_ENTROPY] Sync round failed: " << e.what() << std::endl;
+    return 0;
+  }
+}
+
+void AntiEntropyService::run() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (running_) {
+    cv_.wait_for(lock, interval_, [this] { return !running_; });
+    if (!running_) break;
+
+    lock.unlock();
+    size_t repaired = runOnce();
+    if (repaired > 0) {
+      std::cout << "[ANTI_ENTROPY] Repaired " << repaired << " diverged files" << std::endl;
+    }
+    lock.lock();
+  }
+}
@@ -0,0 +1,34 @@
+#include "append_log.hpp"
+
+AppendLog::AppendLog(size_t max_ids_per_file) : max_ids_per_file_(max_ids_per_file) {}
+
+uint64_t AppendLog::stamp(FileId file_id, const std::vector<FileBlock>& blocks) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  FileLog& log = logs_[file_id];
+  uint64_t first_lsn = log.next_lsn;
+  for (const auto& block : blocks) {
+    log.recent.push_back(block.block_id);
+  }
+  log.next_lsn += blocks.size();
+  while (log.recent.size() > max_ids_per_file_) {
+    log.recent.pop_front();
+  }
+  return first_lsn;
+}
+
+bool AppendLog::range(FileId file_id, uint64_t from_lsn, uint64_t to_lsn,
+                      std::vector<uint64_t>& block_ids) const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = logs_.find(file_id);
+  if (it == logs_.end() || from_lsn == 0 || from_lsn >= to_lsn) {
+    return false;
+  }
+  const FileLog& log = it->second;
+  uint64_t oldest_lsn = log.next_lsn - log.recent.size();
+  if (from_lsn < oldest_lsn || to_lsn > log.next_lsn) {
+    return false;
+  }
+  block_ids.assign(log.recent.begin() + (from_lsn - oldest_lsn),
+                   log.recent.begin() + (to_lsn - oldest_lsn));
+  return true;
+}
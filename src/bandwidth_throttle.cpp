@@ -0,0 +1,31 @@
+#include "bandwidth_throttle.hpp"
+
+BandwidthThrottle::BandwidthThrottle(uint64_t bytes_per_sec)
+    : bytes_per_sec_(bytes_per_sec), next_send_(std::chrono::steady_clock::now()) {}
+
+bool BandwidthThrottle::acquire(size_t bytes) {
+  std::unique_lock<std::mutex> lock(mtx_);
+  auto now = std::chrono::steady_clock::now();
+  if (next_send_ < now) {
+    next_send_ = now;
+  }
+  auto start = next_send_;
+  uint64_t rate = bytes_per_sec_;
+  if (rate > 0) {
+    next_send_ += std::chrono::microseconds(uint64_t(bytes) * 1000000 / rate);
+  }
+  return !cv_.wait_until(lock, start, [this] { return stopped_; });
+}
+
+void BandwidthThrottle::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stopped_ = true;
+  }
+  cv_.notify_all();
+}
+
+bool BandwidthThrottle::stopped() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return stopped_;
+}
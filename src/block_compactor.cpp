@@ -0,0 +1,53 @@
+#include "block_compactor.hpp"
+
+#include <iostream>
+
+BlockCompactor::BlockCompactor(FileStore& file_store, const CompactionPolicy& policy,
+                               std::chrono::milliseconds interval)
+    : file_store_(file_store), policy_(policy), interval_(interval) {}
+
+BlockCompactor::~BlockCompactor() { stop(); }
+
+void BlockCompactor::start() {
+  if (running_.exchange(true)) {
+    return;  // Already running
+  }
+  thread_ = std::thread(&BlockCompactor::run, this);
+}
+
+void BlockCompactor::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!running_.exchange(false)) {
+      return;
+    }
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+size_t BlockCompactor::runOnce() {
+  size_t folded = 0;
+  for (const auto& filename : file_store_.listFiles()) {
+    folded += file_store_.compactFile(filename, policy_);
+  }
+  file_store_.collectGarbage();  // drop versions retired by this pass once readers let go
+  return folded;
+}
+
+void BlockCompactor::run() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (running_) {
+    cv_.wait_for(lock, interval_, [this] { return !running_; });
+    if (!running_) break;
+
+    lock.unlock();
+    size_t folded = runOnce();
+    if (folded > 0) {
+      std::cout << "[COMPACTOR] Folded " << folded << " blocks into extents" << std::endl;
+    }
+    lock.lock();
+  }
+}
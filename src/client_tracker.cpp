@@ -2,15 +2,16 @@
 
 #include <algorithm>
 #include <mutex>
+#include <unordered_set>
 
-void ClientTracker::recordAppend(const std::string& client_id, const std::string& filename,
-                                 uint64_t block_id) {
+void ClientTracker::recordAppend(const std::string& client_id, FileId file_id, uint64_t block_id,
+                                 uint32_t sequence_num) {
   std::unique_lock<std::shared_mutex> lock(mtx);
-  client_appends[client_id][filename].push_back(block_id);
+  client_appends[client_id][file_id].push_back({block_id, sequence_num});
 }
 
 std::vector<uint64_t> ClientTracker::getClientAppends(const std::string& client_id,
-                                                      const std::string& filename) const {
+                                                      FileId file_id) const {
   std::shared_lock<std::shared_mutex> lock(mtx);
 
   auto client_it = client_appends.find(client_id);
@@ -18,17 +19,22 @@ std::vector<uint64_t> ClientTracker::getClientAppends(const std::string& client_
     return {};
   }
 
-  auto file_it = client_it->second.find(filename);
+  auto file_it = client_it->second.find(file_id);
   if (file_it == client_it->second.end()) {
     return {};
   }
 
-  return file_it->second;
+  std::vector<uint64_t> block_ids;
+  block_ids.reserve(file_it->second.size());
+  for (const auto& append : file_it->second) {
+    block_ids.push_back(append.block_id);
+  }
+  return block_ids;
 }
 
-bool ClientTracker::satisfiesReadMyWrites(const std::string& client_id,
-                                         const std::string& filename,
-                                         const std::vector<uint64_t>& file_block_ids) const {
+bool ClientTracker::satisfiesReadMyWrites(const std::string& client_id, FileId file_id,
+                                         const BlockIdList& file_block_ids,
+                                         const std::vector<BlockRange>& compacted_ranges) const {
   std::shared_lock<std::shared_mutex> lock(mtx);
 
   auto client_it = client_appends.find(client_id);
@@ -36,15 +42,36 @@ bool ClientTracker::satisfiesReadMyWrites(const std::string& client_id,
     return true;  // Client has no appends, so any version is fine
   }
 
-  auto file_it = client_it->second.find(filename);
+  auto file_it = client_it->second.find(file_id);
   if (file_it == client_it->second.end()) {
     return true;  // Client has no appends to this file
   }
 
-  // Check that all of the client's appended blocks are in the file
-  for (uint64_t block_id : file_it->second) {
-    if (std::find(file_block_ids.begin(), file_block_ids.end(), block_id) ==
-        file_block_ids.end()) {
+  // Scan the file from the tail until every appended block has been seen
+  std::unordered_set<uint64_t> pending;
+  for (const auto& append : file_it->second) {
+    pending.insert(append.block_id);
+  }
+  file_block_ids.forEachChunkReverse([&](const uint64_t* ids, size_t count) {
+    for (size_t i = count; i-- > 0 && !pending.empty();) {
+      pending.erase(ids[i]);
+    }
+    return !pending.empty();
+  });
+  if (pending.empty()) {
+    return true;
+  }
+
+  // Blocks not listed may have been folded into an extent
+  for (const auto& append : file_it->second) {
+    if (pending.count(append.block_id) == 0) {
+      continue;
+    }
+    bool covered = std::any_of(compacted_ranges.begin(), compacted_ranges.end(),
+                               [&](const BlockRange& range) {
+                                 return range.covers(client_id, append.sequence_num);
+                               });
+    if (!covered) {
       return false;  // Missing a block that the client appended
     }
   }
@@ -57,11 +84,11 @@ void ClientTracker::clearClient(const std::string& client_id) {
   client_appends.erase(client_id);
 }
 
-void ClientTracker::clearFile(const std::string& filename) {
+void ClientTracker::clearFile(FileId file_id) {
   std::unique_lock<std::shared_mutex> lock(mtx);
 
-  // Remove this filename from all clients
+  // Remove this file from all clients
   for (auto& client_entry : client_appends) {
-    client_entry.second.erase(filename);
+    client_entry.second.erase(file_id);
   }
 }
@@ -11,6 +11,30 @@ uint64_t FileBlock::generateBlockId(const std::string& client_id, uint64_t times
   return std::hash<std::string>{}(combined);
 }
 
+uint64_t FileBlock::generateExtentId(uint64_t first_block_id, uint64_t last_block_id) {
+  std::string combined =
+      "extent:" + std::to_string(first_block_id) + ":" + std::to_string(last_block_id);
+  return std::hash<std::string>{}(combined);
+}
+
+uint64_t FileBlock::lastAppendId() const {
+  if (ranges.empty()) {
+    return block_id;
+  }
+  return generateBlockId(ranges.back().client_id, timestamp, ranges.back().last_sequence);
+}
+
+size_t FileBlock::serializedSize() const {
+  size_t total = sizeof(block_id) + sizeof(uint32_t) + client_id.length() + sizeof(sequence_num) +
+                 sizeof(timestamp) + sizeof(size) + size + sizeof(uint32_t);
+  for (const auto& range : ranges) {
+    total += sizeof(uint32_t) + range.client_id.length() + sizeof(range.first_sequence) +
+             sizeof(range.last_sequence) + sizeof(range.offset) + sizeof(range.length) +
+             sizeof(uint32_t) + range.sizes.size() * sizeof(uint32_t);
+  }
+  return total;
+}
+
 size_t FileBlock::serialize(char* buffer, size_t buffer_size) const {
   size_t offset = 0;
 
@@ -47,6 +71,42 @@ size_t FileBlock::serialize(char* buffer, size_t buffer_size) const {
   std::memcpy(buffer + offset, data.data(), size);
   offset += size;
 
+  // Serialize provenance ranges (count is 0 for ordinary blocks)
+  uint32_t range_count = ranges.size();
+  if (offset + sizeof(range_count) > buffer_size) return 0;
+  std::memcpy(buffer + offset, &range_count, sizeof(range_count));
+  offset += sizeof(range_count);
+
+  for (const auto& range : ranges) {
+    uint32_t range_client_len = range.client_id.length();
+    if (offset + sizeof(range_client_len) + range_client_len > buffer_size) return 0;
+    std::memcpy(buffer + offset, &range_client_len, sizeof(range_client_len));
+    offset += sizeof(range_client_len);
+    std::memcpy(buffer + offset, range.client_id.c_str(), range_client_len);
+    offset += range_client_len;
+
+    if (offset + sizeof(range.first_sequence) + sizeof(range.last_sequence) +
+            sizeof(range.offset) + sizeof(range.length) >
+        buffer_size)
+      return 0;
+    std::memcpy(buffer + offset, &range.first_sequence, sizeof(range.first_sequence));
+    offset += sizeof(range.first_sequence);
+    std::memcpy(buffer + offset, &range.last_sequence, sizeof(range.last_sequence));
+    offset += sizeof(range.last_sequence);
+    std::memcpy(buffer + offset, &range.offset, sizeof(range.offset));
+    offset += sizeof(range.offset);
+    std::memcpy(buffer + offset, &range.length, sizeof(range.length));
+    offset += sizeof(range.length);
+
+    uint32_t size_count = range.sizes.size();
+    size_t sizes_bytes = size_count * sizeof(uint32_t);
+    if (offset + sizeof(size_count) + sizes_bytes > buffer_size) return 0;
+    std::memcpy(buffer + offset, &size_count, sizeof(size_count));
+    offset += sizeof(size_count);
+    std::memcpy(buffer + offset, range.sizes.data(), sizes_bytes);
+    offset += sizes_bytes;
+  }
+
   std::cout << "[FileBlock::serialize] block_id=" << block_id
             << ", client_id.len=" << client_id.length()
             << ", data.size=" << size
@@ -96,5 +156,47 @@ FileBlock FileBlock::deserialize(const char* buffer, size_t buffer_size) {
   std::memcpy(block.data.data(), buffer + offset, block.size);
   offset += block.size;
 
+  // Deserialize provenance ranges
+  uint32_t range_count = 0;
+  if (offset + sizeof(range_count) > buffer_size) return block;
+  std::memcpy(&range_count, buffer + offset, sizeof(range_count));
+  offset += sizeof(range_count);
+
+  for (uint32_t i = 0; i < range_count; ++i) {
+    BlockRange range;
+    uint32_t range_client_len = 0;
+    if (offset + sizeof(range_client_len) > buffer_size) return block;
+    std::memcpy(&range_client_len, buffer + offset, sizeof(range_client_len));
+    offset += sizeof(range_client_len);
+
+    if (offset + range_client_len > buffer_size) return block;
+    range.client_id.assign(buffer + offset, range_client_len);
+    offset += range_client_len;
+
+    if (offset + sizeof(range.first_sequence) + sizeof(range.last_sequence) +
+            sizeof(range.offset) + sizeof(range.length) >
+        buffer_size)
+      return block;
+    std::memcpy(&range.first_sequence, buffer + offset, sizeof(range.first_sequence));
+    offset += sizeof(range.first_sequence);
+    std::memcpy(&range.last_sequence, buffer + offset, sizeof(range.last_sequence));
+    offset += sizeof(range.last_sequence);
+    std::memcpy(&range.offset, buffer + offset, sizeof(range.offset));
+    offset += sizeof(range.offset);
+    std::memcpy(&range.length, buffer + offset, sizeof(range.length));
+    offset += sizeof(range.length);
+
+    uint32_t size_count = 0;
+    if (offset + sizeof(size_count) > buffer_size) return block;
+    std::memcpy(&size_count, buffer + offset, sizeof(size_count));
+    offset += sizeof(size_count);
+    if (size_count > (buffer_size - offset) / sizeof(uint32_t)) return block;
+    range.sizes.resize(size_count);
+    std::memcpy(range.sizes.data(), buffer + offset, size_count * sizeof(uint32_t));
+    offset += size_count * sizeof(uint32_t);
+
+    block.ranges.push_back(std::move(range));
+  }
+
   return block;
 }
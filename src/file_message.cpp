@@ -96,6 +96,207 @@ static std::vector<char> deserializeData(const char* buffer, size_t buffer_size,
   return data;
 }
 
+// Helpers to serialize fixed-width integers in network byte order
+static size_t serializeU8(char* buffer, size_t buffer_size, size_t offset, uint8_t value) {
+  if (offset + sizeof(value) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  buffer[offset] = static_cast<char>(value);
+  return offset + sizeof(value);
+}
+
+static size_t serializeU16(char* buffer, size_t buffer_size, size_t offset, uint16_t value) {
+  uint16_t network_value = htons(value);
+  if (offset + sizeof(network_value) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(buffer + offset, &network_value, sizeof(network_value));
+  return offset + sizeof(network_value);
+}
+
+static size_t serializeU32(char* buffer, size_t buffer_size, size_t offset, uint32_t value) {
+  uint32_t network_value = htonl(value);
+  if (offset + sizeof(network_value) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(buffer + offset, &network_value, sizeof(network_value));
+  return offset + sizeof(network_value);
+}
+
+static size_t serializeU64(char* buffer, size_t buffer_size, size_t offset, uint64_t value) {
+  uint64_t network_value = htobe64(value);
+  if (offset + sizeof(network_value) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(buffer + offset, &network_value, sizeof(network_value));
+  return offset + sizeof(network_value);
+}
+
+static uint8_t deserializeU8(const char* buffer, size_t buffer_size, size_t& offset) {
+  if (offset + sizeof(uint8_t) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  return static_cast<uint8_t>(buffer[offset++]);
+}
+
+static uint16_t deserializeU16(const char* buffer, size_t buffer_size, size_t& offset) {
+  uint16_t network_value;
+  if (offset + sizeof(network_value) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(&network_value, buffer + offset, sizeof(network_value));
+  offset += sizeof(network_value);
+  return ntohs(network_value);
+}
+
+static uint32_t deserializeU32(const char* buffer, size_t buffer_size, size_t& offset) {
+  uint32_t network_value;
+  if (offset + sizeof(network_value) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(&network_value, buffer + offset, sizeof(network_value));
+  offset += sizeof(network_value);
+  return ntohl(network_value);
+}
+
+static uint64_t deserializeU64(const char* buffer, size_t buffer_size, size_t& offset) {
+  uint64_t network_value;
+  if (offset + sizeof(network_value) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(&network_value, buffer + offset, sizeof(network_value));
+  offset += sizeof(network_value);
+  return be64toh(network_value);
+}
+
+// Helper to serialize a list of 64-bit values (block IDs, hashes)
+static size_t serializeU64List(char* buffer, size_t buffer_size, size_t offset,
+                               const std::vector<uint64_t>& values) {
+  offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(values.size()));
+  for (uint64_t value : values) {
+    offset = serializeU64(buffer, buffer_size, offset, value);
+  }
+  return offset;
+}
+
+static std::vector<uint64_t> deserializeU64List(const char* buffer, size_t buffer_size,
+                                                size_t& offset) {
+  uint32_t count = deserializeU32(buffer, buffer_size, offset);
+  if (offset + size_t(count) * sizeof(uint64_t) > buffer_size) {
+    throw std::runtime_error("Buffer too small for list");
+  }
+  std::vector<uint64_t> values;
+  values.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    values.push_back(deserializeU64(buffer, buffer_size, offset));
+  }
+  return values;
+}
+
+// Helper to serialize a list of blocks
+static size_t serializeBlocks(char* buffer, size_t buffer_size, size_t offset,
+                              const std::vector<FileBlock>& blocks) {
+  offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(blocks.size()));
+  for (const auto& block : blocks) {
+    size_t block_size = block.serialize(buffer + offset, buffer_size - offset);
+    if (block_size == 0) {
+      throw std::runtime_error("Failed to serialize block");
+    }
+    offset += block_size;
+  }
+  return offset;
+}
+
+static std::vector<FileBlock> deserializeBlocks(const char* buffer, size_t buffer_size,
+                                                size_t& offset) {
+  uint32_t count = deserializeU32(buffer, buffer_size, offset);
+  std::vector<FileBlock> blocks;
+  for (uint32_t i = 0; i < count; i++) {
+    if (offset >= buffer_size) {
+      throw std::runtime_error("Buffer too small for blocks");
+    }
+    FileBlock block = FileBlock::deserialize(buffer + offset, buffer_size - offset);
+    offset += block.serializedSize();
+    blocks.push_back(std::move(block));
+  }
+  return blocks;
+}
+
+// Helper to serialize block digests; client ids are written once in a table and
+// referenced by index, so a digest entry costs ~28 bytes
+static size_t serializeDigests(char* buffer, size_t buffer_size, size_t offset,
+                               const std::vector<BlockDigest>& digests) {
+  std::vector<std::string> clients;
+  auto client_index = [&](const std::string& client_id) {
+    for (size_t i = 0; i < clients.size(); i++) {
+      if (clients[i] == client_id) return static_cast<uint16_t>(i);
+    }
+    clients.push_back(client_id);
+    return static_cast<uint16_t>(clients.size() - 1);
+  };
+  for (const auto& digest : digests) {
+    client_index(digest.client_id);
+    for (const auto& range : digest.ranges) {
+      client_index(range.client_id);
+    }
+  }
+
+  offset = serializeU16(buffer, buffer_size, offset, static_cast<uint16_t>(clients.size()));
+  for (const auto& client_id : clients) {
+    offset = serializeString(buffer, buffer_size, offset, client_id);
+  }
+
+  offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(digests.size()));
+  for (const auto& digest : digests) {
+    offset = serializeU64(buffer, buffer_size, offset, digest.block_id);
+    offset = serializeU16(buffer, buffer_size, offset, client_index(digest.client_id));
+    offset = serializeU32(buffer, buffer_size, offset, digest.sequence_num);
+    offset = serializeU64(buffer, buffer_size, offset, digest.timestamp);
+    offset = serializeU32(buffer, buffer_size, offset, digest.size);
+    offset = serializeU16(buffer, buffer_size, offset, static_cast<uint16_t>(digest.ranges.size()));
+    for (const auto& range : digest.ranges) {
+      offset = serializeU16(buffer, buffer_size, offset, client_index(range.client_id));
+      offset = serializeU32(buffer, buffer_size, offset, range.first_sequence);
+      offset = serializeU32(buffer, buffer_size, offset, range.last_sequence);
+      offset = serializeU64(buffer, buffer_size, offset, range.offset);
+      offset = serializeU64(buffer, buffer_size, offset, range.length);
+    }
+  }
+  return offset;
+}
+
+static std::vector<BlockDigest> deserializeDigests(const char* buffer, size_t buffer_size,
+                                                   size_t& offset) {
+  std::vector<std::string> clients(deserializeU16(buffer, buffer_size, offset));
+  for (auto& client_id : clients) {
+    client_id = deserializeString(buffer, buffer_size, offset);
+  }
+  auto client_at = [&](uint16_t index) -> const std::string& {
+    if (index >= clients.size()) {
+      throw std::runtime_error("Bad client index in digest");
+    }
+    return clients[index];
+  };
+
+  std::vector<BlockDigest> digests(deserializeU32(buffer, buffer_size, offset));
+  for (auto& digest : digests) {
+    digest.block_id = deserializeU64(buffer, buffer_size, offset);
+    digest.client_id = client_at(deserializeU16(buffer, buffer_size, offset));
+    digest.sequence_num = deserializeU32(buffer, buffer_size, offset);
+    digest.timestamp = deserializeU64(buffer, buffer_size, offset);
+    digest.size = deserializeU32(buffer, buffer_size, offset);
+    digest.ranges.resize(deserializeU16(buffer, buffer_size, offset));
+    for (auto& range : digest.ranges) {
+      range.client_id = client_at(deserializeU16(buffer, buffer_size, offset));
+      range.first_sequence = deserializeU32(buffer, buffer_size, offset);
+      range.last_sequence = deserializeU32(buffer, buffer_size, offset);
+      range.offset = deserializeU64(buffer, buffer_size, offset);
+      range.length = deserializeU64(buffer, buffer_size, offset);
+    }
+  }
+  return digests;
+}
+
 // ===== CreateFileRequest =====
 size_t CreateFileRequest::serialize(char* buffer, size_t buffer_size) const {
   size_t offset = 0;
@@ -111,6 +312,8 @@ size_t CreateFileRequest::serialize(char* buffer, size_t buffer_size) const {
   offset += sizeof(network_client_id);
 
   offset = serializeData(buffer, buffer_size, offset, data);
+  offset = serializeString(buffer, buffer_size, offset, creator_id);
+  offset = serializeU64(buffer, buffer_size, offset, timestamp);
 
   return offset;
 }
@@ -129,6 +332,8 @@ CreateFileRequest CreateFileRequest::deserialize(const char* buffer, size_t buff
 
   req.data = deserializeData(buffer, buffer_size, offset);
   req.data_size = req.data.size();
+  req.creator_id = deserializeString(buffer, buffer_size, offset);
+  req.timestamp = deserializeU64(buffer, buffer_size, offset);
 
   return req;
 }
@@ -190,6 +395,8 @@ size_t GetFileRequest::serialize(char* buffer, size_t buffer_size) const {
   std::memcpy(buffer + offset, &network_seq, sizeof(network_seq));
   offset += sizeof(network_seq);
 
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+
   return offset;
 }
 
@@ -210,6 +417,8 @@ GetFileRequest GetFileRequest::deserialize(const char* buffer, size_t buffer_siz
   req.last_known_sequence = ntohl(network_seq);
   offset += sizeof(network_seq);
 
+  req.request_id = deserializeU64(buffer, buffer_size, offset);
+
   return req;
 }
 
@@ -220,6 +429,8 @@ size_t GetFileResponse::serialize(char* buffer, size_t buffer_size) const {
   buffer[offset] = success ? 1 : 0;
   offset += 1;
 
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU32(buffer, buffer_size, offset, lease_ms);
   offset = serializeString(buffer, buffer_size, offset, error_message);
 
   // Serialize metadata
@@ -267,13 +478,12 @@ GetFileResponse GetFileResponse::deserialize(const char* buffer, size_t buffer_s
   resp.success = buffer[offset] != 0;
   offset += 1;
 
+  resp.request_id = deserializeU64(buffer, buffer_size, offset);
+  resp.lease_ms = deserializeU32(buffer, buffer_size, offset);
   resp.error_message = deserializeString(buffer, buffer_size, offset);
 
-  // For failed responses, metadata and blocks may be empty
-  if (!resp.success) {
-    return resp;
-  }
-
+  // Failed responses still carry the metadata (at least the file), so the reader can
+  // match them to its request; their block list is empty
   // Deserialize metadata - need to calculate actual size consumed
   resp.metadata = FileMetadata::deserialize(buffer + offset, buffer_size - offset);
 
@@ -315,35 +525,126 @@ GetFileResponse GetFileResponse::deserialize(const char* buffer, size_t buffer_s
               << ", data.size()=" << block.data.size()
               << ", client_id.length()=" << block.client_id.length() << std::endl;
 
-    // Calculate actual block size by reading directly from buffer
-    // Block format: block_id(8) + client_id_len(4) + client_id + sequence_num(4) +
-    //              timestamp(8) + size(8 on 64-bit) + data
-    size_t block_offset = 0;
-    block_offset += sizeof(uint64_t);  // block_id
+    // Advance by the exact number of bytes the block occupies on the wire
+    size_t block_offset = block.serializedSize();
 
-    // Read client_id length from buffer
-    uint32_t client_id_len = 0;
-    if (offset + block_offset + sizeof(client_id_len) <= buffer_size) {
-      std::memcpy(&client_id_len, buffer + offset + block_offset, sizeof(client_id_len));
-    }
-    std::cout << "[DESER] Read client_id_len from buffer: " << client_id_len << std::endl;
-    block_offset += sizeof(uint32_t);  // client_id length
-    block_offset += client_id_len;  // client_id data
+    std::cout << "[DESER] Block " << i << " consumed " << block_offset << " bytes, next offset: " << (offset + block_offset) << std::endl;
+    offset += block_offset;
+  }
+
+  return resp;
+}
+
+// ===== GetSinceRequest =====
+size_t GetSinceRequest::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  offset = serializeString(buffer, buffer_size, offset, local_filename);
+
+  uint64_t network_timestamp = htobe64(since_timestamp);
+  uint64_t network_block_id = htobe64(since_block_id);
+  if (offset + sizeof(network_timestamp) + sizeof(network_block_id) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(buffer + offset, &network_timestamp, sizeof(network_timestamp));
+  offset += sizeof(network_timestamp);
+  std::memcpy(buffer + offset, &network_block_id, sizeof(network_block_id));
+  offset += sizeof(network_block_id);
+
+  return offset;
+}
+
+GetSinceRequest GetSinceRequest::deserialize(const char* buffer, size_t buffer_size) {
+  GetSinceRequest req;
+  size_t offset = 0;
+
+  req.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  req.local_filename = deserializeString(buffer, buffer_size, offset);
+
+  uint64_t network_timestamp;
+  uint64_t network_block_id;
+  if (offset + sizeof(network_timestamp) + sizeof(network_block_id) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(&network_timestamp, buffer + offset, sizeof(network_timestamp));
+  req.since_timestamp = be64toh(network_timestamp);
+  offset += sizeof(network_timestamp);
+  std::memcpy(&network_block_id, buffer + offset, sizeof(network_block_id));
+  req.since_block_id = be64toh(network_block_id);
+  offset += sizeof(network_block_id);
+
+  return req;
+}
+
+// ===== GetSinceResponse =====
+size_t GetSinceResponse::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
 
-    block_offset += sizeof(uint32_t);  // sequence_num
-    block_offset += sizeof(uint64_t);  // timestamp
+  if (offset + 3 > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  buffer[offset++] = success ? 1 : 0;
+  buffer[offset++] = anchor_found ? 1 : 0;
+  buffer[offset++] = more ? 1 : 0;
+
+  offset = serializeString(buffer, buffer_size, offset, error_message);
+  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+
+  uint32_t network_version = htonl(version);
+  uint32_t network_count = htonl(static_cast<uint32_t>(blocks.size()));
+  if (offset + sizeof(network_version) + sizeof(network_count) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(buffer + offset, &network_version, sizeof(network_version));
+  offset += sizeof(network_version);
+  std::memcpy(buffer + offset, &network_count, sizeof(network_count));
+  offset += sizeof(network_count);
 
-    // Read actual data size from buffer (size_t is 8 bytes on 64-bit systems)
-    size_t data_size = 0;
-    if (offset + block_offset + sizeof(size_t) <= buffer_size) {
-      std::memcpy(&data_size, buffer + offset + block_offset, sizeof(size_t));
+  for (const auto& block : blocks) {
+    size_t block_size = block.serialize(buffer + offset, buffer_size - offset);
+    if (block_size == 0) {
+      throw std::runtime_error("Failed to serialize block");
     }
-    std::cout << "[DESER] Read data_size from buffer: " << data_size << std::endl;
-    block_offset += sizeof(size_t);  // size field (8 bytes on 64-bit)
-    block_offset += data_size;  // actual data
+    offset += block_size;
+  }
 
-    std::cout << "[DESER] Block " << i << " consumed " << block_offset << " bytes, next offset: " << (offset + block_offset) << std::endl;
-    offset += block_offset;
+  return offset;
+}
+
+GetSinceResponse GetSinceResponse::deserialize(const char* buffer, size_t buffer_size) {
+  GetSinceResponse resp;
+  size_t offset = 0;
+
+  if (buffer_size < 3) {
+    throw std::runtime_error("Buffer too small");
+  }
+  resp.success = buffer[offset++] != 0;
+  resp.anchor_found = buffer[offset++] != 0;
+  resp.more = buffer[offset++] != 0;
+
+  resp.error_message = deserializeString(buffer, buffer_size, offset);
+  resp.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+
+  uint32_t network_version;
+  uint32_t network_count;
+  if (offset + sizeof(network_version) + sizeof(network_count) > buffer_size) {
+    throw std::runtime_error("Buffer too small");
+  }
+  std::memcpy(&network_version, buffer + offset, sizeof(network_version));
+  resp.version = ntohl(network_version);
+  offset += sizeof(network_version);
+  std::memcpy(&network_count, buffer + offset, sizeof(network_count));
+  uint32_t block_count = ntohl(network_count);
+  offset += sizeof(network_count);
+
+  for (uint32_t i = 0; i < block_count; ++i) {
+    if (offset >= buffer_size) {
+      throw std::runtime_error("Buffer too small");
+    }
+    FileBlock block = FileBlock::deserialize(buffer + offset, buffer_size - offset);
+    offset += block.serializedSize();
+    resp.blocks.push_back(std::move(block));
   }
 
   return resp;
@@ -371,6 +672,8 @@ size_t AppendFileRequest::serialize(char* buffer, size_t buffer_size) const {
   offset += sizeof(network_seq);
 
   offset = serializeData(buffer, buffer_size, offset, data);
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU8(buffer, buffer_size, offset, static_cast<uint8_t>(consistency));
 
   return offset;
 }
@@ -394,6 +697,8 @@ AppendFileRequest AppendFileRequest::deserialize(const char* buffer, size_t buff
 
   req.data = deserializeData(buffer, buffer_size, offset);
   req.data_size = req.data.size();
+  req.request_id = deserializeU64(buffer, buffer_size, offset);
+  req.consistency = static_cast<ConsistencyLevel>(deserializeU8(buffer, buffer_size, offset));
 
   return req;
 }
@@ -414,6 +719,9 @@ size_t AppendFileResponse::serialize(char* buffer, size_t buffer_size) const {
   std::memcpy(buffer + offset, &network_block_id, sizeof(network_block_id));
   offset += sizeof(network_block_id);
 
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU32(buffer, buffer_size, offset, acks);
+
   return offset;
 }
 
@@ -431,6 +739,9 @@ AppendFileResponse AppendFileResponse::deserialize(const char* buffer, size_t bu
   resp.block_id = be64toh(network_block_id);
   offset += sizeof(network_block_id);
 
+  resp.request_id = deserializeU64(buffer, buffer_size, offset);
+  resp.acks = deserializeU32(buffer, buffer_size, offset);
+
   return resp;
 }
 
@@ -725,41 +1036,179 @@ FileExistsResponse FileExistsResponse::deserialize(const char* buffer, size_t bu
   return resp;
 }
 
-// ===== ReplicateBlockMessage =====
-size_t ReplicateBlockMessage::serialize(char* buffer, size_t buffer_size) const {
+static size_t serializeNodeId(char* buffer, size_t buffer_size, size_t offset,
+                              const NodeId& node) {
+  if (offset > buffer_size) {
+    throw std::runtime_error("Buffer too small for node");
+  }
+  return offset + node.serialize(buffer + offset, buffer_size - offset);
+}
+
+static NodeId deserializeNodeId(const char* buffer, size_t buffer_size, size_t& offset) {
+  if (offset > buffer_size) {
+    throw std::runtime_error("Buffer too small for node");
+  }
+  NodeId node = NodeId::deserialize(buffer + offset, buffer_size - offset);
+  offset += sizeof(node.host) + sizeof(node.port) + sizeof(node.time);
+  return node;
+}
+
+// ===== ReplicateBlocksMessage =====
+size_t ReplicateBlocksMessage::blockCount() const {
+  size_t count = 0;
+  for (const auto& file : files) {
+    count += file.blocks.size();
+  }
+  return count;
+}
+
+size_t ReplicateBlocksMessage::serialize(char* buffer, size_t buffer_size) const {
   size_t offset = 0;
 
-  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(files.size()));
+  for (const auto& file : files) {
+    offset = serializeString(buffer, buffer_size, offset, file.hydfs_filename);
+    offset = serializeU64(buffer, buffer_size, offset, file.lsn);
+    offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(file.blocks.size()));
+    for (const auto& block : file.blocks) {
+      size_t block_size = block.serialize(buffer + offset, buffer_size - offset);
+      if (block_size == 0) {
+        throw std::runtime_error("Failed to serialize block");
+      }
+      offset += block_size;
+    }
+    offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(file.replies.size()));
+    for (const auto& reply : file.replies) {
+      offset = serializeU32(buffer, buffer_size, offset, reply.client_ip);
+      offset = serializeU16(buffer, buffer_size, offset, reply.client_port);
+      offset = serializeU64(buffer, buffer_size, offset, reply.request_id);
+      offset = serializeU8(buffer, buffer_size, offset, reply.needed);
+    }
+  }
 
-  size_t block_size = block.serialize(buffer + offset, buffer_size - offset);
-  if (block_size == 0) {
-    throw std::runtime_error("Failed to serialize block");
+  offset = serializeNodeId(buffer, buffer_size, offset, head);
+  offset = serializeU8(buffer, buffer_size, offset, chained ? 1 : 0);
+  if (chained) {
+    offset = serializeU32(buffer, buffer_size, offset, stored_by);
+    offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(chain.size()));
+    for (const auto& hop : chain) {
+      offset = serializeNodeId(buffer, buffer_size, offset, hop);
+    }
   }
-  offset += block_size;
 
   return offset;
 }
 
-ReplicateBlockMessage ReplicateBlockMessage::deserialize(const char* buffer, size_t buffer_size) {
-  ReplicateBlockMessage msg;
+ReplicateBlocksMessage ReplicateBlocksMessage::deserialize(const char* buffer,
+                                                           size_t buffer_size) {
+  ReplicateBlocksMessage msg;
   size_t offset = 0;
 
-  msg.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  msg.request_id = deserializeU64(buffer, buffer_size, offset);
+  uint32_t file_count = deserializeU32(buffer, buffer_size, offset);
+  for (uint32_t i = 0; i < file_count; i++) {
+    ReplicatedFile file;
+    file.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+    file.lsn = deserializeU64(buffer, buffer_size, offset);
+    uint32_t block_count = deserializeU32(buffer, buffer_size, offset);
+    for (uint32_t j = 0; j < block_count; j++) {
+      if (offset >= buffer_size) {
+        throw std::runtime_error("Buffer too small for blocks");
+      }
+      file.blocks.push_back(FileBlock::deserialize(buffer + offset, buffer_size - offset));
+      offset += file.blocks.back().serializedSize();
+    }
+    uint32_t reply_count = deserializeU32(buffer, buffer_size, offset);
+    for (uint32_t j = 0; j < reply_count; j++) {
+      ChainReply reply;
+      reply.client_ip = deserializeU32(buffer, buffer_size, offset);
+      reply.client_port = deserializeU16(buffer, buffer_size, offset);
+      reply.request_id = deserializeU64(buffer, buffer_size, offset);
+      reply.needed = deserializeU8(buffer, buffer_size, offset);
+      file.replies.push_back(reply);
+    }
+    msg.files.push_back(std::move(file));
+  }
 
-  msg.block = FileBlock::deserialize(buffer + offset, buffer_size - offset);
+  msg.head = deserializeNodeId(buffer, buffer_size, offset);
+  msg.chained = deserializeU8(buffer, buffer_size, offset) != 0;
+  if (msg.chained) {
+    msg.stored_by = deserializeU32(buffer, buffer_size, offset);
+    uint32_t hops = deserializeU32(buffer, buffer_size, offset);
+    for (uint32_t i = 0; i < hops; i++) {
+      msg.chain.push_back(deserializeNodeId(buffer, buffer_size, offset));
+    }
+  }
 
   return msg;
 }
 
+// ===== ReplicateBlocksAck =====
+size_t ReplicateBlocksAck::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU32(buffer, buffer_size, offset, applied);
+
+  return offset;
+}
+
+ReplicateBlocksAck ReplicateBlocksAck::deserialize(const char* buffer, size_t buffer_size) {
+  ReplicateBlocksAck ack;
+  size_t offset = 0;
+
+  ack.request_id = deserializeU64(buffer, buffer_size, offset);
+  ack.applied = deserializeU32(buffer, buffer_size, offset);
+
+  return ack;
+}
+
+// ===== ReplicateGapRequest =====
+size_t ReplicateGapRequest::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  offset = serializeU64(buffer, buffer_size, offset, from_lsn);
+  offset = serializeU64(buffer, buffer_size, offset, to_lsn);
+
+  return offset;
+}
+
+ReplicateGapRequest ReplicateGapRequest::deserialize(const char* buffer, size_t buffer_size) {
+  ReplicateGapRequest req;
+  size_t offset = 0;
+
+  req.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  req.from_lsn = deserializeU64(buffer, buffer_size, offset);
+  req.to_lsn = deserializeU64(buffer, buffer_size, offset);
+
+  return req;
+}
+
 // ===== CollectBlocksRequest =====
 size_t CollectBlocksRequest::serialize(char* buffer, size_t buffer_size) const {
-  return serializeString(buffer, buffer_size, 0, hydfs_filename);
+  size_t offset = 0;
+
+  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU8(buffer, buffer_size, offset, summary_only ? 1 : 0);
+  offset = serializeU32(buffer, buffer_size, offset, digest_from);
+  offset = serializeU64List(buffer, buffer_size, offset, wanted_block_ids);
+
+  return offset;
 }
 
 CollectBlocksRequest CollectBlocksRequest::deserialize(const char* buffer, size_t buffer_size) {
   CollectBlocksRequest req;
   size_t offset = 0;
+
   req.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  req.request_id = deserializeU64(buffer, buffer_size, offset);
+  req.summary_only = deserializeU8(buffer, buffer_size, offset) != 0;
+  req.digest_from = deserializeU32(buffer, buffer_size, offset);
+  req.wanted_block_ids = deserializeU64List(buffer, buffer_size, offset);
+
   return req;
 }
 
@@ -768,115 +1217,312 @@ size_t CollectBlocksResponse::serialize(char* buffer, size_t buffer_size) const
   size_t offset = 0;
 
   offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU8(buffer, buffer_size, offset, found ? 1 : 0);
+  offset = serializeU32(buffer, buffer_size, offset, version);
+  offset = serializeU32(buffer, buffer_size, offset, total_blocks);
+  offset = serializeU64(buffer, buffer_size, offset, list_hash);
+  offset = serializeU32(buffer, buffer_size, offset, digest_from);
+  offset = serializeDigests(buffer, buffer_size, offset, digests);
+  offset = serializeBlocks(buffer, buffer_size, offset, blocks);
 
-  uint32_t block_count = blocks.size();
-  uint32_t network_count = htonl(block_count);
-  if (offset + sizeof(network_count) > buffer_size) {
-    throw std::runtime_error("Buffer too small");
-  }
-  std::memcpy(buffer + offset, &network_count, sizeof(network_count));
-  offset += sizeof(network_count);
+  return offset;
+}
 
-  for (const auto& block : blocks) {
-    size_t block_size = block.serialize(buffer + offset, buffer_size - offset);
-    if (block_size == 0) {
-      throw std::runtime_error("Failed to serialize block");
-    }
-    offset += block_size;
+CollectBlocksResponse CollectBlocksResponse::deserialize(const char* buffer, size_t buffer_size) {
+  CollectBlocksResponse resp;
+  size_t offset = 0;
+
+  resp.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  resp.request_id = deserializeU64(buffer, buffer_size, offset);
+  resp.found = deserializeU8(buffer, buffer_size, offset) != 0;
+  resp.version = deserializeU32(buffer, buffer_size, offset);
+  resp.total_blocks = deserializeU32(buffer, buffer_size, offset);
+  resp.list_hash = deserializeU64(buffer, buffer_size, offset);
+  resp.digest_from = deserializeU32(buffer, buffer_size, offset);
+  resp.digests = deserializeDigests(buffer, buffer_size, offset);
+  resp.blocks = deserializeBlocks(buffer, buffer_size, offset);
+
+  return resp;
+}
+
+// ===== MergeUpdateMessage =====
+size_t MergeUpdateMessage::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU32(buffer, buffer_size, offset, new_version);
+  offset = serializeU32(buffer, buffer_size, offset, page);
+  offset = serializeU32(buffer, buffer_size, offset, page_count);
+  offset = serializeU64List(buffer, buffer_size, offset, merged_block_ids);
+  offset = serializeBlocks(buffer, buffer_size, offset, blocks);
+  offset = serializeU8(buffer, buffer_size, offset, commit ? 1 : 0);
+
+  return offset;
+}
+
+MergeUpdateMessage MergeUpdateMessage::deserialize(const char* buffer, size_t buffer_size) {
+  MergeUpdateMessage msg;
+  size_t offset = 0;
+
+  msg.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  msg.request_id = deserializeU64(buffer, buffer_size, offset);
+  msg.new_version = deserializeU32(buffer, buffer_size, offset);
+  msg.page = deserializeU32(buffer, buffer_size, offset);
+  msg.page_count = deserializeU32(buffer, buffer_size, offset);
+  msg.merged_block_ids = deserializeU64List(buffer, buffer_size, offset);
+  msg.blocks = deserializeBlocks(buffer, buffer_size, offset);
+  msg.commit = deserializeU8(buffer, buffer_size, offset) != 0;
+
+  return msg;
+}
+
+// ===== MergeUpdateAck =====
+size_t MergeUpdateAck::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU8(buffer, buffer_size, offset, success ? 1 : 0);
+  offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(missing_pages.size()));
+  for (uint32_t page : missing_pages) {
+    offset = serializeU32(buffer, buffer_size, offset, page);
   }
 
-  uint32_t network_version = htonl(version);
-  if (offset + sizeof(network_version) > buffer_size) {
-    throw std::runtime_error("Buffer too small");
+  return offset;
+}
+
+MergeUpdateAck MergeUpdateAck::deserialize(const char* buffer, size_t buffer_size) {
+  MergeUpdateAck ack;
+  size_t offset = 0;
+
+  ack.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  ack.request_id = deserializeU64(buffer, buffer_size, offset);
+  ack.success = deserializeU8(buffer, buffer_size, offset) != 0;
+  uint32_t missing = deserializeU32(buffer, buffer_size, offset);
+  for (uint32_t i = 0; i < missing; i++) {
+    ack.missing_pages.push_back(deserializeU32(buffer, buffer_size, offset));
   }
-  std::memcpy(buffer + offset, &network_version, sizeof(network_version));
-  offset += sizeof(network_version);
+
+  return ack;
+}
+
+// ===== TruncateFileMessage =====
+size_t TruncateFileMessage::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU64(buffer, buffer_size, offset, through_timestamp);
 
   return offset;
 }
 
-CollectBlocksResponse CollectBlocksResponse::deserialize(const char* buffer, size_t buffer_size) {
-  CollectBlocksResponse resp;
+TruncateFileMessage TruncateFileMessage::deserialize(const char* buffer, size_t buffer_size) {
+  TruncateFileMessage msg;
   size_t offset = 0;
 
-  resp.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  msg.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  msg.request_id = deserializeU64(buffer, buffer_size, offset);
+  msg.through_timestamp = deserializeU64(buffer, buffer_size, offset);
 
-  uint32_t network_count;
-  std::memcpy(&network_count, buffer + offset, sizeof(network_count));
-  uint32_t block_count = ntohl(network_count);
-  offset += sizeof(network_count);
+  return msg;
+}
 
-  for (uint32_t i = 0; i < block_count; ++i) {
-    FileBlock block = FileBlock::deserialize(buffer + offset, buffer_size - offset);
-    resp.blocks.push_back(block);
-    // Calculate block offset
-    offset += sizeof(uint64_t) * 3 + sizeof(uint32_t) * 2 + sizeof(uint32_t) +
-              block.client_id.length() + block.size;
-  }
+// ===== TruncateFileAck =====
+size_t TruncateFileAck::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
 
-  uint32_t network_version;
-  std::memcpy(&network_version, buffer + offset, sizeof(network_version));
-  resp.version = ntohl(network_version);
-  offset += sizeof(network_version);
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU8(buffer, buffer_size, offset, success ? 1 : 0);
 
-  return resp;
+  return offset;
 }
 
-// ===== MergeUpdateMessage =====
-size_t MergeUpdateMessage::serialize(char* buffer, size_t buffer_size) const {
+TruncateFileAck TruncateFileAck::deserialize(const char* buffer, size_t buffer_size) {
+  TruncateFileAck ack;
   size_t offset = 0;
 
+  ack.request_id = deserializeU64(buffer, buffer_size, offset);
+  ack.success = deserializeU8(buffer, buffer_size, offset) != 0;
+
+  return ack;
+}
+
+// ===== LeaseInvalidateMessage =====
+size_t LeaseInvalidateMessage::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
   offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  return offset;
+}
 
-  uint32_t block_count = merged_block_ids.size();
-  uint32_t network_count = htonl(block_count);
-  if (offset + sizeof(network_count) > buffer_size) {
-    throw std::runtime_error("Buffer too small");
+LeaseInvalidateMessage LeaseInvalidateMessage::deserialize(const char* buffer,
+                                                           size_t buffer_size) {
+  LeaseInvalidateMessage msg;
+  size_t offset = 0;
+  msg.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  return msg;
+}
+
+// ===== GetCancelMessage =====
+size_t GetCancelMessage::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+  return offset;
+}
+
+GetCancelMessage GetCancelMessage::deserialize(const char* buffer, size_t buffer_size) {
+  GetCancelMessage msg;
+  size_t offset = 0;
+  msg.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  return msg;
+}
+
+// ===== DeleteFileMessage =====
+size_t DeleteFileMessage::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeString(buffer, buffer_size, offset, hydfs_filename);
+
+  return offset;
+}
+
+DeleteFileMessage DeleteFileMessage::deserialize(const char* buffer, size_t buffer_size) {
+  DeleteFileMessage msg;
+  size_t offset = 0;
+
+  msg.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+
+  return msg;
+}
+
+// ===== MerkleRequest =====
+size_t MerkleRequest::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU64(buffer, buffer_size, offset, range_start);
+  offset = serializeU64(buffer, buffer_size, offset, range_end);
+  offset = serializeU8(buffer, buffer_size, offset, level);
+  offset = serializeU8(buffer, buffer_size, offset, want_files ? 1 : 0);
+  offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(indices.size()));
+  for (uint32_t index : indices) {
+    offset = serializeU32(buffer, buffer_size, offset, index);
   }
-  std::memcpy(buffer + offset, &network_count, sizeof(network_count));
-  offset += sizeof(network_count);
 
-  for (uint64_t block_id : merged_block_ids) {
-    uint64_t network_block_id = htobe64(block_id);
-    if (offset + sizeof(network_block_id) > buffer_size) {
-      throw std::runtime_error("Buffer too small");
-    }
-    std::memcpy(buffer + offset, &network_block_id, sizeof(network_block_id));
-    offset += sizeof(network_block_id);
+  return offset;
+}
+
+MerkleRequest MerkleRequest::deserialize(const char* buffer, size_t buffer_size) {
+  MerkleRequest req;
+  size_t offset = 0;
+
+  req.request_id = deserializeU64(buffer, buffer_size, offset);
+  req.range_start = deserializeU64(buffer, buffer_size, offset);
+  req.range_end = deserializeU64(buffer, buffer_size, offset);
+  req.level = deserializeU8(buffer, buffer_size, offset);
+  req.want_files = deserializeU8(buffer, buffer_size, offset) != 0;
+  uint32_t count = deserializeU32(buffer, buffer_size, offset);
+  if (offset + size_t(count) * sizeof(uint32_t) > buffer_size) {
+    throw std::runtime_error("Buffer too small for indices");
+  }
+  req.indices.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    req.indices.push_back(deserializeU32(buffer, buffer_size, offset));
   }
 
-  uint32_t network_version = htonl(new_version);
-  if (offset + sizeof(network_version) > buffer_size) {
-    throw std::runtime_error("Buffer too small");
+  return req;
+}
+
+// ===== MerkleResponse =====
+size_t MerkleResponse::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU64List(buffer, buffer_size, offset, hashes);
+  offset = serializeU32(buffer, buffer_size, offset, leaves_complete);
+  offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(files.size()));
+  for (const auto& file : files) {
+    offset = serializeString(buffer, buffer_size, offset, file.hydfs_filename);
+    offset = serializeU64(buffer, buffer_size, offset, file.digest);
   }
-  std::memcpy(buffer + offset, &network_version, sizeof(network_version));
-  offset += sizeof(network_version);
 
   return offset;
 }
 
-MergeUpdateMessage MergeUpdateMessage::deserialize(const char* buffer, size_t buffer_size) {
-  MergeUpdateMessage msg;
+MerkleResponse MerkleResponse::deserialize(const char* buffer, size_t buffer_size) {
+  MerkleResponse resp;
   size_t offset = 0;
 
-  msg.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+  resp.request_id = deserializeU64(buffer, buffer_size, offset);
+  resp.hashes = deserializeU64List(buffer, buffer_size, offset);
+  resp.leaves_complete = deserializeU32(buffer, buffer_size, offset);
+  uint32_t count = deserializeU32(buffer, buffer_size, offset);
+  for (uint32_t i = 0; i < count; i++) {
+    MerkleFileDigest file;
+    file.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+    file.digest = deserializeU64(buffer, buffer_size, offset);
+    resp.files.push_back(std::move(file));
+  }
 
-  uint32_t network_count;
-  std::memcpy(&network_count, buffer + offset, sizeof(network_count));
-  uint32_t block_count = ntohl(network_count);
-  offset += sizeof(network_count);
+  return resp;
+}
 
-  for (uint32_t i = 0; i < block_count; ++i) {
-    uint64_t network_block_id;
-    std::memcpy(&network_block_id, buffer + offset, sizeof(network_block_id));
-    msg.merged_block_ids.push_back(be64toh(network_block_id));
-    offset += sizeof(network_block_id);
+// ===== HintBatchMessage =====
+size_t HintBatchMessage::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU32(buffer, buffer_size, offset, static_cast<uint32_t>(hints.size()));
+  for (const auto& hint : hints) {
+    offset = serializeString(buffer, buffer_size, offset, hint.hydfs_filename);
+    size_t block_size = hint.block.serialize(buffer + offset, buffer_size - offset);
+    if (block_size == 0) {
+      throw std::runtime_error("Failed to serialize block");
+    }
+    offset += block_size;
   }
 
-  uint32_t network_version;
-  std::memcpy(&network_version, buffer + offset, sizeof(network_version));
-  msg.new_version = ntohl(network_version);
-  offset += sizeof(network_version);
+  return offset;
+}
+
+HintBatchMessage HintBatchMessage::deserialize(const char* buffer, size_t buffer_size) {
+  HintBatchMessage msg;
+  size_t offset = 0;
+
+  msg.request_id = deserializeU64(buffer, buffer_size, offset);
+  uint32_t count = deserializeU32(buffer, buffer_size, offset);
+  for (uint32_t i = 0; i < count; i++) {
+    HintEntry hint;
+    hint.hydfs_filename = deserializeString(buffer, buffer_size, offset);
+    if (offset >= buffer_size) {
+      throw std::runtime_error("Buffer too small for blocks");
+    }
+    hint.block = FileBlock::deserialize(buffer + offset, buffer_size - offset);
+    offset += hint.block.serializedSize();
+    msg.hints.push_back(std::move(hint));
+  }
 
   return msg;
 }
+
+// ===== HintBatchAck =====
+size_t HintBatchAck::serialize(char* buffer, size_t buffer_size) const {
+  size_t offset = 0;
+
+  offset = serializeU64(buffer, buffer_size, offset, request_id);
+  offset = serializeU8(buffer, buffer_size, offset, success ? 1 : 0);
+
+  return offset;
+}
+
+HintBatchAck HintBatchAck::deserialize(const char* buffer, size_t buffer_size) {
+  HintBatchAck ack;
+  size_t offset = 0;
+
+  ack.request_id = deserializeU64(buffer, buffer_size, offset);
+  ack.success = deserializeU8(buffer, buffer_size, offset) != 0;
+
+  return ack;
+}
@@ -1,12 +1,20 @@
 #include "file_metadata.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <cstring>
 #include <functional>
 
-uint64_t FileMetadata::generateFileId(const std::string& filename) {
+FileId FileMetadata::generateFileId(const std::string& filename) {
   return std::hash<std::string>{}(filename);
 }
 
+size_t FileMetadata::serializedSize() const {
+  return sizeof(uint32_t) + hydfs_filename.length() + sizeof(file_id) + sizeof(total_size) +
+         sizeof(version) + sizeof(created_timestamp) + sizeof(last_modified_timestamp) +
+         sizeof(uint32_t) + block_ids.size() * sizeof(uint64_t);
+}
+
 size_t FileMetadata::serialize(char* buffer, size_t buffer_size) const {
   size_t offset = 0;
 
@@ -51,8 +59,10 @@ size_t FileMetadata::serialize(char* buffer, size_t buffer_size) const {
   // Serialize block_ids
   size_t blocks_size = block_count * sizeof(uint64_t);
   if (offset + blocks_size > buffer_size) return 0;
-  std::memcpy(buffer + offset, block_ids.data(), blocks_size);
-  offset += blocks_size;
+  block_ids.forEachChunk([&](const uint64_t* ids, size_t count) {
+    std::memcpy(buffer + offset, ids, count * sizeof(uint64_t));
+    offset += count * sizeof(uint64_t);
+  });
 
   return offset;
 }
@@ -105,9 +115,28 @@ FileMetadata FileMetadata::deserialize(const char* buffer, size_t buffer_size) {
 
   size_t blocks_size = block_count * sizeof(uint64_t);
   if (offset + blocks_size > buffer_size) return metadata;
-  metadata.block_ids.resize(block_count);
-  std::memcpy(metadata.block_ids.data(), buffer + offset, blocks_size);
-  offset += blocks_size;
+  for (uint32_t i = 0; i < block_count; ++i) {
+    uint64_t block_id;
+    std::memcpy(&block_id, buffer + offset, sizeof(block_id));
+    metadata.block_ids.push_back(block_id);
+    offset += sizeof(block_id);
+  }
 
   return metadata;
 }
+
+bool parseConsistencyLevel(const std::string& text, ConsistencyLevel& level) {
+  std::string lower = text;
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (lower == "one") {
+    level = ConsistencyLevel::ONE;
+  } else if (lower == "quorum") {
+    level = ConsistencyLevel::QUORUM;
+  } else if (lower == "all") {
+    level = ConsistencyLevel::ALL;
+  } else {
+    return false;
+  }
+  return true;
+}
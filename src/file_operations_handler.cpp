@@ -1,13 +1,137 @@
 #include "file_operations_handler.hpp"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <chrono>
 #include <condition_variable>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <thread>
+#include <unordered_set>
+
+#include "merge_plan.hpp"
+
+// Block bytes per GET_SINCE reply, kept under the 8KB receive buffer
+static constexpr size_t GET_SINCE_REPLY_BYTES = 7000;
+
+// Encoded bytes of the files packed into one REPLICATE_BLOCKS message
+static constexpr size_t REPLICATE_BATCH_BYTES = 7000;
+
+// Recent blocks of a file searched for the blocks of a batch resent without an LSN, or
+// of a replayed hint batch; a resend follows the lost ack closely, so its blocks sit here
+static constexpr size_t REPLAY_WINDOW_BLOCKS = 1024;
+
+// Merge exchange limits: payload bytes per page, block IDs per fetch, wait per reply
+static constexpr size_t MERGE_PAGE_BYTES = 7000;
+static constexpr size_t MERGE_FETCH_BATCH = 500;
+static constexpr std::chrono::seconds MERGE_REPLY_TIMEOUT(2);
+
+// Merge page recovery: sends of an update (the first plus resends), missing pages per ack
+static constexpr int MERGE_SEND_ROUNDS = 4;
+static constexpr size_t MERGE_MISSING_PAGES = 128;
+
+// Sends of a truncation point to a replica (the first plus resends) before giving up on its ack
+static constexpr int TRUNCATE_SEND_ROUNDS = 3;
+
+// Anti-entropy limits: Merkle node hashes per request, leaves per file listing
+static constexpr size_t MERKLE_HASH_BATCH = 512;
+static constexpr size_t MERKLE_LEAF_BATCH = 64;
+
+// How long a QUORUM or ALL append waits for replica acks, and a client for the coordinator
+static constexpr std::chrono::seconds WRITE_ACK_TIMEOUT(2);
+static constexpr std::chrono::seconds CLIENT_REPLY_TIMEOUT(5);
+
+// Single-replica GETs: overall wait, and when to hedge to another replica before enough
+// latency samples exist (and never sooner than the floor)
+static constexpr std::chrono::seconds GET_REPLY_TIMEOUT(5);
+static constexpr std::chrono::milliseconds HEDGE_DEFAULT_DELAY(50);
+static constexpr std::chrono::milliseconds HEDGE_MIN_DELAY(5);
+static constexpr size_t HEDGE_MIN_SAMPLES = 16;
+
+// How long a reader may serve a file from its read cache without asking a replica again
+static constexpr std::chrono::seconds READ_LEASE(3);
+
+// Shortest gap between two read repairs of one file, so a hot file isn't checked on every read
+static constexpr std::chrono::seconds READ_REPAIR_INTERVAL(5);
+
+// Upper bound on the encoded size of a digest in a COLLECT_BLOCKS_RESPONSE
+static size_t digestBytes(const BlockDigest& digest) {
+  size_t bytes = 28 + 6 + digest.client_id.size();
+  for (const auto& range : digest.ranges) {
+    bytes += 26 + 6 + range.client_id.size();
+  }
+  return bytes;
+}
+
+// The wanted block IDs among the file's last REPLAY_WINDOW_BLOCKS blocks
+static std::unordered_set<uint64_t> heldRecently(const FileSnapshot& current,
+                                                 const std::unordered_set<uint64_t>& wanted) {
+  std::unordered_set<uint64_t> held;
+  size_t scanned = 0;
+  if (!current || wanted.empty()) {
+    return held;
+  }
+  current->metadata.block_ids.forEachChunkReverse([&](const uint64_t* ids, size_t count) {
+    for (size_t i = count; i-- > 0 && held.size() < wanted.size(); scanned++) {
+      if (scanned == REPLAY_WINDOW_BLOCKS) return false;
+      if (wanted.count(ids[i])) held.insert(ids[i]);
+    }
+    return held.size() < wanted.size();
+  });
+  return held;
+}
+
+static BlockDigest digestOf(const FileBlock& block) {
+  return {block.block_id, block.client_id, block.sequence_num, block.timestamp,
+          static_cast<uint32_t>(block.size), block.ranges};
+}
+
+// One copy of a file from the replies of several replicas. Version counters are per
+// replica and can't rank copies, so copies that differ are reconciled the way a merge
+// would: the union of their blocks in merge order, holding each append once even where
+// replicas stored it under different block IDs
+static GetFileResponse reconcileCopies(const std::vector<const GetFileResponse*>& copies) {
+  bool identical = std::all_of(copies.begin(), copies.end(), [&](const GetFileResponse* copy) {
+    return copy->metadata.block_ids == copies.front()->metadata.block_ids;
+  });
+  if (identical) {
+    return *copies.front();
+  }
+
+  std::vector<std::vector<BlockDigest>> digests(copies.size());
+  std::unordered_map<uint64_t, const FileBlock*> by_id;
+  const GetFileResponse* fullest = copies.front();
+  for (size_t r = 0; r < copies.size(); r++) {
+    for (const auto& block : copies[r]->blocks) {
+      digests[r].push_back(digestOf(block));
+      by_id.emplace(block.block_id, &block);
+    }
+    if (copies[r]->blocks.size() > fullest->blocks.size()) fullest = copies[r];
+  }
+  MergePlan plan = planMerge(digests);
+
+  GetFileResponse merged;
+  merged.success = true;
+  merged.request_id = fullest->request_id;
+  merged.lease_ms = 0;  // no replica holds this exact copy, so none can lease it
+  merged.metadata = fullest->metadata;
+  merged.metadata.block_ids.clear();
+  merged.metadata.total_size = 0;
+  for (const GetFileResponse* copy : copies) {
+    merged.metadata.version = std::max(merged.metadata.version, copy->metadata.version);
+  }
+  merged.blocks.reserve(plan.block_ids.size());
+  for (uint64_t block_id : plan.block_ids) {
+    const FileBlock& block = *by_id.at(block_id);
+    merged.metadata.block_ids.push_back(block_id);
+    merged.metadata.total_size += block.size;
+    merged.blocks.push_back(block);
+  }
+  return merged;
+}
 
 FileOperationsHandler::FileOperationsHandler(FileStore& file_store,
                                              ConsistentHashRing& hash_ring,
@@ -17,9 +141,33 @@ FileOperationsHandler::FileOperationsHandler(FileStore& file_store,
       hash_ring_(hash_ring),
       self_id_(self_id),
       logger_(logger),
-      socket_(socket) {
+      socket_(socket),
+      file_names_(file_store.fileNames()),
+      group_commit_([this](std::vector<GroupCommitter::Group>& groups) { dispatchGroups(groups); }),
+      sequencer_executor_(std::max(2u, std::thread::hardware_concurrency())),
+      sequencer_(sequencer_executor_),
+      get_executor_(std::max(2u, std::thread::hardware_concurrency())) {
   // Load all files from test_files/ directory into local cache
   loadTestFiles();
+
+  // Keep the Merkle tree in step with the store, starting from what it already holds
+  file_store_.setChangeListener([this](const std::string& filename, const FileSnapshot& version) {
+    merkle_tree_.update(filename, hash_ring_.getFilePosition(filename),
+                        version ? version->digest() : 0);
+    revokeLeases(filename);
+  });
+  for (const auto& filename : file_store_.listFiles()) {
+    if (FileSnapshot snapshot = file_store_.pinFile(filename)) {
+      merkle_tree_.update(filename, hash_ring_.getFilePosition(filename), snapshot->digest());
+    }
+  }
+  group_commit_.start();
+}
+
+FileOperationsHandler::~FileOperationsHandler() {
+  sequencer_executor_.shutdown();  // run queued appends into the committer
+  group_commit_.stop();  // commit queued appends while the rest of the handler is intact
+  file_store_.setChangeListener({});
 }
 
 void FileOperationsHandler::loadTestFiles() {
@@ -85,9 +233,10 @@ std::string FileOperationsHandler::getClientId() const {
   return ss.str();
 }
 
-uint32_t FileOperationsHandler::getNextSequenceNum(const std::string& hydfs_filename) {
-  std::lock_guard<std::mutex> lock(seq_mtx_);
-  return sequence_numbers_[hydfs_filename]++;
+FileId FileOperationsHandler::knownFileId(const std::string& hydfs_filename) const {
+  FileId file_id = 0;
+  file_names_.find(hydfs_filename, file_id);
+  return file_id;
 }
 
 bool FileOperationsHandler::isCoordinator(const std::string& hydfs_filename) const {
@@ -120,33 +269,303 @@ bool FileOperationsHandler::sendFileMessage(FileMessageType type, const char* bu
   return sent > 0;
 }
 
-bool FileOperationsHandler::replicateBlock(const std::string& hydfs_filename,
-                                           const FileBlock& block,
-                                           const std::vector<NodeId>& replicas) {
-  ReplicateBlockMessage msg;
-  msg.hydfs_filename = hydfs_filename;
-  msg.block = block;
+void FileOperationsHandler::replicateBlocks(const std::vector<NodeId>& hops,
+                                            const std::vector<ReplicatedFile>& files,
+                                            const std::vector<uint64_t>& write_ids,
+                                            bool chained) {
+  // A replica that is down or suspected, or still catching up, gets the blocks as hints;
+  // a chain closes up behind it
+  size_t first = 0;
+  while (first < hops.size() && !canSendTo(hops[first])) {
+    hintBlocks(hops[first], files);
+    first++;
+  }
+  if (first == hops.size()) {
+    return;
+  }
+  const NodeId& replica = hops[first];
+
+  ReplicateBlocksMessage msg;
+  msg.head = self_id_;
+  msg.chained = chained;
+  if (chained) {
+    msg.chain.assign(hops.begin() + first + 1, hops.end());
+    msg.stored_by = 1;  // our own copy
+  }
+  std::vector<uint64_t> msg_writes;  // per block of msg
+  size_t msg_bytes = 0;
+  auto send = [&]() {
+    msg.request_id = next_request_id_++;
+
+    // Unacknowledged blocks become hints once the ack times out
+    if (hints_) {
+      std::vector<HintedHandoff::Hint> sent;
+      for (const auto& file : msg.files) {
+        for (const auto& block : file.blocks) {
+          sent.push_back({file.hydfs_filename, block});
+        }
+      }
+      hints_->expectAck(msg.request_id, replica, std::move(sent));
+    }
+    bool awaited = std::any_of(msg_writes.begin(), msg_writes.end(),
+                               [](uint64_t write_id) { return write_id != 0; });
+    if (awaited) {
+      std::lock_guard<std::mutex> lock(writes_mtx_);
+      write_of_request_[msg.request_id] = msg_writes;
+      for (uint64_t write_id : msg_writes) {
+        auto it = pending_writes_.find(write_id);
+        if (it != pending_writes_.end()) it->second.requests.push_back(msg.request_id);
+      }
+    }
+
+    char buffer[8192];
+    size_t size = msg.serialize(buffer, sizeof(buffer));
+    struct sockaddr_in dest_addr;
+    socket_.buildServerAddr(dest_addr, replica.host, replica.port);
+
+    if (!sendFileMessage(FileMessageType::REPLICATE_BLOCKS, buffer, size, dest_addr)) {
+      logger_.log("Failed to replicate blocks to " + std::string(replica.host) + ":" +
+                  std::string(replica.port));
+      if (hints_) {
+        hints_->acknowledge(msg.request_id, 0);  // all of it becomes hints
+      }
+      if (awaited) {
+        std::lock_guard<std::mutex> lock(writes_mtx_);
+        write_of_request_.erase(msg.request_id);
+      }
+    }
+    msg.files.clear();
+    msg_writes.clear();
+    msg_bytes = 0;
+  };
+
+  // Pack whole files into each message; a file's group alone always fits one
+  size_t position = 0;
+  for (const auto& file : files) {
+    size_t file_bytes = file.hydfs_filename.size() + 20 + 15 * file.replies.size();
+    for (const auto& block : file.blocks) {
+      file_bytes += block.serializedSize();
+    }
+    if (!msg.files.empty() && msg_bytes + file_bytes > REPLICATE_BATCH_BYTES) {
+      send();
+    }
+    msg.files.push_back(file);
+    msg_bytes += file_bytes;
+    msg_writes.insert(msg_writes.end(), write_ids.begin() + position,
+                      write_ids.begin() + position + file.blocks.size());
+    position += file.blocks.size();
+  }
+  if (!msg.files.empty()) {
+    send();
+  }
+}
+
+bool FileOperationsHandler::canSendTo(const NodeId& replica) const {
+  return !hints_ || (hints_->isAlive(replica) && !hints_->hasHints(replica));
+}
+
+void FileOperationsHandler::hintBlocks(const NodeId& replica,
+                                       const std::vector<ReplicatedFile>& files) {
+  for (const auto& file : files) {
+    for (const auto& block : file.blocks) {
+      hints_->addHint(replica, file.hydfs_filename, block);
+    }
+  }
+}
+
+void FileOperationsHandler::recordWriteAck(uint64_t request_id, size_t applied) {
+  std::vector<FinishedWrite> finished;
+  {
+    std::lock_guard<std::mutex> lock(writes_mtx_);
+    auto route = write_of_request_.find(request_id);
+    if (route == write_of_request_.end()) {
+      return;  // its writes already finished; a late ack is ignored
+    }
+    std::vector<uint64_t> write_ids = std::move(route->second);
+    write_of_request_.erase(route);
+
+    size_t stored = std::min(applied, write_ids.size());
+    for (size_t i = 0; i < stored; i++) {
+      auto it = pending_writes_.find(write_ids[i]);
+      if (it != pending_writes_.end() && ++it->second.acks >= it->second.needed) {
+        finished.push_back(finishWrite(it, true));
+      }
+    }
+  }
+  answerWrites(finished);
+}
+
+size_t FileOperationsHandler::expireWrites() {
+  std::vector<FinishedWrite> finished;
+  {
+    std::lock_guard<std::mutex> lock(writes_mtx_);
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = pending_writes_.begin(); it != pending_writes_.end();) {
+      auto next = std::next(it);
+      if (it->second.deadline <= now) {
+        finished.push_back(finishWrite(it, false));
+      }
+      it = next;
+    }
+  }
+  answerWrites(finished);
+  return finished.size();
+}
+
+FileOperationsHandler::FinishedWrite FileOperationsHandler::finishWrite(
+    std::unordered_map<uint64_t, PendingWrite>::iterator it, bool success) {
+  // Its routes no longer wait on it; a route with no write left goes too
+  uint64_t write_id = it->first;
+  for (uint64_t request_id : it->second.requests) {
+    auto route = write_of_request_.find(request_id);
+    if (route == write_of_request_.end()) continue;
+    std::replace(route->second.begin(), route->second.end(), write_id, uint64_t{0});
+    if (std::all_of(route->second.begin(), route->second.end(),
+                    [](uint64_t other) { return other == 0; })) {
+      write_of_request_.erase(route);
+    }
+  }
+  FinishedWrite finished{std::move(it->second), success};
+  pending_writes_.erase(it);
+  return finished;
+}
+
+void FileOperationsHandler::answerWrites(const std::vector<FinishedWrite>& finished) {
+  for (const auto& reply : finished) {
+    if (reply.success && reply.write.tail_replies) {
+      continue;  // the chain's tail already answered the client
+    }
+    sendAppendResponse(reply.write.client, reply.write.client_request_id, reply.success,
+                       reply.write.block_id, reply.write.acks,
+                       reply.success ? "" : "Not enough replicas acknowledged the block");
+  }
+}
+
+void FileOperationsHandler::sendAppendResponse(const struct sockaddr_in& client,
+                                               uint64_t request_id, bool success,
+                                               uint64_t block_id, uint32_t acks,
+                                               const std::string& error) {
+  AppendFileResponse resp;
+  resp.success = success;
+  resp.error_message = error;
+  resp.block_id = block_id;
+  resp.request_id = request_id;
+  resp.acks = acks;
 
   char buffer[8192];
-  size_t size = msg.serialize(buffer, sizeof(buffer));
+  size_t size = resp.serialize(buffer, sizeof(buffer));
+  sendFileMessage(FileMessageType::APPEND_RESPONSE, buffer, size, client);
+}
 
-  bool all_success = true;
-  for (const auto& replica : replicas) {
-    if (replica == self_id_) {
-      continue;  // Don't replicate to self
+void FileOperationsHandler::trackGetSent(const NodeId& peer, const struct sockaddr_in& dest,
+                                         FileId file_id) {
+  replica_selector_.onSend(peer);
+  std::lock_guard<std::mutex> lock(inflight_mtx_);
+  inflight_gets_.push_back({peer, dest.sin_addr.s_addr, dest.sin_port, file_id,
+                            std::chrono::steady_clock::now()});
+}
+
+void FileOperationsHandler::trackGetReply(const struct sockaddr_in& sender, FileId file_id) {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(inflight_mtx_);
+  bool matched = false;
+  for (auto it = inflight_gets_.begin(); it != inflight_gets_.end();) {
+    auto waited = std::chrono::duration_cast<std::chrono::microseconds>(now - it->sent);
+    if (!matched && it->ip == sender.sin_addr.s_addr && it->port == sender.sin_port &&
+        it->file_id == file_id) {
+      replica_selector_.onReply(it->peer, waited);
+      it = inflight_gets_.erase(it);
+      matched = true;
+    } else if (waited > GET_REPLY_TIMEOUT) {
+      // Never answered: count the wait against the peer
+      replica_selector_.onTimeout(it->peer, waited);
+      it = inflight_gets_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void FileOperationsHandler::cancelGets(const std::string& hydfs_filename, FileId file_id) {
+  std::vector<NodeId> losers;
+  {
+    std::lock_guard<std::mutex> lock(inflight_mtx_);
+    for (auto it = inflight_gets_.begin(); it != inflight_gets_.end();) {
+      if (it->file_id == file_id) {
+        replica_selector_.onCancel(it->peer);
+        losers.push_back(it->peer);
+        it = inflight_gets_.erase(it);
+      } else {
+        ++it;
+      }
     }
+  }
 
+  GetCancelMessage msg;
+  msg.hydfs_filename = hydfs_filename;
+  char buffer[1024];
+  size_t size = msg.serialize(buffer, sizeof(buffer));
+  for (const auto& replica : losers) {
     struct sockaddr_in dest_addr;
     socket_.buildServerAddr(dest_addr, replica.host, replica.port);
+    sendFileMessage(FileMessageType::GET_CANCEL, buffer, size, dest_addr);
+  }
+}
 
-    if (!sendFileMessage(FileMessageType::REPLICATE_BLOCK, buffer, size, dest_addr)) {
-      logger_.log("Failed to replicate block to " + std::string(replica.host) + ":" +
-                  std::string(replica.port));
-      all_success = false;
+bool FileOperationsHandler::getCancelled(const struct sockaddr_in& requester, FileId file_id,
+                                         std::chrono::steady_clock::time_point arrived) {
+  std::lock_guard<std::mutex> lock(cancelled_gets_mtx_);
+  auto it = cancelled_gets_.find({requester.sin_addr.s_addr, requester.sin_port, file_id});
+  if (it == cancelled_gets_.end() || it->second < arrived) {
+    return false;  // no cancel, or one for an earlier GET
+  }
+  cancelled_gets_.erase(it);
+  return true;
+}
+
+uint32_t FileOperationsHandler::grantLease(FileId file_id, const struct sockaddr_in& reader) {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(leases_mtx_);
+  auto& holders = leases_[file_id];
+  holders.erase(std::remove_if(holders.begin(), holders.end(),
+                               [&](const LeaseHolder& holder) {
+                                 return holder.expiry <= now ||
+                                        (holder.reader.sin_addr.s_addr ==
+                                             reader.sin_addr.s_addr &&
+                                         holder.reader.sin_port == reader.sin_port);
+                               }),
+                holders.end());
+  holders.push_back({reader, now + READ_LEASE});
+  return std::chrono::duration_cast<std::chrono::milliseconds>(READ_LEASE).count();
+}
+
+void FileOperationsHandler::revokeLeases(const std::string& hydfs_filename) {
+  FileId file_id = file_names_.intern(hydfs_filename);
+  std::vector<LeaseHolder> holders;
+  {
+    std::lock_guard<std::mutex> lock(leases_mtx_);
+    auto it = leases_.find(file_id);
+    if (it == leases_.end()) {
+      return;
     }
+    holders = std::move(it->second);
+    leases_.erase(it);
   }
 
-  return all_success;
+  // The store calls us under its lock; the file's sequencer sends once the change that
+  // got us here (an append commits on that sequencer too) has returned
+  sequencer_.post(file_id, [this, hydfs_filename, holders = std::move(holders)] {
+    LeaseInvalidateMessage msg;
+    msg.hydfs_filename = hydfs_filename;
+    char buffer[512];
+    size_t size = msg.serialize(buffer, sizeof(buffer));
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& holder : holders) {
+      if (holder.expiry > now) {
+        sendFileMessage(FileMessageType::LEASE_INVALIDATE, buffer, size, holder.reader);
+      }
+    }
+  });
 }
 
 // ===== Core File Operations =====
@@ -179,7 +598,7 @@ bool FileOperationsHandler::createFile(const std::string& local_filename,
   }
   std::cout << "========================\n" << std::endl;
 
-  // Create the initial file block
+  // Create the initial file block; every replica stores it under this ID
   FileBlock initial_block;
   initial_block.client_id = getClientId();
   initial_block.sequence_num = 0;
@@ -202,7 +621,8 @@ bool FileOperationsHandler::createFile(const std::string& local_filename,
 
   if (we_are_replica) {
     // Store locally first
-    bool success = file_store_.createFile(hydfs_filename, data, getClientId());
+    bool success = file_store_.createFile(hydfs_filename, data, initial_block.client_id,
+                                          initial_block.timestamp);
     if (!success) {
       std::cout << "File already exists in HyDFS\n";
       return false;
@@ -225,6 +645,8 @@ bool FileOperationsHandler::createFile(const std::string& local_filename,
   req.client_id = hash_ring_.getNodePosition(self_id_);  // Use uint64_t position
   req.data = data;
   req.data_size = data.size();
+  req.creator_id = initial_block.client_id;
+  req.timestamp = initial_block.timestamp;
 
   char buffer[8192];
   size_t size = req.serialize(buffer, sizeof(buffer));
@@ -267,23 +689,28 @@ bool FileOperationsHandler::createFile(const std::string& local_filename,
 }
 
 bool FileOperationsHandler::getFile(const std::string& hydfs_filename,
-                                    const std::string& local_filename) {
+                                    const std::string& local_filename, ConsistencyLevel level) {
+  if (level != ConsistencyLevel::ONE) {
+    return getFileQuorum(hydfs_filename, local_filename, level);
+  }
+
   std::cout << "\n=== GET FILE OPERATION ===" << std::endl;
   std::cout << "HyDFS file: " << hydfs_filename << std::endl;
   std::cout << "Local file: " << local_filename << std::endl;
 
-  // Check if we have it locally first
-  if (file_store_.hasFile(hydfs_filename)) {
+  FileId file_id = file_names_.intern(hydfs_filename);
+
+  // Check if we have it locally first (pin one version so data and block ids agree)
+  if (FileSnapshot snapshot = file_store_.pinFile(file_id)) {
     std::cout << "File found locally, retrieving..." << std::endl;
     logger_.log("GET operation started for " + hydfs_filename + " (local)");
 
-    std::vector<char> data = file_store_.getFile(hydfs_filename);
+    std::vector<char> data = snapshot->assemble();
 
     // Check read-my-writes consistency
     std::string client_id = getClientId();
-    std::vector<uint64_t> block_ids = file_store_.getFileMetadata(hydfs_filename).block_ids;
-
-    if (!client_tracker_.satisfiesReadMyWrites(client_id, hydfs_filename, block_ids)) {
+    if (!client_tracker_.satisfiesReadMyWrites(client_id, file_id, snapshot->metadata.block_ids,
+                                               snapshot->compactedRanges())) {
       std::cout << "❌ Local copy does not satisfy read-my-writes consistency" << std::endl;
       std::cout << "Fetching from remote replica instead..." << std::endl;
       // Fall through to remote fetch
@@ -298,6 +725,21 @@ bool FileOperationsHandler::getFile(const std::string& hydfs_filename,
     }
   }
 
+  // A leased copy from an earlier read answers without a round trip
+  ReadCache::Entry cached;
+  if (read_cache_.get(file_id, cached)) {
+    if (client_tracker_.satisfiesReadMyWrites(getClientId(), file_id, cached.block_ids,
+                                              cached.compacted)) {
+      storeLocalFile(local_filename, cached.data);
+      std::cout << "✅ File served from read cache (version " << cached.version << "): "
+                << hydfs_filename << " -> " << local_filename << std::endl;
+      logger_.log("GET operation completed for " + hydfs_filename + " (cached)");
+      std::cout << "========================\n" << std::endl;
+      return true;
+    }
+    read_cache_.invalidate(file_id);
+  }
+
   // Find replicas for this file
   std::vector<NodeId> replicas = hash_ring_.getFileReplicas(hydfs_filename, 3);
   if (replicas.empty()) {
@@ -315,64 +757,136 @@ bool FileOperationsHandler::getFile(const std::string& hydfs_filename,
   // Register pending get request
   {
     std::lock_guard<std::mutex> lock(pending_gets_mtx_);
-    pending_gets_[hydfs_filename] = local_filename;
-    get_results_.erase(hydfs_filename);  // Clear any old result
+    pending_gets_[file_id] = local_filename;
+    get_started_[file_id] = std::chrono::steady_clock::now();
+    get_results_.erase(file_id);  // Clear any old result
   }
 
-  // Send GET request to first available replica (try others if first fails)
-  bool request_sent = false;
-  for (const auto& replica : replicas) {
-    // Skip self if we already checked locally
-    if (replica == self_id_) {
-      continue;
-    }
-
-    GetFileRequest req;
-    req.hydfs_filename = hydfs_filename;
-    req.local_filename = local_filename;
-    req.client_id = hash_ring_.getNodePosition(self_id_);
-    req.last_known_sequence = 0;
-
-    char buffer[8192];
-    size_t size = req.serialize(buffer, sizeof(buffer));
-
-    struct sockaddr_in dest_addr;
-    socket_.buildServerAddr(dest_addr, replica.host, replica.port);
+  GetFileRequest req;
+  req.hydfs_filename = hydfs_filename;
+  req.local_filename = local_filename;
+  req.client_id = hash_ring_.getNodePosition(self_id_);
+  req.last_known_sequence = 0;
+  req.request_id = 0;
 
-    std::cout << "Sending GET_REQUEST to " << replica.host << ":" << replica.port << std::endl;
-    logger_.log("Sending GET_REQUEST for " + hydfs_filename + " to " +
-                std::string(replica.host) + ":" + std::string(replica.port));
+  char buffer[8192];
+  size_t size = req.serialize(buffer, sizeof(buffer));
 
-    if (sendFileMessage(FileMessageType::GET_REQUEST, buffer, size, dest_addr)) {
-      request_sent = true;
-      break;  // Successfully sent to one replica
-    }
+  // Replicas in the order we ask them, expected-fastest first; self was already checked locally
+  std::vector<NodeId> targets;
+  for (const auto& replica : replicas) {
+    if (!(replica == self_id_)) targets.push_back(replica);
   }
+  targets = replica_selector_.order(targets);
+  if (chain_replication_ && !replicas.empty()) {
+    // The tail holds exactly the committed appends, so a chain is read from its tail
+    auto tail = std::find(targets.begin(), targets.end(), replicas.back());
+    std::rotate(targets.begin(), tail, tail == targets.end() ? tail : std::next(tail));
+  }
+  size_t next_target = 0;
+  auto sendNext = [&] {
+    while (next_target < targets.size()) {
+      const NodeId& replica = targets[next_target++];
+      struct sockaddr_in dest_addr;
+      socket_.buildServerAddr(dest_addr, replica.host, replica.port);
+
+      std::cout << "Sending GET_REQUEST to " << replica.host << ":" << replica.port << std::endl;
+      logger_.log("Sending GET_REQUEST for " + hydfs_filename + " to " +
+                  std::string(replica.host) + ":" + std::string(replica.port));
+      if (sendFileMessage(FileMessageType::GET_REQUEST, buffer, size, dest_addr)) {
+        trackGetSent(replica, dest_addr, file_id);
+        return true;
+      }
+    }
+    return false;
+  };
 
-  if (!request_sent) {
+  if (!sendNext()) {
     std::cout << "❌ Failed to send get request to any replica" << std::endl;
     std::lock_guard<std::mutex> lock(pending_gets_mtx_);
-    pending_gets_.erase(hydfs_filename);
+    pending_gets_.erase(file_id);
+    get_started_.erase(file_id);
     std::cout << "========================\n" << std::endl;
     return false;
   }
 
-  // Wait for response with timeout
+  // Hedge: a replica that hasn't answered within the recent latency percentile gets company
+  // from the next one, and the first good reply wins (a failed reply hedges at once)
+  double hedge_percentile = hedge_percentile_;
+  auto hedge_delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+      get_latency_.percentile(hedge_percentile, HEDGE_DEFAULT_DELAY, HEDGE_MIN_SAMPLES));
+  hedge_delay = std::max(hedge_delay, HEDGE_MIN_DELAY);
+  size_t asked = 1;
+  size_t failed = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + GET_REPLY_TIMEOUT;
+  auto next_hedge = start + hedge_delay;
   std::unique_lock<std::mutex> lock(pending_gets_mtx_);
-  bool received = get_cv_.wait_for(lock, std::chrono::seconds(5), [this, &hydfs_filename] {
-    return get_results_.find(hydfs_filename) != get_results_.end();
-  });
+  bool received = false;
+  while (true) {
+    bool hedging = hedge_percentile > 0 && next_target < targets.size();
+    auto wake = hedging ? std::min(next_hedge, deadline) : deadline;
+    bool replied = get_cv_.wait_until(lock, wake, [this, file_id] {
+      return get_results_.find(file_id) != get_results_.end();
+    });
+
+    if (replied && get_results_[file_id]) {
+      received = true;
+      break;
+    }
+    if (replied) {
+      // This replica failed; the GET fails once every replica we asked has
+      get_results_.erase(file_id);
+      if (++failed >= asked && next_target >= targets.size()) {
+        received = true;
+        get_results_[file_id] = false;
+        break;
+      }
+      if (failed < asked) continue;  // a hedge is still outstanding
+    } else if (std::chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+
+    lock.unlock();
+    bool sent = sendNext();
+    lock.lock();
+    if (sent) {
+      asked++;
+      std::cout << "[HEDGE] Asked another replica after "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count()
+                << " ms" << std::endl;
+    } else if (failed >= asked) {
+      received = true;
+      get_results_[file_id] = false;
+      break;
+    }
+    next_hedge = std::chrono::steady_clock::now() + hedge_delay;
+  }
 
   if (!received) {
     std::cout << "❌ Timeout waiting for GET_RESPONSE" << std::endl;
-    pending_gets_.erase(hydfs_filename);
+    pending_gets_.erase(file_id);
+    get_started_.erase(file_id);
+    get_results_.erase(file_id);
     std::cout << "========================\n" << std::endl;
     return false;
   }
 
-  bool success = get_results_[hydfs_filename];
-  get_results_.erase(hydfs_filename);
-  pending_gets_.erase(hydfs_filename);
+  // Later replies find no pending request and are dropped; the replicas a hedge's losing
+  // requests went to stop counting them as outstanding and skip them if still queued
+  if (get_results_[file_id]) {
+    get_latency_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start));
+  }
+  bool success = get_results_[file_id];
+  get_results_.erase(file_id);
+  pending_gets_.erase(file_id);
+  get_started_.erase(file_id);
+  lock.unlock();
+  cancelGets(hydfs_filename, file_id);
 
   if (success) {
     std::cout << "✅ GET operation completed successfully" << std::endl;
@@ -386,79 +900,329 @@ bool FileOperationsHandler::getFile(const std::string& hydfs_filename,
   return success;
 }
 
-bool FileOperationsHandler::appendFile(const std::string& local_filename,
-                                       const std::string& hydfs_filename) {
-  std::cout << "\n=== APPEND FILE OPERATION ===" << std::endl;
-  std::cout << "Local file (from cache): " << local_filename << std::endl;
+bool FileOperationsHandler::getFileQuorum(const std::string& hydfs_filename,
+                                          const std::string& local_filename,
+                                          ConsistencyLevel level) {
+  std::cout << "\n=== GET FILE OPERATION (" << to_string(level) << ") ===" << std::endl;
   std::cout << "HyDFS file: " << hydfs_filename << std::endl;
+  std::cout << "Local file: " << local_filename << std::endl;
 
-  // Read from local cache
-  std::vector<char> data;
-  if (!getLocalFile(local_filename, data)) {
-    std::cout << "❌ Failed to find local file in cache: " << local_filename << std::endl;
-    std::cout << "Hint: Use 'liststore' to see available local files" << std::endl;
-    std::cout << "============================\n" << std::endl;
+  FileId file_id = file_names_.intern(hydfs_filename);
+  std::vector<NodeId> replicas = hash_ring_.getFileReplicas(hydfs_filename, 3);
+  if (replicas.empty()) {
+    std::cout << "❌ No replicas found for file: " << hydfs_filename << std::endl;
+    std::cout << "========================\n" << std::endl;
     return false;
   }
+  size_t needed = requiredReplicas(level, replicas.size());
+  uint64_t request_id = next_request_id_++;
+  auto issued_at = std::chrono::steady_clock::now();
+
+  // Our own copy answers for us when we are one of the replicas
+  std::vector<GetFileResponse> responses;
+  if (std::find(replicas.begin(), replicas.end(), self_id_) != replicas.end()) {
+    GetFileResponse own;
+    own.request_id = request_id;
+    own.lease_ms = 0;
+    if (FileSnapshot snapshot = file_store_.pinFile(file_id)) {
+      own.success = true;
+      own.metadata = snapshot->metadata;
+      own.blocks = snapshot->copyBlocks();
+    } else {
+      own.success = false;
+      own.error_message = "File not found";
+    }
+    responses.push_back(std::move(own));
+  }
 
-  std::cout << "Data to append: " << data.size() << " bytes" << std::endl;
+  {
+    std::lock_guard<std::mutex> lock(merge_mtx_);
+    pending_reads_[request_id];
+  }
 
-  // Create append request
-  AppendFileRequest req;
+  GetFileRequest req;
   req.hydfs_filename = hydfs_filename;
   req.local_filename = local_filename;
   req.client_id = hash_ring_.getNodePosition(self_id_);
-  req.sequence_num = getNextSequenceNum(hydfs_filename);
-  req.data = data;
-  req.data_size = data.size();
-
-  std::cout << "Sequence number: " << req.sequence_num << std::endl;
+  req.last_known_sequence = 0;
+  req.request_id = request_id;
 
   char buffer[8192];
   size_t size = req.serialize(buffer, sizeof(buffer));
 
-  if (size > sizeof(buffer)) {
-    std::cout << "❌ Error: Data too large to send in single message" << std::endl;
-    std::cout << "Maximum size: " << sizeof(buffer) << " bytes" << std::endl;
-    std::cout << "============================\n" << std::endl;
+  size_t asked = responses.size();
+  for (const auto& replica : replicas) {
+    if (replica == self_id_) {
+      continue;
+    }
+    struct sockaddr_in dest_addr;
+    socket_.buildServerAddr(dest_addr, replica.host, replica.port);
+    if (sendFileMessage(FileMessageType::GET_REQUEST, buffer, size, dest_addr)) {
+      trackGetSent(replica, dest_addr, file_id);
+      asked++;
+    }
+  }
+
+  // Return once `needed` replicas have the file, or as soon as that can no longer happen
+  auto found = [](const std::vector<GetFileResponse>& replies) {
+    return std::count_if(replies.begin(), replies.end(),
+                         [](const GetFileResponse& reply) { return reply.success; });
+  };
+  size_t local_found = found(responses);
+  size_t local_failed = responses.size() - local_found;
+  {
+    std::unique_lock<std::mutex> lock(merge_mtx_);
+    merge_cv_.wait_for(lock, CLIENT_REPLY_TIMEOUT, [&] {
+      const auto& replies = pending_reads_[request_id];
+      size_t have = local_found + found(replies);
+      size_t failed = local_failed + replies.size() - found(replies);
+      return have >= needed || asked - failed < needed;
+    });
+    auto& replies = pending_reads_[request_id];
+    std::move(replies.begin(), replies.end(), std::back_inserter(responses));
+    pending_reads_.erase(request_id);
+  }
+
+  std::vector<const GetFileResponse*> candidates;
+  for (const auto& resp : responses) {
+    if (resp.success) candidates.push_back(&resp);
+  }
+  std::cout << candidates.size() << " of " << needed << " required replica(s) answered"
+            << std::endl;
+  if (candidates.size() < needed) {
+    std::cout << "❌ GET did not reach " << to_string(level) << std::endl;
+    logger_.log("GET at " + std::string(to_string(level)) + " failed for " + hydfs_filename);
+    std::cout << "========================\n" << std::endl;
     return false;
   }
+  // The union of the copies holds every block any of them acknowledged
+  GetFileResponse reconciled = reconcileCopies(candidates);
+  bool stored = storeGetResponse(reconciled, local_filename, issued_at);
+  if (stored) {
+    std::cout << "✅ GET operation completed successfully (" << reconciled.blocks.size()
+              << " blocks)" << std::endl;
+    logger_.log("GET at " + std::string(to_string(level)) + " completed for " + hydfs_filename);
+    scheduleReadRepair(hydfs_filename, reconciled.metadata.version, reconciled.blocks);
+  } else {
+    logger_.log("GET at " + std::string(to_string(level)) + " failed for " + hydfs_filename);
+  }
+  std::cout << "========================\n" << std::endl;
+  return stored;
+}
+
+bool FileOperationsHandler::getFileSince(const std::string& hydfs_filename,
+                                         const std::string& local_filename,
+                                         uint64_t since_timestamp, uint64_t since_block_id) {
+  std::cout << "\n=== GET SINCE OPERATION ===" << std::endl;
+  std::cout << "HyDFS file: " << hydfs_filename << std::endl;
+  std::cout << "Since: timestamp " << since_timestamp << ", block " << since_block_id << std::endl;
+
+  FileId file_id = file_names_.intern(hydfs_filename);
+
+  // Serve from the local time index if we hold a replica
+  if (FileSnapshot snapshot = file_store_.pinFile(file_id)) {
+    bool anchor_found = false;
+    std::vector<FileBlock> blocks =
+        snapshot->blocksSince(since_timestamp, since_block_id, anchor_found);
+    storeBlocksSince(local_filename, blocks, anchor_found, false);
+    logger_.log("GET_SINCE completed for " + hydfs_filename + " (local)");
+    std::cout << "===========================\n" << std::endl;
+    return true;
+  }
 
-  // Send to coordinator (first replica)
   std::vector<NodeId> replicas = hash_ring_.getFileReplicas(hydfs_filename, 3);
   if (replicas.empty()) {
-    std::cout << "❌ No replicas found for file" << std::endl;
-    std::cout << "============================\n" << std::endl;
+    std::cout << "❌ No replicas found for file: " << hydfs_filename << std::endl;
+    std::cout << "===========================\n" << std::endl;
     return false;
   }
 
-  NodeId coordinator = replicas[0];
-  std::cout << "Coordinator: " << coordinator.host << ":" << coordinator.port << std::endl;
-
-  struct sockaddr_in dest_addr;
-  socket_.buildServerAddr(dest_addr, coordinator.host, coordinator.port);
-
-  logger_.log("Sending APPEND_REQUEST for " + hydfs_filename + " to coordinator " +
-              std::string(coordinator.host) + ":" + std::string(coordinator.port));
-
-  if (!sendFileMessage(FileMessageType::APPEND_REQUEST, buffer, size, dest_addr)) {
-    std::cout << "❌ Failed to send append request" << std::endl;
-    std::cout << "============================\n" << std::endl;
-    return false;
+  {
+    std::lock_guard<std::mutex> lock(pending_gets_mtx_);
+    pending_gets_[file_id] = local_filename;
+    get_results_.erase(file_id);
   }
 
-  std::cout << "✅ Append request sent to coordinator" << std::endl;
-  std::cout << "Data will be appended and replicated to all " << replicas.size() << " replicas" << std::endl;
-  logger_.log("APPEND operation initiated for " + hydfs_filename);
-  std::cout << "============================\n" << std::endl;
+  GetSinceRequest req;
+  req.hydfs_filename = hydfs_filename;
+  req.local_filename = local_filename;
+  req.since_timestamp = since_timestamp;
+  req.since_block_id = since_block_id;
 
-  return true;
+  char buffer[8192];
+  size_t size = req.serialize(buffer, sizeof(buffer));
+
+  bool request_sent = false;
+  for (const auto& replica : replicas) {
+    struct sockaddr_in dest_addr;
+    socket_.buildServerAddr(dest_addr, replica.host, replica.port);
+    if (sendFileMessage(FileMessageType::GET_SINCE_REQUEST, buffer, size, dest_addr)) {
+      logger_.log("Sending GET_SINCE_REQUEST for " + hydfs_filename + " to " +
+                  std::string(replica.host) + ":" + std::string(replica.port));
+      request_sent = true;
+      break;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(pending_gets_mtx_);
+  bool received = request_sent && get_cv_.wait_for(lock, std::chrono::seconds(5), [this, file_id] {
+    return get_results_.find(file_id) != get_results_.end();
+  });
+  bool success = received && get_results_[file_id];
+  get_results_.erase(file_id);
+  pending_gets_.erase(file_id);
+
+  if (!received) {
+    std::cout << "❌ No GET_SINCE_RESPONSE from any replica" << std::endl;
+  }
+  logger_.log("GET_SINCE " + std::string(success ? "completed" : "failed") + " for " +
+              hydfs_filename);
+  std::cout << "===========================\n" << std::endl;
+  return success;
+}
+
+void FileOperationsHandler::storeBlocksSince(const std::string& local_filename,
+                                             const std::vector<FileBlock>& blocks,
+                                             bool anchor_found, bool more) {
+  std::vector<char> data;
+  for (const auto& block : blocks) {
+    data.insert(data.end(), block.data.begin(), block.data.end());
+  }
+  storeLocalFile(local_filename, data);
+
+  std::cout << "✅ " << blocks.size() << " new block(s), " << data.size() << " bytes -> "
+            << local_filename << std::endl;
+  if (!anchor_found) {
+    std::cout << "Block not found (or none given); filtered by timestamp instead" << std::endl;
+  }
+  if (!blocks.empty()) {
+    std::cout << "Next poll: since " << blocks.back().timestamp << " after block "
+              << blocks.back().lastAppendId() << std::endl;
+  }
+  if (more) {
+    std::cout << "More blocks are available; poll again from the cursor above" << std::endl;
+  }
+}
+
+bool FileOperationsHandler::appendFile(const std::string& local_filename,
+                                       const std::string& hydfs_filename,
+                                       ConsistencyLevel level) {
+  std::cout << "\n=== APPEND FILE OPERATION ===" << std::endl;
+  std::cout << "Local file (from cache): " << local_filename << std::endl;
+  std::cout << "HyDFS file: " << hydfs_filename << std::endl;
+  std::cout << "Consistency: " << to_string(level) << std::endl;
+
+  // Read from local cache
+  std::vector<char> data;
+  if (!getLocalFile(local_filename, data)) {
+    std::cout << "❌ Failed to find local file in cache: " << local_filename << std::endl;
+    std::cout << "Hint: Use 'liststore' to see available local files" << std::endl;
+    std::cout << "============================\n" << std::endl;
+    return false;
+  }
+
+  std::cout << "Data to append: " << data.size() << " bytes" << std::endl;
+
+  // Create append request
+  FileId file_id = file_names_.intern(hydfs_filename);
+  AppendFileRequest req;
+  req.hydfs_filename = hydfs_filename;
+  req.local_filename = local_filename;
+  req.client_id = hash_ring_.getNodePosition(self_id_);
+  req.sequence_num = sequencer_.nextSequence(file_id);
+  req.data = data;
+  req.data_size = data.size();
+  req.request_id = next_request_id_++;
+  req.consistency = level;
+  read_cache_.invalidate(file_id);  // our next read must see this append
+
+  std::cout << "Sequence number: " << req.sequence_num << std::endl;
+
+  char buffer[8192];
+  size_t size = req.serialize(buffer, sizeof(buffer));
+
+  if (size > sizeof(buffer)) {
+    std::cout << "❌ Error: Data too large to send in single message" << std::endl;
+    std::cout << "Maximum size: " << sizeof(buffer) << " bytes" << std::endl;
+    std::cout << "============================\n" << std::endl;
+    return false;
+  }
+
+  // Send to coordinator (first replica)
+  std::vector<NodeId> replicas = hash_ring_.getFileReplicas(hydfs_filename, 3);
+  if (replicas.empty()) {
+    std::cout << "❌ No replicas found for file" << std::endl;
+    std::cout << "============================\n" << std::endl;
+    return false;
+  }
+
+  NodeId coordinator = replicas[0];
+  std::cout << "Coordinator: " << coordinator.host << ":" << coordinator.port << std::endl;
+
+  struct sockaddr_in dest_addr;
+  socket_.buildServerAddr(dest_addr, coordinator.host, coordinator.port);
+
+  logger_.log("Sending APPEND_REQUEST for " + hydfs_filename + " to coordinator " +
+              std::string(coordinator.host) + ":" + std::string(coordinator.port));
+
+  if (level != ConsistencyLevel::ONE) {
+    std::lock_guard<std::mutex> lock(merge_mtx_);
+    pending_appends_[req.request_id];
+  }
+
+  if (!sendFileMessage(FileMessageType::APPEND_REQUEST, buffer, size, dest_addr)) {
+    std::cout << "❌ Failed to send append request" << std::endl;
+    std::cout << "============================\n" << std::endl;
+    std::lock_guard<std::mutex> lock(merge_mtx_);
+    pending_appends_.erase(req.request_id);
+    return false;
+  }
+
+  // QUORUM and ALL wait for the coordinator to count the replicas that hold the block
+  if (level != ConsistencyLevel::ONE) {
+    std::unique_lock<std::mutex> lock(merge_mtx_);
+    merge_cv_.wait_for(lock, CLIENT_REPLY_TIMEOUT, [this, &req] {
+      return pending_appends_[req.request_id].has_value();
+    });
+    std::optional<AppendFileResponse> resp = std::move(pending_appends_[req.request_id]);
+    pending_appends_.erase(req.request_id);
+    lock.unlock();
+
+    bool success = resp && resp->success;
+    if (success) {
+      std::cout << "✅ Append stored on " << resp->acks << " replica(s) (block "
+                << resp->block_id << ")" << std::endl;
+    } else {
+      std::cout << "❌ Append did not reach " << to_string(level) << ": "
+                << (resp ? resp->error_message : "no reply from coordinator") << std::endl;
+    }
+    logger_.log("APPEND at " + std::string(to_string(level)) + " " +
+                (success ? "completed" : "failed") + " for " + hydfs_filename);
+    std::cout << "============================\n" << std::endl;
+    return success;
+  }
+
+  std::cout << "✅ Append request sent to coordinator" << std::endl;
+  std::cout << "Data will be appended and replicated to all " << replicas.size() << " replicas" << std::endl;
+  logger_.log("APPEND operation initiated for " + hydfs_filename);
+  std::cout << "============================\n" << std::endl;
+
+  return true;
 }
 
 bool FileOperationsHandler::mergeFile(const std::string& hydfs_filename) {
+  // The coordinator runs the merge itself; anyone else asks the coordinator to
+  if (isCoordinator(hydfs_filename)) {
+    uint32_t new_version = 0;
+    bool merged = coordinateMerge(hydfs_filename, new_version);
+    std::cout << (merged ? "✅ Merge completed" : "❌ Merge failed") << " for " << hydfs_filename
+              << " (version " << new_version << ")\n";
+    return merged;
+  }
+
   MergeFileRequest req;
   req.hydfs_filename = hydfs_filename;
-  req.is_coordinator = isCoordinator(hydfs_filename);
+  req.is_coordinator = false;
 
   char buffer[8192];
   size_t size = req.serialize(buffer, sizeof(buffer));
@@ -481,12 +1245,482 @@ bool FileOperationsHandler::mergeFile(const std::string& hydfs_filename) {
   return true;
 }
 
+bool FileOperationsHandler::coordinateMerge(const std::string& hydfs_filename,
+                                            uint32_t& new_version) {
+  std::vector<NodeId> replicas = hash_ring_.getFileReplicas(hydfs_filename, 3);
+  FileSnapshot local = file_store_.pinFile(hydfs_filename);
+
+  // Phase 1: summaries. Copies with the same block count and list hash already agree
+  struct ReplicaCopy {
+    NodeId node;
+    bool found = false;
+    uint32_t version = 0;
+    uint32_t total_blocks = 0;
+    uint64_t list_hash = 0;
+  };
+  std::vector<ReplicaCopy> copies;
+  for (const auto& replica : replicas) {
+    ReplicaCopy copy;
+    copy.node = replica;
+    if (replica == self_id_) {
+      if (local) {
+        copy.found = true;
+        copy.version = local->metadata.version;
+        copy.total_blocks = static_cast<uint32_t>(local->blockCount());
+        copy.list_hash = local->listHash();
+      }
+    } else {
+      CollectBlocksRequest req;
+      req.hydfs_filename = hydfs_filename;
+      req.summary_only = true;
+      req.digest_from = 0;
+      CollectBlocksResponse resp;
+      if (!requestCollect(replica, req, resp)) {
+        // An unreachable replica sits this merge out; re-replication repairs it later
+        logger_.log("Merge of " + hydfs_filename + ": no summary from " +
+                    std::string(replica.host) + ":" + std::string(replica.port));
+        continue;
+      }
+      copy.found = resp.found;
+      copy.version = resp.version;
+      copy.total_blocks = resp.total_blocks;
+      copy.list_hash = resp.list_hash;
+    }
+    copies.push_back(copy);
+  }
+
+  const ReplicaCopy* first_found = nullptr;
+  bool in_sync = true;
+  new_version = 0;
+  for (const auto& copy : copies) {
+    new_version = std::max(new_version, copy.version);
+    if (!copy.found) {
+      in_sync = false;
+    } else if (!first_found) {
+      first_found = &copy;
+    } else if (copy.total_blocks != first_found->total_blocks ||
+               copy.list_hash != first_found->list_hash) {
+      in_sync = false;
+    }
+  }
+  if (!first_found) {
+    logger_.log("Merge of " + hydfs_filename + ": no replica holds the file");
+    return false;
+  }
+  if (in_sync) {
+    logger_.log("Merge of " + hydfs_filename + ": replicas already in sync");
+    return true;
+  }
+
+  // Phase 2: digests. A copy whose list matches ours reuses our digests
+  std::vector<BlockDigest> local_digests;
+  if (local) {
+    local_digests.reserve(local->blockCount());
+    for (size_t i = 0; i < local->blockCount(); i++) {
+      local_digests.push_back(local->digestAt(i));
+    }
+  }
+  uint64_t local_hash = local ? local->listHash() : 0;
+  std::vector<std::vector<BlockDigest>> digests(copies.size());
+  for (size_t r = 0; r < copies.size(); r++) {
+    const ReplicaCopy& copy = copies[r];
+    if (!copy.found) {
+      continue;
+    }
+    if (copy.node == self_id_ || (local && copy.list_hash == local_hash &&
+                                  copy.total_blocks == local_digests.size())) {
+      digests[r] = local_digests;
+    } else if (!collectDigests(copy.node, hydfs_filename, copy.total_blocks, digests[r])) {
+      logger_.log("Merge of " + hydfs_filename + ": failed to collect digests from " +
+                  std::string(copy.node.host) + ":" + std::string(copy.node.port));
+      return false;
+    }
+  }
+
+  MergePlan plan = planMerge(digests, local ? local->truncated_through : 0);
+  new_version++;
+
+  // Phase 3: gather the blocks some replica lacks, from our copy or from a holder
+  std::unordered_map<uint64_t, size_t> local_position;
+  for (size_t i = 0; i < local_digests.size(); i++) {
+    local_position.emplace(local_digests[i].block_id, i);
+  }
+  std::unordered_map<uint64_t, size_t> holder_of;  // block ID -> first remote copy holding it
+  for (size_t r = 0; r < copies.size(); r++) {
+    for (const auto& digest : digests[r]) {
+      holder_of.emplace(digest.block_id, r);
+    }
+  }
+
+  std::unordered_map<uint64_t, FileBlock> gathered;
+  std::unordered_map<size_t, std::vector<uint64_t>> to_fetch;  // copy index -> block IDs
+  for (size_t r = 0; r < copies.size(); r++) {
+    for (uint64_t block_id : plan.missing[r]) {
+      if (gathered.count(block_id)) {
+        continue;
+      }
+      auto local_it = local_position.find(block_id);
+      if (local_it != local_position.end()) {
+        gathered.emplace(block_id, local->copyBlock(local_it->second));
+      } else {
+        gathered.emplace(block_id, FileBlock{});  // placeholder until fetched
+        to_fetch[holder_of.at(block_id)].push_back(block_id);
+      }
+    }
+  }
+  for (const auto& [holder, block_ids] : to_fetch) {
+    std::vector<FileBlock> fetched;
+    if (!fetchBlocks(copies[holder].node, hydfs_filename, block_ids, fetched)) {
+      logger_.log("Merge of " + hydfs_filename + ": failed to fetch blocks from " +
+                  std::string(copies[holder].node.host) + ":" +
+                  std::string(copies[holder].node.port));
+      return false;
+    }
+    for (auto& block : fetched) {
+      gathered[block.block_id] = std::move(block);
+    }
+  }
+
+  // Phase 4: install the merge everywhere, shipping each replica only what it lacks
+  bool success = true;
+  for (size_t r = 0; r < copies.size(); r++) {
+    std::vector<FileBlock> blocks;
+    blocks.reserve(plan.missing[r].size());
+    for (uint64_t block_id : plan.missing[r]) {
+      blocks.push_back(gathered[block_id]);
+    }
+
+    bool applied;
+    if (copies[r].node == self_id_) {
+      applied = file_store_.applyMerge(hydfs_filename, plan.block_ids, blocks, new_version);
+    } else {
+      applied = sendMergeUpdate(copies[r].node, hydfs_filename, new_version, plan.block_ids,
+                                blocks);
+    }
+    if (!applied) {
+      logger_.log("Merge of " + hydfs_filename + ": replica " + std::string(copies[r].node.host) +
+                  ":" + std::string(copies[r].node.port) + " did not apply the merge");
+      success = false;
+    }
+  }
+
+  logger_.log("Merged " + hydfs_filename + " into version " + std::to_string(new_version) +
+              ": " + std::to_string(plan.block_ids.size()) + " blocks, " +
+              std::to_string(gathered.size()) + " shipped, " + std::to_string(plan.covered) +
+              " covered by extents");
+  return success;
+}
+
+bool FileOperationsHandler::requestCollect(const NodeId& replica, CollectBlocksRequest& req,
+                                           CollectBlocksResponse& resp) {
+  req.request_id = next_request_id_++;
+  {
+    std::lock_guard<std::mutex> lock(merge_mtx_);
+    pending_collects_[req.request_id];
+  }
+
+  char buffer[8192];
+  size_t size = req.serialize(buffer, sizeof(buffer));
+  struct sockaddr_in dest_addr;
+  socket_.buildServerAddr(dest_addr, replica.host, replica.port);
+  bool sent = sendFileMessage(FileMessageType::COLLECT_BLOCKS_REQUEST, buffer, size, dest_addr);
+
+  std::unique_lock<std::mutex> lock(merge_mtx_);
+  bool received = sent && merge_cv_.wait_for(lock, MERGE_REPLY_TIMEOUT, [this, &req] {
+    return pending_collects_[req.request_id].has_value();
+  });
+  if (received) {
+    resp = std::move(*pending_collects_[req.request_id]);
+  }
+  pending_collects_.erase(req.request_id);
+  return received;
+}
+
+bool FileOperationsHandler::collectDigests(const NodeId& replica,
+                                           const std::string& hydfs_filename,
+                                           uint32_t total_blocks,
+                                           std::vector<BlockDigest>& digests) {
+  digests.clear();
+  digests.reserve(total_blocks);
+  while (digests.size() < total_blocks) {
+    CollectBlocksRequest req;
+    req.hydfs_filename = hydfs_filename;
+    req.summary_only = false;
+    req.digest_from = static_cast<uint32_t>(digests.size());
+    CollectBlocksResponse resp;
+    if (!requestCollect(replica, req, resp) || !resp.found || resp.digests.empty()) {
+      return false;
+    }
+    // The copy changed between pages; the raced appends are kept by applyMerge anyway
+    for (auto& digest : resp.digests) {
+      if (digests.size() < total_blocks) {
+        digests.push_back(std::move(digest));
+      }
+    }
+  }
+  return true;
+}
+
+bool FileOperationsHandler::fetchBlocks(const NodeId& replica, const std::string& hydfs_filename,
+                                        const std::vector<uint64_t>& block_ids,
+                                        std::vector<FileBlock>& blocks) {
+  std::unordered_set<uint64_t> remaining(block_ids.begin(), block_ids.end());
+  while (!remaining.empty()) {
+    CollectBlocksRequest req;
+    req.hydfs_filename = hydfs_filename;
+    req.summary_only = false;
+    req.digest_from = 0;
+    for (uint64_t block_id : remaining) {
+      if (req.wanted_block_ids.size() == MERGE_FETCH_BATCH) {
+        break;
+      }
+      req.wanted_block_ids.push_back(block_id);
+    }
+    CollectBlocksResponse resp;
+    if (!requestCollect(replica, req, resp) || resp.blocks.empty()) {
+      return false;
+    }
+    for (auto& block : resp.blocks) {
+      if (remaining.erase(block.block_id)) {
+        blocks.push_back(std::move(block));
+      }
+    }
+  }
+  return true;
+}
+
+bool FileOperationsHandler::sendMergeUpdate(const NodeId& replica,
+                                            const std::string& hydfs_filename,
+                                            uint32_t new_version,
+                                            const std::vector<uint64_t>& block_ids,
+                                            const std::vector<FileBlock>& blocks,
+                                            FileMessageType type) {
+  uint64_t request_id = next_request_id_++;
+  {
+    std::lock_guard<std::mutex> lock(merge_mtx_);
+    pending_merge_updates_[request_id];
+  }
+
+  struct sockaddr_in dest_addr;
+  socket_.buildServerAddr(dest_addr, replica.host, replica.port);
+
+  // Lay the pages out once so any of them can be resent: blocks go first, then the ID
+  // list fills the rest of each page
+  struct Page {
+    size_t first_id = 0;
+    size_t id_count = 0;
+    size_t first_block = 0;
+    size_t block_count = 0;
+  };
+  std::vector<Page> pages;
+  size_t next_id = 0;
+  size_t next_block = 0;
+  do {
+    Page page;
+    page.first_id = next_id;
+    page.first_block = next_block;
+    size_t page_bytes = 0;
+    while (next_block < blocks.size()) {
+      size_t block_bytes = blocks[next_block].serializedSize();
+      if (next_block > page.first_block && page_bytes + block_bytes > MERGE_PAGE_BYTES) {
+        break;
+      }
+      page_bytes += block_bytes;
+      next_block++;
+    }
+    while (next_id < block_ids.size() && page_bytes + sizeof(uint64_t) <= MERGE_PAGE_BYTES) {
+      next_id++;
+      page_bytes += sizeof(uint64_t);
+    }
+    page.id_count = next_id - page.first_id;
+    page.block_count = next_block - page.first_block;
+    pages.push_back(page);
+  } while (next_id < block_ids.size() || next_block < blocks.size());
+
+  MergeUpdateMessage msg;
+  msg.hydfs_filename = hydfs_filename;
+  msg.request_id = request_id;
+  msg.new_version = new_version;
+  msg.page_count = static_cast<uint32_t>(pages.size());
+
+  // Pages are paced through the shared throttle so bulk transfers stay under the cap
+  char buffer[8192];
+  auto send_page = [&](uint32_t index, bool commit) {
+    const Page& page = pages[index];
+    auto ids = block_ids.begin() + page.first_id;
+    auto first = blocks.begin() + page.first_block;
+    msg.page = index;
+    msg.merged_block_ids.assign(ids, ids + page.id_count);
+    msg.blocks.assign(first, first + page.block_count);
+    msg.commit = commit;
+    size_t size = msg.serialize(buffer, sizeof(buffer));
+    if (transfer_throttle_ && !transfer_throttle_->acquire(size)) {
+      return false;  // shutting down
+    }
+    return sendFileMessage(type, buffer, size, dest_addr);
+  };
+
+  // Send every page, then only the ones the replica reports missing; the last page of
+  // each send asks the replica to apply the merge or report what it still lacks
+  std::vector<uint32_t> to_send;
+  for (uint32_t index = 0; index < pages.size(); index++) {
+    to_send.push_back(index);
+  }
+  bool applied = false;
+  for (int round = 0; round < MERGE_SEND_ROUNDS && !to_send.empty(); round++) {
+    bool sent = true;
+    for (size_t i = 0; i < to_send.size() && sent; i++) {
+      sent = send_page(to_send[i], i + 1 == to_send.size());
+    }
+    if (!sent) {
+      break;
+    }
+
+    std::optional<MergeUpdateAck> ack;
+    {
+      std::unique_lock<std::mutex> lock(merge_mtx_);
+      merge_cv_.wait_for(lock, MERGE_REPLY_TIMEOUT, [this, request_id] {
+        return pending_merge_updates_[request_id].has_value();
+      });
+      ack.swap(pending_merge_updates_[request_id]);
+    }
+    if (!ack) {
+      to_send = {msg.page_count - 1};  // the commit page or its ack was lost: ask again
+      continue;
+    }
+
+    applied = ack->success;
+    to_send.clear();  // done once the replica applied the merge or failed to
+    for (uint32_t index : ack->missing_pages) {
+      if (index < pages.size()) {
+        to_send.push_back(index);
+      }
+    }
+    if (!to_send.empty() && to_send.back() != msg.page_count - 1) {
+      to_send.push_back(msg.page_count - 1);  // end on the commit page
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(merge_mtx_);
+  pending_merge_updates_.erase(request_id);
+  return applied;
+}
+
+void FileOperationsHandler::scheduleReadRepair(const std::string& hydfs_filename,
+                                               uint32_t version, std::vector<FileBlock> blocks) {
+  FileId file_id = file_names_.intern(hydfs_filename);
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(read_repair_mtx_);
+    auto it = last_read_repair_.find(file_id);
+    if (it != last_read_repair_.end() && now - it->second < READ_REPAIR_INTERVAL) {
+      return;
+    }
+    if (last_read_repair_.size() >= 4096) {
+      for (auto old = last_read_repair_.begin(); old != last_read_repair_.end();) {
+        old = now - old->second < READ_REPAIR_INTERVAL ? std::next(old)
+                                                       : last_read_repair_.erase(old);
+      }
+    }
+    last_read_repair_[file_id] = now;
+  }
+
+  executor_.submit([this, hydfs_filename, version, blocks = std::move(blocks)] {
+    size_t repaired = readRepair(hydfs_filename, version, blocks);
+    if (repaired > 0) {
+      logger_.log("Read repair of " + hydfs_filename + " healed " + std::to_string(repaired) +
+                  " replicas");
+    }
+  });
+}
+
+size_t FileOperationsHandler::readRepair(const std::string& hydfs_filename, uint32_t version,
+                                         const std::vector<FileBlock>& blocks) {
+  std::vector<uint64_t> fresh_ids;
+  std::unordered_map<uint64_t, const FileBlock*> by_id;
+  uint64_t fresh_hash = 0;
+  fresh_ids.reserve(blocks.size());
+  for (const auto& block : blocks) {
+    fresh_ids.push_back(block.block_id);
+    by_id[block.block_id] = &block;
+    fresh_hash = FileVersion::extendListHash(fresh_hash, block.block_id);
+  }
+
+  size_t repaired = 0;
+  for (const auto& replica : hash_ring_.getFileReplicas(hydfs_filename, 3)) {
+    // Summary first: only a copy with fewer blocks can be lagging
+    bool found = false;
+    uint32_t replica_version = 0;
+    uint32_t total_blocks = 0;
+    uint64_t list_hash = 0;
+    FileSnapshot local;
+    if (replica == self_id_) {
+      local = file_store_.pinFile(hydfs_filename);
+      if (local) {
+        found = true;
+        replica_version = local->metadata.version;
+        total_blocks = static_cast<uint32_t>(local->blockCount());
+        list_hash = local->listHash();
+      }
+    } else {
+      CollectBlocksRequest req;
+      req.hydfs_filename = hydfs_filename;
+      req.summary_only = true;
+      req.digest_from = 0;
+      CollectBlocksResponse resp;
+      if (!requestCollect(replica, req, resp)) {
+        continue;  // unreachable; hinted handoff or re-replication covers it
+      }
+      found = resp.found;
+      replica_version = resp.version;
+      total_blocks = resp.total_blocks;
+      list_hash = resp.list_hash;
+    }
+    if (found && (total_blocks > blocks.size() ||
+                  (total_blocks == blocks.size() && list_hash == fresh_hash))) {
+      continue;
+    }
+
+    std::vector<BlockDigest> digests;
+    if (local) {
+      digests.reserve(local->blockCount());
+      for (size_t i = 0; i < local->blockCount(); i++) {
+        digests.push_back(local->digestAt(i));
+      }
+    } else if (found && !collectDigests(replica, hydfs_filename, total_blocks, digests)) {
+      continue;
+    }
+    std::vector<uint64_t> missing = planReadRepair(fresh_ids, digests);
+    if (missing.empty()) {
+      continue;  // in sync, or diverged (left to merge and anti-entropy)
+    }
+
+    std::vector<FileBlock> shipped;
+    shipped.reserve(missing.size());
+    for (uint64_t block_id : missing) {
+      shipped.push_back(*by_id[block_id]);
+    }
+    uint32_t new_version = std::max(version, replica_version);
+    bool applied = replica == self_id_
+                       ? file_store_.applyMerge(hydfs_filename, fresh_ids, shipped, new_version)
+                       : sendMergeUpdate(replica, hydfs_filename, new_version, fresh_ids, shipped);
+    if (applied) {
+      repaired++;
+      logger_.log("Read repair sent " + std::to_string(shipped.size()) + " blocks of " +
+                  hydfs_filename + " to " + std::string(replica.host) + ":" +
+                  std::string(replica.port));
+    }
+  }
+  return repaired;
+}
+
 void FileOperationsHandler::listFileLocations(const std::string& hydfs_filename) {
   std::vector<NodeId> replicas = hash_ring_.getFileReplicas(hydfs_filename, 3);
 
   std::cout << "\n=== LS: Checking file existence across replicas ===" << std::endl;
   std::cout << "File: " << hydfs_filename << std::endl;
-  std::cout << "File ID: " << FileMetadata::generateFileId(hydfs_filename) << std::endl;
+  FileId file_id = file_names_.intern(hydfs_filename);
+  std::cout << "File ID: " << file_id << std::endl;
 
   // Register pending ls request
   {
@@ -495,7 +1729,7 @@ void FileOperationsHandler::listFileLocations(const std::string& hydfs_filename)
     state.hydfs_filename = hydfs_filename;
     state.expected_replicas = replicas;
     state.start_time = std::chrono::steady_clock::now();
-    pending_ls_[hydfs_filename] = state;
+    pending_ls_[file_id] = state;
   }
 
   // Send FILE_EXISTS_REQUEST to all replicas
@@ -517,12 +1751,12 @@ void FileOperationsHandler::listFileLocations(const std::string& hydfs_filename)
   {
     std::unique_lock<std::mutex> lock(pending_ls_mtx_);
     bool got_all_responses = ls_cv_.wait_for(lock, std::chrono::seconds(3), [&]() {
-      auto it = pending_ls_.find(hydfs_filename);
+      auto it = pending_ls_.find(file_id);
       if (it == pending_ls_.end()) return true;
       return it->second.responses.size() >= replicas.size();
     });
 
-    auto it = pending_ls_.find(hydfs_filename);
+    auto it = pending_ls_.find(file_id);
     if (it == pending_ls_.end()) {
       std::cout << "❌ LS request cancelled or failed" << std::endl;
       return;
@@ -575,7 +1809,7 @@ void FileOperationsHandler::listFileLocations(const std::string& hydfs_filename)
 
 void FileOperationsHandler::listLocalFiles() {
   // Get HyDFS replica files
-  std::vector<std::string> hydfs_files = file_store_.listFiles();
+  std::vector<std::pair<std::string, FileStat>> hydfs_files = file_store_.listFileStats();
 
   // Get local cached files
   std::vector<std::string> local_files;
@@ -612,10 +1846,9 @@ void FileOperationsHandler::listLocalFiles() {
   if (hydfs_files.empty()) {
     std::cout << "   (No HyDFS replicas)" << std::endl;
   } else {
-    for (const auto& filename : hydfs_files) {
-      FileMetadata meta = file_store_.getFileMetadata(filename);
-      std::cout << "   " << filename << " (file ID: " << meta.file_id << ", "
-                << meta.total_size << " bytes, last modified: " << meta.last_modified_timestamp << ")" << std::endl;
+    for (const auto& [filename, stat] : hydfs_files) {
+      std::cout << "   " << filename << " (file ID: " << stat.file_id << ", "
+                << stat.total_size << " bytes, last modified: " << stat.last_modified_timestamp << ")" << std::endl;
     }
   }
 
@@ -651,24 +1884,401 @@ void FileOperationsHandler::catLocalFile(const std::string& local_filename) {
   std::cout << "=====================\n" << std::endl;
 }
 
+void FileOperationsHandler::saveStoreImage(const std::string& image_path) {
+  std::cout << "\n=== SAVE STORE IMAGE ===" << std::endl;
+  std::string path = image_path.empty() ? file_store_.getImagePath() : image_path;
+  std::cout << "Image: " << path << std::endl;
+
+  if (file_store_.saveImage(path)) {
+    std::cout << "✅ Store image saved" << std::endl;
+    logger_.log("Saved store image to " + path);
+  } else {
+    std::cout << "❌ Failed to save store image" << std::endl;
+  }
+  std::cout << "========================\n" << std::endl;
+}
+
+void FileOperationsHandler::loadStoreImage(const std::string& image_path) {
+  std::cout << "\n=== LOAD STORE IMAGE ===" << std::endl;
+  std::string path = image_path.empty() ? file_store_.getImagePath() : image_path;
+  std::cout << "Image: " << path << std::endl;
+
+  if (file_store_.loadImage(path)) {
+    std::cout << "✅ Store seeded from image (" << file_store_.listFiles().size() << " files)"
+              << std::endl;
+    logger_.log("Loaded store image from " + path);
+  } else {
+    std::cout << "❌ Failed to load store image" << std::endl;
+  }
+  std::cout << "========================\n" << std::endl;
+}
+
+void FileOperationsHandler::setRetentionPolicy(const std::string& prefix,
+                                               const RetentionPolicy& policy) {
+  file_store_.setRetentionPolicy(prefix, policy);
+  std::string target = prefix.empty() ? "all files" : "prefix '" + prefix + "'";
+  if (policy.unlimited()) {
+    std::cout << "Retention rule removed for " << target << std::endl;
+  } else {
+    std::cout << "Retention for " << target << ": max age " << policy.max_age_ms
+              << " ms, max " << policy.max_bytes << " bytes, max " << policy.max_blocks
+              << " blocks (0 = no cap)" << std::endl;
+  }
+  logger_.log("Retention rule set for " + target);
+}
+
+void FileOperationsHandler::listRetentionPolicies() const {
+  auto rules = file_store_.listRetentionPolicies();
+  std::cout << "\n=== RETENTION RULES (" << rules.size() << ") ===" << std::endl;
+  for (const auto& [prefix, policy] : rules) {
+    std::cout << "  " << (prefix.empty() ? "*" : prefix) << ": max age " << policy.max_age_ms
+              << " ms, max " << policy.max_bytes << " bytes, max " << policy.max_blocks
+              << " blocks" << std::endl;
+  }
+  std::cout << "========================\n" << std::endl;
+}
+
+void FileOperationsHandler::propagateTruncation(const std::string& hydfs_filename,
+                                                uint64_t cut_timestamp) {
+  // Only the coordinator announces a truncation point, so replicas converge on its cut
+  if (!isCoordinator(hydfs_filename)) {
+    return;
+  }
+
+  std::vector<NodeId> replicas;
+  for (const auto& replica : hash_ring_.getFileReplicas(hydfs_filename, 3)) {
+    if (!(replica == self_id_)) {
+      replicas.push_back(replica);
+    }
+  }
+  if (replicas.empty()) {
+    return;
+  }
+
+  // Waiting for acks would stall the reaper, so the rounds run on the executor
+  executor_.submit([this, hydfs_filename, cut_timestamp, replicas]() mutable {
+    for (int round = 0; round < TRUNCATE_SEND_ROUNDS && !replicas.empty(); round++) {
+      std::vector<std::pair<NodeId, uint64_t>> sent;
+      {
+        std::lock_guard<std::mutex> lock(merge_mtx_);
+        for (const auto& replica : replicas) {
+          uint64_t request_id = next_request_id_++;
+          pending_merge_acks_[request_id];
+          sent.emplace_back(replica, request_id);
+        }
+      }
+
+      char buffer[1024];
+      for (const auto& [replica, request_id] : sent) {
+        TruncateFileMessage msg;
+        msg.hydfs_filename = hydfs_filename;
+        msg.request_id = request_id;
+        msg.through_timestamp = cut_timestamp;
+        size_t size = msg.serialize(buffer, sizeof(buffer));
+        struct sockaddr_in dest_addr;
+        socket_.buildServerAddr(dest_addr, replica.host, replica.port);
+        sendFileMessage(FileMessageType::TRUNCATE_FILE, buffer, size, dest_addr);
+      }
+
+      // Resend only to the replicas that stayed silent
+      std::unique_lock<std::mutex> lock(merge_mtx_);
+      merge_cv_.wait_for(lock, MERGE_REPLY_TIMEOUT, [this, &sent] {
+        return std::all_of(sent.begin(), sent.end(), [this](const auto& entry) {
+          return pending_merge_acks_[entry.second].has_value();
+        });
+      });
+      replicas.clear();
+      for (const auto& [replica, request_id] : sent) {
+        if (!pending_merge_acks_[request_id].has_value()) {
+          replicas.push_back(replica);
+        }
+        pending_merge_acks_.erase(request_id);
+      }
+    }
+
+    logger_.log("Propagated truncation of " + hydfs_filename + " through " +
+                std::to_string(cut_timestamp) +
+                (replicas.empty() ? "" : ", " + std::to_string(replicas.size()) +
+                                              " replicas did not ack"));
+  });
+}
+
+bool FileOperationsHandler::transferFile(const std::string& hydfs_filename, const NodeId& target) {
+  FileSnapshot snapshot = file_store_.pinFile(hydfs_filename);
+  if (!snapshot) {
+    return false;
+  }
+
+  std::vector<FileBlock> blocks = snapshot->copyBlocks();
+  std::vector<uint64_t> block_ids;
+  block_ids.reserve(blocks.size());
+  for (const auto& block : blocks) {
+    block_ids.push_back(block.block_id);
+  }
+  bool stored = sendMergeUpdate(target, hydfs_filename, snapshot->metadata.version, block_ids,
+                                blocks, FileMessageType::TRANSFER_FILES);
+  logger_.log("Transfer of " + hydfs_filename + " to " + std::string(target.host) + ":" +
+              std::string(target.port) + (stored ? " done" : " failed"));
+  return stored;
+}
+
+void FileOperationsHandler::dropReplica(const std::string& hydfs_filename, const NodeId& target) {
+  DeleteFileMessage msg;
+  msg.hydfs_filename = hydfs_filename;
+
+  char buffer[1024];
+  size_t size = msg.serialize(buffer, sizeof(buffer));
+  struct sockaddr_in dest_addr;
+  socket_.buildServerAddr(dest_addr, target.host, target.port);
+  sendFileMessage(FileMessageType::DELETE_FILE, buffer, size, dest_addr);
+}
+
+bool FileOperationsHandler::replayHints(const NodeId& target,
+                                        const std::vector<HintedHandoff::Hint>& hints) {
+  uint64_t request_id = next_request_id_++;
+  {
+    std::lock_guard<std::mutex> lock(merge_mtx_);
+    pending_merge_acks_[request_id];
+  }
+
+  HintBatchMessage msg;
+  msg.request_id = request_id;
+  for (const auto& hint : hints) {
+    msg.hints.push_back(HintEntry{hint.hydfs_filename, hint.block});
+  }
+
+  char buffer[8192];
+  size_t size = msg.serialize(buffer, sizeof(buffer));
+  struct sockaddr_in dest_addr;
+  socket_.buildServerAddr(dest_addr, target.host, target.port);
+  bool sent = sendFileMessage(FileMessageType::HINT_BATCH, buffer, size, dest_addr);
+
+  std::unique_lock<std::mutex> lock(merge_mtx_);
+  bool acked = sent && merge_cv_.wait_for(lock, MERGE_REPLY_TIMEOUT, [this, request_id] {
+    return pending_merge_acks_[request_id].has_value();
+  });
+  bool applied = acked && *pending_merge_acks_[request_id];
+  pending_merge_acks_.erase(request_id);
+  return applied;
+}
+
+size_t FileOperationsHandler::runAntiEntropy() {
+  // Batches held too long for a gap are applied as they are, then compared with the rest
+  for (const auto& batch : reorder_buffer_.releaseStale()) {
+    applyReplicatedBatch(batch);
+  }
+  requestGaps();
+
+  // We coordinate the range (predecessor, self]; its co-replicas are our successors
+  std::vector<std::pair<uint64_t, NodeId>> nodes = hash_ring_.getAllNodes();
+  uint64_t self_position = hash_ring_.getNodePosition(self_id_);
+  auto self_it = std::find_if(nodes.begin(), nodes.end(),
+                              [this](const auto& node) { return node.second == self_id_; });
+  if (nodes.size() < 2 || self_it == nodes.end()) {
+    return 0;
+  }
+  auto pred_it = self_it == nodes.begin() ? std::prev(nodes.end()) : std::prev(self_it);
+  RingRange range{pred_it->first, self_position};
+
+  std::set<std::string> differing;
+  for (const auto& peer : hash_ring_.getSuccessors(self_position, 3)) {
+    if (peer == self_id_) {
+      continue;
+    }
+    if (!diffRange(peer, range, differing)) {
+      logger_.log("Anti-entropy: no Merkle exchange with " + std::string(peer.host) + ":" +
+                  std::string(peer.port));
+    }
+  }
+
+  size_t repaired = 0;
+  for (const auto& hydfs_filename : differing) {
+    uint32_t new_version = 0;
+    if (coordinateMerge(hydfs_filename, new_version)) {
+      repaired++;
+    }
+  }
+  if (!differing.empty()) {
+    logger_.log("Anti-entropy: " + std::to_string(differing.size()) + " files diverged, " +
+                std::to_string(repaired) + " repaired");
+  }
+  return repaired;
+}
+
+bool FileOperationsHandler::requestMerkle(const NodeId& peer, MerkleRequest& req,
+                                          MerkleResponse& resp) {
+  req.request_id = next_request_id_++;
+  {
+    std::lock_guard<std::mutex> lock(merge_mtx_);
+    pending_merkle_[req.request_id];
+  }
+
+  char buffer[8192];
+  size_t size = req.serialize(buffer, sizeof(buffer));
+  struct sockaddr_in dest_addr;
+  socket_.buildServerAddr(dest_addr, peer.host, peer.port);
+  bool sent = sendFileMessage(FileMessageType::MERKLE_REQUEST, buffer, size, dest_addr);
+
+  std::unique_lock<std::mutex> lock(merge_mtx_);
+  bool received = sent && merge_cv_.wait_for(lock, MERGE_REPLY_TIMEOUT, [this, &req] {
+    return pending_merkle_[req.request_id].has_value();
+  });
+  if (received) {
+    resp = std::move(*pending_merkle_[req.request_id]);
+  }
+  pending_merkle_.erase(req.request_id);
+  return received && resp.hashes.size() == req.indices.size();
+}
+
+bool FileOperationsHandler::diffRange(const NodeId& peer, const RingRange& range,
+                                      std::set<std::string>& differing) {
+  // Descend from the root, keeping only the nodes whose hashes differ
+  std::vector<uint32_t> frontier = {0};
+  for (size_t level = 0; level <= MerkleTree::kDepth; level++) {
+    std::vector<uint32_t> next;
+    for (size_t from = 0; from < frontier.size(); from += MERKLE_HASH_BATCH) {
+      MerkleRequest req;
+      req.range_start = range.start;
+      req.range_end = range.end;
+      req.level = static_cast<uint8_t>(level);
+      req.want_files = false;
+      req.indices.assign(frontier.begin() + from,
+                         frontier.begin() + std::min(frontier.size(), from + MERKLE_HASH_BATCH));
+      MerkleResponse resp;
+      if (!requestMerkle(peer, req, resp)) {
+        return false;
+      }
+      for (size_t i = 0; i < req.indices.size(); i++) {
+        uint32_t index = req.indices[i];
+        if (merkle_tree_.hash(level, index, range) == resp.hashes[i]) {
+          continue;
+        }
+        if (level == MerkleTree::kDepth) {
+          next.push_back(index);
+        } else {
+          for (uint32_t child = 0; child < MerkleTree::kFanout; child++) {
+            next.push_back(index * MerkleTree::kFanout + child);
+          }
+        }
+      }
+    }
+    frontier = std::move(next);
+    if (frontier.empty()) {
+      return true;  // the range matches
+    }
+  }
+
+  // frontier holds the leaves that differ: compare their files
+  for (size_t from = 0; from < frontier.size();) {
+    MerkleRequest req;
+    req.range_start = range.start;
+    req.range_end = range.end;
+    req.level = static_cast<uint8_t>(MerkleTree::kDepth);
+    req.want_files = true;
+    req.indices.assign(frontier.begin() + from,
+                       frontier.begin() + std::min(frontier.size(), from + MERKLE_LEAF_BATCH));
+    MerkleResponse resp;
+    if (!requestMerkle(peer, req, resp) || resp.leaves_complete == 0) {
+      return false;
+    }
+
+    std::unordered_map<std::string, uint64_t> remote;
+    for (const auto& file : resp.files) {
+      remote.emplace(file.hydfs_filename, file.digest);
+    }
+    for (size_t i = 0; i < resp.leaves_complete && i < req.indices.size(); i++) {
+      for (const auto& entry : merkle_tree_.leafEntries(req.indices[i], range)) {
+        auto it = remote.find(entry.name);
+        if (it == remote.end() || it->second != entry.digest) {
+          differing.insert(entry.name);
+        }
+        if (it != remote.end()) {
+          remote.erase(it);
+        }
+      }
+    }
+    for (const auto& [hydfs_filename, digest] : remote) {
+      differing.insert(hydfs_filename);  // the peer has it, we don't
+    }
+    from += resp.leaves_complete;
+  }
+  return true;
+}
+
+void FileOperationsHandler::handleMerkleRequest(const MerkleRequest& req,
+                                                const struct sockaddr_in& sender) {
+  RingRange range{req.range_start, req.range_end};
+  MerkleResponse resp;
+  resp.request_id = req.request_id;
+  resp.leaves_complete = 0;
+
+  bool valid_level = req.level <= MerkleTree::kDepth;
+  for (uint32_t index : req.indices) {
+    bool valid = valid_level && index < MerkleTree::levelWidth(req.level);
+    resp.hashes.push_back(valid ? merkle_tree_.hash(req.level, index, range) : 0);
+  }
+
+  if (req.want_files && req.level == MerkleTree::kDepth) {
+    // List whole leaves only, as many as fit
+    size_t reply_bytes = resp.hashes.size() * sizeof(uint64_t);
+    for (uint32_t leaf : req.indices) {
+      if (leaf >= MerkleTree::kLeaves) {
+        break;
+      }
+      std::vector<MerkleTree::Entry> entries = merkle_tree_.leafEntries(leaf, range);
+      size_t leaf_bytes = 0;
+      for (const auto& entry : entries) {
+        leaf_bytes += sizeof(uint32_t) + entry.name.size() + sizeof(uint64_t);
+      }
+      if (reply_bytes + leaf_bytes > MERGE_PAGE_BYTES) {
+        break;
+      }
+      reply_bytes += leaf_bytes;
+      for (auto& entry : entries) {
+        resp.files.push_back({std::move(entry.name), entry.digest});
+      }
+      resp.leaves_complete++;
+    }
+  }
+
+  char buffer[8192];
+  size_t size = resp.serialize(buffer, sizeof(buffer));
+  sendFileMessage(FileMessageType::MERKLE_RESPONSE, buffer, size, sender);
+}
+
 bool FileOperationsHandler::getFileFromReplica(const std::string& vm_address,
                                                const std::string& hydfs_filename,
                                                const std::string& local_filename) {
-  // Parse VM address (host:port)
-  size_t colon_pos = vm_address.find(':');
-  if (colon_pos == std::string::npos) {
-    std::cout << "Invalid VM address format. Use host:port\n";
-    return false;
-  }
+  std::vector<NodeId> replicas = hash_ring_.getFileReplicas(hydfs_filename, 3);
+  std::string host, port;
+  if (vm_address == "best") {
+    // The replica expected to answer fastest
+    if (replicas.empty()) {
+      std::cout << "No replicas found for file: " << hydfs_filename << "\n";
+      return false;
+    }
+    NodeId best = replica_selector_.order(replicas).front();
+    host = best.host;
+    port = best.port;
+  } else {
+    // Parse VM address (host:port)
+    size_t colon_pos = vm_address.find(':');
+    if (colon_pos == std::string::npos) {
+      std::cout << "Invalid VM address format. Use host:port or best\n";
+      return false;
+    }
 
-  std::string host = vm_address.substr(0, colon_pos);
-  std::string port = vm_address.substr(colon_pos + 1);
+    host = vm_address.substr(0, colon_pos);
+    port = vm_address.substr(colon_pos + 1);
+  }
 
+  FileId file_id = file_names_.intern(hydfs_filename);
   GetFileRequest req;
   req.hydfs_filename = hydfs_filename;
   req.local_filename = local_filename;
   req.client_id = hash_ring_.getNodePosition(self_id_);
   req.last_known_sequence = 0;
+  req.request_id = 0;
 
   char buffer[8192];
   size_t size = req.serialize(buffer, sizeof(buffer));
@@ -676,8 +2286,16 @@ bool FileOperationsHandler::getFileFromReplica(const std::string& vm_address,
   struct sockaddr_in dest_addr;
   socket_.buildServerAddr(dest_addr, host.c_str(), port.c_str());
 
-  sendFileMessage(FileMessageType::GET_REQUEST, buffer, size, dest_addr);
-  std::cout << "Get request sent to " << vm_address << "\n";
+  if (sendFileMessage(FileMessageType::GET_REQUEST, buffer, size, dest_addr)) {
+    // Time the reply when the address is one of the file's replicas
+    for (const auto& replica : replicas) {
+      if (host == replica.host && port == replica.port) {
+        trackGetSent(replica, dest_addr, file_id);
+        break;
+      }
+    }
+  }
+  std::cout << "Get request sent to " << host << ":" << port << "\n";
   return true;
 }
 
@@ -692,11 +2310,10 @@ void FileOperationsHandler::handleCreateRequest(const CreateFileRequest& req,
   std::cout << "Client ID: " << req.client_id << std::endl;
   logger_.log("RECEIVED CREATE_REQUEST for: " + req.hydfs_filename);
 
-  // Convert client_id from uint64_t to string
-  std::string client_id_str = std::to_string(req.client_id);
-
-  // Store the file locally - the client has already sent this to all replicas
-  bool success = file_store_.createFile(req.hydfs_filename, req.data, client_id_str);
+  // Store the file locally - the client has already sent this to all replicas, and the
+  // first block takes the creator's ID and timestamp so every replica holds the same block
+  bool success =
+      file_store_.createFile(req.hydfs_filename, req.data, req.creator_id, req.timestamp);
 
   if (success) {
     std::cout << "✅ File created successfully: " << req.hydfs_filename << std::endl;
@@ -732,12 +2349,24 @@ void FileOperationsHandler::handleGetRequest(const GetFileRequest& req,
   logger_.log("REPLICA: Received GET_REQUEST for " + req.hydfs_filename);
 
   GetFileResponse resp;
+  resp.request_id = req.request_id;
+  resp.lease_ms = 0;
+  FileId file_id = knownFileId(req.hydfs_filename);
 
-  if (file_store_.hasFile(req.hydfs_filename)) {
+  if (FileSnapshot snapshot = file_store_.pinFile(file_id)) {
     std::cout << "File found in local store" << std::endl;
     resp.success = true;
-    resp.metadata = file_store_.getFileMetadata(req.hydfs_filename);
-    resp.blocks = file_store_.getFileBlocks(req.hydfs_filename);
+    // Only the coordinator, which sees every change to the file first, leases it. The
+    // lease holds if the copy we send was still current once it was registered, so any
+    // later change revokes it
+    if (isCoordinator(req.hydfs_filename)) {
+      uint32_t lease_ms = grantLease(file_id, sender);
+      if (file_store_.pinFile(file_id) == snapshot) {
+        resp.lease_ms = lease_ms;
+      }
+    }
+    resp.metadata = snapshot->metadata;
+    resp.blocks = snapshot->copyBlocks();
     std::cout << "Metadata shows " << resp.metadata.block_ids.size() << " block IDs" << std::endl;
     std::cout << "Retrieved " << resp.blocks.size() << " blocks" << std::endl;
 
@@ -761,6 +2390,8 @@ void FileOperationsHandler::handleGetRequest(const GetFileRequest& req,
     std::cout << "❌ File not found in local store" << std::endl;
     resp.success = false;
     resp.error_message = "File not found";
+    resp.metadata.hydfs_filename = req.hydfs_filename;  // lets the requester match the reply
+    resp.metadata.file_id = FileMetadata::generateFileId(req.hydfs_filename);
   }
 
   try {
@@ -775,6 +2406,10 @@ void FileOperationsHandler::handleGetRequest(const GetFileRequest& req,
       // Send error response instead
       GetFileResponse error_resp;
       error_resp.success = false;
+      error_resp.request_id = req.request_id;
+      error_resp.lease_ms = 0;
+      error_resp.metadata.hydfs_filename = req.hydfs_filename;
+      error_resp.metadata.file_id = FileMetadata::generateFileId(req.hydfs_filename);
       error_resp.error_message = "File too large for UDP transfer (max ~7KB)";
       std::vector<char> small_buffer(4096);
       size_t error_size = error_resp.serialize(small_buffer.data(), small_buffer.size());
@@ -788,6 +2423,10 @@ void FileOperationsHandler::handleGetRequest(const GetFileRequest& req,
     // Send error response
     GetFileResponse error_resp;
     error_resp.success = false;
+    error_resp.request_id = req.request_id;
+    error_resp.lease_ms = 0;
+    error_resp.metadata.hydfs_filename = req.hydfs_filename;
+    error_resp.metadata.file_id = FileMetadata::generateFileId(req.hydfs_filename);
     error_resp.error_message = std::string("Serialization error: ") + e.what();
     std::vector<char> error_buffer(4096);
     size_t error_size = error_resp.serialize(error_buffer.data(), error_buffer.size());
@@ -821,53 +2460,174 @@ void FileOperationsHandler::handleAppendRequest(const AppendFileRequest& req,
 
   std::cout << "Generated block ID: " << block.block_id << std::endl;
 
-  // Append locally
-  bool success = file_store_.appendBlock(req.hydfs_filename, block);
+  // Queue behind concurrent appends to the file; the group commits on the file's sequencer
+  GroupCommitter::Append append;
+  append.block = std::move(block);
+  append.client = sender;
+  append.request_id = req.request_id;
+  append.consistency = req.consistency;
+  group_commit_.add(req.hydfs_filename, file_names_.intern(req.hydfs_filename), std::move(append));
 
+  std::cout << "=========================================\n" << std::endl;
+}
+
+void FileOperationsHandler::dispatchGroups(std::vector<GroupCommitter::Group>& groups) {
+  auto round = std::make_shared<CommitRound>();
+  round->files.resize(groups.size());
+  round->remaining = groups.size();
+  round->chained = chain_replication_;
+
+  for (size_t i = 0; i < groups.size(); i++) {
+    auto group = std::make_shared<GroupCommitter::Group>(std::move(groups[i]));
+    sequencer_.post(group->file_id, [this, round, group, i] {
+      commitGroup(*group, round->chained, round->files[i]);
+      {
+        std::lock_guard<std::mutex> lock(round->mtx);
+        if (--round->remaining > 0) {
+          return;
+        }
+      }
+      replicateRound(*round);
+    });
+  }
+}
+
+void FileOperationsHandler::commitGroup(const GroupCommitter::Group& group, bool chained,
+                                        CommitRound::Committed& committed) {
+  ReplicatedFile& file = committed.file;
+  file.hydfs_filename = group.hydfs_filename;
+  for (const auto& append : group.appends) {
+    file.blocks.push_back(append.block);
+  }
+
+  // Append locally, the whole group as one version
+  bool success = file_store_.appendBlocks(group.file_id, file.blocks);
   if (success) {
-    std::cout << "✅ Appended to local store" << std::endl;
-    logger_.log("Appended block " + std::to_string(block.block_id) + " to " + req.hydfs_filename);
+    file.lsn = append_log_.stamp(group.file_id, file.blocks);
+    std::cout << "✅ Appended " << file.blocks.size() << " blocks to local store" << std::endl;
+    logger_.log("Appended " + std::to_string(file.blocks.size()) + " blocks to " +
+                file.hydfs_filename);
+    for (const auto& block : file.blocks) {
+      client_tracker_.recordAppend(block.client_id, group.file_id, block.block_id,
+                                   block.sequence_num);
+    }
   } else {
     std::cout << "❌ Failed to append locally" << std::endl;
   }
 
-  AppendFileResponse resp;
-  resp.success = success;
-  resp.block_id = block.block_id;
-
-  if (!success) {
-    resp.error_message = "File not found or append failed";
+  // The other replicas in ring order; in chain mode the last one is the tail
+  std::vector<NodeId> replicas;
+  if (success) {
+    replicas = hash_ring_.getFileReplicas(file.hydfs_filename, 3);
+    for (const auto& replica : replicas) {
+      if (!(replica == self_id_)) committed.others.push_back(replica);  // Don't replicate to self
+    }
   }
 
-  char buffer[8192];
-  size_t size = resp.serialize(buffer, sizeof(buffer));
-  sendFileMessage(FileMessageType::APPEND_RESPONSE, buffer, size, sender);
-
-  // Replicate to other nodes
-  if (success) {
-    std::vector<NodeId> replicas = hash_ring_.getFileReplicas(req.hydfs_filename, 3);
-    std::cout << "Replicating to " << replicas.size() << " replicas..." << std::endl;
+  // ONE is answered now; QUORUM and ALL once enough replicas acknowledge the block. In
+  // chain mode they wait for the tail, whose single ack covers the whole chain; the tail
+  // checks the copies the chain actually stored against the level
+  for (const auto& append : group.appends) {
+    uint32_t needed = success ? requiredReplicas(append.consistency, replicas.size()) : 1;
+    bool via_tail = chained && needed > 1;
+    if (needed <= 1) {
+      sendAppendResponse(append.client, append.request_id, success, append.block.block_id,
+                         success ? 1 : 0, success ? "" : "File not found or append failed");
+      committed.write_ids.push_back(0);
+      if (chained) file.replies.push_back({});
+      continue;
+    }
+    uint64_t write_id = next_request_id_++;
+    PendingWrite write;
+    write.client = append.client;
+    write.client_request_id = append.request_id;
+    write.block_id = append.block.block_id;
+    write.needed = via_tail ? 2 : needed;
+    write.acks = 1;  // our own copy
+    write.tail_replies = via_tail;
+    write.deadline = std::chrono::steady_clock::now() + WRITE_ACK_TIMEOUT;
+    {
+      std::lock_guard<std::mutex> lock(writes_mtx_);
+      pending_writes_[write_id] = write;
+    }
+    committed.write_ids.push_back(write_id);
+    if (via_tail) {
+      file.replies.push_back({ntohl(append.client.sin_addr.s_addr),
+                              ntohs(append.client.sin_port), append.request_id,
+                              static_cast<uint8_t>(needed)});
+    }
+  }
+}
 
-    replicateBlock(req.hydfs_filename, block, replicas);
-    client_tracker_.recordAppend(block.client_id, req.hydfs_filename, block.block_id);
+void FileOperationsHandler::replicateRound(CommitRound& round) {
+  // Blocks bound for each replica (or chain), and per block the write its ack counts toward
+  struct Outgoing {
+    std::vector<NodeId> hops;
+    std::vector<ReplicatedFile> files;
+    std::vector<uint64_t> write_ids;
+  };
+  std::vector<Outgoing> outgoing;
+  auto outgoingTo = [&outgoing](const std::vector<NodeId>& hops) -> Outgoing& {
+    for (auto& out : outgoing) {
+      if (out.hops == hops) return out;
+    }
+    outgoing.push_back({hops, {}, {}});
+    return outgoing.back();
+  };
 
-    std::cout << "✅ COORDINATOR: Append operation completed" << std::endl;
+  for (const auto& committed : round.files) {
+    if (committed.others.empty()) {
+      continue;
+    }
+    if (round.chained) {
+      Outgoing& out = outgoingTo(committed.others);
+      out.files.push_back(committed.file);
+      out.write_ids.insert(out.write_ids.end(), committed.write_ids.begin(),
+                           committed.write_ids.end());
+      continue;
+    }
+    for (const auto& replica : committed.others) {
+      Outgoing& out = outgoingTo({replica});
+      out.files.push_back(committed.file);
+      out.write_ids.insert(out.write_ids.end(), committed.write_ids.begin(),
+                           committed.write_ids.end());
+    }
   }
 
-  std::cout << "=========================================\n" << std::endl;
+  // Replicate to other nodes, the groups of all files for a replica (or chain) packed together
+  for (const auto& out : outgoing) {
+    std::cout << "Replicating " << out.write_ids.size() << " blocks of " << out.files.size()
+              << " files to " << out.hops.front() << (round.chained ? " and down the chain" : "")
+              << std::endl;
+    replicateBlocks(out.hops, out.files, out.write_ids, round.chained);
+  }
 }
 
 void FileOperationsHandler::handleMergeRequest(const MergeFileRequest& req,
                                                const struct sockaddr_in& sender) {
-  // TODO: Implement full merge coordination
-  // For now, just respond with success
-  MergeFileResponse resp;
-  resp.success = true;
-  resp.new_version = file_store_.getFileMetadata(req.hydfs_filename).version;
+  // Coordination waits on replies from the replicas, which arrive on this thread
+  std::string hydfs_filename = req.hydfs_filename;
+  struct sockaddr_in reply_to = sender;
+  bool queued = executor_.submit([this, hydfs_filename, reply_to] {
+    MergeFileResponse resp;
+    resp.new_version = 0;
+    if (isCoordinator(hydfs_filename)) {
+      resp.success = coordinateMerge(hydfs_filename, resp.new_version);
+      if (!resp.success) {
+        resp.error_message = "Merge failed";
+      }
+    } else {
+      resp.success = false;
+      resp.error_message = "Not the coordinator for " + hydfs_filename;
+    }
 
-  char buffer[8192];
-  size_t size = resp.serialize(buffer, sizeof(buffer));
-  sendFileMessage(FileMessageType::MERGE_RESPONSE, buffer, size, sender);
+    char buffer[8192];
+    size_t size = resp.serialize(buffer, sizeof(buffer));
+    sendFileMessage(FileMessageType::MERGE_RESPONSE, buffer, size, reply_to);
+  });
+  if (!queued) {
+    logger_.log("Dropped merge request for " + hydfs_filename + ": shutting down");
+  }
 }
 
 void FileOperationsHandler::handleLsRequest(const LsFileRequest& req,
@@ -893,10 +2653,9 @@ void FileOperationsHandler::handleListStoreRequest(const ListStoreRequest& /* re
                                                    const struct sockaddr_in& sender) {
   ListStoreResponse resp;
 
-  std::vector<std::string> files = file_store_.listFiles();
-  for (const auto& filename : files) {
+  for (const auto& [filename, stat] : file_store_.listFileStats()) {
     resp.filenames.push_back(filename);
-    resp.file_ids.push_back(file_store_.getFileMetadata(filename).file_id);
+    resp.file_ids.push_back(stat.file_id);
   }
 
   char buffer[8192];
@@ -908,13 +2667,13 @@ void FileOperationsHandler::handleFileExistsRequest(const FileExistsRequest& req
                                                      const struct sockaddr_in& sender) {
   FileExistsResponse resp;
   resp.hydfs_filename = req.hydfs_filename;
-  resp.exists = file_store_.hasFile(req.hydfs_filename);
+  FileStat stat;
+  resp.exists = file_store_.statFile(req.hydfs_filename, stat);
 
   if (resp.exists) {
-    FileMetadata meta = file_store_.getFileMetadata(req.hydfs_filename);
-    resp.file_id = meta.file_id;
-    resp.file_size = meta.total_size;
-    resp.version = meta.last_modified_timestamp;  // Using version field to store timestamp
+    resp.file_id = stat.file_id;
+    resp.file_size = stat.total_size;
+    resp.version = stat.last_modified_timestamp;  // Using version field to store timestamp
   } else {
     resp.file_id = 0;
     resp.file_size = 0;
@@ -929,7 +2688,7 @@ void FileOperationsHandler::handleFileExistsRequest(const FileExistsRequest& req
 void FileOperationsHandler::handleFileExistsResponse(const FileExistsResponse& resp) {
   std::lock_guard<std::mutex> lock(pending_ls_mtx_);
 
-  auto it = pending_ls_.find(resp.hydfs_filename);
+  auto it = pending_ls_.find(file_names_.intern(resp.hydfs_filename));
   if (it == pending_ls_.end()) {
     // No pending request for this file
     return;
@@ -951,51 +2710,301 @@ void FileOperationsHandler::handleFileExistsResponse(const FileExistsResponse& r
   }
 }
 
-void FileOperationsHandler::handleReplicateBlock(const ReplicateBlockMessage& msg,
-                                                  const struct sockaddr_in& sender) {
-  std::cout << "\n=== RECEIVED REPLICATE_BLOCK ===" << std::endl;
-  std::cout << "Filename: " << msg.hydfs_filename << std::endl;
-  std::cout << "Block ID: " << msg.block.block_id << std::endl;
-  std::cout << "Client ID: " << msg.block.client_id << std::endl;
-  std::cout << "Data size: " << msg.block.size << " bytes" << std::endl;
+void FileOperationsHandler::handleReplicateBlocks(const ReplicateBlocksMessage& msg,
+                                                   const struct sockaddr_in& sender) {
+  // Apply each file's blocks in the head's LSN order; early batches wait for their gap
+  for (const auto& batch : reorder_buffer_.offer({msg, sender, {}})) {
+    applyReplicatedBatch(batch);
+  }
+  requestGaps();
+}
 
-  // Store the replicated block
-  bool success = file_store_.appendBlock(msg.hydfs_filename, msg.block);
+void FileOperationsHandler::requestGaps() {
+  for (const auto& gap : reorder_buffer_.gaps()) {
+    std::cout << "[REPLICATE] Asking " << gap.head << " for LSNs " << gap.from_lsn << "-"
+              << gap.to_lsn - 1 << " of " << gap.hydfs_filename << std::endl;
+    ReplicateGapRequest req;
+    req.hydfs_filename = gap.hydfs_filename;
+    req.from_lsn = gap.from_lsn;
+    req.to_lsn = gap.to_lsn;
 
-  if (!success) {
-    std::cout << "File doesn't exist, creating new file..." << std::endl;
-    // Try to create the file first (in case it doesn't exist yet)
-    success = file_store_.createFile(msg.hydfs_filename, msg.block.data, msg.block.client_id);
+    char buffer[512];
+    size_t size = req.serialize(buffer, sizeof(buffer));
+    struct sockaddr_in dest_addr;
+    socket_.buildServerAddr(dest_addr, gap.head.host, gap.head.port);
+    sendFileMessage(FileMessageType::REPLICATE_GAP_REQUEST, buffer, size, dest_addr);
   }
+}
 
-  if (success) {
-    std::cout << "✅ Block replicated successfully" << std::endl;
-  } else {
-    std::cout << "❌ Block replication FAILED" << std::endl;
+void FileOperationsHandler::handleGapRequest(const ReplicateGapRequest& req,
+                                             const struct sockaddr_in& sender) {
+  // Resend the range from our store; if part of it is gone, skip the replica past it
+  // and merge the file so it gets what it missed in whatever form we now hold it
+  std::vector<uint64_t> block_ids;
+  std::vector<FileBlock> blocks;
+  FileId file_id = 0;
+  FileSnapshot current;
+  if (file_names_.find(req.hydfs_filename, file_id)) {
+    current = file_store_.pinFile(file_id);
   }
-  std::cout << "================================\n" << std::endl;
+  bool complete = current && append_log_.range(file_id, req.from_lsn, req.to_lsn, block_ids);
+  if (complete) {
+    // One pass over the file from the tail, where recent LSNs sit
+    std::unordered_map<uint64_t, size_t> position_of;
+    for (uint64_t block_id : block_ids) {
+      position_of.emplace(block_id, SIZE_MAX);
+    }
+    size_t pending = position_of.size();
+    size_t position = current->blockCount();
+    current->metadata.block_ids.forEachChunkReverse([&](const uint64_t* ids, size_t count) {
+      for (size_t i = count; i-- > 0 && pending > 0;) {
+        position--;
+        auto it = position_of.find(ids[i]);
+        if (it != position_of.end() && it->second == SIZE_MAX) {
+          it->second = position;
+          pending--;
+        }
+      }
+      return pending > 0;
+    });
+    complete = pending == 0;  // otherwise compacted or truncated since
+    for (size_t i = 0; complete && i < block_ids.size(); i++) {
+      blocks.push_back(current->copyBlock(position_of[block_ids[i]]));
+    }
+  }
+
+  ReplicateBlocksMessage msg;
+  msg.request_id = 0;  // gap fills are not acked
+  msg.head = self_id_;
+  char buffer[8192];
+  auto send = [&] {
+    size_t size = msg.serialize(buffer, sizeof(buffer));
+    sendFileMessage(FileMessageType::REPLICATE_BLOCKS, buffer, size, sender);
+  };
+  ReplicatedFile file;
+  file.hydfs_filename = req.hydfs_filename;
+  if (!complete || blocks.empty()) {
+    file.lsn = req.to_lsn;
+    msg.files.push_back(file);
+    send();
+    logger_.log("Skipped a replica past LSN " + std::to_string(req.to_lsn) + " of " +
+                req.hydfs_filename);
+    if (current) {
+      scheduleGapMerge(file_id, req.hydfs_filename);
+    }
+    return;
+  }
+
+  size_t bytes = 0;
+  file.lsn = req.from_lsn;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    size_t block_bytes = blocks[i].serializedSize();
+    if (!file.blocks.empty() && bytes + block_bytes > REPLICATE_BATCH_BYTES) {
+      msg.files = {file};
+      send();
+      file.lsn += file.blocks.size();
+      file.blocks.clear();
+      bytes = 0;
+    }
+    file.blocks.push_back(std::move(blocks[i]));
+    bytes += block_bytes;
+  }
+  msg.files = {file};
+  send();
+  logger_.log("Resent LSNs " + std::to_string(req.from_lsn) + "-" +
+              std::to_string(req.to_lsn - 1) + " of " + req.hydfs_filename);
+}
+
+void FileOperationsHandler::scheduleGapMerge(FileId file_id, const std::string& hydfs_filename) {
+  {
+    std::lock_guard<std::mutex> lock(gap_merges_mtx_);
+    if (!gap_merges_.insert(file_id).second) {
+      return;  // the replica asked again before the merge ran
+    }
+  }
+  bool queued = executor_.submit([this, file_id, hydfs_filename] {
+    if (!mergeFile(hydfs_filename)) {
+      logger_.log("Merge of " + hydfs_filename + " after a gap it couldn't fill failed");
+    }
+    std::lock_guard<std::mutex> lock(gap_merges_mtx_);
+    gap_merges_.erase(file_id);
+  });
+  if (!queued) {
+    std::lock_guard<std::mutex> lock(gap_merges_mtx_);
+    gap_merges_.erase(file_id);
+  }
+}
+
+void FileOperationsHandler::applyReplicatedBatch(const ReorderBuffer::Batch& batch) {
+  const ReplicateBlocksMessage& msg = batch.msg;
+  const struct sockaddr_in& sender = batch.sender;
+
+  // Apply the files in order; the ack's high-water mark covers the blocks stored so far
+  uint32_t applied = 0;
+  for (size_t f = 0; f < msg.files.size(); f++) {
+    const ReplicatedFile& file = msg.files[f];
+    FileId file_id = file_names_.intern(file.hydfs_filename);
+
+    // A batch may arrive twice if its ack was lost. Its LSNs tell how many blocks an
+    // earlier copy already delivered; unsequenced blocks are looked for near the tail
+    FileSnapshot current = file_store_.pinFile(file_id);
+    size_t delivered = f < batch.delivered.size() ? batch.delivered[f] : 0;
+    std::unordered_set<uint64_t> held;
+    if (file.lsn == 0) {
+      std::unordered_set<uint64_t> incoming;
+      for (const auto& block : file.blocks) {
+        incoming.insert(block.block_id);
+      }
+      held = heldRecently(current, incoming);
+    }
+    std::vector<FileBlock> missing;
+    for (size_t i = delivered; i < file.blocks.size(); i++) {
+      if (!held.count(file.blocks[i].block_id)) {
+        missing.push_back(file.blocks[i]);
+      }
+    }
+
+    bool success = true;
+    if (!missing.empty() && !current) {
+      // Try to create the file first (in case it doesn't exist yet)
+      success = file_store_.createFile(file.hydfs_filename, missing.front().data,
+                                       missing.front().client_id);
+      missing.erase(missing.begin());
+    }
+    if (success && !missing.empty()) {
+      success = file_store_.appendBlocks(file_id, missing);
+    }
+    if (!success) {
+      logger_.log("Replication FAILED for file: " + file.hydfs_filename);
+      break;
+    }
+    applied += static_cast<uint32_t>(file.blocks.size());
+  }
+  logger_.log("Replicated " + std::to_string(applied) + " of " +
+              std::to_string(msg.blockCount()) + " blocks");
+
+  if (msg.chained) {
+    forwardChain(msg, applied);
+    return;
+  }
+  if (msg.request_id == 0) {
+    return;  // a gap fill
+  }
+
+  // Blocks past the mark are retried from the coordinator's hints
+  ReplicateBlocksAck ack;
+  ack.request_id = msg.request_id;
+  ack.applied = applied;
 
-  logger_.log("Replicated block for file: " + msg.hydfs_filename +
-              (success ? " [SUCCESS]" : " [FAILED]"));
+  char buffer[64];
+  size_t size = ack.serialize(buffer, sizeof(buffer));
+  sendFileMessage(FileMessageType::REPLICATE_BLOCKS_ACK, buffer, size, sender);
+}
 
-  // Send acknowledgment back to coordinator
-  ReplicateBlockMessage ack_msg;
-  ack_msg.hydfs_filename = msg.hydfs_filename;
-  ack_msg.block = msg.block;  // Include original block for identification
+void FileOperationsHandler::forwardChain(const ReplicateBlocksMessage& msg, uint32_t applied) {
+  // Pass on only the files we stored, so the tail's mark never runs ahead of ours
+  ReplicateBlocksMessage next = msg;
+  next.stored_by = msg.stored_by + 1;
+  next.files.clear();
+  size_t kept = 0;
+  for (const auto& file : msg.files) {
+    if (kept + file.blocks.size() > applied) break;
+    kept += file.blocks.size();
+    next.files.push_back(file);
+  }
 
+  // Hand the batch to the next reachable hop; one that is down gets it as hints
   char buffer[8192];
-  size_t size = ack_msg.serialize(buffer, sizeof(buffer));
-  sendFileMessage(FileMessageType::REPLICATE_ACK, buffer, size, sender);
+  for (size_t i = 0; i < msg.chain.size(); i++) {
+    const NodeId& hop = msg.chain[i];
+    if (canSendTo(hop)) {
+      next.chain.assign(msg.chain.begin() + i + 1, msg.chain.end());
+      size_t size = next.serialize(buffer, sizeof(buffer));
+      struct sockaddr_in dest_addr;
+      socket_.buildServerAddr(dest_addr, hop.host, hop.port);
+      if (sendFileMessage(FileMessageType::REPLICATE_BLOCKS, buffer, size, dest_addr)) {
+        return;
+      }
+    }
+    if (hints_) {
+      hintBlocks(hop, next.files);
+    }
+  }
+
+  // We are the tail: answer the clients of the blocks we stored, then give the head its
+  // ack. Hops that were down only got hints, so a write whose level asks for more copies
+  // than the chain stored fails
+  for (const auto& file : next.files) {
+    for (size_t i = 0; i < file.blocks.size() && i < file.replies.size(); i++) {
+      const ChainReply& reply = file.replies[i];
+      if (reply.client_port == 0) {
+        continue;  // the head answered this one
+      }
+      struct sockaddr_in client {};
+      client.sin_family = AF_INET;
+      client.sin_addr.s_addr = htonl(reply.client_ip);
+      client.sin_port = htons(reply.client_port);
+      bool enough = next.stored_by >= reply.needed;
+      sendAppendResponse(client, reply.request_id, enough, file.blocks[i].block_id,
+                         next.stored_by,
+                         enough ? "" : "Not enough replicas stored the block");
+    }
+  }
+
+  ReplicateBlocksAck ack;
+  ack.request_id = msg.request_id;
+  ack.applied = applied;
+  size_t size = ack.serialize(buffer, sizeof(buffer));
+  struct sockaddr_in head_addr;
+  socket_.buildServerAddr(head_addr, msg.head.host, msg.head.port);
+  sendFileMessage(FileMessageType::REPLICATE_BLOCKS_ACK, buffer, size, head_addr);
 }
 
 void FileOperationsHandler::handleCollectBlocksRequest(const CollectBlocksRequest& req,
                                                        const struct sockaddr_in& sender) {
   CollectBlocksResponse resp;
   resp.hydfs_filename = req.hydfs_filename;
-
-  if (file_store_.hasFile(req.hydfs_filename)) {
-    resp.blocks = file_store_.getFileBlocks(req.hydfs_filename);
-    resp.version = file_store_.getFileMetadata(req.hydfs_filename).version;
+  resp.request_id = req.request_id;
+  resp.found = false;
+  resp.version = 0;
+  resp.total_blocks = 0;
+  resp.list_hash = 0;
+  resp.digest_from = req.digest_from;
+
+  if (FileSnapshot snapshot = file_store_.pinFile(req.hydfs_filename)) {
+    resp.found = true;
+    resp.version = snapshot->metadata.version;
+    resp.total_blocks = static_cast<uint32_t>(snapshot->blockCount());
+    resp.list_hash = snapshot->listHash();
+
+    size_t reply_bytes = 0;
+    if (!req.wanted_block_ids.empty()) {
+      // Ship the wanted blocks that fit; the coordinator asks again for the rest
+      std::unordered_set<uint64_t> wanted(req.wanted_block_ids.begin(),
+                                          req.wanted_block_ids.end());
+      for (size_t i = 0; i < snapshot->blockCount() && resp.blocks.size() < wanted.size(); i++) {
+        if (!wanted.count(snapshot->blockAt(i).block_id)) {
+          continue;
+        }
+        FileBlock block = snapshot->copyBlock(i);
+        size_t block_bytes = block.serializedSize();
+        if (!resp.blocks.empty() && reply_bytes + block_bytes > MERGE_PAGE_BYTES) {
+          break;
+        }
+        reply_bytes += block_bytes;
+        resp.blocks.push_back(std::move(block));
+      }
+    } else if (!req.summary_only) {
+      for (size_t i = req.digest_from; i < snapshot->blockCount(); i++) {
+        BlockDigest digest = snapshot->digestAt(i);
+        size_t bytes = digestBytes(digest);
+        if (!resp.digests.empty() && reply_bytes + bytes > MERGE_PAGE_BYTES) {
+          break;
+        }
+        reply_bytes += bytes;
+        resp.digests.push_back(std::move(digest));
+      }
+    }
   }
 
   char buffer[8192];
@@ -1003,13 +3012,150 @@ void FileOperationsHandler::handleCollectBlocksRequest(const CollectBlocksReques
   sendFileMessage(FileMessageType::COLLECT_BLOCKS_RESPONSE, buffer, size, sender);
 }
 
-void FileOperationsHandler::handleMergeUpdate(const MergeUpdateMessage& msg) {
-  // TODO: Apply merged block list
-  logger_.log("Received merge update for: " + msg.hydfs_filename);
+void FileOperationsHandler::handleMergeUpdate(const MergeUpdateMessage& msg,
+                                              const struct sockaddr_in& sender) {
+  FileId file_id = file_names_.intern(msg.hydfs_filename);
+  MergeUpdateAck ack;
+  ack.hydfs_filename = msg.hydfs_filename;
+  ack.request_id = msg.request_id;
+  ack.success = false;
+  {
+    std::lock_guard<std::mutex> lock(staged_mtx_);
+    StagedMerge& staged = staged_merges_[file_id];
+    if (staged.request_id != msg.request_id) {
+      staged = StagedMerge();  // a newer update replaces whatever an older one left
+      staged.request_id = msg.request_id;
+      staged.page_count = msg.page_count;
+    }
+    if (msg.page >= staged.page_count) {
+      logger_.log("Bad merge update page for " + msg.hydfs_filename + ", discarding");
+      return;
+    }
+    // A resent page we already hold adds nothing
+    if (staged.block_ids.emplace(msg.page, msg.merged_block_ids).second) {
+      staged.blocks.insert(staged.blocks.end(), msg.blocks.begin(), msg.blocks.end());
+    }
+    if (!msg.commit) {
+      return;
+    }
+
+    // Ask for the pages that went missing rather than failing the whole update
+    for (uint32_t page = 0;
+         page < staged.page_count && ack.missing_pages.size() < MERGE_MISSING_PAGES; page++) {
+      if (staged.block_ids.count(page) == 0) {
+        ack.missing_pages.push_back(page);
+      }
+    }
+    if (ack.missing_pages.empty()) {
+      std::vector<uint64_t> block_ids;
+      for (const auto& [page, ids] : staged.block_ids) {
+        block_ids.insert(block_ids.end(), ids.begin(), ids.end());
+      }
+      ack.success = file_store_.applyMerge(msg.hydfs_filename, block_ids, staged.blocks,
+                                           msg.new_version);
+      staged_merges_.erase(file_id);
+    }
+  }
+
+  if (!ack.missing_pages.empty()) {
+    logger_.log("Merge update for " + msg.hydfs_filename + " is missing " +
+                std::to_string(ack.missing_pages.size()) + " pages, asking for them again");
+  } else {
+    logger_.log("Merge update for " + msg.hydfs_filename + " to version " +
+                std::to_string(msg.new_version) + (ack.success ? " applied" : " failed"));
+  }
+
+  char buffer[1024];
+  size_t size = ack.serialize(buffer, sizeof(buffer));
+  sendFileMessage(FileMessageType::MERGE_UPDATE_ACK, buffer, size, sender);
+}
+
+void FileOperationsHandler::handleTruncateFile(const TruncateFileMessage& msg,
+                                              const struct sockaddr_in& sender) {
+  TruncateFileAck ack;
+  ack.request_id = msg.request_id;
+  ack.success = file_store_.hasFile(msg.hydfs_filename);
+  size_t dropped = file_store_.truncateThrough(msg.hydfs_filename, msg.through_timestamp);
+  logger_.log("Truncated " + msg.hydfs_filename + " through " +
+              std::to_string(msg.through_timestamp) + " (" + std::to_string(dropped) +
+              " blocks dropped)");
+
+  char buffer[1024];
+  size_t size = ack.serialize(buffer, sizeof(buffer));
+  sendFileMessage(FileMessageType::TRUNCATE_FILE_ACK, buffer, size, sender);
+}
+
+void FileOperationsHandler::handleDeleteFile(const DeleteFileMessage& msg) {
+  // Our ring view may lag the sender's; never drop a file we still replicate
+  for (const auto& replica : hash_ring_.getFileReplicas(msg.hydfs_filename, 3)) {
+    if (replica == self_id_) {
+      logger_.log("Kept " + msg.hydfs_filename + ": still a replica here");
+      return;
+    }
+  }
+  if (file_store_.deleteFile(msg.hydfs_filename)) {
+    logger_.log("Dropped " + msg.hydfs_filename + ": no longer a replica here");
+  }
+}
+
+void FileOperationsHandler::handleHintBatch(const HintBatchMessage& msg,
+                                            const struct sockaddr_in& sender) {
+  // A batch may be replayed twice if its ack was lost; skip blocks we already hold,
+  // looked for once per file among its recent blocks, where a replay's blocks sit
+  std::unordered_map<std::string, std::unordered_set<uint64_t>> held;
+  for (const auto& hint : msg.hints) {
+    held[hint.hydfs_filename].insert(hint.block.block_id);
+  }
+  for (auto& [filename, ids] : held) {
+    ids = heldRecently(file_store_.pinFile(filename), ids);
+  }
+
+  bool success = true;
+  size_t applied = 0;
+  for (const auto& hint : msg.hints) {
+    if (held[hint.hydfs_filename].count(hint.block.block_id)) {
+      continue;
+    }
+    FileSnapshot current = file_store_.pinFile(hint.hydfs_filename);
+
+    bool stored = current ? file_store_.appendBlock(hint.hydfs_filename, hint.block)
+                          : file_store_.createFile(hint.hydfs_filename, hint.block.data,
+                                                   hint.block.client_id);
+    if (stored) {
+      applied++;
+    } else {
+      success = false;
+    }
+  }
+  logger_.log("Applied " + std::to_string(applied) + " of " + std::to_string(msg.hints.size()) +
+              " hinted blocks");
+
+  HintBatchAck ack;
+  ack.request_id = msg.request_id;
+  ack.success = success;
+
+  char buffer[64];
+  size_t size = ack.serialize(buffer, sizeof(buffer));
+  sendFileMessage(FileMessageType::HINT_BATCH_ACK, buffer, size, sender);
 }
 
 void FileOperationsHandler::handleGetResponse(const GetFileResponse& resp,
                                                const std::string& local_filename) {
+  FileId file_id = knownFileId(resp.metadata.hydfs_filename);
+  std::chrono::steady_clock::time_point issued_at;  // unknown: the copy isn't cached
+  {
+    // A hedged read already has its answer; the slower replica's reply is dropped
+    std::lock_guard<std::mutex> lock(pending_gets_mtx_);
+    auto it = get_results_.find(file_id);
+    if (it != get_results_.end() && it->second) {
+      std::cout << "[HEDGE] Dropping late GET_RESPONSE for " << resp.metadata.hydfs_filename
+                << std::endl;
+      return;
+    }
+    auto started = get_started_.find(file_id);
+    if (started != get_started_.end()) issued_at = started->second;
+  }
+
   std::cout << "\n=== RECEIVED GET_RESPONSE ===" << std::endl;
   std::cout << "Success: " << (resp.success ? "YES" : "NO") << std::endl;
 
@@ -1019,9 +3165,9 @@ void FileOperationsHandler::handleGetResponse(const GetFileResponse& resp,
 
     // Signal failure to waiting thread
     std::lock_guard<std::mutex> lock(pending_gets_mtx_);
-    auto it = pending_gets_.find(resp.metadata.hydfs_filename);
+    auto it = pending_gets_.find(file_id);
     if (it != pending_gets_.end()) {
-      get_results_[resp.metadata.hydfs_filename] = false;
+      get_results_[file_id] = false;
       get_cv_.notify_all();
     }
     return;
@@ -1049,19 +3195,37 @@ void FileOperationsHandler::handleGetResponse(const GetFileResponse& resp,
     }
   }
 
-  // Check read-my-writes consistency
-  std::string client_id = getClientId();
-  if (!client_tracker_.satisfiesReadMyWrites(client_id, resp.metadata.hydfs_filename,
-                                             resp.metadata.block_ids)) {
-    std::cout << "❌ Response does not satisfy read-my-writes consistency" << std::endl;
-    std::cout << "Some of your appended blocks are missing from this replica" << std::endl;
-    std::cout << "============================\n" << std::endl;
+  bool stored = storeGetResponse(resp, local_filename, issued_at);
+  std::cout << "============================\n" << std::endl;
 
-    // Signal failure
+  // Signal the result to waiting thread
+  {
     std::lock_guard<std::mutex> lock(pending_gets_mtx_);
-    get_results_[resp.metadata.hydfs_filename] = false;
+    get_results_[file_id] = stored;
     get_cv_.notify_all();
-    return;
+  }
+
+  // Heal replicas that lag the copy we just read; the read doesn't wait for it
+  if (stored) {
+    scheduleReadRepair(resp.metadata.hydfs_filename, resp.metadata.version, resp.blocks);
+  }
+}
+
+bool FileOperationsHandler::storeGetResponse(const GetFileResponse& resp,
+                                             const std::string& local_filename,
+                                             std::chrono::steady_clock::time_point issued_at) {
+  // Check read-my-writes consistency (compacted extents carry their provenance ranges)
+  std::string client_id = getClientId();
+  std::vector<BlockRange> compacted;
+  for (const auto& block : resp.blocks) {
+    compacted.insert(compacted.end(), block.ranges.begin(), block.ranges.end());
+  }
+  FileId file_id = knownFileId(resp.metadata.hydfs_filename);
+  if (!client_tracker_.satisfiesReadMyWrites(client_id, file_id,
+                                             resp.metadata.block_ids, compacted)) {
+    std::cout << "❌ Response does not satisfy read-my-writes consistency" << std::endl;
+    std::cout << "Some of your appended blocks are missing from this replica" << std::endl;
+    return false;
   }
 
   // Assemble file from blocks
@@ -1074,16 +3238,104 @@ void FileOperationsHandler::handleGetResponse(const GetFileResponse& resp,
 
   std::cout << "Assembled file data: " << file_data.size() << " bytes" << std::endl;
 
+  // Keep a leased copy for later reads; its lease runs from when the read was sent, so it
+  // never outlives the replica's record of it
+  if (resp.lease_ms > 0 && issued_at != std::chrono::steady_clock::time_point()) {
+    ReadCache::Entry entry;
+    entry.version = resp.metadata.version;
+    entry.block_ids = resp.metadata.block_ids;
+    entry.compacted = compacted;
+    entry.data = file_data;
+    entry.lease_expiry = issued_at + std::chrono::milliseconds(resp.lease_ms);
+    read_cache_.put(file_id, std::move(entry), issued_at);
+  }
+
   // Store in local cache instead of filesystem
   storeLocalFile(local_filename, file_data);
 
   std::cout << "✅ File stored in local cache: " << local_filename << std::endl;
   logger_.log("GET_RESPONSE processed successfully for " + resp.metadata.hydfs_filename);
-  std::cout << "============================\n" << std::endl;
+  return true;
+}
+
+void FileOperationsHandler::handleGetCancel(const GetCancelMessage& msg,
+                                            const struct sockaddr_in& sender) {
+  FileId file_id = knownFileId(msg.hydfs_filename);
+  if (file_id == 0) {
+    return;  // we hold no copy, so there is nothing to send
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(cancelled_gets_mtx_);
+  // A cancel outlives the GET it was for by at most the requester's wait
+  for (auto it = cancelled_gets_.begin(); it != cancelled_gets_.end();) {
+    it = now - it->second > GET_REPLY_TIMEOUT ? cancelled_gets_.erase(it) : std::next(it);
+  }
+  cancelled_gets_[{sender.sin_addr.s_addr, sender.sin_port, file_id}] = now;
+}
+
+void FileOperationsHandler::handleGetSinceRequest(const GetSinceRequest& req,
+                                                  const struct sockaddr_in& sender) {
+  logger_.log("REPLICA: Received GET_SINCE_REQUEST for " + req.hydfs_filename);
+  GetSinceResponse resp;
+  resp.success = false;
+  resp.hydfs_filename = req.hydfs_filename;
+  resp.version = 0;
+  resp.anchor_found = false;
+  resp.more = false;
+
+  if (FileSnapshot snapshot = file_store_.pinFile(req.hydfs_filename)) {
+    resp.success = true;
+    resp.version = snapshot->metadata.version;
+    std::vector<FileBlock> blocks =
+        snapshot->blocksSince(req.since_timestamp, req.since_block_id, resp.anchor_found);
+
+    // Send what fits in one datagram; the requester polls again from the last block
+    size_t reply_bytes = 0;
+    for (auto& block : blocks) {
+      size_t block_bytes = block.serializedSize();
+      if (!resp.blocks.empty() && reply_bytes + block_bytes > GET_SINCE_REPLY_BYTES) {
+        resp.more = true;
+        break;
+      }
+      reply_bytes += block_bytes;
+      resp.blocks.push_back(std::move(block));
+    }
+    std::cout << "[GET_SINCE] " << req.hydfs_filename << ": " << resp.blocks.size() << " of "
+              << blocks.size() << " new block(s)" << std::endl;
+  } else {
+    resp.error_message = "File not found";
+  }
+
+  try {
+    std::vector<char> buffer(UDPSocketConnection::BUFFER_LEN);
+    size_t size = resp.serialize(buffer.data(), buffer.size());
+    sendFileMessage(FileMessageType::GET_SINCE_RESPONSE, buffer.data(), size, sender);
+  } catch (const std::exception& e) {
+    std::cout << "❌ ERROR during serialization: " << e.what() << std::endl;
+    GetSinceResponse error_resp = resp;
+    error_resp.success = false;
+    error_resp.error_message = std::string("Serialization error: ") + e.what();
+    error_resp.blocks.clear();
+    std::vector<char> error_buffer(4096);
+    size_t error_size = error_resp.serialize(error_buffer.data(), error_buffer.size());
+    sendFileMessage(FileMessageType::GET_SINCE_RESPONSE, error_buffer.data(), error_size, sender);
+  }
+}
+
+void FileOperationsHandler::handleGetSinceResponse(const GetSinceResponse& resp,
+                                                   const std::string& local_filename) {
+  std::cout << "\n=== RECEIVED GET_SINCE_RESPONSE ===" << std::endl;
+  if (resp.success) {
+    std::cout << "File: " << resp.hydfs_filename << " (version " << resp.version << ")"
+              << std::endl;
+    storeBlocksSince(local_filename, resp.blocks, resp.anchor_found, resp.more);
+  } else {
+    std::cout << "❌ Error: " << resp.error_message << std::endl;
+  }
 
-  // Signal success to waiting thread
   std::lock_guard<std::mutex> lock(pending_gets_mtx_);
-  get_results_[resp.metadata.hydfs_filename] = true;
+  get_results_[knownFileId(resp.hydfs_filename)] = resp.success;
   get_cv_.notify_all();
 }
 
@@ -1106,12 +3358,32 @@ void FileOperationsHandler::handleFileMessage(FileMessageType type, const char*
       }
       case FileMessageType::GET_REQUEST: {
         GetFileRequest req = GetFileRequest::deserialize(buffer, buffer_size);
-        handleGetRequest(req, sender);
+        auto arrived = std::chrono::steady_clock::now();
+        get_executor_.submit([this, req = std::move(req), sender, arrived] {
+          if (getCancelled(sender, knownFileId(req.hydfs_filename), arrived)) {
+            logger_.log("GET of " + req.hydfs_filename + " cancelled by the requester, not sent");
+            return;
+          }
+          handleGetRequest(req, sender);
+        });
+        break;
+      }
+      case FileMessageType::GET_CANCEL: {
+        GetCancelMessage msg = GetCancelMessage::deserialize(buffer, buffer_size);
+        handleGetCancel(msg, sender);
+        break;
+      }
+      case FileMessageType::GET_SINCE_REQUEST: {
+        GetSinceRequest req = GetSinceRequest::deserialize(buffer, buffer_size);
+        handleGetSinceRequest(req, sender);
         break;
       }
       case FileMessageType::APPEND_REQUEST: {
         AppendFileRequest req = AppendFileRequest::deserialize(buffer, buffer_size);
-        handleAppendRequest(req, sender);
+        FileId file_id = file_names_.intern(req.hydfs_filename);
+        sequencer_.post(file_id, [this, req = std::move(req), sender] {
+          handleAppendRequest(req, sender);
+        });
         break;
       }
       case FileMessageType::MERGE_REQUEST: {
@@ -1139,10 +3411,9 @@ void FileOperationsHandler::handleFileMessage(FileMessageType type, const char*
         handleFileExistsResponse(resp);
         break;
       }
-      case FileMessageType::REPLICATE_BLOCK: {
-        std::cout << "[HANDLE_FILE_MSG] Dispatching to handleReplicateBlock" << std::endl;
-        ReplicateBlockMessage msg = ReplicateBlockMessage::deserialize(buffer, buffer_size);
-        handleReplicateBlock(msg, sender);
+      case FileMessageType::REPLICATE_BLOCKS: {
+        ReplicateBlocksMessage msg = ReplicateBlocksMessage::deserialize(buffer, buffer_size);
+        handleReplicateBlocks(msg, sender);
         break;
       }
       case FileMessageType::COLLECT_BLOCKS_REQUEST: {
@@ -1150,15 +3421,91 @@ void FileOperationsHandler::handleFileMessage(FileMessageType type, const char*
         handleCollectBlocksRequest(req, sender);
         break;
       }
-      case FileMessageType::MERGE_UPDATE: {
+      case FileMessageType::MERGE_UPDATE:
+      case FileMessageType::TRANSFER_FILES: {
         MergeUpdateMessage msg = MergeUpdateMessage::deserialize(buffer, buffer_size);
-        handleMergeUpdate(msg);
+        handleMergeUpdate(msg, sender);
+        break;
+      }
+      case FileMessageType::MERGE_UPDATE_ACK: {
+        MergeUpdateAck ack = MergeUpdateAck::deserialize(buffer, buffer_size);
+        std::lock_guard<std::mutex> lock(merge_mtx_);
+        auto it = pending_merge_updates_.find(ack.request_id);
+        if (it != pending_merge_updates_.end()) {
+          it->second = std::move(ack);
+          merge_cv_.notify_all();
+        }
+        break;
+      }
+      case FileMessageType::DELETE_FILE: {
+        DeleteFileMessage msg = DeleteFileMessage::deserialize(buffer, buffer_size);
+        handleDeleteFile(msg);
+        break;
+      }
+      case FileMessageType::MERKLE_REQUEST: {
+        MerkleRequest req = MerkleRequest::deserialize(buffer, buffer_size);
+        handleMerkleRequest(req, sender);
+        break;
+      }
+      case FileMessageType::MERKLE_RESPONSE: {
+        MerkleResponse resp = MerkleResponse::deserialize(buffer, buffer_size);
+        std::lock_guard<std::mutex> lock(merge_mtx_);
+        auto it = pending_merkle_.find(resp.request_id);
+        if (it != pending_merkle_.end()) {
+          it->second = std::move(resp);
+          merge_cv_.notify_all();
+        }
+        break;
+      }
+      case FileMessageType::TRUNCATE_FILE: {
+        TruncateFileMessage msg = TruncateFileMessage::deserialize(buffer, buffer_size);
+        handleTruncateFile(msg, sender);
+        break;
+      }
+      case FileMessageType::TRUNCATE_FILE_ACK: {
+        TruncateFileAck ack = TruncateFileAck::deserialize(buffer, buffer_size);
+        std::lock_guard<std::mutex> lock(merge_mtx_);
+        auto it = pending_merge_acks_.find(ack.request_id);
+        if (it != pending_merge_acks_.end()) {
+          it->second = ack.success;
+          merge_cv_.notify_all();
+        }
+        break;
+      }
+      case FileMessageType::REPLICATE_GAP_REQUEST: {
+        ReplicateGapRequest req = ReplicateGapRequest::deserialize(buffer, buffer_size);
+        handleGapRequest(req, sender);
+        break;
+      }
+      case FileMessageType::REPLICATE_BLOCKS_ACK: {
+        ReplicateBlocksAck ack = ReplicateBlocksAck::deserialize(buffer, buffer_size);
+        if (hints_) {
+          hints_->acknowledge(ack.request_id, ack.applied);
+        }
+        recordWriteAck(ack.request_id, ack.applied);
+        break;
+      }
+      case FileMessageType::HINT_BATCH: {
+        HintBatchMessage msg = HintBatchMessage::deserialize(buffer, buffer_size);
+        handleHintBatch(msg, sender);
+        break;
+      }
+      case FileMessageType::LEASE_INVALIDATE: {
+        LeaseInvalidateMessage msg = LeaseInvalidateMessage::deserialize(buffer, buffer_size);
+        if (FileId file_id = knownFileId(msg.hydfs_filename)) {
+          read_cache_.invalidate(file_id);
+        }
+        logger_.log("Read lease revoked for " + msg.hydfs_filename);
         break;
       }
-      case FileMessageType::REPLICATE_ACK: {
-        // Acknowledgment received - log it
-        ReplicateBlockMessage ack_msg = ReplicateBlockMessage::deserialize(buffer, buffer_size);
-        logger_.log("Received replication ACK for: " + ack_msg.hydfs_filename);
+      case FileMessageType::HINT_BATCH_ACK: {
+        HintBatchAck ack = HintBatchAck::deserialize(buffer, buffer_size);
+        std::lock_guard<std::mutex> lock(merge_mtx_);
+        auto it = pending_merge_acks_.find(ack.request_id);
+        if (it != pending_merge_acks_.end()) {
+          it->second = ack.success;
+          merge_cv_.notify_all();
+        }
         break;
       }
       case FileMessageType::CREATE_RESPONSE: {
@@ -1173,12 +3520,25 @@ void FileOperationsHandler::handleFileMessage(FileMessageType type, const char*
       case FileMessageType::GET_RESPONSE: {
         GetFileResponse resp = GetFileResponse::deserialize(buffer, buffer_size);
         std::cout << "[RESPONSE] GET_RESPONSE received - success: " << resp.success << std::endl;
+        FileId file_id = knownFileId(resp.metadata.hydfs_filename);
+        trackGetReply(sender, file_id);
+
+        // Replies to a quorum read are collected for the reader to pick from
+        if (resp.request_id != 0) {
+          std::lock_guard<std::mutex> lock(merge_mtx_);
+          auto it = pending_reads_.find(resp.request_id);
+          if (it != pending_reads_.end()) {
+            it->second.push_back(std::move(resp));
+            merge_cv_.notify_all();
+          }
+          break;
+        }
 
         // Find the pending get request to determine local filename
         std::string local_filename;
         {
           std::lock_guard<std::mutex> lock(pending_gets_mtx_);
-          auto it = pending_gets_.find(resp.metadata.hydfs_filename);
+          auto it = pending_gets_.find(file_id);
           if (it != pending_gets_.end()) {
             local_filename = it->second;
           }
@@ -1191,10 +3551,34 @@ void FileOperationsHandler::handleFileMessage(FileMessageType type, const char*
         }
         break;
       }
+      case FileMessageType::GET_SINCE_RESPONSE: {
+        GetSinceResponse resp = GetSinceResponse::deserialize(buffer, buffer_size);
+        std::string local_filename;
+        {
+          std::lock_guard<std::mutex> lock(pending_gets_mtx_);
+          auto it = pending_gets_.find(knownFileId(resp.hydfs_filename));
+          if (it != pending_gets_.end()) {
+            local_filename = it->second;
+          }
+        }
+
+        if (!local_filename.empty()) {
+          handleGetSinceResponse(resp, local_filename);
+        } else {
+          std::cout << "[WARNING] Received GET_SINCE_RESPONSE for non-pending request" << std::endl;
+        }
+        break;
+      }
       case FileMessageType::APPEND_RESPONSE: {
         AppendFileResponse resp = AppendFileResponse::deserialize(buffer, buffer_size);
         std::cout << "[RESPONSE] APPEND_RESPONSE received - success: " << resp.success
-                  << " block_id: " << resp.block_id << std::endl;
+                  << " block_id: " << resp.block_id << " acks: " << resp.acks << std::endl;
+        std::lock_guard<std::mutex> lock(merge_mtx_);
+        auto it = pending_appends_.find(resp.request_id);
+        if (it != pending_appends_.end()) {
+          it->second = std::move(resp);
+          merge_cv_.notify_all();
+        }
         break;
       }
       case FileMessageType::MERGE_RESPONSE: {
@@ -1215,7 +3599,12 @@ void FileOperationsHandler::handleFileMessage(FileMessageType type, const char*
       }
       case FileMessageType::COLLECT_BLOCKS_RESPONSE: {
         CollectBlocksResponse resp = CollectBlocksResponse::deserialize(buffer, buffer_size);
-        std::cout << "[RESPONSE] COLLECT_BLOCKS_RESPONSE received - " << resp.blocks.size() << " blocks" << std::endl;
+        std::lock_guard<std::mutex> lock(merge_mtx_);
+        auto it = pending_collects_.find(resp.request_id);
+        if (it != pending_collects_.end()) {
+          it->second = std::move(resp);
+          merge_cv_.notify_all();
+        }
         break;
       }
       default:
@@ -0,0 +1,95 @@
+#include "file_sequencer.hpp"
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+FileSequencer::FileSequencer(TaskExecutor& executor, size_t shard_count, size_t budget)
+    : executor_(executor), budget_(budget > 0 ? budget : 1) {
+  for (size_t i = 0; i < (shard_count > 0 ? shard_count : 1); i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+FileSequencer::Shard& FileSequencer::shardOf(FileId file_id) const {
+  return *shards_[file_id % shards_.size()];
+}
+
+void FileSequencer::post(FileId file_id, Task task) {
+  Shard& shard = shardOf(file_id);
+  {
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    Mailbox& mailbox = shard.mailboxes[file_id];
+    mailbox.tasks.push_back(std::move(task));
+    if (mailbox.scheduled) {
+      return;  // the running drain will get to it
+    }
+    mailbox.scheduled = true;
+  }
+  if (!resubmit(file_id)) {
+    drain(file_id);  // shutting down: nobody else will run these
+  }
+}
+
+uint32_t FileSequencer::nextSequence(FileId file_id) {
+  Shard& shard = shardOf(file_id);
+  std::lock_guard<std::mutex> lock(shard.mtx);
+  return shard.next_sequence[file_id]++;
+}
+
+bool FileSequencer::resubmit(FileId file_id) {
+  {
+    Shard& shard = shardOf(file_id);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.drains++;
+  }
+  return executor_.submit([this, file_id] { drain(file_id); });
+}
+
+void FileSequencer::drain(FileId file_id) {
+  Shard& shard = shardOf(file_id);
+  for (size_t run = 0;; run++) {
+    if (run == budget_) {
+      if (resubmit(file_id)) {
+        return;  // yield the worker; the mailbox stays scheduled
+      }
+      run = 0;  // shutting down: keep going here
+    }
+
+    Task task;
+    {
+      std::lock_guard<std::mutex> lock(shard.mtx);
+      Mailbox& mailbox = shard.mailboxes[file_id];  // scheduled mailboxes hold a task
+      task = std::move(mailbox.tasks.front());
+      mailbox.tasks.pop_front();
+    }
+
+    try {
+      task();
+    } catch (const std::exception& e) {
+      std::cout << "[SEQUENCER] Task for file " << file_id << " failed: " << e.what()
+                << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.tasks++;
+    auto it = shard.mailboxes.find(file_id);
+    if (it->second.tasks.empty()) {
+      shard.mailboxes.erase(it);  // idle: the next post starts a fresh mailbox
+      return;
+    }
+  }
+}
+
+FileSequencer::Stats FileSequencer::stats() const {
+  Stats stats;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mtx);
+    stats.files += shard->mailboxes.size();
+    stats.tasks += shard->tasks;
+    stats.drains += shard->drains;
+    for (const auto& [file_id, mailbox] : shard->mailboxes) {
+      stats.queued += mailbox.tasks.size();
+    }
+  }
+  return stats;
+}
@@ -1,8 +1,522 @@
 #include "file_store.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <mutex>
+#include <thread>
+
+// Append provenance to an extent, extending the previous range when the same
+// client continues its sequence right where the previous range ended
+static void appendRange(std::vector<BlockRange>& ranges, const BlockRange& range) {
+  if (!ranges.empty()) {
+    BlockRange& last = ranges.back();
+    if (last.client_id == range.client_id && last.last_sequence + 1 == range.first_sequence &&
+        last.offset + last.length == range.offset) {
+      last.last_sequence = range.last_sequence;
+      last.length += range.length;
+      last.sizes.insert(last.sizes.end(), range.sizes.begin(), range.sizes.end());
+      return;
+    }
+  }
+  ranges.push_back(range);
+}
+
+// Build one extent holding the data and provenance of a run of blocks
+static FileBlock foldBlocks(const std::vector<BlockView>& run) {
+  const BlockView& first = run.front();
+  const BlockView& last = run.back();
+
+  FileBlock extent;
+  extent.block_id = FileBlock::generateExtentId(first.block_id, last.block_id);
+  extent.client_id = *first.client_id;
+  extent.sequence_num = first.sequence_num;
+  extent.timestamp = last.timestamp;
+
+  size_t total_size = 0;
+  for (const BlockView& view : run) {
+    total_size += view.size;
+  }
+  extent.data.reserve(total_size);
+
+  for (const BlockView& view : run) {
+    uint64_t base = extent.data.size();
+    if (view.block && view.block->isExtent()) {
+      for (const auto& range : view.block->ranges) {
+        BlockRange shifted = range;
+        shifted.offset += base;
+        appendRange(extent.ranges, shifted);
+      }
+    } else {
+      appendRange(extent.ranges, {*view.client_id, view.sequence_num, view.sequence_num, base,
+                                  view.size, {static_cast<uint32_t>(view.size)}});
+    }
+    extent.data.insert(extent.data.end(), view.data, view.data + view.size);
+  }
+  extent.size = extent.data.size();
+
+  return extent;
+}
+
+/**
+ * Fixed header at the start of a store image
+ * The body is a sequence of records: [uint64 record size][metadata][uint32 block count][blocks]
+ */
+struct ImageHeader {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t reserved;
+  uint64_t file_count;
+  uint64_t body_size;
+  uint64_t checksum;  // FNV-1a over the body
+};
+
+static constexpr char IMAGE_MAGIC[8] = {'H', 'Y', 'D', 'F', 'S', 'I', 'M', 'G'};
+static constexpr uint32_t IMAGE_FORMAT_VERSION = 2;
+
+// FNV-1a, continued from a previous hash so the body can be checksummed record by record
+static uint64_t fnv1a(const char* data, size_t len, uint64_t hash = 14695981039346656037ULL) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Decode one image record into a version; nullptr if the record is malformed
+static std::shared_ptr<FileVersion> decodeRecord(const char* record, size_t record_size) {
+  auto version = std::make_shared<FileVersion>();
+  version->metadata = FileMetadata::deserialize(record, record_size);
+  size_t offset = version->metadata.serializedSize();
+
+  uint32_t block_count = 0;
+  if (offset + sizeof(block_count) > record_size) return nullptr;
+  std::memcpy(&block_count, record + offset, sizeof(block_count));
+  offset += sizeof(block_count);
+
+  for (uint32_t i = 0; i < block_count; i++) {
+    if (offset >= record_size) return nullptr;
+    FileBlock block = FileBlock::deserialize(record + offset, record_size - offset);
+    offset += block.serializedSize();
+    if (offset > record_size) return nullptr;
+    version->appendBlock(std::move(block));
+  }
+
+  return offset == record_size ? version : nullptr;
+}
+
+static uint64_t currentTimeMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::shared_ptr<const FileBlock> FileVersion::appendBlock(FileBlock block) {
+  bool small = block.size <= INLINE_MAX_BYTES && block.data.size() == block.size &&
+               !block.isExtent();
+  if (!small) {
+    auto stored = std::make_shared<const FileBlock>(std::move(block));
+    appendShared(stored);
+    return stored;
+  }
+
+  // Start a new chunk when the tail chunk can't hold the payload; chunk sizes
+  // double so small files stay small and large ones use few chunks
+  if (chunks.empty() || arena_capacity - arena_used < block.size) {
+    size_t capacity = INLINE_MAX_BYTES;
+    if (!chunks.empty()) {
+      capacity = std::min(INLINE_MAX_CHUNK_BYTES, 2 * size_t(arena_capacity));
+    }
+    chunks.push_back(std::shared_ptr<char[]>(new char[capacity]));
+    arena_capacity = static_cast<uint32_t>(capacity);
+    arena_used = 0;
+  }
+  std::memcpy(chunks.back().get() + arena_used, block.data.data(), block.size);
+
+  InlineBlock entry;
+  entry.block_id = block.block_id;
+  entry.timestamp = block.timestamp;
+  entry.sequence_num = block.sequence_num;
+  entry.client = internClient(block.client_id);
+  entry.chunk = chunks_base + static_cast<uint32_t>(chunks.size() - 1);
+  entry.offset = arena_used;
+  entry.size = block.size;
+  arena_used += block.size;
+
+  order.push_back(INLINE_SLOT | (inline_base + static_cast<uint32_t>(inline_blocks.size())));
+  inline_blocks.push_back(entry);
+  indexBlock(entry.block_id, entry.timestamp, appendsHash(block.client_id, block.sequence_num));
+  return nullptr;
+}
+
+void FileVersion::appendShared(std::shared_ptr<const FileBlock> block) {
+  indexBlock(block->block_id, block->timestamp, appendsHash(*block));
+  order.push_back(blocks_base + static_cast<uint32_t>(blocks.size()));
+  blocks.push_back(std::move(block));
+}
+
+void FileVersion::carryOver(const FileVersion& from, size_t i) {
+  uint32_t slot = from.order[i];
+  if (!(slot & INLINE_SLOT)) {
+    appendShared(from.blocks[slot - from.blocks_base]);
+    return;
+  }
+
+  InlineBlock entry = from.inline_blocks[(slot & ~INLINE_SLOT) - from.inline_base];
+  const std::shared_ptr<char[]>& chunk = from.chunks[entry.chunk - from.chunks_base];
+  if (chunks.empty() || chunks.back() != chunk) {
+    // The chunk may be shared with other versions, so it counts as full: later inline
+    // appends start a chunk of their own
+    chunks.push_back(chunk);
+    arena_capacity = from.arena_capacity;
+    arena_used = from.arena_capacity;
+  }
+  entry.chunk = chunks_base + static_cast<uint32_t>(chunks.size() - 1);
+  if (!clients) {
+    clients = from.clients;
+  }
+  if (clients != from.clients) {
+    entry.client = internClient((*from.clients)[entry.client]);
+  }
+
+  order.push_back(INLINE_SLOT | (inline_base + static_cast<uint32_t>(inline_blocks.size())));
+  inline_blocks.push_back(entry);
+  indexBlock(entry.block_id, entry.timestamp,
+             appendsHash((*clients)[entry.client], entry.sequence_num));
+}
+
+void FileVersion::dropFront(size_t count) {
+  count = std::min(count, order.size());
+
+  // Blocks and inline blocks are stored in file order, so the prefix of the
+  // file maps to a prefix of each list
+  uint32_t standalone = 0;
+  uint32_t small = 0;
+  size_t dropped_bytes = 0;
+  uint64_t dropped_hash = 0;  // list hash of the dropped prefix on its own
+  auto it = order.begin();
+  auto id_it = metadata.block_ids.begin();
+  for (size_t i = 0; i < count; i++, ++it, ++id_it) {
+    if (*it & INLINE_SLOT) {
+      const InlineBlock& entry = inline_blocks[small++];
+      dropped_bytes += entry.size;
+      content_hash -= appendsHash((*clients)[entry.client], entry.sequence_num);
+    } else {
+      const FileBlock& block = *blocks[standalone++];
+      dropped_bytes += block.size;
+      content_hash -= appendsHash(block);
+    }
+    dropped_hash = extendListHash(dropped_hash, *id_it);
+  }
+
+  // The prefix's terms carry one more factor of the base per block left behind it
+  uint64_t weight = 1;
+  uint64_t base = LIST_HASH_BASE;
+  for (size_t exp = order.size() - count; exp > 0; exp >>= 1) {
+    if (exp & 1) weight *= base;
+    base *= base;
+  }
+  list_hash -= dropped_hash * weight;
+
+  order.dropFront(count);
+  time_index.dropFront(count);
+  metadata.block_ids.dropFront(count);
+  metadata.total_size -= std::min(dropped_bytes, metadata.total_size);
+  blocks.dropFront(standalone);
+  blocks_base += standalone;
+  inline_blocks.dropFront(small);
+  inline_base += small;
+
+  // Release arena chunks before the first remaining inline block, but keep the
+  // last chunk so later appends can fill it
+  if (!chunks.empty()) {
+    uint32_t last = chunks_base + static_cast<uint32_t>(chunks.size() - 1);
+    uint32_t first = inline_blocks.empty() ? last : std::min(inline_blocks[0].chunk, last);
+    chunks.dropFront(first - chunks_base);
+    chunks_base = first;
+  }
+}
+
+uint64_t FileVersion::extendListHash(uint64_t hash, uint64_t block_id) {
+  // splitmix64 finalizer, so block IDs that differ in a few bits spread over the word
+  uint64_t mixed = block_id + 0x9e3779b97f4a7c15ULL;
+  mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111ebULL;
+  mixed ^= mixed >> 31;
+  return hash * LIST_HASH_BASE + mixed;
+}
+
+uint64_t FileVersion::appendsHash(const std::string& client_id, uint32_t sequence_num) {
+  // Mixed the same way as list hash terms, so nearby sequence numbers spread over the word
+  uint64_t client = std::hash<std::string>{}(client_id);
+  return extendListHash(0, client ^ (uint64_t(sequence_num) * 0x9e3779b97f4a7c15ULL));
+}
+
+uint64_t FileVersion::appendsHash(const FileBlock& block) {
+  if (!block.isExtent()) {
+    return appendsHash(block.client_id, block.sequence_num);
+  }
+  uint64_t hash = 0;
+  for (const auto& range : block.ranges) {
+    for (uint64_t seq = range.first_sequence; seq <= range.last_sequence; seq++) {
+      hash += appendsHash(range.client_id, static_cast<uint32_t>(seq));
+    }
+  }
+  return hash;
+}
+
+void FileVersion::indexBlock(uint64_t block_id, uint64_t timestamp, uint64_t appends_hash) {
+  time_index.push_back(time_index.empty() ? timestamp : std::max(time_index.back(), timestamp));
+  list_hash = extendListHash(list_hash, block_id);
+  content_hash += appends_hash;
+}
+
+size_t FileVersion::firstAfter(uint64_t timestamp) const {
+  // The running max never decreases, so binary search for the first value past timestamp
+  size_t low = 0;
+  size_t high = time_index.size();
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (time_index[mid] > timestamp) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return low;
+}
+
+bool FileVersion::findBlock(uint64_t block_id, size_t& position) const {
+  // Pollers ask about blocks they saw recently, which sit near the tail
+  for (size_t i = order.size(); i-- > 0;) {
+    if (blockAt(i).block_id == block_id) {
+      position = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Find a folded append by the ID and timestamp it was appended with
+static bool findFolded(const FileBlock& extent, uint64_t timestamp, uint64_t block_id,
+                       size_t& range_index, uint32_t& sequence) {
+  for (size_t r = 0; r < extent.ranges.size(); r++) {
+    const BlockRange& range = extent.ranges[r];
+    if (range.sizes.size() != range.last_sequence - range.first_sequence + 1) {
+      continue;  // no per-append sizes to cut at
+    }
+    for (uint32_t seq = range.first_sequence; seq <= range.last_sequence; seq++) {
+      if (FileBlock::generateBlockId(range.client_id, timestamp, seq) == block_id) {
+        range_index = r;
+        sequence = seq;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// The part of an extent after one of its folded appends, with the provenance of what's left
+static FileBlock extentAfter(const FileBlock& extent, size_t range_index, uint32_t sequence) {
+  const BlockRange& anchor = extent.ranges[range_index];
+  uint64_t cut = anchor.endOf(sequence);
+
+  FileBlock tail;
+  tail.block_id = extent.block_id;
+  tail.timestamp = extent.timestamp;
+  tail.data.assign(extent.data.begin() + cut, extent.data.end());
+  tail.size = tail.data.size();
+  if (sequence < anchor.last_sequence) {
+    BlockRange rest = anchor;
+    rest.first_sequence = sequence + 1;
+    rest.offset = 0;
+    rest.length = anchor.offset + anchor.length - cut;
+    rest.sizes.erase(rest.sizes.begin(), rest.sizes.begin() + (rest.first_sequence -
+                                                               anchor.first_sequence));
+    tail.ranges.push_back(std::move(rest));
+  }
+  for (size_t r = range_index + 1; r < extent.ranges.size(); r++) {
+    BlockRange shifted = extent.ranges[r];
+    shifted.offset -= cut;
+    tail.ranges.push_back(std::move(shifted));
+  }
+  if (!tail.ranges.empty()) {
+    tail.client_id = tail.ranges.front().client_id;
+    tail.sequence_num = tail.ranges.front().first_sequence;
+  }
+  return tail;
+}
+
+std::vector<FileBlock> FileVersion::blocksSince(uint64_t since_timestamp, uint64_t since_block_id,
+                                                bool& anchor_found) const {
+  std::vector<FileBlock> file_blocks;
+  size_t position = 0;
+  anchor_found = since_block_id != 0 && findBlock(since_block_id, position);
+  if (anchor_found) {
+    for (size_t i = position + 1; i < order.size(); i++) {
+      file_blocks.push_back(copyBlock(i));
+    }
+    return file_blocks;
+  }
+
+  // An anchor folded into an extent is found through the extent's provenance; it sits at
+  // or after the first block whose running max reaches the anchor's own timestamp
+  size_t first = since_timestamp > 0 ? firstAfter(since_timestamp - 1) : 0;
+  for (size_t i = first; since_block_id != 0 && i < order.size(); i++) {
+    auto extent = sharedAt(i);
+    size_t range_index = 0;
+    uint32_t sequence = 0;
+    if (!extent || !extent->isExtent() ||
+        !findFolded(*extent, since_timestamp, since_block_id, range_index, sequence)) {
+      continue;
+    }
+    anchor_found = true;
+    FileBlock tail = extentAfter(*extent, range_index, sequence);
+    if (tail.size > 0) {
+      file_blocks.push_back(std::move(tail));
+    }
+    for (size_t j = i + 1; j < order.size(); j++) {
+      file_blocks.push_back(copyBlock(j));
+    }
+    return file_blocks;
+  }
+
+  // Clocks of different clients can disagree, so later blocks may still be older
+  for (size_t i = firstAfter(since_timestamp); i < order.size(); i++) {
+    BlockView view = blockAt(i);
+    if (view.timestamp > since_timestamp) {
+      file_blocks.push_back(copyBlock(i));
+    }
+  }
+  return file_blocks;
+}
+
+std::shared_ptr<const FileBlock> FileVersion::sharedAt(size_t i) const {
+  uint32_t slot = order[i];
+  return (slot & INLINE_SLOT) ? nullptr : blocks[slot - blocks_base];
+}
+
+BlockView FileVersion::blockAt(size_t i) const {
+  uint32_t slot = order[i];
+  if (!(slot & INLINE_SLOT)) {
+    const FileBlock& block = *blocks[slot - blocks_base];
+    return {block.block_id,  &block.client_id, block.sequence_num, block.timestamp,
+            block.data.data(), block.size,     &block};
+  }
+
+  const InlineBlock& entry = inline_blocks[(slot & ~INLINE_SLOT) - inline_base];
+  return {entry.block_id,
+          &(*clients)[entry.client],
+          entry.sequence_num,
+          entry.timestamp,
+          chunks[entry.chunk - chunks_base].get() + entry.offset,
+          entry.size,
+          nullptr};
+}
+
+FileBlock FileVersion::copyBlock(size_t i) const {
+  BlockView view = blockAt(i);
+  if (view.block) {
+    return *view.block;
+  }
+
+  FileBlock block;
+  block.block_id = view.block_id;
+  block.client_id = *view.client_id;
+  block.sequence_num = view.sequence_num;
+  block.timestamp = view.timestamp;
+  block.data.assign(view.data, view.data + view.size);
+  block.size = view.size;
+  return block;
+}
+
+std::vector<char> FileVersion::assemble() const {
+  std::vector<char> file_data;
+  file_data.reserve(metadata.total_size);
+  for (size_t i = 0; i < order.size(); i++) {
+    BlockView view = blockAt(i);
+    file_data.insert(file_data.end(), view.data, view.data + view.size);
+  }
+  return file_data;
+}
+
+BlockDigest FileVersion::digestAt(size_t i) const {
+  BlockView view = blockAt(i);
+  BlockDigest digest;
+  digest.block_id = view.block_id;
+  digest.client_id = *view.client_id;
+  digest.sequence_num = view.sequence_num;
+  digest.timestamp = view.timestamp;
+  digest.size = static_cast<uint32_t>(view.size);
+  if (view.block) {
+    digest.ranges = view.block->ranges;
+  }
+  return digest;
+}
+
+uint64_t FileVersion::digest() const {
+  uint64_t hash = LIST_HASH_SEED;
+  for (uint64_t value : {metadata.file_id, content_hash}) {
+    hash = (hash ^ value) * 1099511628211ULL;
+  }
+  return hash != 0 ? hash : 1;  // 0 means "no file" to anti-entropy
+}
+
+std::vector<FileBlock> FileVersion::copyBlocks() const {
+  std::vector<FileBlock> file_blocks;
+  file_blocks.reserve(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    file_blocks.push_back(copyBlock(i));
+  }
+  return file_blocks;
+}
+
+std::vector<BlockRange> FileVersion::compactedRanges() const {
+  std::vector<BlockRange> ranges;
+  for (const auto& block : blocks) {
+    if (block->isExtent()) {
+      ranges.insert(ranges.end(), block->ranges.begin(), block->ranges.end());
+    }
+  }
+  return ranges;
+}
+
+FileStat FileVersion::stat() const {
+  FileStat stat;
+  stat.file_id = metadata.file_id;
+  stat.total_size = metadata.total_size;
+  stat.version = metadata.version;
+  stat.block_count = order.size();
+  stat.created_timestamp = metadata.created_timestamp;
+  stat.last_modified_timestamp = metadata.last_modified_timestamp;
+  return stat;
+}
+
+uint32_t FileVersion::internClient(const std::string& client_id) {
+  if (clients) {
+    auto it = std::find(clients->begin(), clients->end(), client_id);
+    if (it != clients->end()) {
+      return static_cast<uint32_t>(it - clients->begin());
+    }
+  }
+
+  // Copy-on-write: older versions keep sharing the previous list
+  auto grown = clients ? std::make_shared<std::vector<std::string>>(*clients)
+                       : std::make_shared<std::vector<std::string>>();
+  grown->push_back(client_id);
+  clients = std::move(grown);
+  return static_cast<uint32_t>(clients->size() - 1);
+}
 
 FileStore::FileStore(const std::string& storage_dir) : storage_dir(storage_dir) {
   // In-memory only storage - no disk persistence
@@ -10,28 +524,29 @@ FileStore::FileStore(const std::string& storage_dir) : storage_dir(storage_dir)
 }
 
 bool FileStore::createFile(const std::string& filename, const std::vector<char>& data,
-                           const std::string& client_id) {
-  std::unique_lock<std::shared_mutex> lock(mtx);
+                           const std::string& client_id, uint64_t timestamp) {
+  FileId file_id = file_names.intern(filename);
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
 
   std::cout << "[FILE_STORE] createFile called: " << filename << " (" << data.size() << " bytes)" << std::endl;
 
   // Check if file already exists
-  if (files.find(filename) != files.end()) {
+  if (pinFile(file_id)) {
     std::cout << "[FILE_STORE] File already exists: " << filename << std::endl;
     return false;  // File already exists
   }
 
-  // Create metadata
-  FileMetadata metadata;
+  // Build the first version
+  auto next = std::make_shared<FileVersion>();
+  FileMetadata& metadata = next->metadata;
   metadata.hydfs_filename = filename;
   metadata.file_id = FileMetadata::generateFileId(filename);
   metadata.total_size = data.size();
   metadata.version = 1;
 
-  auto now = std::chrono::system_clock::now();
-  auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                       now.time_since_epoch())
-                       .count();
+  if (timestamp == 0) {
+    timestamp = currentTimeMs();
+  }
   metadata.created_timestamp = timestamp;
   metadata.last_modified_timestamp = timestamp;
 
@@ -46,98 +561,225 @@ bool FileStore::createFile(const std::string& filename, const std::vector<char>&
     block.block_id = FileBlock::generateBlockId(client_id, timestamp, 0);
 
     metadata.block_ids.push_back(block.block_id);
-    blocks[block.block_id] = block;
+    next->appendBlock(std::move(block));
   }
 
-  files[filename] = metadata;
+  {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    for (const auto& block : next->blocks) {
+      blocks[block->block_id] = block;
+    }
+    publishVersion(files[file_id], std::move(next));
+  }
 
   std::cout << "[FILE_STORE] File created successfully in memory: " << filename << std::endl;
   return true;
 }
 
 bool FileStore::appendBlock(const std::string& filename, const FileBlock& block) {
-  std::unique_lock<std::shared_mutex> lock(mtx);
+  FileId file_id = 0;
+  if (!file_names.find(filename, file_id)) {
+    std::cout << "[FILE_STORE] File not found for append: " << filename << std::endl;
+    return false;
+  }
+  return appendBlock(file_id, block);
+}
 
-  std::cout << "[FILE_STORE] appendBlock called: " << filename << " (block " << block.block_id << ")" << std::endl;
+bool FileStore::appendBlock(FileId file_id, const FileBlock& block) {
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
 
   // Check if file exists
-  auto it = files.find(filename);
-  if (it == files.end()) {
-    std::cout << "[FILE_STORE] File not found for append: " << filename << std::endl;
+  FileSnapshot current = pinFile(file_id);
+  if (!current) {
+    std::cout << "[FILE_STORE] File not found for append: " << file_id << std::endl;
     return false;  // File doesn't exist
   }
 
-  // Add block
-  blocks[block.block_id] = block;
-  it->second.block_ids.push_back(block.block_id);
-  it->second.total_size += block.size;
+  const std::string& filename = current->metadata.hydfs_filename;
+  std::cout << "[FILE_STORE] appendBlock called: " << filename << " (block " << block.block_id << ")" << std::endl;
 
-  auto now = std::chrono::system_clock::now();
-  it->second.last_modified_timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                           now.time_since_epoch())
-                                           .count();
-  it->second.version++;
+  // Copy-on-write: build the next version outside the store lock
+  auto next = std::make_shared<FileVersion>(*current);
+  std::shared_ptr<const FileBlock> stored = next->appendBlock(block);
+  next->metadata.block_ids.push_back(block.block_id);
+  next->metadata.total_size += block.size;
+  next->metadata.last_modified_timestamp = currentTimeMs();
+  next->metadata.version++;
+
+  {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    if (stored) {
+      blocks[block.block_id] = std::move(stored);  // inline blocks stay out of the index
+    }
+    publishVersion(files[file_id], std::move(next));
+  }
 
   std::cout << "[FILE_STORE] Block appended successfully: " << filename << std::endl;
   return true;
 }
 
-std::vector<char> FileStore::getFile(const std::string& filename) const {
-  std::shared_lock<std::shared_mutex> lock(mtx);
+bool FileStore::appendBlocks(FileId file_id, const std::vector<FileBlock>& group) {
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
 
-  auto it = files.find(filename);
-  if (it == files.end()) {
-    return {};  // File doesn't exist
+  FileSnapshot current = pinFile(file_id);
+  if (!current) {
+    std::cout << "[FILE_STORE] File not found for append: " << file_id << std::endl;
+    return false;
   }
 
-  // Assemble file from blocks
-  std::vector<char> file_data;
-  file_data.reserve(it->second.total_size);
+  // One copy-on-write version for the whole group
+  auto next = std::make_shared<FileVersion>(*current);
+  std::vector<std::shared_ptr<const FileBlock>> stored;
+  for (const auto& block : group) {
+    if (auto standalone = next->appendBlock(block)) {
+      stored.push_back(std::move(standalone));
+    }
+    next->metadata.block_ids.push_back(block.block_id);
+    next->metadata.total_size += block.size;
+  }
+  next->metadata.last_modified_timestamp = currentTimeMs();
+  next->metadata.version++;
 
-  for (uint64_t block_id : it->second.block_ids) {
-    auto block_it = blocks.find(block_id);
-    if (block_it != blocks.end()) {
-      file_data.insert(file_data.end(), block_it->second.data.begin(),
-                      block_it->second.data.end());
+  {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    for (auto& block : stored) {
+      uint64_t block_id = block->block_id;
+      blocks[block_id] = std::move(block);
     }
+    publishVersion(files[file_id], std::move(next));
   }
 
-  return file_data;
+  std::cout << "[FILE_STORE] " << group.size() << " blocks appended to "
+            << current->metadata.hydfs_filename << std::endl;
+  return true;
+}
+
+std::vector<char> FileStore::getFile(const std::string& filename) const {
+  FileSnapshot snapshot = pinFile(filename);
+  if (!snapshot) {
+    return {};  // File doesn't exist
+  }
+
+  // Assemble file from blocks without holding the lock
+  return snapshot->assemble();
 }
 
 std::vector<FileBlock> FileStore::getFileBlocks(const std::string& filename) const {
-  std::shared_lock<std::shared_mutex> lock(mtx);
+  FileSnapshot snapshot = pinFile(filename);
+  if (!snapshot) {
+    return {};
+  }
 
-  auto it = files.find(filename);
-  if (it == files.end()) {
+  return snapshot->copyBlocks();
+}
+
+FileMetadata FileStore::getFileMetadata(const std::string& filename) const {
+  FileSnapshot snapshot = pinFile(filename);
+  if (!snapshot) {
     return {};
   }
 
-  std::vector<FileBlock> file_blocks;
-  for (uint64_t block_id : it->second.block_ids) {
-    auto block_it = blocks.find(block_id);
-    if (block_it != blocks.end()) {
-      file_blocks.push_back(block_it->second);
-    }
+  return snapshot->metadata;
+}
+
+FileSnapshot FileStore::pinFile(const std::string& filename) const {
+  FileId file_id = 0;
+  return file_names.find(filename, file_id) ? pinFile(file_id) : nullptr;
+}
+
+FileSnapshot FileStore::pinFile(FileId file_id) const {
+  std::shared_lock<std::shared_mutex> lock(mtx);
+
+  auto it = files.find(file_id);
+  if (it == files.end()) {
+    return nullptr;
   }
 
-  return file_blocks;
+  return it->second.current;
 }
 
-FileMetadata FileStore::getFileMetadata(const std::string& filename) const {
+bool FileStore::statFile(const std::string& filename, FileStat& stat) const {
+  FileId file_id = 0;
+  return file_names.find(filename, file_id) && statFile(file_id, stat);
+}
+
+bool FileStore::statFile(FileId file_id, FileStat& stat) const {
   std::shared_lock<std::shared_mutex> lock(mtx);
 
-  auto it = files.find(filename);
+  auto it = files.find(file_id);
   if (it == files.end()) {
-    return {};
+    return false;
+  }
+
+  stat = it->second.current->stat();
+  return true;
+}
+
+std::vector<std::pair<std::string, FileStat>> FileStore::listFileStats() const {
+  std::shared_lock<std::shared_mutex> lock(mtx);
+
+  std::vector<std::pair<std::string, FileStat>> stats;
+  stats.reserve(files.size());
+  for (const auto& entry : files) {
+    stats.emplace_back(entry.second.current->metadata.hydfs_filename, entry.second.current->stat());
   }
 
-  return it->second;
+  return stats;
+}
+
+bool FileStore::getFileAtVersion(const std::string& filename, uint32_t version,
+                                 std::vector<char>& data) const {
+  FileId file_id = 0;
+  if (!file_names.find(filename, file_id)) {
+    return false;
+  }
+
+  FileSnapshot snapshot;
+  {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+
+    auto it = files.find(file_id);
+    if (it == files.end()) {
+      return false;
+    }
+
+    const FileEntry& entry = it->second;
+    if (entry.current->metadata.version == version) {
+      snapshot = entry.current;
+    } else {
+      auto retired_it = entry.retired.find(version);
+      if (retired_it != entry.retired.end()) {
+        snapshot = retired_it->second.lock();
+      }
+    }
+  }
+
+  if (!snapshot) {
+    return false;  // Never existed, or already garbage-collected
+  }
+
+  data = snapshot->assemble();
+  return true;
+}
+
+size_t FileStore::collectGarbage() {
+  std::unique_lock<std::shared_mutex> lock(mtx);
+
+  size_t dropped = 0;
+  for (auto& entry : files) {
+    dropped += pruneRetired(entry.second);
+  }
+
+  return dropped;
 }
 
 bool FileStore::hasFile(const std::string& filename) const {
+  FileId file_id = 0;
+  if (!file_names.find(filename, file_id)) {
+    return false;
+  }
   std::shared_lock<std::shared_mutex> lock(mtx);
-  return files.find(filename) != files.end();
+  return files.find(file_id) != files.end();
 }
 
 std::vector<std::string> FileStore::listFiles() const {
@@ -145,86 +787,783 @@ std::vector<std::string> FileStore::listFiles() const {
 
   std::vector<std::string> file_list;
   for (const auto& entry : files) {
-    file_list.push_back(entry.first);
+    file_list.push_back(entry.second.current->metadata.hydfs_filename);
   }
 
   return file_list;
 }
 
 bool FileStore::mergeFile(const std::string& filename, std::vector<FileBlock>& all_blocks) {
-  std::unique_lock<std::shared_mutex> lock(mtx);
+  FileId file_id = 0;
+  if (!file_names.find(filename, file_id)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
 
-  auto it = files.find(filename);
-  if (it == files.end()) {
+  FileSnapshot current = pinFile(file_id);
+  if (!current) {
     return false;
   }
 
-  // Clear existing blocks for this file
-  for (uint64_t block_id : it->second.block_ids) {
-    blocks.erase(block_id);
+  // Build the merged version outside the store lock; readers keep seeing the
+  // current version until it is published. Blocks we already hold are carried over
+  FlatHashMap<uint64_t, size_t> position;  // block_id -> index in the current version
+  for (size_t i = 0; i < current->blockCount(); i++) {
+    position[current->blockAt(i).block_id] = i;
   }
-  it->second.block_ids.clear();
+  auto next = std::make_shared<FileVersion>();
+  next->metadata = current->metadata;
+  next->metadata.block_ids.clear();
+  next->clients = current->clients;
+  next->truncated_through = current->truncated_through;
 
-  // Add merged blocks
+  std::vector<bool> carried(current->blockCount(), false);
+  SharedBlocks removed;
+  SharedBlocks added;
   size_t total_size = 0;
-  for (const auto& block : all_blocks) {
-    blocks[block.block_id] = block;
-    it->second.block_ids.push_back(block.block_id);
+  for (auto& block : all_blocks) {
+    next->metadata.block_ids.push_back(block.block_id);
     total_size += block.size;
+    auto pos_it = position.find(block.block_id);
+    if (pos_it != position.end() && current->blockAt(pos_it->second).size == block.size) {
+      next->carryOver(*current, pos_it->second);
+      carried[pos_it->second] = true;
+    } else if (auto stored = next->appendBlock(std::move(block))) {
+      added.push_back(std::move(stored));
+    }
+  }
+  for (size_t i = 0; i < carried.size(); i++) {
+    auto shared = carried[i] ? nullptr : current->sharedAt(i);
+    if (shared) removed.push_back(std::move(shared));
+  }
+
+  next->metadata.total_size = total_size;
+  next->metadata.version++;
+  next->metadata.last_modified_timestamp = currentTimeMs();
+
+  {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    reindexBlocks(removed, added);
+    publishVersion(files[file_id], std::move(next));
+  }
+
+  return true;
+}
+
+// True if every append carried by a block is inside one of the ranges
+static bool coveredBy(const std::vector<BlockRange>& ranges, const BlockView& view) {
+  auto inside = [&](const std::string& client, uint32_t first, uint32_t last) {
+    return std::any_of(ranges.begin(), ranges.end(), [&](const BlockRange& range) {
+      return range.client_id == client && range.first_sequence <= first &&
+             range.last_sequence >= last;
+    });
+  };
+  if (!view.block || !view.block->isExtent()) {
+    return inside(*view.client_id, view.sequence_num, view.sequence_num);
+  }
+  return std::all_of(view.block->ranges.begin(), view.block->ranges.end(),
+                     [&](const BlockRange& range) {
+                       return inside(range.client_id, range.first_sequence, range.last_sequence);
+                     });
+}
+
+bool FileStore::applyMerge(const std::string& filename, const std::vector<uint64_t>& block_ids,
+                           const std::vector<FileBlock>& incoming, uint32_t version) {
+  FileId file_id = file_names.intern(filename);
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
+
+  FileSnapshot current = pinFile(file_id);
+  uint64_t now = currentTimeMs();
+
+  FlatHashMap<uint64_t, const FileBlock*> arriving;
+  for (const auto& block : incoming) {
+    arriving[block.block_id] = &block;
+  }
+  FlatHashMap<uint64_t, size_t> position;  // block_id -> index in the current version
+  size_t current_count = current ? current->blockCount() : 0;
+  for (size_t i = 0; i < current_count; i++) {
+    position[current->blockAt(i).block_id] = i;
+  }
+
+  // Build the merged version outside the store lock
+  auto next = std::make_shared<FileVersion>();
+  if (current) {
+    next->metadata = current->metadata;
+    next->metadata.block_ids.clear();
+    next->clients = current->clients;
+    next->truncated_through = current->truncated_through;
+  } else {
+    next->metadata.hydfs_filename = filename;
+    next->metadata.file_id = FileMetadata::generateFileId(filename);
+    next->metadata.created_timestamp = now;
+  }
+
+  // Blocks we hold are carried over; only arriving blocks are stored anew
+  std::vector<bool> carried(current_count, false);
+  SharedBlocks added;
+  auto keep = [&](size_t i) {
+    next->carryOver(*current, i);
+    carried[i] = true;
+  };
+
+  FlatHashMap<uint64_t, bool> placed;
+  for (uint64_t block_id : block_ids) {
+    if (!placed.emplace(block_id, true).second) {
+      continue;
+    }
+    // A peer that missed our truncation may still list expired blocks; leave them out
+    auto in_it = arriving.find(block_id);
+    if (in_it != arriving.end()) {
+      if (next->truncatedAway(in_it->second->timestamp)) {
+        continue;
+      }
+      if (auto stored = next->appendBlock(*in_it->second)) {
+        added.push_back(std::move(stored));
+      }
+      continue;
+    }
+    auto pos_it = position.find(block_id);
+    if (pos_it == position.end()) {
+      std::cout << "[FILE_STORE] Merge of " << filename << " is missing block " << block_id
+                << std::endl;
+      return false;
+    }
+    if (!next->truncatedAway(current->blockAt(pos_it->second).timestamp)) {
+      keep(pos_it->second);
+    }
+  }
+
+  // Keep appends that raced with the merge; the next merge will place them
+  std::vector<BlockRange> merged_ranges = next->compactedRanges();
+  for (size_t i = 0; i < current_count; i++) {
+    BlockView view = current->blockAt(i);
+    if (!placed.contains(view.block_id) && !coveredBy(merged_ranges, view) &&
+        !next->truncatedAway(view.timestamp)) {
+      keep(i);
+    }
   }
 
-  it->second.total_size = total_size;
-  it->second.version++;
+  size_t total_size = 0;
+  for (size_t i = 0; i < next->blockCount(); i++) {
+    BlockView view = next->blockAt(i);
+    next->metadata.block_ids.push_back(view.block_id);
+    total_size += view.size;
+  }
+  next->metadata.total_size = total_size;
+  next->metadata.version = version;
+  next->metadata.last_modified_timestamp = now;
 
-  auto now = std::chrono::system_clock::now();
-  it->second.last_modified_timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                           now.time_since_epoch())
-                                           .count();
+  SharedBlocks removed;
+  for (size_t i = 0; i < current_count; i++) {
+    auto shared = carried[i] ? nullptr : current->sharedAt(i);
+    if (shared) removed.push_back(std::move(shared));
+  }
+
+  {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    reindexBlocks(removed, added);
+    publishVersion(files[file_id], std::move(next));
+  }
 
+  std::cout << "[FILE_STORE] Applied merge of " << filename << " (version " << version << ")"
+            << std::endl;
   return true;
 }
 
 bool FileStore::deleteFile(const std::string& filename) {
+  FileId file_id = 0;
+  if (!file_names.find(filename, file_id)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
   std::unique_lock<std::shared_mutex> lock(mtx);
 
-  auto it = files.find(filename);
+  auto it = files.find(file_id);
   if (it == files.end()) {
     return false;
   }
 
-  // Delete all blocks from memory
-  for (uint64_t block_id : it->second.block_ids) {
-    blocks.erase(block_id);
+  // Drop the blocks from the index; readers that pinned a version keep theirs alive
+  for (const auto& block : it->second.current->blocks) {
+    blocks.erase(block->block_id);
   }
 
   // Delete metadata from memory
   files.erase(it);
+  if (on_change) {
+    on_change(filename, nullptr);
+  }
 
   return true;
 }
 
 void FileStore::clearAllFiles() {
+  auto write_locks = lockAllWriters();
   std::unique_lock<std::shared_mutex> lock(mtx);
 
   // Clear all in-memory structures
+  if (on_change) {
+    for (const auto& [file_id, entry] : files) {
+      on_change(entry.current->metadata.hydfs_filename, nullptr);
+    }
+  }
   files.clear();
   blocks.clear();
 }
 
 bool FileStore::storeFile(const FileMetadata& metadata, const std::vector<FileBlock>& file_blocks) {
+  FileId file_id = file_names.intern(metadata.hydfs_filename);
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
+
+  FlatHashMap<uint64_t, const FileBlock*> incoming;
+  for (const auto& block : file_blocks) {
+    incoming[block.block_id] = &block;
+  }
+  FileSnapshot current = pinFile(file_id);
+  FlatHashMap<uint64_t, size_t> position;  // block_id -> index in the current version
+  size_t current_count = current ? current->blockCount() : 0;
+  for (size_t i = 0; i < current_count; i++) {
+    position[current->blockAt(i).block_id] = i;
+  }
+
+  // Build the version in metadata order outside the store lock. Blocks we already hold
+  // are carried over from the current version, inline ones included
+  auto next = std::make_shared<FileVersion>();
+  next->metadata = metadata;
+  next->metadata.file_id = FileMetadata::generateFileId(metadata.hydfs_filename);
+  if (current) {
+    next->clients = current->clients;
+    next->truncated_through = current->truncated_through;
+  }
+  std::vector<bool> carried(current_count, false);
+  SharedBlocks added;
+  for (uint64_t block_id : metadata.block_ids) {
+    auto in_it = incoming.find(block_id);
+    if (in_it != incoming.end()) {
+      if (auto stored = next->appendBlock(*in_it->second)) {
+        added.push_back(std::move(stored));
+      }
+      continue;
+    }
+    auto pos_it = position.find(block_id);
+    if (pos_it == position.end()) {
+      std::cout << "[FILE_STORE] Store of " << metadata.hydfs_filename << " is missing block "
+                << block_id << std::endl;
+      return false;
+    }
+    next->carryOver(*current, pos_it->second);
+    carried[pos_it->second] = true;
+  }
+
+  SharedBlocks removed;
+  for (size_t i = 0; i < current_count; i++) {
+    auto shared = carried[i] ? nullptr : current->sharedAt(i);
+    if (shared) removed.push_back(std::move(shared));
+  }
+
+  {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    reindexBlocks(removed, added);
+    publishVersion(files[file_id], std::move(next));
+  }
+
+  return true;
+}
+
+size_t FileStore::compactFile(const std::string& filename, const CompactionPolicy& policy) {
+  FileId file_id = 0;
+  if (!file_names.find(filename, file_id)) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
+
+  FileSnapshot current = pinFile(file_id);
+  if (!current) {
+    return 0;
+  }
+
+  uint64_t now = currentTimeMs();
+  size_t min_run = std::max<size_t>(policy.min_run_blocks, 2);
+
+  // Only folded runs are rewritten; every other block is carried over by reference.
+  // Arena chunks that held nothing but folded blocks go once the current version retires
+  auto next = std::make_shared<FileVersion>();
+  next->metadata = current->metadata;
+  next->metadata.block_ids.clear();
+  next->clients = current->clients;
+  next->truncated_through = current->truncated_through;
+  std::vector<BlockView> run;
+  size_t run_start = 0;
+  size_t run_bytes = 0;
+  size_t folded = 0;
+  size_t extents_built = 0;
+  SharedBlocks removed;  // standalone blocks folded away
+  SharedBlocks added;    // the extents
+
+  // Carry one block over unchanged
+  auto keep = [&](size_t i) { next->carryOver(*current, i); };
+
+  // Emit the current run, folding it into one extent if it is long enough
+  auto flush_run = [&]() {
+    if (run.size() >= min_run) {
+      auto extent = std::make_shared<const FileBlock>(foldBlocks(run));
+      for (size_t i = 0; i < run.size(); i++) {
+        if (auto shared = current->sharedAt(run_start + i)) removed.push_back(std::move(shared));
+      }
+      added.push_back(extent);
+      next->appendShared(std::move(extent));
+      folded += run.size() - 1;
+      extents_built++;
+    } else {
+      for (size_t i = 0; i < run.size(); i++) {
+        keep(run_start + i);
+      }
+    }
+    run.clear();
+    run_bytes = 0;
+  };
+
+  for (size_t i = 0; i < current->blockCount(); i++) {
+    BlockView view = current->blockAt(i);
+    bool is_extent = view.block && view.block->isExtent();
+    size_t size_limit = is_extent ? policy.max_extent_bytes : policy.small_block_bytes;
+    bool stable = view.timestamp + policy.min_age_ms <= now;
+    bool candidate = stable && view.size < size_limit;
+
+    if (!candidate || run_bytes + view.size > policy.max_extent_bytes) {
+      flush_run();
+    }
+
+    if (candidate) {
+      if (run.empty()) {
+        run_start = i;
+      }
+      run.push_back(view);
+      run_bytes += view.size;
+    } else {
+      keep(i);
+    }
+  }
+  flush_run();
+
+  if (folded == 0) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < next->blockCount(); i++) {
+    next->metadata.block_ids.push_back(next->blockAt(i).block_id);
+  }
+
+  // Compaction doesn't change contents, so the version number stays the same
+  {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    reindexBlocks(removed, added);
+    publishVersion(files[file_id], std::move(next));
+  }
+
+  std::cout << "[FILE_STORE] Compacted " << filename << ": folded " << folded
+            << " blocks into " << extents_built << " extent(s)" << std::endl;
+  return folded;
+}
+
+void FileStore::setRetentionPolicy(const std::string& prefix, const RetentionPolicy& policy) {
   std::unique_lock<std::shared_mutex> lock(mtx);
+  if (policy.unlimited()) {
+    retention_rules.erase(prefix);
+  } else {
+    retention_rules[prefix] = policy;
+  }
+}
 
-  // Store metadata in memory
-  files[metadata.hydfs_filename] = metadata;
+RetentionPolicy FileStore::getRetentionPolicy(const std::string& filename) const {
+  std::shared_lock<std::shared_mutex> lock(mtx);
 
-  // Store blocks in memory
-  for (const auto& block : file_blocks) {
-    blocks[block.block_id] = block;
+  const RetentionPolicy* match = nullptr;
+  size_t match_length = 0;
+  for (const auto& [prefix, policy] : retention_rules) {
+    bool longer = !match || prefix.size() > match_length;
+    if (longer && filename.compare(0, prefix.size(), prefix) == 0) {
+      match = &policy;
+      match_length = prefix.size();
+    }
+  }
+  return match ? *match : RetentionPolicy{};
+}
+
+std::map<std::string, RetentionPolicy> FileStore::listRetentionPolicies() const {
+  std::shared_lock<std::shared_mutex> lock(mtx);
+  return retention_rules;
+}
+
+size_t FileStore::applyRetention(const std::string& filename, uint64_t now_ms,
+                                 uint64_t& cut_timestamp) {
+  RetentionPolicy policy = getRetentionPolicy(filename);
+  if (policy.unlimited()) {
+    return 0;
+  }
+
+  FileId file_id = 0;
+  if (!file_names.find(filename, file_id)) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
+  FileSnapshot current = pinFile(file_id);
+  if (!current) {
+    return 0;
+  }
+
+  size_t block_count = current->blockCount();
+  size_t count = 0;
+  if (policy.max_blocks > 0 && block_count > policy.max_blocks) {
+    count = block_count - policy.max_blocks;
+  }
+  if (policy.max_age_ms > 0 && now_ms > policy.max_age_ms) {
+    // Every block before this position is at least max_age_ms old
+    count = std::max(count, current->firstAfter(now_ms - policy.max_age_ms));
+  }
+  if (policy.max_bytes > 0) {
+    size_t remaining = current->metadata.total_size;
+    size_t i = 0;
+    for (; i < block_count && remaining > policy.max_bytes; i++) {
+      remaining -= std::min(current->blockAt(i).size, remaining);
+    }
+    count = std::max(count, i);
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+  // Cut by timestamp rather than position so replicas that compacted differently find
+  // the same cut; blocks stamped alongside the last expired one go with it
+  cut_timestamp = current->time_index[count - 1];
+  return dropPrefix(current, current->firstAfter(cut_timestamp), cut_timestamp);
+}
+
+size_t FileStore::truncateThrough(const std::string& filename, uint64_t timestamp) {
+  FileId file_id = 0;
+  if (!file_names.find(filename, file_id)) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> write_lock(writerOf(file_id));
+
+  FileSnapshot current = pinFile(file_id);
+  if (!current || timestamp <= current->truncated_through) {
+    return 0;  // already cut there
+  }
+  return dropPrefix(current, current->firstAfter(timestamp), timestamp);
+}
+
+size_t FileStore::dropPrefix(const FileSnapshot& current, size_t count, uint64_t timestamp) {
+  std::vector<uint64_t> dropped_ids;  // standalone blocks leaving the index
+  for (size_t i = 0; i < count; i++) {
+    if (auto shared = current->sharedAt(i)) {
+      dropped_ids.push_back(shared->block_id);
+    }
+  }
+
+  // Dropping a prefix shares every remaining chunk with the current version
+  auto next = std::make_shared<FileVersion>(*current);
+  next->truncated_through = std::max(next->truncated_through, timestamp);
+  if (count > 0) {
+    next->dropFront(count);
+    next->metadata.version++;
+    next->metadata.last_modified_timestamp = currentTimeMs();
+  }
+  const std::string& filename = current->metadata.hydfs_filename;
+
+  {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    for (uint64_t block_id : dropped_ids) {
+      blocks.erase(block_id);
+    }
+    publishVersion(files[file_names.intern(filename)], std::move(next));
+  }
+
+  if (count > 0) {
+    std::cout << "[FILE_STORE] Dropped " << count << " expired block(s) from " << filename
+              << std::endl;
+  }
+  return count;
+}
+
+std::vector<BlockRange> FileStore::getCompactedRanges(const std::string& filename) const {
+  FileSnapshot snapshot = pinFile(filename);
+  if (!snapshot) {
+    return {};
+  }
+
+  return snapshot->compactedRanges();
+}
+
+bool FileStore::saveImage(const std::string& path) const {
+  // Pin every file under one lock so the image is a single point in time
+  std::vector<FileSnapshot> snapshots;
+  {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    snapshots.reserve(files.size());
+    for (const auto& entry : files) {
+      snapshots.push_back(entry.second.current);
+    }
+  }
+
+  std::filesystem::path image_path(path);
+  if (image_path.has_parent_path()) {
+    std::error_code ec;
+    std::filesystem::create_directories(image_path.parent_path(), ec);
+  }
+
+  // Write to a temporary file and rename, so a crash never leaves a torn image
+  std::string tmp_path = path + ".tmp";
+  std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cout << "[FILE_STORE] Cannot open image for writing: " << tmp_path << std::endl;
+    return false;
+  }
+
+  ImageHeader header{};
+  std::memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+  header.format_version = IMAGE_FORMAT_VERSION;
+  header.file_count = snapshots.size();
+  header.checksum = fnv1a(nullptr, 0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  std::vector<char> record;
+  for (const auto& snapshot : snapshots) {
+    // Inline blocks are written in the regular block format
+    FileBlock scratch;
+    auto block_at = [&](size_t i) -> const FileBlock& {
+      BlockView view = snapshot->blockAt(i);
+      if (view.block) return *view.block;
+      scratch = snapshot->copyBlock(i);
+      return scratch;
+    };
+
+    size_t record_size = snapshot->metadata.serializedSize() + sizeof(uint32_t);
+    for (size_t i = 0; i < snapshot->blockCount(); i++) {
+      record_size += block_at(i).serializedSize();
+    }
+
+    record.resize(sizeof(uint64_t) + record_size);
+    uint64_t size_field = record_size;
+    std::memcpy(record.data(), &size_field, sizeof(size_field));
+    size_t offset = sizeof(size_field);
+
+    offset += snapshot->metadata.serialize(record.data() + offset, record.size() - offset);
+    uint32_t block_count = snapshot->blockCount();
+    std::memcpy(record.data() + offset, &block_count, sizeof(block_count));
+    offset += sizeof(block_count);
+    for (size_t i = 0; i < snapshot->blockCount(); i++) {
+      offset += block_at(i).serialize(record.data() + offset, record.size() - offset);
+    }
+
+    header.checksum = fnv1a(record.data(), record.size(), header.checksum);
+    header.body_size += record.size();
+    out.write(record.data(), record.size());
+  }
+
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.close();
+  if (!out) {
+    std::cout << "[FILE_STORE] Failed to write image: " << tmp_path << std::endl;
+    return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    std::cout << "[FILE_STORE] Failed to install image " << path << ": " << ec.message()
+              << std::endl;
+    return false;
+  }
+
+  std::cout << "[FILE_STORE] Saved image " << path << " (" << snapshots.size() << " files, "
+            << header.body_size << " bytes)" << std::endl;
+  return true;
+}
+
+bool FileStore::loadImage(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ImageHeader)) {
+    close(fd);
+    std::cout << "[FILE_STORE] Image too small: " << path << std::endl;
+    return false;
   }
 
+  size_t image_size = st.st_size;
+  void* mapping = mmap(nullptr, image_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cout << "[FILE_STORE] Cannot map image: " << path << std::endl;
+    return false;
+  }
+  madvise(mapping, image_size, MADV_SEQUENTIAL);
+
+  const char* image = static_cast<const char*>(mapping);
+  ImageHeader header;
+  std::memcpy(&header, image, sizeof(header));
+  const char* body = image + sizeof(header);
+
+  // Validate before touching the store
+  bool valid = std::memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0 &&
+               header.format_version == IMAGE_FORMAT_VERSION &&
+               header.body_size == image_size - sizeof(header) &&
+               fnv1a(body, header.body_size) == header.checksum;
+
+  // Find record boundaries with one sequential scan
+  std::vector<std::pair<size_t, size_t>> records;  // (offset, size) within body
+  if (valid) {
+    records.reserve(header.file_count);
+    size_t offset = 0;
+    while (offset < header.body_size) {
+      uint64_t record_size = 0;
+      if (offset + sizeof(record_size) > header.body_size) break;
+      std::memcpy(&record_size, body + offset, sizeof(record_size));
+      offset += sizeof(record_size);
+      if (record_size > header.body_size - offset) break;
+      records.emplace_back(offset, record_size);
+      offset += record_size;
+    }
+    valid = offset == header.body_size && records.size() == header.file_count;
+  }
+
+  if (!valid) {
+    munmap(mapping, image_size);
+    std::cout << "[FILE_STORE] Rejected corrupt image: " << path << std::endl;
+    return false;
+  }
+
+  // Decode records in parallel, each worker filling its own slice
+  std::vector<std::shared_ptr<FileVersion>> decoded(records.size());
+  std::atomic<bool> decode_ok{true};
+  size_t workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+  workers = std::min(workers, std::max<size_t>(1, records.size() / 64));
+  size_t per_worker = (records.size() + workers - 1) / workers;
+
+  std::vector<std::thread> threads;
+  for (size_t w = 0; w < workers; w++) {
+    threads.emplace_back([&, w]() {
+      size_t end = std::min(records.size(), (w + 1) * per_worker);
+      for (size_t i = w * per_worker; i < end && decode_ok; i++) {
+        decoded[i] = decodeRecord(body + records[i].first, records[i].second);
+        if (!decoded[i]) {
+          decode_ok = false;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  munmap(mapping, image_size);
+
+  if (!decode_ok) {
+    std::cout << "[FILE_STORE] Rejected image with malformed records: " << path << std::endl;
+    return false;
+  }
+
+  size_t block_count = 0;
+  size_t indexed_blocks = 0;
+  for (const auto& version : decoded) {
+    block_count += version->blockCount();
+    indexed_blocks += version->blocks.size();
+  }
+
+  auto write_locks = lockAllWriters();
+  std::unique_lock<std::shared_mutex> lock(mtx);
+
+  if (on_change) {
+    for (const auto& [file_id, entry] : files) {
+      on_change(entry.current->metadata.hydfs_filename, nullptr);
+    }
+  }
+  files.clear();
+  blocks.clear();
+  files.reserve(decoded.size());
+  blocks.reserve(indexed_blocks);
+  for (auto& version : decoded) {
+    for (const auto& block : version->blocks) {
+      blocks[block->block_id] = block;
+    }
+    FileSnapshot& current = files[file_names.intern(version->metadata.hydfs_filename)].current;
+    current = std::move(version);
+    if (on_change) {
+      on_change(current->metadata.hydfs_filename, current);
+    }
+  }
+
+  std::cout << "[FILE_STORE] Loaded image " << path << " (" << decoded.size() << " files, "
+            << block_count << " blocks)" << std::endl;
   return true;
 }
 
+std::string FileStore::getImagePath() const {
+  return storage_dir + "/store.img";
+}
+
+void FileStore::setChangeListener(ChangeListener listener) {
+  std::unique_lock<std::shared_mutex> lock(mtx);
+  on_change = std::move(listener);
+}
+
+void FileStore::reindexBlocks(const SharedBlocks& removed, const SharedBlocks& added) {
+  for (const auto& block : removed) {
+    auto it = blocks.find(block->block_id);
+    if (it != blocks.end() && it->second == block) {
+      blocks.erase(it);
+    }
+  }
+  for (const auto& block : added) {
+    blocks[block->block_id] = block;
+  }
+}
+
+std::mutex& FileStore::writerOf(FileId file_id) {
+  return write_mtx[file_id % write_mtx.size()];
+}
+
+std::vector<std::unique_lock<std::mutex>> FileStore::lockAllWriters() {
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(write_mtx.size());
+  for (auto& writer : write_mtx) {
+    locks.emplace_back(writer);  // always in index order, so two callers can't deadlock
+  }
+  return locks;
+}
+
+void FileStore::publishVersion(FileEntry& entry, FileSnapshot next) {
+  if (entry.current) {
+    uint32_t old_version = entry.current->metadata.version;
+    if (old_version != next->metadata.version) {
+      entry.retired[old_version] = entry.current;
+    }
+  }
+  entry.current = std::move(next);
+  pruneRetired(entry);
+  if (on_change) {
+    on_change(entry.current->metadata.hydfs_filename, entry.current);
+  }
+}
+
+size_t FileStore::pruneRetired(FileEntry& entry) {
+  size_t dropped = 0;
+  for (auto it = entry.retired.begin(); it != entry.retired.end();) {
+    if (it->second.expired()) {
+      it = entry.retired.erase(it);
+      dropped++;
+    } else {
+      ++it;
+    }
+  }
+  return dropped;
+}
+
 // Note: Persistence functions removed - in-memory only storage
 void FileStore::persistMetadata(const std::string& /* filename */) {
   // No-op: In-memory only
@@ -0,0 +1,132 @@
+#include "group_commit.hpp"
+
+#include <iostream>
+#include <utility>
+
+GroupCommitter::GroupCommitter(FlushFn flush, std::chrono::microseconds window,
+                               size_t max_bytes, size_t max_appends)
+    : flush_(std::move(flush)),
+      window_(window),
+      max_bytes_(max_bytes),
+      max_appends_(max_appends > 0 ? max_appends : 1) {}
+
+GroupCommitter::~GroupCommitter() { stop(); }
+
+void GroupCommitter::start() {
+  if (running_.exchange(true)) {
+    return;  // Already running
+  }
+  thread_ = std::thread(&GroupCommitter::run, this);
+}
+
+void GroupCommitter::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!running_.exchange(false)) {
+      return;
+    }
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  runOnce(true);  // commit what was still waiting for its window
+}
+
+void GroupCommitter::add(const std::string& hydfs_filename, FileId file_id, Append append) {
+  size_t bytes = append.block.serializedSize();
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto open = open_.find(file_id);
+    if (open != open_.end() && open->second->bytes + bytes > max_bytes_) {
+      // Full: it goes out as is and this append starts the next group
+      open->second->sealed = sealed_ = wake = true;
+      open_.erase(open);
+      open = open_.end();
+    }
+
+    if (open == open_.end()) {
+      Pending pending;
+      pending.group.hydfs_filename = hydfs_filename;
+      pending.group.file_id = file_id;
+      pending.deadline = std::chrono::steady_clock::now() + window_;
+      wake = wake || groups_.empty();
+      groups_.push_back(std::move(pending));
+      open = open_.emplace(file_id, std::prev(groups_.end())).first;
+    }
+
+    Pending& pending = *open->second;
+    pending.group.appends.push_back(std::move(append));
+    pending.bytes += bytes;
+    if (pending.group.appends.size() >= max_appends_ || pending.bytes >= max_bytes_) {
+      pending.sealed = sealed_ = wake = true;
+      open_.erase(open);
+    }
+  }
+  if (wake) {
+    cv_.notify_all();
+  }
+}
+
+size_t GroupCommitter::runOnce(bool all) {
+  std::lock_guard<std::mutex> handoff_lock(handoff_mtx_);
+
+  // A file's later group is never due before its earlier one, so taking the due groups
+  // front to back keeps each file's appends in order
+  std::vector<Group> due;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = groups_.begin(); it != groups_.end();) {
+      if (!all && !it->sealed && it->deadline > now) {
+        ++it;
+        continue;
+      }
+      auto open = open_.find(it->group.file_id);
+      if (open != open_.end() && open->second == it) {
+        open_.erase(open);
+      }
+      due.push_back(std::move(it->group));
+      it = groups_.erase(it);
+    }
+    sealed_ = false;
+  }
+  if (due.empty()) {
+    return 0;
+  }
+
+  size_t flushed = 0;
+  for (const auto& group : due) {
+    flushed += group.appends.size();
+  }
+  flush_(due);
+  groups_flushed_ += due.size();
+  appends_flushed_ += flushed;
+  return flushed;
+}
+
+GroupCommitter::Stats GroupCommitter::stats() const {
+  Stats stats;
+  stats.groups = groups_flushed_;
+  stats.appends = appends_flushed_;
+  return stats;
+}
+
+void GroupCommitter::run() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (running_) {
+    if (groups_.empty()) {
+      cv_.wait(lock, [this] { return !running_ || !groups_.empty(); });
+    } else if (!sealed_) {
+      // The oldest group has the earliest deadline
+      auto deadline = groups_.front().deadline;
+      cv_.wait_until(lock, deadline, [this] { return !running_ || sealed_; });
+    }
+    if (!running_) break;
+
+    lock.unlock();
+    runOnce();
+    lock.lock();
+  }
+}
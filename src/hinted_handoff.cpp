@@ -0,0 +1,390 @@
+#include "hinted_handoff.hpp"
+
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+// Log records are a host-order u32 length followed by the payload. The first record
+// holds the replica's NodeId; each later one is a hint (filename, then the block)
+static constexpr const char* LOG_SUFFIX = ".hints";
+
+// Size of a hint in a replay batch: length-prefixed filename plus the block
+static size_t encodedSize(const HintedHandoff::Hint& hint) {
+  return sizeof(uint32_t) + hint.hydfs_filename.size() + hint.block.serializedSize();
+}
+
+static void writeRecord(std::ofstream& out, const std::vector<char>& payload) {
+  uint32_t length = payload.size();
+  out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+  out.write(payload.data(), payload.size());
+}
+
+static void writeHeader(std::ofstream& out, const NodeId& replica) {
+  std::vector<char> payload(sizeof(NodeId::host) + sizeof(NodeId::port) + sizeof(NodeId::time));
+  replica.serialize(payload.data(), payload.size());
+  writeRecord(out, payload);
+}
+
+static void writeHint(std::ofstream& out, const HintedHandoff::Hint& hint) {
+  std::vector<char> payload(encodedSize(hint));
+  uint32_t name_length = hint.hydfs_filename.size();
+  std::memcpy(payload.data(), &name_length, sizeof(name_length));
+  std::memcpy(payload.data() + sizeof(name_length), hint.hydfs_filename.data(), name_length);
+  size_t offset = sizeof(name_length) + name_length;
+  hint.block.serialize(payload.data() + offset, payload.size() - offset);
+  writeRecord(out, payload);
+}
+
+static bool readHint(const char* payload, size_t length, HintedHandoff::Hint& hint) {
+  uint32_t name_length = 0;
+  if (length < sizeof(name_length)) return false;
+  std::memcpy(&name_length, payload, sizeof(name_length));
+  if (name_length > length - sizeof(name_length)) return false;
+  hint.hydfs_filename.assign(payload + sizeof(name_length), name_length);
+
+  size_t offset = sizeof(name_length) + name_length;
+  try {
+    hint.block = FileBlock::deserialize(payload + offset, length - offset);
+  } catch (const std::exception&) {
+    return false;
+  }
+  return hint.block.serializedSize() == length - offset;
+}
+
+HintedHandoff::HintedHandoff(const std::string& hint_dir, DeliverFn deliver, LivenessFn is_alive,
+                             uint64_t bytes_per_sec, std::chrono::milliseconds interval,
+                             std::chrono::milliseconds ack_timeout, size_t max_queue_bytes)
+    : hint_dir_(hint_dir),
+      deliver_(std::move(deliver)),
+      is_alive_(std::move(is_alive)),
+      bytes_per_sec_(bytes_per_sec),
+      interval_(interval),
+      ack_timeout_(ack_timeout),
+      max_queue_bytes_(max_queue_bytes),
+      next_send_(std::chrono::steady_clock::now()) {
+  loadLogs();
+}
+
+HintedHandoff::~HintedHandoff() { stop(); }
+
+void HintedHandoff::start() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stopping_ = false;
+  }
+  if (running_.exchange(true)) {
+    return;  // Already running
+  }
+  thread_ = std::thread(&HintedHandoff::run, this);
+}
+
+void HintedHandoff::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stopping_ = true;  // a replay waiting on the cap gives up
+    if (!running_.exchange(false)) {
+      return;
+    }
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool HintedHandoff::hasHints(const NodeId& replica) const {
+  std::lock_guard<std::mutex> lock(queue_mtx_);
+  auto it = queues_.find(replica);
+  return it != queues_.end() && !it->second.hints.empty();
+}
+
+bool HintedHandoff::addHint(const NodeId& replica, const std::string& hydfs_filename,
+                            const FileBlock& block) {
+  std::lock_guard<std::mutex> lock(queue_mtx_);
+  return enqueue(replica, Hint{hydfs_filename, block});
+}
+
+void HintedHandoff::expectAck(uint64_t request_id, const NodeId& replica,
+                              std::vector<Hint> hints) {
+  std::lock_guard<std::mutex> lock(queue_mtx_);
+  awaiting_acks_[request_id] =
+      AwaitingAck{replica, std::move(hints), std::chrono::steady_clock::now() + ack_timeout_};
+}
+
+void HintedHandoff::acknowledge(uint64_t request_id, size_t applied) {
+  std::lock_guard<std::mutex> lock(queue_mtx_);
+  auto it = awaiting_acks_.find(request_id);
+  if (it == awaiting_acks_.end()) {
+    return;
+  }
+  // Blocks past the replica's high-water mark weren't stored; retry them as hints
+  for (size_t i = applied; i < it->second.hints.size(); i++) {
+    enqueue(it->second.replica, it->second.hints[i]);
+  }
+  awaiting_acks_.erase(it);
+}
+
+void HintedHandoff::discard(const NodeId& replica) {
+  std::lock_guard<std::mutex> lock(queue_mtx_);
+  for (auto it = awaiting_acks_.begin(); it != awaiting_acks_.end();) {
+    it = it->second.replica == replica ? awaiting_acks_.erase(it) : std::next(it);
+  }
+
+  auto it = queues_.find(replica);
+  if (it == queues_.end()) {
+    return;
+  }
+  if (!it->second.hints.empty()) {
+    std::cout << "[HINTED_HANDOFF] Discarding " << it->second.hints.size() << " hints for "
+              << replica << std::endl;
+  }
+  it->second.hints.clear();
+  it->second.sizes.clear();
+  it->second.bytes = 0;
+  rewriteLog(replica, it->second);
+  queues_.erase(it);
+}
+
+size_t HintedHandoff::runOnce() {
+  std::vector<NodeId> replicas;
+  {
+    // Sent blocks whose ack never came become hints
+    std::lock_guard<std::mutex> lock(queue_mtx_);
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = awaiting_acks_.begin(); it != awaiting_acks_.end();) {
+      if (it->second.deadline > now) {
+        ++it;
+        continue;
+      }
+      for (const auto& hint : it->second.hints) {
+        enqueue(it->second.replica, hint);
+      }
+      it = awaiting_acks_.erase(it);
+    }
+
+    for (const auto& [replica, queue] : queues_) {
+      if (!queue.hints.empty()) replicas.push_back(replica);
+    }
+  }
+  if (on_expire_) {
+    on_expire_();
+  }
+
+  std::lock_guard<std::mutex> replay_lock(replay_mtx_);
+  size_t replayed = 0;
+  for (const auto& replica : replicas) {
+    if (is_alive_(replica)) {
+      replayed += replay(replica);
+    }
+  }
+  return replayed;
+}
+
+HintedHandoff::Progress HintedHandoff::progress() const {
+  Progress progress;
+  std::lock_guard<std::mutex> lock(queue_mtx_);
+  for (const auto& [replica, queue] : queues_) {
+    progress.pending += queue.hints.size();
+  }
+  for (const auto& [request_id, awaiting] : awaiting_acks_) {
+    progress.awaiting_ack += awaiting.hints.size();
+  }
+  progress.replayed = replayed_;
+  progress.dropped = dropped_;
+  return progress;
+}
+
+void HintedHandoff::run() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (running_) {
+    cv_.wait_for(lock, interval_, [this] { return !running_; });
+    if (!running_) break;
+
+    lock.unlock();
+    size_t replayed = runOnce();
+    if (replayed > 0) {
+      std::cout << "[HINTED_HANDOFF] Replayed " << replayed << " hints" << std::endl;
+    }
+    lock.lock();
+  }
+}
+
+size_t HintedHandoff::replay(const NodeId& replica) {
+  size_t replayed = 0;
+  while (true) {
+    // The oldest hints that fit one datagram (always at least one)
+    std::vector<Hint> batch;
+    size_t batch_bytes = 0;
+    {
+      std::lock_guard<std::mutex> lock(queue_mtx_);
+      auto it = queues_.find(replica);
+      if (it == queues_.end()) break;
+      const Queue& queue = it->second;
+      for (size_t i = 0; i < queue.hints.size(); i++) {
+        if (!batch.empty() && batch_bytes + queue.sizes[i] > kBatchBytes) break;
+        batch.push_back(queue.hints[i]);
+        batch_bytes += queue.sizes[i];
+      }
+    }
+    if (batch.empty() || !throttle(batch_bytes) || !deliver_(replica, batch)) {
+      break;  // retried on a later pass
+    }
+
+    std::lock_guard<std::mutex> lock(queue_mtx_);
+    auto it = queues_.find(replica);
+    if (it == queues_.end()) break;  // discarded while in flight
+    Queue& queue = it->second;
+    for (size_t i = 0; i < batch.size() && !queue.hints.empty(); i++) {
+      queue.bytes -= queue.sizes.front();
+      queue.hints.pop_front();
+      queue.sizes.pop_front();
+    }
+    replayed += batch.size();
+  }
+
+  if (replayed > 0) {
+    // Drop the replayed prefix from the log; a crash before this only replays it again
+    std::lock_guard<std::mutex> lock(queue_mtx_);
+    auto it = queues_.find(replica);
+    if (it != queues_.end()) {
+      rewriteLog(replica, it->second);
+      if (it->second.hints.empty()) {
+        queues_.erase(it);
+      }
+    }
+    replayed_ += replayed;
+  }
+  return replayed;
+}
+
+bool HintedHandoff::throttle(size_t bytes) {
+  std::unique_lock<std::mutex> lock(mtx_);
+  auto now = std::chrono::steady_clock::now();
+  if (next_send_ < now) {
+    next_send_ = now;
+  }
+  auto start = next_send_;
+  uint64_t rate = bytes_per_sec_;
+  if (rate > 0) {
+    next_send_ += std::chrono::microseconds(uint64_t(bytes) * 1000000 / rate);
+  }
+  return !cv_.wait_until(lock, start, [this] { return stopping_; });
+}
+
+bool HintedHandoff::enqueue(const NodeId& replica, const Hint& hint) {
+  size_t size = encodedSize(hint);
+  auto it = queues_.find(replica);
+  size_t queued_bytes = it == queues_.end() ? 0 : it->second.bytes;
+  if (size > kBatchBytes || queued_bytes + size > max_queue_bytes_) {
+    // Left for merge or anti-entropy to repair
+    dropped_++;
+    return false;
+  }
+
+  if (it == queues_.end()) {
+    it = queues_.emplace(replica, Queue{}).first;
+    std::error_code ec;
+    std::filesystem::create_directories(hint_dir_, ec);
+    it->second.log.open(logPath(replica), std::ios::binary | std::ios::trunc);
+    writeHeader(it->second.log, replica);
+  }
+
+  Queue& queue = it->second;
+  queue.hints.push_back(hint);
+  queue.sizes.push_back(size);
+  queue.bytes += size;
+  writeHint(queue.log, hint);
+  queue.log.flush();
+  if (!queue.log) {
+    std::cout << "[HINTED_HANDOFF] Failed to log hint for " << replica << std::endl;
+  }
+  return true;
+}
+
+void HintedHandoff::rewriteLog(const NodeId& replica, Queue& queue) {
+  queue.log.close();
+  std::string path = logPath(replica);
+  std::error_code ec;
+  if (queue.hints.empty()) {
+    std::filesystem::remove(path, ec);
+    return;
+  }
+
+  // Write to a temporary file and rename, so a crash never leaves a torn log
+  std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    writeHeader(out, replica);
+    for (const auto& hint : queue.hints) {
+      writeHint(out, hint);
+    }
+  }
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    std::cout << "[HINTED_HANDOFF] Failed to rewrite " << path << ": " << ec.message()
+              << std::endl;
+  }
+  queue.log.open(path, std::ios::binary | std::ios::app);
+}
+
+std::string HintedHandoff::logPath(const NodeId& replica) const {
+  return hint_dir_ + "/" + replica.host + "_" + replica.port + "_" +
+         std::to_string(replica.time) + LOG_SUFFIX;
+}
+
+void HintedHandoff::loadLogs() {
+  std::error_code ec;
+  if (!std::filesystem::is_directory(hint_dir_, ec)) {
+    return;
+  }
+
+  size_t loaded = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(hint_dir_, ec)) {
+    if (entry.path().extension() != LOG_SUFFIX) continue;
+
+    std::ifstream in(entry.path(), std::ios::binary);
+    std::vector<char> contents((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+
+    // Walk the records; a torn tail from a crash mid-append is cut off
+    std::vector<std::pair<size_t, size_t>> records;  // (offset, length)
+    size_t offset = 0;
+    while (offset + sizeof(uint32_t) <= contents.size()) {
+      uint32_t length = 0;
+      std::memcpy(&length, contents.data() + offset, sizeof(length));
+      offset += sizeof(length);
+      if (length > contents.size() - offset) break;
+      records.emplace_back(offset, length);
+      offset += length;
+    }
+
+    if (records.empty() || records[0].second != sizeof(NodeId::host) + sizeof(NodeId::port) +
+                                                    sizeof(NodeId::time)) {
+      std::cout << "[HINTED_HANDOFF] Removing unreadable log " << entry.path() << std::endl;
+      std::filesystem::remove(entry.path(), ec);
+      continue;
+    }
+    NodeId replica = NodeId::deserialize(contents.data() + records[0].first, records[0].second);
+
+    Queue& queue = queues_[replica];
+    for (size_t i = 1; i < records.size(); i++) {
+      Hint hint;
+      if (!readHint(contents.data() + records[i].first, records[i].second, hint)) break;
+      queue.sizes.push_back(encodedSize(hint));
+      queue.bytes += queue.sizes.back();
+      queue.hints.push_back(std::move(hint));
+    }
+    loaded += queue.hints.size();
+    rewriteLog(replica, queue);
+    if (queue.hints.empty()) {
+      queues_.erase(replica);
+    }
+  }
+
+  if (loaded > 0) {
+    std::cout << "[HINTED_HANDOFF] Loaded " << loaded << " hints from " << hint_dir_ << std::endl;
+  }
+}
@@ -0,0 +1,43 @@
+#include "latency_tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyTracker::LatencyTracker(size_t window) : window_(std::max<size_t>(window, 1)) {
+  samples_.reserve(window_);
+}
+
+void LatencyTracker::record(std::chrono::microseconds latency) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (samples_.size() < window_) {
+    samples_.push_back(latency);
+  } else {
+    samples_[next_] = latency;
+  }
+  next_ = (next_ + 1) % window_;
+}
+
+std::chrono::microseconds LatencyTracker::percentile(double percentile,
+                                                     std::chrono::microseconds fallback,
+                                                     size_t min_samples) const {
+  std::vector<std::chrono::microseconds> sorted;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (samples_.empty() || samples_.size() < min_samples) {
+      return fallback;
+    }
+    sorted = samples_;
+  }
+
+  // Nearest-rank: the smallest sample with at least `percentile` percent at or below it
+  percentile = std::clamp(percentile, 0.0, 100.0);
+  size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+  size_t index = rank > 0 ? rank - 1 : 0;
+  std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+  return sorted[index];
+}
+
+size_t LatencyTracker::samples() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return samples_.size();
+}
@@ -1,6 +1,7 @@
 #include <cstring>
 #include <future>
 #include <iostream>
+#include <sstream>
 
 #include "logger.hpp"
 #include "message.hpp"
@@ -34,14 +35,30 @@ int main(int argc, char* argv[]) {
       std::cout << "\n=== HyDFS Commands ===\n\n";
       std::cout << "File Operations:\n";
       std::cout << "  create <localfile> <hydfsfile>   - Create file in HyDFS from local file\n";
-      std::cout << "  get <hydfsfile> <localfile>      - Get file from HyDFS to local file\n";
-      std::cout << "  append <localfile> <hydfsfile>   - Append local file to HyDFS file\n";
+      std::cout << "  get <hydfsfile> <localfile> [one|quorum|all]\n";
+      std::cout << "                                   - Get file from HyDFS to local file\n";
+      std::cout << "  getsince <hydfsfile> <localfile> <timestamp_ms> [block_id]\n";
+      std::cout << "                                   - Get only blocks appended since a point\n";
+      std::cout << "  append <localfile> <hydfsfile> [one|quorum|all]\n";
+      std::cout << "                                   - Append local file to HyDFS file\n";
       std::cout << "  merge <hydfsfile>                - Merge all replicas of a file\n";
       std::cout << "  ls <hydfsfile>                   - List all VMs storing the file\n";
       std::cout << "  store / liststore                - List all files stored on this VM (with ring ID)\n";
       std::cout << "  cat <localfile>                  - Print local file contents\n";
-      std::cout << "  getfromreplica <vm:port> <hydfsfile> <localfile>\n";
+      std::cout << "  getfromreplica <vm:port|best> <hydfsfile> <localfile>\n";
       std::cout << "                                   - Get file from specific replica\n";
+      std::cout << "  saveimage <path|default>         - Dump this VM's store into an image file\n";
+      std::cout << "  loadimage <path|default>         - Replace this VM's store with an image file\n";
+      std::cout << "  retention <prefix|*> <max_age_ms> <max_bytes> <max_blocks>\n";
+      std::cout << "                                   - Cap files by prefix (0 = no cap, all 0 removes)\n";
+      std::cout << "  list_retention                   - Show this VM's retention rules\n";
+      std::cout << "  sync                             - Run anti-entropy with co-replicas now\n";
+      std::cout << "  rereplication                    - Show progress restoring lost replicas\n";
+      std::cout << "  rebalance [bytes_per_sec]        - Show moves to new nodes, set cap\n";
+      std::cout << "  hints [bytes_per_sec]            - Show hinted writes, set replay cap\n";
+      std::cout << "  hedge [percentile]               - Show/set GET hedge percentile (0 = off)\n";
+      std::cout << "  readcache                        - Show read cache hits, misses and size\n";
+      std::cout << "  chain [on|off]                   - Show/set chain replication of appends\n";
       std::cout << "\nMembership Operations:\n";
       std::cout << "  join                             - Join the network\n";
       std::cout << "  leave                            - Leave the network and exit\n";
@@ -57,7 +74,7 @@ int main(int argc, char* argv[]) {
       std::cout << "\nExamples:\n";
       std::cout << "  create test.txt myfile.txt\n";
       std::cout << "  get myfile.txt downloaded.txt\n";
-      std::cout << "  append data.txt myfile.txt\n";
+      std::cout << "  append data.txt myfile.txt quorum\n";
       std::cout << "  ls myfile.txt\n";
       std::cout << "  getfromreplica localhost:12345 myfile.txt local.txt\n";
       std::cout << "\n";
@@ -104,13 +121,35 @@ int main(int argc, char* argv[]) {
       std::cin >> local_file >> hydfs_file;
       node.getFileHandler()->createFile(local_file, hydfs_file);
     } else if (input == "get") {
-      std::string hydfs_file, local_file;
+      // Optional consistency level is read from the rest of the line
+      std::string hydfs_file, local_file, rest, level_name;
       std::cin >> hydfs_file >> local_file;
-      node.getFileHandler()->getFile(hydfs_file, local_file);
+      std::getline(std::cin, rest);
+      ConsistencyLevel level = ConsistencyLevel::ONE;
+      if (std::istringstream(rest) >> level_name && !parseConsistencyLevel(level_name, level)) {
+        std::cerr << "Invalid consistency level: " << level_name << std::endl;
+        continue;
+      }
+      node.getFileHandler()->getFile(hydfs_file, local_file, level);
+    } else if (input == "getsince") {
+      // Optional block id is read from the rest of the line
+      std::string hydfs_file, local_file, rest;
+      uint64_t since_timestamp = 0, since_block_id = 0;
+      std::cin >> hydfs_file >> local_file >> since_timestamp;
+      std::getline(std::cin, rest);
+      std::istringstream(rest) >> since_block_id;
+      node.getFileHandler()->getFileSince(hydfs_file, local_file, since_timestamp,
+                                          since_block_id);
     } else if (input == "append") {
-      std::string local_file, hydfs_file;
+      std::string local_file, hydfs_file, rest, level_name;
       std::cin >> local_file >> hydfs_file;
-      node.getFileHandler()->appendFile(local_file, hydfs_file);
+      std::getline(std::cin, rest);
+      ConsistencyLevel level = ConsistencyLevel::ONE;
+      if (std::istringstream(rest) >> level_name && !parseConsistencyLevel(level_name, level)) {
+        std::cerr << "Invalid consistency level: " << level_name << std::endl;
+        continue;
+      }
+      node.getFileHandler()->appendFile(local_file, hydfs_file, level);
     } else if (input == "merge") {
       std::string hydfs_file;
       std::cin >> hydfs_file;
@@ -130,6 +169,92 @@ int main(int argc, char* argv[]) {
       std::string vm_address, hydfs_file, local_file;
       std::cin >> vm_address >> hydfs_file >> local_file;
       node.getFileHandler()->getFileFromReplica(vm_address, hydfs_file, local_file);
+    } else if (input == "saveimage" || input == "loadimage") {
+      std::string image_path;
+      std::cin >> image_path;
+      if (image_path == "default") image_path.clear();
+      if (input == "saveimage") {
+        node.getFileHandler()->saveStoreImage(image_path);
+      } else {
+        node.getFileHandler()->loadStoreImage(image_path);
+      }
+    } else if (input == "retention") {
+      std::string prefix;
+      RetentionPolicy policy;
+      std::cin >> prefix >> policy.max_age_ms >> policy.max_bytes >> policy.max_blocks;
+      if (prefix == "*") prefix.clear();
+      node.getFileHandler()->setRetentionPolicy(prefix, policy);
+    } else if (input == "list_retention") {
+      node.getFileHandler()->listRetentionPolicies();
+    } else if (input == "sync") {
+      size_t repaired = node.getAntiEntropy()->runOnce();
+      std::cout << "Anti-entropy repaired " << repaired << " files" << std::endl;
+    } else if (input == "rebalance") {
+      Rebalancer* rebalancer = node.getRebalancer();
+      std::string line;
+      std::getline(std::cin, line);
+      uint64_t cap = 0;
+      if (std::istringstream(line) >> cap) {
+        rebalancer->setBandwidthCap(cap);
+      }
+      Rebalancer::Progress progress = rebalancer->progress();
+      std::cout << "Rebalance: " << progress.pending << " pending, " << progress.moved
+                << " moved (" << progress.bytes_moved << " bytes), " << progress.failed
+                << " failed; cap " << rebalancer->getBandwidthCap() << " bytes/s" << std::endl;
+    } else if (input == "hints") {
+      HintedHandoff* hints = node.getHintedHandoff();
+      std::string line;
+      std::getline(std::cin, line);
+      uint64_t cap = 0;
+      if (std::istringstream(line) >> cap) {
+        hints->setBandwidthCap(cap);
+      }
+      HintedHandoff::Progress progress = hints->progress();
+      std::cout << "Hinted handoff: " << progress.pending << " pending, " << progress.awaiting_ack
+                << " awaiting ack, " << progress.replayed << " replayed, " << progress.dropped
+                << " dropped; cap " << hints->getBandwidthCap() << " bytes/s" << std::endl;
+    } else if (input == "readcache") {
+      ReadCache::Stats stats = node.getFileHandler()->getReadCacheStats();
+      std::cout << "Read cache: " << stats.entries << " files (" << stats.bytes << " bytes), "
+                << stats.hits << " hits, " << stats.misses << " misses, " << stats.invalidations
+                << " invalidations" << std::endl;
+    } else if (input == "hedge") {
+      std::string line;
+      std::getline(std::cin, line);
+      double percentile = 0;
+      if (std::istringstream(line) >> percentile) {
+        if (percentile < 0 || percentile > 100) {
+          std::cerr << "Hedge percentile must be between 0 and 100" << std::endl;
+          continue;
+        }
+        node.getFileHandler()->setHedgePercentile(percentile);
+      }
+      double current = node.getFileHandler()->getHedgePercentile();
+      if (current > 0) {
+        std::cout << "GETs hedge after p" << current << " of recent latency" << std::endl;
+      } else {
+        std::cout << "GET hedging is off" << std::endl;
+      }
+    } else if (input == "chain") {
+      std::string line;
+      std::getline(std::cin, line);
+      std::string mode;
+      if (std::istringstream(line) >> mode) {
+        if (mode != "on" && mode != "off") {
+          std::cerr << "Usage: chain [on|off]" << std::endl;
+          continue;
+        }
+        node.getFileHandler()->setChainReplication(mode == "on");
+      }
+      if (node.getFileHandler()->isChainReplication()) {
+        std::cout << "Appends replicate down a chain (head -> tail)" << std::endl;
+      } else {
+        std::cout << "Appends replicate from the coordinator to each replica" << std::endl;
+      }
+    } else if (input == "rereplication") {
+      ReReplicator::Progress progress = node.getReReplicator()->progress();
+      std::cout << "Re-replication: " << progress.pending << " pending, " << progress.completed
+                << " completed, " << progress.failed << " failed" << std::endl;
     } else {
       std::cerr << "INVALID COMMAND" << std::endl;
     }
@@ -78,6 +78,12 @@ MembershipInfo MembershipList::getNodeInfo(const NodeId& node_id) {
   throw std::runtime_error("Trying to get info about node that doesn't exist");
 }
 
+bool MembershipList::isAlive(const NodeId& node_id) const {
+  std::shared_lock<std::shared_mutex> lock(mtx);
+  auto it = mem_list.find(node_id);
+  return it != mem_list.end() && it->second.status == NodeStatus::ALIVE;
+}
+
 void MembershipList::updateMode(const NodeId& node_id, FailureDetectionMode new_mode) {
   std::unique_lock<std::shared_mutex> lock(mtx);
   if (auto it = mem_list.find(node_id); it != mem_list.end()) {
@@ -0,0 +1,140 @@
+#include "merge_plan.hpp"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
+#include "flat_hash_map.hpp"
+
+// True if every append in `inner` is also in one of the ranges of `outer`
+static bool containsAll(const BlockDigest& outer, const BlockDigest& inner) {
+  auto covered = [&](const std::string& client, uint32_t first, uint32_t last) {
+    return std::any_of(outer.ranges.begin(), outer.ranges.end(), [&](const BlockRange& range) {
+      return range.client_id == client && range.first_sequence <= first &&
+             range.last_sequence >= last;
+    });
+  };
+
+  if (inner.ranges.empty()) {
+    return covered(inner.client_id, inner.sequence_num, inner.sequence_num);
+  }
+  return std::all_of(inner.ranges.begin(), inner.ranges.end(), [&](const BlockRange& range) {
+    return covered(range.client_id, range.first_sequence, range.last_sequence);
+  });
+}
+
+MergePlan planMerge(const std::vector<std::vector<BlockDigest>>& replicas,
+                   uint64_t truncated_through) {
+  MergePlan plan;
+
+  // Union by block ID, without what retention already cut
+  FlatHashMap<uint64_t, const BlockDigest*> by_id;
+  std::vector<const BlockDigest*> blocks;
+  std::vector<const BlockDigest*> extents;
+  for (const auto& replica : replicas) {
+    for (const auto& digest : replica) {
+      if (by_id.emplace(digest.block_id, &digest).second) {
+        if (truncated_through > 0 && digest.timestamp <= truncated_through) {
+          plan.expired++;
+          continue;
+        }
+        blocks.push_back(&digest);
+        if (!digest.ranges.empty()) {
+          extents.push_back(&digest);
+        }
+      }
+    }
+  }
+
+  // The lowest block ID each plain append is held under
+  std::map<std::pair<std::string, uint32_t>, uint64_t> lowest_id;
+  for (const BlockDigest* block : blocks) {
+    if (block->ranges.empty()) {
+      auto [it, added] =
+          lowest_id.emplace(std::make_pair(block->client_id, block->sequence_num), block->block_id);
+      if (!added) it->second = std::min(it->second, block->block_id);
+    }
+  }
+
+  // Drop blocks another block already carries; of two extents with the same
+  // coverage the one with the lower ID wins
+  auto is_covered = [&](const BlockDigest* block) {
+    if (block->ranges.empty() &&
+        lowest_id[std::make_pair(block->client_id, block->sequence_num)] != block->block_id) {
+      return true;  // the same append under another ID
+    }
+    return std::any_of(extents.begin(), extents.end(), [&](const BlockDigest* extent) {
+      if (extent == block || !containsAll(*extent, *block)) return false;
+      return !containsAll(*block, *extent) || extent->block_id < block->block_id;
+    });
+  };
+  std::vector<const BlockDigest*> kept;
+  kept.reserve(blocks.size());
+  for (const BlockDigest* block : blocks) {
+    if ((!extents.empty() || lowest_id.size() < blocks.size()) && is_covered(block)) {
+      plan.covered++;
+    } else {
+      kept.push_back(block);
+    }
+  }
+
+  std::sort(kept.begin(), kept.end(), [](const BlockDigest* a, const BlockDigest* b) {
+    return std::tie(a->client_id, a->sequence_num, a->timestamp, a->block_id) <
+           std::tie(b->client_id, b->sequence_num, b->timestamp, b->block_id);
+  });
+  plan.block_ids.reserve(kept.size());
+  for (const BlockDigest* block : kept) {
+    plan.block_ids.push_back(block->block_id);
+  }
+
+  // What each replica needs to end up with the merged list
+  for (const auto& replica : replicas) {
+    std::unordered_set<uint64_t> held;
+    for (const auto& digest : replica) {
+      held.insert(digest.block_id);
+    }
+
+    std::vector<uint64_t> missing;
+    for (uint64_t block_id : plan.block_ids) {
+      if (held.count(block_id) == 0) {
+        missing.push_back(block_id);
+      }
+    }
+
+    bool in_sync = replica.size() == plan.block_ids.size();
+    for (size_t i = 0; in_sync && i < replica.size(); i++) {
+      in_sync = replica[i].block_id == plan.block_ids[i];
+    }
+
+    plan.missing.push_back(std::move(missing));
+    plan.in_sync.push_back(in_sync);
+  }
+
+  return plan;
+}
+
+std::vector<uint64_t> planReadRepair(const std::vector<uint64_t>& fresh_ids,
+                                     const std::vector<BlockDigest>& replica) {
+  FlatHashMap<uint64_t, bool> fresh;
+  for (uint64_t block_id : fresh_ids) {
+    fresh.emplace(block_id, true);
+  }
+  FlatHashMap<uint64_t, bool> held;
+  for (const auto& digest : replica) {
+    if (fresh.find(digest.block_id) == fresh.end()) {
+      return {};  // diverged
+    }
+    held.emplace(digest.block_id, true);
+  }
+
+  std::vector<uint64_t> missing;
+  for (uint64_t block_id : fresh_ids) {
+    if (held.find(block_id) == held.end()) {
+      missing.push_back(block_id);
+    }
+  }
+  return missing;
+}
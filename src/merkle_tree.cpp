@@ -0,0 +1,127 @@
+#include "merkle_tree.hpp"
+
+#include <algorithm>
+
+// Spread a digest over all 64 bits before it is XORed into the tree
+static uint64_t mix(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
+  return value;
+}
+
+// How a tree node's span of positions relates to a ring range
+enum class Overlap { kNone, kPartial, kFull };
+
+static Overlap overlapOf(uint64_t first, uint64_t last, uint64_t lo, uint64_t hi) {
+  if (last < lo || first > hi) return Overlap::kNone;
+  if (first >= lo && last <= hi) return Overlap::kFull;
+  return Overlap::kPartial;
+}
+
+// The range (start, end] as at most two closed intervals
+static Overlap overlapOf(uint64_t first, uint64_t last, const RingRange& range) {
+  if (range.start == range.end) return Overlap::kFull;
+  if (range.start < range.end) return overlapOf(first, last, range.start + 1, range.end);
+
+  Overlap high = range.start == UINT64_MAX ? Overlap::kNone
+                                           : overlapOf(first, last, range.start + 1, UINT64_MAX);
+  Overlap low = overlapOf(first, last, 0, range.end);
+  if (high == Overlap::kFull || low == Overlap::kFull) return Overlap::kFull;
+  if (high == Overlap::kNone && low == Overlap::kNone) return Overlap::kNone;
+  return Overlap::kPartial;
+}
+
+MerkleTree::MerkleTree() : leaves_(kLeaves) {
+  for (size_t level = 0; level <= kDepth; level++) {
+    levels_.emplace_back(levelWidth(level), 0);
+  }
+}
+
+void MerkleTree::update(const std::string& name, uint64_t position, uint64_t digest) {
+  size_t leaf = leafOf(position);
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  auto& entries = leaves_[leaf];
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->name != name) continue;
+    if (it->digest == digest) return;
+    apply(leaf, mix(it->digest));
+    if (digest == 0) {
+      entries.erase(it);
+      return;
+    }
+    it->digest = digest;
+    apply(leaf, mix(digest));
+    return;
+  }
+
+  if (digest != 0) {
+    entries.push_back({name, position, digest});
+    apply(leaf, mix(digest));
+  }
+}
+
+void MerkleTree::clear() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  for (auto& level : levels_) {
+    std::fill(level.begin(), level.end(), 0);
+  }
+  for (auto& entries : leaves_) {
+    entries.clear();
+  }
+}
+
+uint64_t MerkleTree::hash(size_t level, size_t index, const RingRange& range) const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return hashLocked(level, index, range);
+}
+
+std::vector<MerkleTree::Entry> MerkleTree::leafEntries(size_t leaf,
+                                                       const RingRange& range) const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::vector<Entry> entries;
+  for (const auto& entry : leaves_[leaf]) {
+    if (range.contains(entry.position)) {
+      entries.push_back(entry);
+    }
+  }
+  return entries;
+}
+
+void MerkleTree::apply(size_t leaf, uint64_t value) {
+  for (size_t level = kDepth + 1; level-- > 0;) {
+    levels_[level][leaf >> (kFanoutBits * (kDepth - level))] ^= value;
+  }
+}
+
+uint64_t MerkleTree::hashLocked(size_t level, size_t index, const RingRange& range) const {
+  // Node spans 2^span_bits positions starting at index << span_bits
+  size_t span_bits = 64 - kFanoutBits * level;
+  uint64_t first = span_bits == 64 ? 0 : uint64_t(index) << span_bits;
+  uint64_t last = span_bits == 64 ? UINT64_MAX : first + ((uint64_t(1) << span_bits) - 1);
+
+  switch (overlapOf(first, last, range)) {
+    case Overlap::kNone:
+      return 0;
+    case Overlap::kFull:
+      return levels_[level][index];
+    case Overlap::kPartial:
+      break;
+  }
+
+  // Only nodes on the range's two boundaries get here, so this stays O(depth * fanout)
+  uint64_t hash = 0;
+  if (level == kDepth) {
+    for (const auto& entry : leaves_[index]) {
+      if (range.contains(entry.position)) hash ^= mix(entry.digest);
+    }
+    return hash;
+  }
+  for (size_t child = 0; child < kFanout; child++) {
+    hash ^= hashLocked(level + 1, index * kFanout + child, range);
+  }
+  return hash;
+}
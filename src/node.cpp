@@ -41,9 +41,84 @@ Node::Node(const std::string_view& host, const std::string_view& port, NodeId& i
   file_store_ = std::make_unique<FileStore>(storage_dir);
   std::cout << "[DEBUG] FileStore created successfully" << std::endl;
 
+  // Seed the store from a previously saved image, if there is one
+  if (file_store_->loadImage(file_store_->getImagePath())) {
+    std::cout << "[DEBUG] FileStore seeded from " << file_store_->getImagePath() << std::endl;
+  }
+
   std::cout << "[DEBUG] Creating FileOperationsHandler..." << std::endl;
   file_handler_ = std::make_unique<FileOperationsHandler>(*file_store_, ring, self, logger, socket);
   std::cout << "[DEBUG] FileOperationsHandler created successfully" << std::endl;
+
+  compactor_ = std::make_unique<BlockCompactor>(*file_store_);
+  compactor_->start();
+
+  // Enforce retention rules locally; the coordinator tells replicas where it cut
+  reaper_ = std::make_unique<RetentionReaper>(
+      *file_store_, [this](const std::string& filename, uint64_t cut_timestamp) {
+        file_handler_->propagateTruncation(filename, cut_timestamp);
+      });
+  reaper_->start();
+
+  // Refill the replica sets of files whose replicas leave the ring
+  rereplicator_ = std::make_unique<ReReplicator>(
+      *file_store_, ring, self, [this](const std::string& filename, const NodeId& target) {
+        return file_handler_->transferFile(filename, target);
+      });
+
+  // Move files to nodes that join, paced so the move doesn't saturate the network
+  rebalancer_ = std::make_unique<Rebalancer>(
+      *file_store_, ring, self,
+      [this](const std::string& filename, const NodeId& target) {
+        return file_handler_->transferFile(filename, target);
+      },
+      [this](const std::string& filename, const NodeId& target) {
+        file_handler_->dropReplica(filename, target);
+      });
+  // Merges and transfers share the cap, so re-replication and repair count against it too
+  file_handler_->setTransferThrottle(rebalancer_->throttle());
+
+  // Heal replicas that missed updates by comparing Merkle trees with co-replicas
+  anti_entropy_ = std::make_unique<AntiEntropyService>(
+      [this] { return file_handler_->runAntiEntropy(); });
+  anti_entropy_->start();
+
+  // Hold appends for unreachable replicas and replay them when the replica is back
+  hinted_handoff_ = std::make_unique<HintedHandoff>(
+      storage_dir + "/hints",
+      [this](const NodeId& target, const std::vector<HintedHandoff::Hint>& hints) {
+        return file_handler_->replayHints(target, hints);
+      },
+      [this](const NodeId& node_id) { return mem_list.isAlive(node_id); });
+  file_handler_->setHintedHandoff(hinted_handoff_.get());
+  hinted_handoff_->setOnExpire([this] { file_handler_->expireWrites(); });
+  hinted_handoff_->start();
+}
+
+void Node::addToRing(const NodeId& node_id) {
+  if (ring.hasNode(node_id)) {
+    return;
+  }
+  ring.addNode(node_id);
+  if (rebalancer_) {
+    rebalancer_->onNodeAdded(node_id);
+  }
+}
+
+void Node::removeFromRing(const NodeId& node_id) {
+  if (!ring.hasNode(node_id)) {
+    return;
+  }
+  ring.removeNode(node_id);
+  if (hinted_handoff_) {
+    hinted_handoff_->discard(node_id);  // its replacement gets whole files instead
+  }
+  if (file_handler_) {
+    file_handler_->getReplicaSelector().forget(node_id);
+  }
+  if (rereplicator_) {
+    rereplicator_->onNodeRemoved(node_id);
+  }
 }
 
 void Node::handleIncoming() {
@@ -155,6 +230,10 @@ void Node::runPingAck(bool enable_suspicion) {
   for (const auto& neighbor : kRandomNeighbors) {
     socket.buildServerAddr(dest_addr, neighbor.node_id.host, neighbor.node_id.port);
     size_t bytes_serialized = sendPing().serialize(buffer.data(), UDPSocketConnection::BUFFER_LEN);
+    {
+      std::lock_guard<std::mutex> lock(ping_mtx_);
+      ping_sent_[neighbor.node_id] = std::chrono::steady_clock::now();
+    }
     socket.write_to_socket(buffer, bytes_serialized, dest_addr);
   }
 
@@ -168,7 +247,7 @@ void Node::runPingAck(bool enable_suspicion) {
       uint32_t time_delta = curr_time - latest.local_time;
       if (latest.status == NodeStatus::LEFT && time_delta > T_CLEANUP) {
         mem_list.removeNode(latest.node_id, true);
-        ring.removeNode(latest.node_id);  // MP3: Remove from ring
+        removeFromRing(latest.node_id);  // MP3: Remove from ring
         continue;
       }
       if (updateStatus(neighbor, time_delta, enable_suspicion))
@@ -208,10 +287,10 @@ void Node::runGossip(bool enable_suspicion) {
       mem_list.updateNodeStatus(id, NodeStatus::DEAD);  // SUS --> DEAD
     } else if (node.status == NodeStatus::DEAD && passed_time > T_CLEANUP) {
       mem_list.removeNode(id);  // remove from mem_list
-      ring.removeNode(id);  // MP3: Remove from ring
+      removeFromRing(id);  // MP3: Remove from ring
     } else if (node.status == NodeStatus::LEFT && passed_time > T_CLEANUP) {
       mem_list.removeNode(node.node_id, true);
-      ring.removeNode(node.node_id);  // MP3: Remove from ring
+      removeFromRing(node.node_id);  // MP3: Remove from ring
     }
   }
 
@@ -257,7 +336,7 @@ bool Node::updateStatus(const MembershipInfo& old_info, const uint32_t time_delt
       case NodeStatus::LEFT:
         if (time_delta > T_CLEANUP) {
           mem_list.removeNode(node_id, old_info.status == NodeStatus::LEFT);
-          ring.removeNode(node_id);  // MP3: Remove from ring
+          removeFromRing(node_id);  // MP3: Remove from ring
           updated = true;
         }
         break;
@@ -272,7 +351,7 @@ void Node::handleJoin(std::array<char, UDPSocketConnection::BUFFER_LEN>& buffer,
   if (new_node.mode != fd_mode) mem_list.updateMode(new_node.node_id, fd_mode);
 
   // MP3: Add new node to ring
-  ring.addNode(new_node.node_id);
+  addToRing(new_node.node_id);
 
   // send new node current membership list
   const std::vector<MembershipInfo> mem_list_copy = mem_list.copy();
@@ -353,7 +432,7 @@ void Node::handlePing(std::array<char, UDPSocketConnection::BUFFER_LEN>& buffer,
   } catch (std::runtime_error const&) {
     // if we haven't seen this node add it to membership list
     mem_list.addNode(node);
-    ring.addNode(node.node_id);  // MP3: Add to ring
+    addToRing(node.node_id);  // MP3: Add to ring
   }
 
   // when a node receives a PING they reply with ACK
@@ -372,7 +451,7 @@ Message Node::sendPing() {
 void Node::handleAck(const MembershipInfo& node) {
   if (!introducer_alive) {
     mem_list.addNode(node);
-    ring.addNode(node.node_id);  // MP3: Add to ring
+    addToRing(node.node_id);  // MP3: Add to ring
     if (node.mode != fd_mode) {
       mem_list.updateMode(self, node.mode);
       fd_mode = node.mode;
@@ -381,6 +460,21 @@ void Node::handleAck(const MembershipInfo& node) {
   } else {
     mem_list.updateLocalTime(node.node_id);
   }
+
+  // The ping's round trip feeds the latency estimate reads use to pick replicas
+  std::chrono::steady_clock::time_point sent;
+  {
+    std::lock_guard<std::mutex> lock(ping_mtx_);
+    auto it = ping_sent_.find(node.node_id);
+    if (it == ping_sent_.end()) return;
+    sent = it->second;
+    ping_sent_.erase(it);
+  }
+  if (file_handler_) {
+    file_handler_->getReplicaSelector().observeRtt(
+        node.node_id, std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - sent));
+  }
 }
 
 Message Node::sendAck() {
@@ -441,12 +535,12 @@ std::vector<MembershipInfo> Node::handleGossip(const Message& message) {
             } else {
               // case 5: diff status, update from SUS to DEAD --> remove from mem_list
               mem_list.removeNode(curr_status.node_id);
-              ring.removeNode(curr_status.node_id);  // MP3: Remove from ring
+              removeFromRing(curr_status.node_id);  // MP3: Remove from ring
             }
           } else if (update.status == NodeStatus::LEFT && curr_status.status != NodeStatus::LEFT) {
             // we didn't know that node left
             mem_list.removeNode(update.node_id, true);
-            ring.removeNode(update.node_id);  // MP3: Remove from ring
+            removeFromRing(update.node_id);  // MP3: Remove from ring
             updates.push_back(update);  // want to gossip this info to other nodes
           } else if ((curr_status.status == NodeStatus::SUSPECT ||
                       curr_status.status == NodeStatus::DEAD) &&
@@ -460,7 +554,7 @@ std::vector<MembershipInfo> Node::handleGossip(const Message& message) {
     } catch (std::runtime_error const&) {
       // case 1: new node --> add to mem_list
       mem_list.addNode(update);
-      ring.addNode(update.node_id);  // MP3: Add new node to ring
+      addToRing(update.node_id);  // MP3: Add new node to ring
     }
   }
   return updates;
@@ -0,0 +1,105 @@
+#include "re_replicator.hpp"
+
+#include <iostream>
+#include <utility>
+
+// Attempts per transfer before it counts as failed
+static constexpr int TRANSFER_ATTEMPTS = 3;
+
+static std::string transferKey(const std::string& filename, const NodeId& target) {
+  return filename + "@" + target.host + ":" + target.port;
+}
+
+ReReplicator::ReReplicator(FileStore& file_store, const ConsistentHashRing& hash_ring,
+                           const NodeId& self_id, TransferFn transfer, size_t max_parallel,
+                           int replication_factor)
+    : file_store_(file_store),
+      hash_ring_(hash_ring),
+      self_id_(self_id),
+      transfer_(std::move(transfer)),
+      replication_factor_(replication_factor),
+      executor_(max_parallel) {}
+
+std::vector<std::pair<std::string, NodeId>> ReReplicator::planTransfers(
+    const NodeId& removed) const {
+  std::vector<std::pair<std::string, NodeId>> plan;
+  uint64_t removed_position = hash_ring_.getNodePosition(removed);
+  size_t factor = static_cast<size_t>(replication_factor_);
+
+  for (const auto& filename : file_store_.listFiles()) {
+    std::vector<NodeId> replicas = hash_ring_.getFileReplicas(filename, replication_factor_);
+    if (replicas.size() < factor || !(replicas[0] == self_id_)) {
+      continue;  // no new replica to fill, or another survivor sends this file
+    }
+
+    // The removed node was a replica iff it sat clockwise before the last current
+    // replica, which then moved into the replica set and lacks the file
+    uint64_t file_position = hash_ring_.getFilePosition(filename);
+    uint64_t removed_distance = removed_position - file_position;
+    uint64_t last_distance = hash_ring_.getNodePosition(replicas.back()) - file_position;
+    if (removed_distance < last_distance) {
+      plan.emplace_back(filename, replicas.back());
+    }
+  }
+  return plan;
+}
+
+size_t ReReplicator::onNodeRemoved(const NodeId& removed) {
+  size_t queued = 0;
+  for (const auto& [filename, target] : planTransfers(removed)) {
+    {
+      std::lock_guard<std::mutex> lock(in_flight_mtx_);
+      if (!in_flight_.insert(transferKey(filename, target)).second) {
+        continue;
+      }
+    }
+    pending_++;
+    if (!executor_.submit([this, filename, target] { runTransfer(filename, target); })) {
+      pending_--;
+      std::lock_guard<std::mutex> lock(in_flight_mtx_);
+      in_flight_.erase(transferKey(filename, target));
+      continue;
+    }
+    queued++;
+  }
+
+  if (queued > 0) {
+    std::cout << "[REREPLICATE] Node " << removed.host << ":" << removed.port << " left: "
+              << queued << " files queued for new replicas" << std::endl;
+  }
+  return queued;
+}
+
+ReReplicator::Progress ReReplicator::progress() const {
+  Progress progress;
+  progress.pending = pending_;
+  progress.completed = completed_;
+  progress.failed = failed_;
+  return progress;
+}
+
+void ReReplicator::runTransfer(const std::string& filename, const NodeId& target) {
+  bool sent = false;
+  for (int attempt = 0; attempt < TRANSFER_ATTEMPTS && !sent; attempt++) {
+    // The file may have been deleted, or the target may have left too
+    if (!file_store_.hasFile(filename) || !hash_ring_.hasNode(target)) {
+      break;
+    }
+    sent = transfer_(filename, target);
+  }
+
+  if (sent) {
+    completed_++;
+  } else {
+    failed_++;
+  }
+  pending_--;
+  {
+    std::lock_guard<std::mutex> lock(in_flight_mtx_);
+    in_flight_.erase(transferKey(filename, target));
+  }
+  if (!sent) {
+    std::cout << "[REREPLICATE] Could not copy " << filename << " to " << target.host << ":"
+              << target.port << std::endl;
+  }
+}
@@ -0,0 +1,74 @@
+#include "read_cache.hpp"
+
+#include <iterator>
+#include <utility>
+
+// Invalidation times older than this can't affect a read still in flight
+static constexpr std::chrono::seconds INVALIDATION_MEMORY(30);
+
+ReadCache::ReadCache(size_t capacity_bytes) : capacity_(capacity_bytes) {}
+
+bool ReadCache::get(FileId file_id, Entry& entry, std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = slots_.find(file_id);
+  if (it == slots_.end() || it->second.entry.lease_expiry <= now) {
+    if (it != slots_.end()) erase(file_id);
+    stats_.misses++;
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second.lru);
+  entry = it->second.entry;
+  stats_.hits++;
+  return true;
+}
+
+bool ReadCache::put(FileId file_id, Entry entry, std::chrono::steady_clock::time_point issued_at) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto invalidated = invalidated_at_.find(file_id);
+  if (invalidated != invalidated_at_.end() && invalidated->second >= issued_at) {
+    return false;
+  }
+  if (entry.data.size() > capacity_) {
+    return false;
+  }
+
+  erase(file_id);
+  bytes_ += entry.data.size();
+  lru_.push_front(file_id);
+  slots_.emplace(file_id, Slot{std::move(entry), lru_.begin()});
+  while (bytes_ > capacity_) {
+    erase(lru_.back());
+  }
+  return true;
+}
+
+void ReadCache::invalidate(FileId file_id) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto now = std::chrono::steady_clock::now();
+  for (auto it = invalidated_at_.begin(); it != invalidated_at_.end();) {
+    it = now - it->second > INVALIDATION_MEMORY ? invalidated_at_.erase(it) : std::next(it);
+  }
+  invalidated_at_[file_id] = now;
+  if (slots_.count(file_id)) {
+    erase(file_id);
+    stats_.invalidations++;
+  }
+}
+
+ReadCache::Stats ReadCache::stats() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  Stats stats = stats_;
+  stats.entries = slots_.size();
+  stats.bytes = bytes_;
+  return stats;
+}
+
+void ReadCache::erase(FileId file_id) {
+  auto it = slots_.find(file_id);
+  if (it == slots_.end()) {
+    return;
+  }
+  bytes_ -= it->second.entry.data.size();
+  lru_.erase(it->second.lru);
+  slots_.erase(it);
+}
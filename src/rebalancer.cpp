@@ -0,0 +1,108 @@
+#include "rebalancer.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+// Attempts per file before the move counts as failed
+static constexpr int MOVE_ATTEMPTS = 3;
+
+Rebalancer::Rebalancer(FileStore& file_store, const ConsistentHashRing& hash_ring,
+                       const NodeId& self_id, TransferFn transfer, DropFn drop,
+                       uint64_t bytes_per_sec, int replication_factor)
+    : file_store_(file_store),
+      hash_ring_(hash_ring),
+      self_id_(self_id),
+      transfer_(std::move(transfer)),
+      drop_(std::move(drop)),
+      replication_factor_(replication_factor),
+      throttle_(std::make_shared<BandwidthThrottle>(bytes_per_sec)) {}
+
+Rebalancer::~Rebalancer() {
+  throttle_->stop();
+  executor_.shutdown();  // queued moves see the stopped throttle and return at once
+}
+
+std::vector<Rebalancer::Move> Rebalancer::planMoves(const NodeId& added) const {
+  std::vector<Move> moves;
+  size_t factor = static_cast<size_t>(replication_factor_);
+
+  for (const auto& filename : file_store_.listFiles()) {
+    // One node past the replica set: with `added` in the set, it is the one pushed out
+    std::vector<NodeId> replicas = hash_ring_.getFileReplicas(filename, replication_factor_ + 1);
+    size_t added_at = factor;
+    for (size_t i = 0; i < std::min(factor, replicas.size()); i++) {
+      if (replicas[i] == added) added_at = i;
+    }
+    if (added_at == factor || replicas.size() < 2) {
+      continue;  // the file's replica set didn't change
+    }
+
+    // The first old replica sends, so exactly one node moves each file
+    const NodeId& source = added_at == 0 ? replicas[1] : replicas[0];
+    if (!(source == self_id_)) {
+      continue;
+    }
+
+    Move move;
+    move.filename = filename;
+    move.target = added;
+    move.displaced_valid = replicas.size() > factor;
+    move.displaced = move.displaced_valid ? replicas[factor] : NodeId{};
+    FileStat stat;
+    move.bytes = file_store_.statFile(filename, stat) ? stat.total_size : 0;
+    moves.push_back(std::move(move));
+  }
+  return moves;
+}
+
+size_t Rebalancer::onNodeAdded(const NodeId& added) {
+  std::vector<Move> moves = planMoves(added);
+  size_t queued = 0;
+  for (auto& move : moves) {
+    pending_++;
+    if (!executor_.submit([this, move] { runMove(move); })) {
+      pending_--;
+      continue;
+    }
+    queued++;
+  }
+
+  if (queued > 0) {
+    std::cout << "[REBALANCE] Node " << added.host << ":" << added.port << " joined: " << queued
+              << " files queued to move" << std::endl;
+  }
+  return queued;
+}
+
+Rebalancer::Progress Rebalancer::progress() const {
+  Progress progress;
+  progress.pending = pending_;
+  progress.moved = moved_;
+  progress.failed = failed_;
+  progress.bytes_moved = bytes_moved_;
+  return progress;
+}
+
+void Rebalancer::runMove(const Move& move) {
+  bool sent = false;
+  for (int attempt = 0; attempt < MOVE_ATTEMPTS && !sent; attempt++) {
+    // The file may be gone, or the ring may have moved on since the plan
+    if (throttle_->stopped() || !file_store_.hasFile(move.filename) ||
+        !hash_ring_.hasNode(move.target)) {
+      break;
+    }
+    sent = transfer_(move.filename, move.target);
+  }
+
+  if (sent) {
+    moved_++;
+    bytes_moved_ += move.bytes;
+    if (move.displaced_valid) {
+      drop_(move.filename, move.displaced);
+    }
+  } else {
+    failed_++;
+  }
+  pending_--;
+}
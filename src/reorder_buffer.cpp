@@ -0,0 +1,153 @@
+#include "reorder_buffer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+ReorderBuffer::ReorderBuffer(std::chrono::milliseconds gap_retry,
+                             std::chrono::milliseconds max_hold, size_t max_held)
+    : gap_retry_(gap_retry), max_hold_(max_hold), max_held_(max_held) {}
+
+std::vector<ReorderBuffer::Batch> ReorderBuffer::offer(Batch batch) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::vector<Batch> released;
+  track(batch.msg);
+  if (ready(batch.msg)) {
+    advance(batch);
+    released.push_back(std::move(batch));
+  } else {
+    held_.push_back({std::move(batch), std::chrono::steady_clock::now()});
+    if (held_.size() > max_held_) {
+      // Out of room: the oldest batch goes out with its gap still open
+      advance(held_.front().batch);
+      released.push_back(std::move(held_.front().batch));
+      held_.pop_front();
+      skipped_++;
+    }
+  }
+  releaseExpired(released);
+  drain(released);
+  return released;
+}
+
+std::vector<ReorderBuffer::Batch> ReorderBuffer::releaseStale() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::vector<Batch> released;
+  releaseExpired(released);
+  drain(released);
+  return released;
+}
+
+std::vector<ReorderBuffer::Gap> ReorderBuffer::gaps() {
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  // Each file's gap runs from its next LSN to the earliest LSN held for it
+  std::unordered_map<std::string, Gap> open;
+  for (const auto& held : held_) {
+    const ReplicateBlocksMessage& msg = held.batch.msg;
+    for (const auto& file : msg.files) {
+      auto stream = streams_.find(file.hydfs_filename);
+      if (file.lsn == 0 || stream == streams_.end() || !(stream->second.head == msg.head) ||
+          file.lsn <= stream->second.next_lsn) {
+        continue;
+      }
+      auto it = open.find(file.hydfs_filename);
+      if (it == open.end()) {
+        open[file.hydfs_filename] =
+            Gap{msg.head, file.hydfs_filename, stream->second.next_lsn, file.lsn};
+      } else {
+        it->second.to_lsn = std::min(it->second.to_lsn, file.lsn);
+      }
+    }
+  }
+
+  std::vector<Gap> due;
+  auto now = std::chrono::steady_clock::now();
+  for (auto& [filename, gap] : open) {
+    Stream& stream = streams_[filename];
+    if (now - stream.last_request >= gap_retry_) {
+      stream.last_request = now;
+      due.push_back(std::move(gap));
+    }
+  }
+  return due;
+}
+
+ReorderBuffer::Stats ReorderBuffer::stats() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  Stats stats;
+  stats.held = held_.size();
+  stats.reordered = reordered_;
+  stats.skipped = skipped_;
+  return stats;
+}
+
+void ReorderBuffer::track(const ReplicateBlocksMessage& msg) {
+  for (const auto& file : msg.files) {
+    if (file.lsn == 0) {
+      continue;
+    }
+    Stream& stream = streams_[file.hydfs_filename];
+    if (!(stream.head == msg.head)) {
+      stream = Stream{msg.head, 1, {}};  // a new head numbers the file from 1
+    }
+  }
+}
+
+bool ReorderBuffer::ready(const ReplicateBlocksMessage& msg) const {
+  for (const auto& file : msg.files) {
+    if (file.lsn == 0 || file.blocks.empty()) {
+      continue;  // unsequenced, or the head skipping a range it no longer has
+    }
+    auto stream = streams_.find(file.hydfs_filename);
+    if (stream != streams_.end() && stream->second.head == msg.head &&
+        file.lsn > stream->second.next_lsn) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ReorderBuffer::advance(Batch& batch) {
+  const ReplicateBlocksMessage& msg = batch.msg;
+  batch.delivered.assign(msg.files.size(), 0);
+  for (size_t i = 0; i < msg.files.size(); i++) {
+    const ReplicatedFile& file = msg.files[i];
+    auto stream = streams_.find(file.hydfs_filename);
+    if (file.lsn == 0 || stream == streams_.end() || !(stream->second.head == msg.head)) {
+      continue;
+    }
+    if (file.lsn < stream->second.next_lsn) {
+      batch.delivered[i] = std::min<size_t>(stream->second.next_lsn - file.lsn, file.blocks.size());
+    }
+    stream->second.next_lsn =
+        std::max(stream->second.next_lsn, file.lsn + file.blocks.size());
+  }
+}
+
+void ReorderBuffer::drain(std::vector<Batch>& released) {
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (auto it = held_.begin(); it != held_.end();) {
+      if (!ready(it->batch.msg)) {
+        ++it;
+        continue;
+      }
+      advance(it->batch);
+      released.push_back(std::move(it->batch));
+      it = held_.erase(it);
+      reordered_++;
+      progress = true;
+    }
+  }
+}
+
+void ReorderBuffer::releaseExpired(std::vector<Batch>& released) {
+  auto now = std::chrono::steady_clock::now();
+  while (!held_.empty() && now - held_.front().arrived >= max_hold_) {
+    advance(held_.front().batch);
+    released.push_back(std::move(held_.front().batch));
+    held_.pop_front();
+    skipped_++;
+  }
+}
@@ -0,0 +1,79 @@
+#include "replica_selector.hpp"
+
+#include <algorithm>
+
+ReplicaSelector::ReplicaSelector(double alpha, std::chrono::microseconds initial_rtt)
+    : alpha_(alpha), initial_rtt_us_(static_cast<double>(initial_rtt.count())) {}
+
+void ReplicaSelector::onSend(const NodeId& peer) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  peers_[peer].outstanding++;
+}
+
+void ReplicaSelector::onReply(const NodeId& peer, std::chrono::microseconds rtt) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  PeerStats& stats = peers_[peer];
+  if (stats.outstanding > 0) stats.outstanding--;
+  sample(stats, rtt);
+}
+
+void ReplicaSelector::onTimeout(const NodeId& peer, std::chrono::microseconds waited) {
+  // The wait is a lower bound on the RTT, which is enough to steer reads away
+  onReply(peer, waited);
+}
+
+void ReplicaSelector::onCancel(const NodeId& peer) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = peers_.find(peer);
+  if (it != peers_.end() && it->second.outstanding > 0) it->second.outstanding--;
+}
+
+void ReplicaSelector::observeRtt(const NodeId& peer, std::chrono::microseconds rtt) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  sample(peers_[peer], rtt);
+}
+
+double ReplicaSelector::expectedLatency(const NodeId& peer) const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return expected(peer);
+}
+
+std::vector<NodeId> ReplicaSelector::order(const std::vector<NodeId>& candidates) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::vector<NodeId> ordered = candidates;
+  if (ordered.size() < 2) {
+    return ordered;
+  }
+
+  // Two distinct random candidates; the faster one goes first
+  std::uniform_int_distribution<size_t> pick(0, ordered.size() - 1);
+  size_t a = pick(rng_);
+  size_t b = pick(rng_);
+  while (b == a) b = pick(rng_);
+  size_t winner = expected(ordered[b]) < expected(ordered[a]) ? b : a;
+  std::swap(ordered[0], ordered[winner]);
+
+  std::stable_sort(ordered.begin() + 1, ordered.end(), [this](const NodeId& x, const NodeId& y) {
+    return expected(x) < expected(y);
+  });
+  return ordered;
+}
+
+void ReplicaSelector::forget(const NodeId& peer) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  peers_.erase(peer);
+}
+
+void ReplicaSelector::sample(PeerStats& stats, std::chrono::microseconds rtt) {
+  double us = static_cast<double>(rtt.count());
+  stats.rtt_us = stats.rtt_us == 0 ? us : alpha_ * us + (1 - alpha_) * stats.rtt_us;
+}
+
+double ReplicaSelector::expected(const NodeId& peer) const {
+  auto it = peers_.find(peer);
+  if (it == peers_.end()) {
+    return initial_rtt_us_;
+  }
+  double rtt = it->second.rtt_us == 0 ? initial_rtt_us_ : it->second.rtt_us;
+  return rtt * (it->second.outstanding + 1);
+}
@@ -0,0 +1,68 @@
+#include "retention_reaper.hpp"
+
+#include <iostream>
+#include <utility>
+
+RetentionReaper::RetentionReaper(FileStore& file_store, TruncateCallback on_truncate,
+                                 std::chrono::milliseconds interval)
+    : file_store_(file_store), on_truncate_(std::move(on_truncate)), interval_(interval) {}
+
+RetentionReaper::~RetentionReaper() { stop(); }
+
+void RetentionReaper::start() {
+  if (running_.exchange(true)) {
+    return;  // Already running
+  }
+  thread_ = std::thread(&RetentionReaper::run, this);
+}
+
+void RetentionReaper::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!running_.exchange(false)) {
+      return;
+    }
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+size_t RetentionReaper::runOnce() {
+  if (file_store_.listRetentionPolicies().empty()) {
+    return 0;  // Nothing to enforce
+  }
+
+  uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+  size_t dropped = 0;
+  for (const auto& filename : file_store_.listFiles()) {
+    uint64_t cut_timestamp = 0;
+    size_t count = file_store_.applyRetention(filename, now, cut_timestamp);
+    if (count > 0) {
+      dropped += count;
+      if (on_truncate_) {
+        on_truncate_(filename, cut_timestamp);
+      }
+    }
+  }
+  file_store_.collectGarbage();  // release dropped blocks once readers let go
+  return dropped;
+}
+
+void RetentionReaper::run() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (running_) {
+    cv_.wait_for(lock, interval_, [this] { return !running_; });
+    if (!running_) break;
+
+    lock.unlock();
+    size_t dropped = runOnce();
+    if (dropped > 0) {
+      std::cout << "[REAPER] Dropped " << dropped << " expired blocks" << std::endl;
+    }
+    lock.lock();
+  }
+}
@@ -0,0 +1,60 @@
+#include "task_executor.hpp"
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+TaskExecutor::TaskExecutor(size_t worker_count) {
+  for (size_t i = 0; i < worker_count; i++) {
+    workers_.emplace_back(&TaskExecutor::workerLoop, this);
+  }
+}
+
+TaskExecutor::~TaskExecutor() { shutdown(); }
+
+bool TaskExecutor::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (stopping_) {
+      return false;
+    }
+    tasks_.push_back(std::move(task));
+  }
+  cv_.notify_one();
+  return true;
+}
+
+void TaskExecutor::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  workers_.clear();
+}
+
+void TaskExecutor::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;  // Stopping and drained
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+
+    try {
+      task();
+    } catch (const std::exception& e) {
+      std::cout << "[EXECUTOR] Task failed: " << e.what() << std::endl;
+    }
+  }
+}
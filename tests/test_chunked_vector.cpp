@@ -0,0 +1,135 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "chunked_vector.hpp"
+
+TEST_CASE("ChunkedVector push, index and iterate across trie levels") {
+  ChunkedVector<uint64_t> vec;
+  REQUIRE(vec.empty());
+  REQUIRE(vec.begin() == vec.end());
+
+  // Enough elements for a three-level trie plus a partial tail
+  const uint64_t count = 40000;
+  for (uint64_t i = 0; i < count; ++i) {
+    vec.push_back(i * 3);
+  }
+
+  REQUIRE(vec.size() == count);
+  REQUIRE(vec.back() == (count - 1) * 3);
+  for (uint64_t i = 0; i < count; i += 97) {
+    REQUIRE(vec[i] == i * 3);
+  }
+
+  uint64_t expected = 0;
+  for (uint64_t value : vec) {
+    REQUIRE(value == expected * 3);
+    ++expected;
+  }
+  REQUIRE(expected == count);
+
+  auto it = vec.iteratorAt(count - 2);
+  REQUIRE(*it == (count - 2) * 3);
+  REQUIRE(++it != vec.end());
+  REQUIRE(++it == vec.end());
+
+  std::vector<uint64_t> flat = vec.toVector();
+  REQUIRE(flat.size() == count);
+  REQUIRE(ChunkedVector<uint64_t>(flat) == vec);
+
+  vec.clear();
+  REQUIRE(vec.empty());
+  vec.push_back(7);
+  REQUIRE(vec[0] == 7);
+}
+
+TEST_CASE("ChunkedVector copies are independent snapshots") {
+  ChunkedVector<int> base;
+  for (int i = 0; i < 1000; ++i) {
+    base.push_back(i);
+  }
+
+  ChunkedVector<int> copy = base;
+  for (int i = 1000; i < 2000; ++i) {
+    copy.push_back(i);
+  }
+  ChunkedVector<int> other = base;
+  other.push_back(-1);
+
+  REQUIRE(base.size() == 1000);
+  REQUIRE(copy.size() == 2000);
+  REQUIRE(other.size() == 1001);
+  REQUIRE(base.back() == 999);
+  REQUIRE(other.back() == -1);
+  REQUIRE(copy[1000] == 1000);
+  REQUIRE(copy != base);
+}
+
+TEST_CASE("ChunkedVector visits chunks in both directions") {
+  ChunkedVector<int> vec;
+  for (int i = 0; i < 100; ++i) {
+    vec.push_back(i);
+  }
+
+  std::vector<int> forward;
+  vec.forEachChunk([&](const int* values, size_t count) {
+    REQUIRE(count <= ChunkedVector<int>::kWidth);
+    forward.insert(forward.end(), values, values + count);
+  });
+  REQUIRE(forward == vec.toVector());
+
+  // Reverse visits the partial tail first and can stop early
+  std::vector<size_t> sizes;
+  vec.forEachChunkReverse([&](const int* values, size_t count) {
+    sizes.push_back(count);
+    return values[0] != 32;
+  });
+  REQUIRE(sizes == std::vector<size_t>{4, 32, 32});
+}
+
+TEST_CASE("ChunkedVector drops a prefix and keeps appending") {
+  ChunkedVector<uint64_t> vec;
+  for (uint64_t i = 0; i < 5000; ++i) {
+    vec.push_back(i);
+  }
+  ChunkedVector<uint64_t> snapshot = vec;
+
+  vec.dropFront(1234);
+  REQUIRE(vec.size() == 3766);
+  REQUIRE(vec[0] == 1234);
+  REQUIRE(*vec.begin() == 1234);
+  REQUIRE(vec.back() == 4999);
+
+  for (uint64_t i = 5000; i < 6000; ++i) {
+    vec.push_back(i);
+  }
+  vec.dropFront(2000);
+  REQUIRE(vec.size() == 2766);
+  for (size_t i = 0; i < vec.size(); i += 7) {
+    REQUIRE(vec[i] == 3234 + i);
+  }
+
+  std::vector<uint64_t> forward;
+  vec.forEachChunk([&](const uint64_t* values, size_t count) {
+    forward.insert(forward.end(), values, values + count);
+  });
+  REQUIRE(forward.size() == vec.size());
+  REQUIRE(forward.front() == 3234);
+
+  size_t reversed = 0;
+  vec.forEachChunkReverse([&](const uint64_t*, size_t count) {
+    reversed += count;
+    return true;
+  });
+  REQUIRE(reversed == vec.size());
+
+  // Copies taken before the drop still see every element
+  REQUIRE(snapshot.size() == 5000);
+  REQUIRE(snapshot[0] == 0);
+  REQUIRE(snapshot[1234] == 1234);
+
+  vec.dropFront(vec.size());
+  REQUIRE(vec.empty());
+  vec.push_back(1);
+  REQUIRE(vec.size() == 1);
+}
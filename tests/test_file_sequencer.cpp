@@ -0,0 +1,77 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "file_sequencer.hpp"
+
+static void waitForTasks(const FileSequencer& sequencer, size_t count) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (sequencer.stats().tasks < count && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+TEST_CASE("File sequencer runs a file's tasks in order and other files alongside") {
+  TaskExecutor executor(4);
+  FileSequencer sequencer(executor, 4, 8);
+
+  // Ordering holds across the budget, which hands the file back to the executor
+  std::vector<std::vector<int>> order(3);
+  std::mutex order_mtx;
+  for (int i = 0; i < 100; i++) {
+    for (FileId file_id = 0; file_id < 3; file_id++) {
+      sequencer.post(file_id, [&, file_id, i] {
+        std::lock_guard<std::mutex> lock(order_mtx);
+        order[file_id].push_back(i);
+      });
+    }
+  }
+  waitForTasks(sequencer, 300);
+  for (const auto& file_order : order) {
+    REQUIRE(file_order.size() == 100);
+    for (int i = 0; i < 100; i++) REQUIRE(file_order[i] == i);
+  }
+
+  // A blocked file doesn't hold up another
+  std::atomic<bool> release{false};
+  std::atomic<bool> other_ran{false};
+  sequencer.post(1, [&] {
+    while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  sequencer.post(2, [&] { other_ran = true; });
+  waitForTasks(sequencer, 301);
+  REQUIRE(other_ran);
+  release = true;
+  waitForTasks(sequencer, 302);
+
+  auto stats = sequencer.stats();
+  REQUIRE(stats.files == 0);  // drained mailboxes are dropped
+  REQUIRE(stats.queued == 0);
+  REQUIRE(stats.tasks == 302);
+  executor.shutdown();  // stop the workers before the sequencer they drain goes away
+}
+
+TEST_CASE("File sequencer hands out sequence numbers per file and runs tasks after shutdown") {
+  TaskExecutor executor(2);
+  FileSequencer sequencer(executor);
+  REQUIRE(sequencer.nextSequence(7) == 0);
+  REQUIRE(sequencer.nextSequence(7) == 1);
+  REQUIRE(sequencer.nextSequence(8) == 0);
+
+  // Numbering survives the file's mailbox running dry
+  std::atomic<bool> ran_on_worker{false};
+  sequencer.post(7, [&] { ran_on_worker = true; });
+  waitForTasks(sequencer, 1);
+  REQUIRE(ran_on_worker);
+  REQUIRE(sequencer.stats().files == 0);
+  REQUIRE(sequencer.nextSequence(7) == 2);
+
+  executor.shutdown();
+  bool ran = false;
+  sequencer.post(7, [&] { ran = true; });
+  REQUIRE(ran);
+  REQUIRE(sequencer.nextSequence(7) == 3);
+}
@@ -0,0 +1,752 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "client_tracker.hpp"
+#include "file_store.hpp"
+#include "merge_plan.hpp"
+
+static FileBlock makeBlock(const std::string& client_id, uint32_t sequence_num, uint64_t timestamp,
+                           const std::string& payload) {
+  FileBlock block;
+  block.client_id = client_id;
+  block.sequence_num = sequence_num;
+  block.timestamp = timestamp;
+  block.data.assign(payload.begin(), payload.end());
+  block.size = block.data.size();
+  block.block_id = FileBlock::generateBlockId(client_id, timestamp, sequence_num);
+  return block;
+}
+
+TEST_CASE("FileStore compaction folds small blocks and keeps provenance") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("log.txt", {'h', 'i'}, "creator"));
+
+  std::string expected = "hi";
+  std::vector<FileBlock> appended;
+  for (uint32_t seq = 1; seq <= 20; ++seq) {
+    std::string payload = "line" + std::to_string(seq) + "\n";
+    FileBlock block = makeBlock(seq <= 10 ? "alice" : "bob", seq, 1000 + seq, payload);
+    REQUIRE(store.appendBlock("log.txt", block));
+    appended.push_back(block);
+    expected += payload;
+  }
+
+  CompactionPolicy policy;
+  policy.min_age_ms = 0;
+  size_t folded = store.compactFile("log.txt", policy);
+  REQUIRE(folded > 0);
+
+  std::vector<char> data = store.getFile("log.txt");
+  REQUIRE(std::string(data.begin(), data.end()) == expected);
+  REQUIRE(store.getFileMetadata("log.txt").block_ids.size() < 21);
+
+  // Runs of one client collapse into a single range
+  std::vector<BlockRange> ranges = store.getCompactedRanges("log.txt");
+  REQUIRE(ranges.size() == 3);  // creator, alice 1-10, bob 11-20
+  REQUIRE(ranges[1].client_id == "alice");
+  REQUIRE(ranges[1].first_sequence == 1);
+  REQUIRE(ranges[1].last_sequence == 10);
+
+  // Read-my-writes still recognizes appends that were folded away
+  ClientTracker tracker;
+  FileId file_id = store.fileNames().intern("log.txt");
+  for (const auto& block : appended) {
+    tracker.recordAppend(block.client_id, file_id, block.block_id, block.sequence_num);
+  }
+  FileMetadata meta = store.getFileMetadata("log.txt");
+  REQUIRE(tracker.satisfiesReadMyWrites("alice", file_id, meta.block_ids, ranges));
+  REQUIRE_FALSE(tracker.satisfiesReadMyWrites("alice", file_id, meta.block_ids));
+}
+
+TEST_CASE("Compacted extent survives serialization") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("f", {}, "c"));
+  for (uint32_t seq = 0; seq < 8; ++seq) {
+    REQUIRE(store.appendBlock("f", makeBlock("c", seq, 10 + seq, "abc")));
+  }
+  CompactionPolicy policy;
+  policy.min_age_ms = 0;
+  REQUIRE(store.compactFile("f", policy) == 7);
+
+  std::vector<FileBlock> blocks = store.getFileBlocks("f");
+  REQUIRE(blocks.size() == 1);
+  REQUIRE(blocks[0].isExtent());
+
+  std::vector<char> buffer(blocks[0].serializedSize());
+  REQUIRE(blocks[0].serialize(buffer.data(), buffer.size()) == buffer.size());
+  FileBlock copy = FileBlock::deserialize(buffer.data(), buffer.size());
+  REQUIRE(copy.block_id == blocks[0].block_id);
+  REQUIRE(copy.data == blocks[0].data);
+  REQUIRE(copy.ranges.size() == 1);
+  REQUIRE(copy.ranges[0].last_sequence == 7);
+  REQUIRE(copy.ranges[0].length == 24);
+}
+
+TEST_CASE("FileStore readers keep a pinned version across appends and merges") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("mvcc.txt", {'a'}, "creator"));
+
+  FileSnapshot pinned = store.pinFile("mvcc.txt");
+  REQUIRE(pinned);
+  REQUIRE(pinned->metadata.version == 1);
+
+  REQUIRE(store.appendBlock("mvcc.txt", makeBlock("alice", 1, 2000, "b")));
+  std::vector<FileBlock> merged = {makeBlock("bob", 1, 3000, "xyz")};
+  REQUIRE(store.mergeFile("mvcc.txt", merged));
+
+  // The pinned snapshot is untouched by later writers
+  std::vector<char> old_data = pinned->assemble();
+  REQUIRE(std::string(old_data.begin(), old_data.end()) == "a");
+
+  std::vector<char> current = store.getFile("mvcc.txt");
+  REQUIRE(std::string(current.begin(), current.end()) == "xyz");
+  REQUIRE(store.getFileMetadata("mvcc.txt").version == 3);
+
+  // Version 1 is still readable while pinned; version 2 was never pinned
+  std::vector<char> data;
+  REQUIRE(store.getFileAtVersion("mvcc.txt", 1, data));
+  REQUIRE(std::string(data.begin(), data.end()) == "a");
+  REQUIRE_FALSE(store.getFileAtVersion("mvcc.txt", 2, data));
+  REQUIRE(store.getFileAtVersion("mvcc.txt", 3, data));
+
+  // Once released, the old version is garbage-collected
+  pinned.reset();
+  REQUIRE(store.collectGarbage() >= 1);
+  REQUIRE_FALSE(store.getFileAtVersion("mvcc.txt", 1, data));
+}
+
+TEST_CASE("FileStore image round-trips and rejects corruption") {
+  const std::string image_path = "./test_store_image.img";
+
+  FileStore store("./test_storage");
+  for (int i = 0; i < 200; ++i) {
+    std::string name = "file" + std::to_string(i);
+    REQUIRE(store.createFile(name, {'x'}, "creator"));
+    REQUIRE(store.appendBlock(name, makeBlock("alice", 1, 1000 + i, "payload" + std::to_string(i))));
+  }
+  REQUIRE(store.saveImage(image_path));
+
+  FileStore restored("./test_storage_restored");
+  REQUIRE(restored.createFile("stale.txt", {'s'}, "creator"));
+  REQUIRE(restored.loadImage(image_path));
+  REQUIRE_FALSE(restored.hasFile("stale.txt"));
+  REQUIRE(restored.listFiles().size() == 200);
+  for (int i = 0; i < 200; i += 37) {
+    std::string name = "file" + std::to_string(i);
+    REQUIRE(restored.getFile(name) == store.getFile(name));
+    REQUIRE(restored.getFileMetadata(name).version == store.getFileMetadata(name).version);
+    REQUIRE(restored.getFileMetadata(name).block_ids == store.getFileMetadata(name).block_ids);
+  }
+
+  // Flip one byte in the body; the checksum must catch it
+  {
+    std::fstream image(image_path, std::ios::in | std::ios::out | std::ios::binary);
+    image.seekg(-1, std::ios::end);
+    char last = 0;
+    image.read(&last, 1);
+    image.seekp(-1, std::ios::end);
+    last ^= 0x5a;
+    image.write(&last, 1);
+  }
+  REQUIRE_FALSE(restored.loadImage(image_path));
+  REQUIRE(restored.listFiles().size() == 200);
+
+  std::remove(image_path.c_str());
+}
+
+TEST_CASE("FileStore stat reports size and version without the block list") {
+  FileStore store("./test_storage");
+  FileStat stat;
+  REQUIRE_FALSE(store.statFile("missing.txt", stat));
+
+  REQUIRE(store.createFile("stat.txt", {'a', 'b'}, "creator"));
+  REQUIRE(store.appendBlock("stat.txt", makeBlock("alice", 1, 1000, "cde")));
+  REQUIRE(store.statFile("stat.txt", stat));
+  REQUIRE(stat.file_id == FileMetadata::generateFileId("stat.txt"));
+  REQUIRE(stat.total_size == 5);
+  REQUIRE(stat.version == 2);
+  REQUIRE(stat.block_count == 2);
+
+  // Handles resolve to the same file as the name
+  FileId file_id = 0;
+  REQUIRE(store.fileNames().find("stat.txt", file_id));
+  FileStat by_id;
+  REQUIRE(store.statFile(file_id, by_id));
+  REQUIRE(by_id.version == stat.version);
+  REQUIRE(store.appendBlock(file_id, makeBlock("alice", 2, 1001, "f")));
+  REQUIRE(store.pinFile("stat.txt")->stat().total_size == 6);
+
+  REQUIRE(store.createFile("other.txt", {}, "creator"));
+  auto stats = store.listFileStats();
+  REQUIRE(stats.size() == 2);
+  for (const auto& [filename, file_stat] : stats) {
+    REQUIRE(file_stat.version == store.pinFile(filename)->stat().version);
+  }
+}
+
+TEST_CASE("FileStore appends a group of blocks as one version") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("group.txt", {'>'}, "creator"));
+  FileId file_id = store.fileNames().intern("group.txt");
+  FileSnapshot before = store.pinFile(file_id);
+
+  std::vector<FileBlock> group = {makeBlock("alice", 1, 1000, "ab"),
+                                  makeBlock("bob", 1, 1001, std::string(5000, 'x')),
+                                  makeBlock("alice", 2, 1002, "c")};
+  REQUIRE(store.appendBlocks(file_id, group));
+
+  FileSnapshot after = store.pinFile(file_id);
+  REQUIRE(after->metadata.version == before->metadata.version + 1);
+  REQUIRE(after->metadata.total_size == 1 + 2 + 5000 + 1);
+  REQUIRE(after->metadata.block_ids.size() == 4);
+  std::vector<char> data = store.getFile("group.txt");
+  REQUIRE(std::string(data.begin(), data.begin() + 3) == ">ab");
+  REQUIRE(data.back() == 'c');
+  size_t position = 0;
+  REQUIRE(after->findBlock(group[1].block_id, position));
+  REQUIRE(position == 2);
+
+  // The pinned older version still sees the file as it was
+  REQUIRE(before->metadata.block_ids.size() == 1);
+  REQUIRE_FALSE(store.appendBlocks(store.fileNames().intern("missing.txt"), group));
+}
+
+TEST_CASE("FileStore packs small appends inline") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("tiny.txt", {'>'}, "creator"));
+
+  std::string expected = ">";
+  std::string big(FileVersion::INLINE_MAX_BYTES + 1, 'B');
+  for (uint32_t seq = 1; seq <= 300; ++seq) {
+    std::string payload = (seq == 150) ? big : "entry" + std::to_string(seq) + "\n";
+    const char* client = seq % 2 ? "alice" : "bob";
+    REQUIRE(store.appendBlock("tiny.txt", makeBlock(client, seq, 1000 + seq, payload)));
+    expected += payload;
+  }
+
+  FileSnapshot snapshot = store.pinFile("tiny.txt");
+  REQUIRE(snapshot->blockCount() == 301);
+  REQUIRE(snapshot->blocks.size() == 1);  // only the oversized append stands alone
+  REQUIRE(snapshot->inline_blocks.size() == 300);
+  REQUIRE(snapshot->clients->size() == 3);
+
+  std::vector<char> data = store.getFile("tiny.txt");
+  REQUIRE(std::string(data.begin(), data.end()) == expected);
+
+  std::vector<FileBlock> blocks = store.getFileBlocks("tiny.txt");
+  REQUIRE(blocks[150].size == big.size());
+  REQUIRE(blocks[7].client_id == "alice");
+  REQUIRE(blocks[7].sequence_num == 7);
+  REQUIRE(blocks[7].block_id == FileBlock::generateBlockId("alice", 1007, 7));
+
+  // Later appends never disturb bytes an older pinned version reads
+  REQUIRE(store.appendBlock("tiny.txt", makeBlock("alice", 301, 2000, "tail")));
+  std::vector<char> pinned = snapshot->assemble();
+  REQUIRE(std::string(pinned.begin(), pinned.end()) == expected);
+
+  // Compaction folds inline runs into extents like any other small blocks
+  CompactionPolicy policy;
+  policy.min_age_ms = 0;
+  REQUIRE(store.compactFile("tiny.txt", policy) > 0);
+  data = store.getFile("tiny.txt");
+  REQUIRE(std::string(data.begin(), data.end()) == expected + "tail");
+}
+
+TEST_CASE("FileStore compaction rewrites only the folded run") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("c.txt", {}, "creator"));
+  std::string expected;
+  for (uint32_t seq = 1; seq <= 8; ++seq) {
+    std::string payload = seq == 1 ? std::string(2000, 'x') : "old" + std::to_string(seq) + "\n";
+    REQUIRE(store.appendBlock("c.txt", makeBlock("alice", seq, 1000 + seq, payload)));
+    expected += payload;
+  }
+  std::string folded = expected;
+  REQUIRE(store.pinFile("c.txt")->blocks.size() == 1);  // the first one stands alone
+  uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+  for (uint32_t seq = 9; seq <= 11; ++seq) {
+    std::string payload = "new" + std::to_string(seq) + "\n";
+    REQUIRE(store.appendBlock("c.txt", makeBlock("alice", seq, now, payload)));
+    expected += payload;
+  }
+  FileSnapshot before = store.pinFile("c.txt");
+
+  // The recent blocks aren't stable yet, so they are carried over, payloads in place
+  REQUIRE(store.compactFile("c.txt", CompactionPolicy{}) == 7);
+  FileSnapshot after = store.pinFile("c.txt");
+  REQUIRE(after->blockCount() == 4);  // the extent, then the 3 recent blocks
+  for (size_t i = 1; i < 4; i++) {
+    REQUIRE(after->blockAt(i).data == before->blockAt(i + 7).data);
+  }
+
+  // Appends past the carried blocks leave the older version's bytes alone
+  REQUIRE(store.appendBlock("c.txt", makeBlock("alice", 12, now, "tail\n")));
+  std::vector<char> pinned = before->assemble();
+  REQUIRE(std::string(pinned.begin(), pinned.end()) == expected);
+  std::vector<char> data = store.getFile("c.txt");
+  REQUIRE(std::string(data.begin(), data.end()) == expected + "tail\n");
+
+  // The store holds the extent, not the standalone block folded into it, so a listing
+  // that names the folded block can't be stored
+  FileMetadata listed = store.getFileMetadata("c.txt");
+  listed.block_ids.clear();
+  listed.block_ids.push_back(after->blockAt(0).block_id);
+  listed.block_ids.push_back(before->blockAt(0).block_id);
+  REQUIRE_FALSE(store.storeFile(listed, {}));
+  data = store.getFile("c.txt");
+  REQUIRE(std::string(data.begin(), data.end()) == expected + "tail\n");
+
+  listed.block_ids.clear();
+  listed.block_ids.push_back(after->blockAt(0).block_id);
+  listed.total_size = folded.size();
+  REQUIRE(store.storeFile(listed, {}));
+  data = store.getFile("c.txt");
+  REQUIRE(std::string(data.begin(), data.end()) == folded);
+}
+
+TEST_CASE("Re-storing a file keeps the small inline blocks it already holds") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("s.txt", {}, "creator"));
+  std::string expected;
+  for (uint32_t seq = 1; seq <= 5; ++seq) {
+    std::string payload = "small" + std::to_string(seq) + "\n";
+    REQUIRE(store.appendBlock("s.txt", makeBlock("alice", seq, 100 + seq, payload)));
+    expected += payload;
+  }
+
+  // Ship only a new block; the inline ones are taken from the current version
+  FileBlock shipped = makeBlock("bob", 1, 200, "big\n");
+  FileMetadata metadata = store.getFileMetadata("s.txt");
+  metadata.block_ids.push_back(shipped.block_id);
+  metadata.total_size += shipped.size;
+  REQUIRE(store.storeFile(metadata, {shipped}));
+
+  FileSnapshot stored = store.pinFile("s.txt");
+  REQUIRE(stored->blockCount() == 6);
+  REQUIRE(stored->metadata.block_ids == metadata.block_ids);
+  std::vector<char> data = store.getFile("s.txt");
+  REQUIRE(std::string(data.begin(), data.end()) == expected + "big\n");
+  REQUIRE(stored->metadata.total_size == data.size());
+
+  // A block neither shipped nor held fails the store and leaves the file alone
+  metadata.block_ids.push_back(makeBlock("carol", 1, 300, "gone").block_id);
+  REQUIRE_FALSE(store.storeFile(metadata, {}));
+  REQUIRE(store.pinFile("s.txt") == stored);
+}
+
+TEST_CASE("FileStore serves blocks appended since a timestamp or block") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("feed.txt", {}, "creator"));
+
+  std::vector<FileBlock> appended;
+  for (uint32_t seq = 0; seq < 100; ++seq) {
+    // One client with a lagging clock stamps some blocks in the past
+    uint64_t timestamp = (seq % 10 == 9) ? 1000 + seq - 50 : 1000 + seq;
+    appended.push_back(makeBlock(seq % 10 == 9 ? "lagging" : "alice", seq, timestamp,
+                                 "entry" + std::to_string(seq)));
+    REQUIRE(store.appendBlock("feed.txt", appended.back()));
+  }
+
+  FileSnapshot snapshot = store.pinFile("feed.txt");
+  REQUIRE(snapshot->firstAfter(1050) == 51);
+  REQUIRE(snapshot->firstAfter(5000) == 100);
+
+  bool anchor_found = true;
+  std::vector<FileBlock> since_time = snapshot->blocksSince(1089, 0, anchor_found);
+  REQUIRE_FALSE(anchor_found);
+  REQUIRE(since_time.size() == 9);  // 90..98; 99 is stamped 1049
+  REQUIRE(since_time.front().block_id == appended[90].block_id);
+
+  std::vector<FileBlock> since_block =
+      snapshot->blocksSince(0, appended[96].block_id, anchor_found);
+  REQUIRE(anchor_found);
+  REQUIRE(since_block.size() == 3);
+  REQUIRE(since_block.back().block_id == appended[99].block_id);
+
+  // An unknown block falls back to the timestamp
+  REQUIRE(snapshot->blocksSince(1097, 12345, anchor_found).size() == 1);
+  REQUIRE_FALSE(anchor_found);
+
+  // Compaction keeps the index in file order
+  CompactionPolicy policy;
+  policy.min_age_ms = 0;
+  REQUIRE(store.compactFile("feed.txt", policy) > 0);
+  size_t total_bytes = 0;
+  for (const auto& block : store.pinFile("feed.txt")->blocksSince(0, 0, anchor_found)) {
+    total_bytes += block.size;
+  }
+  REQUIRE(total_bytes == store.getFileMetadata("feed.txt").total_size);
+}
+
+TEST_CASE("GET_SINCE resumes inside an extent the anchor was folded into") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("poll.txt", {}, "creator"));
+  std::vector<FileBlock> appended;
+  for (uint32_t seq = 1; seq <= 6; ++seq) {
+    appended.push_back(makeBlock("alice", seq, 100 + seq, std::string(seq, 'a' + seq) + "\n"));
+    REQUIRE(store.appendBlock("poll.txt", appended.back()));
+  }
+  appended.push_back(makeBlock("bob", 1, 107, "b\n"));
+  REQUIRE(store.appendBlock("poll.txt", appended.back()));
+
+  // A poller saw up to alice's third append, then the appends were folded
+  CompactionPolicy policy;
+  policy.min_age_ms = 0;
+  REQUIRE(store.compactFile("poll.txt", policy) == 6);
+  FileSnapshot snapshot = store.pinFile("poll.txt");
+  REQUIRE(snapshot->blockCount() == 1);
+
+  bool anchor_found = false;
+  std::vector<FileBlock> since =
+      snapshot->blocksSince(appended[2].timestamp, appended[2].block_id, anchor_found);
+  REQUIRE(anchor_found);
+  REQUIRE(since.size() == 1);
+  REQUIRE(std::string(since[0].data.begin(), since[0].data.end()) == "eeee\nfffff\ngggggg\nb\n");
+  REQUIRE(since[0].ranges.size() == 2);
+  REQUIRE(since[0].ranges[0].first_sequence == 4);
+  REQUIRE(since[0].ranges[1].offset == 18);
+
+  // The cursor of the partial extent is its last append, so the next poll starts after it
+  REQUIRE(store.appendBlock("poll.txt", makeBlock("alice", 7, 200, "tail\n")));
+  since = store.pinFile("poll.txt")->blocksSince(since[0].timestamp, since[0].lastAppendId(),
+                                                 anchor_found);
+  REQUIRE(anchor_found);
+  REQUIRE(since.size() == 1);
+  REQUIRE(std::string(since[0].data.begin(), since[0].data.end()) == "tail\n");
+
+  // An anchor at the end of a run leaves nothing of the extent
+  since = store.pinFile("poll.txt")->blocksSince(appended[6].timestamp, appended[6].block_id,
+                                                 anchor_found);
+  REQUIRE(anchor_found);
+  REQUIRE(since.size() == 1);
+  REQUIRE(since[0].sequence_num == 7);
+}
+
+TEST_CASE("FileStore retention drops expired prefixes") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("events.log", {}, "creator"));
+  REQUIRE(store.createFile("keep.txt", {}, "creator"));
+
+  std::vector<FileBlock> appended;
+  for (uint32_t seq = 0; seq < 200; ++seq) {
+    // Mix inline and standalone blocks
+    std::string payload =
+        (seq % 50 == 0) ? std::string(2000, 'x') : "event" + std::to_string(seq);
+    appended.push_back(makeBlock("alice", seq, 10000 + seq, payload));
+    REQUIRE(store.appendBlock("events.log", appended.back()));
+  }
+  FileSnapshot before = store.pinFile("events.log");
+
+  RetentionPolicy policy;
+  policy.max_blocks = 150;
+  store.setRetentionPolicy("events", policy);
+  REQUIRE(store.getRetentionPolicy("keep.txt").unlimited());
+  REQUIRE(store.getRetentionPolicy("events.log").max_blocks == 150);
+
+  uint64_t cut = 0;
+  REQUIRE(store.applyRetention("events.log", 20000, cut) == 50);
+  REQUIRE(cut == appended[49].timestamp);
+
+  // Age: everything stamped at or before 10099 is expired
+  policy.max_age_ms = 1000;
+  store.setRetentionPolicy("events", policy);
+  REQUIRE(store.applyRetention("events.log", 11099, cut) == 50);
+  REQUIRE(cut == appended[99].timestamp);
+
+  FileSnapshot after = store.pinFile("events.log");
+  REQUIRE(after->blockCount() == 100);
+  REQUIRE(after->blockAt(0).block_id == appended[100].block_id);
+  REQUIRE(after->metadata.block_ids[0] == appended[100].block_id);
+  std::string expected;
+  for (size_t i = 100; i < 200; ++i) {
+    expected.append(appended[i].data.begin(), appended[i].data.end());
+  }
+  std::vector<char> data = store.getFile("events.log");
+  REQUIRE(std::string(data.begin(), data.end()) == expected);
+  REQUIRE(after->metadata.total_size == expected.size());
+
+  // A reader that pinned the old version still sees every block
+  REQUIRE(before->blockCount() == 200);
+  REQUIRE(before->copyBlock(0).data == appended[0].data);
+
+  // Bytes: keep at most the last 2000 bytes
+  policy = RetentionPolicy{};
+  policy.max_bytes = 2000;
+  store.setRetentionPolicy("events", policy);
+  REQUIRE(store.applyRetention("events.log", 0, cut) > 0);
+  REQUIRE(store.getFileMetadata("events.log").total_size <= 2000);
+
+  // Appends after a drop still work, and a peer's truncation point is honoured
+  FileBlock next = makeBlock("bob", 0, 20000, "tail");
+  REQUIRE(store.appendBlock("events.log", next));
+  REQUIRE(store.truncateThrough("events.log", appended[99].timestamp) == 0);  // already cut
+  size_t remaining = store.pinFile("events.log")->blockCount();
+  REQUIRE(store.truncateThrough("events.log", appended[199].timestamp) == remaining - 1);
+  data = store.getFile("events.log");
+  REQUIRE(std::string(data.begin(), data.end()) == "tail");
+
+  store.setRetentionPolicy("events", RetentionPolicy{});
+  REQUIRE(store.listRetentionPolicies().empty());
+}
+
+static std::vector<BlockDigest> digestsOf(const FileSnapshot& snapshot) {
+  std::vector<BlockDigest> digests;
+  for (size_t i = 0; i < snapshot->blockCount(); ++i) {
+    digests.push_back(snapshot->digestAt(i));
+  }
+  return digests;
+}
+
+TEST_CASE("Replica merge ships only missing blocks and converges") {
+  FileStore a("./test_storage_a");
+  FileStore b("./test_storage_b");
+  FileBlock shared = makeBlock("alice", 1, 100, "shared\n");
+  for (FileStore* store : {&a, &b}) {
+    REQUIRE(store->createFile("m.txt", {}, "creator"));
+    REQUIRE(store->appendBlock("m.txt", shared));
+  }
+  // Each replica saw appends the other missed; a's run of alice appends is compacted
+  std::vector<FileBlock> only_a, only_b;
+  for (uint32_t seq = 2; seq <= 6; ++seq) {
+    only_a.push_back(makeBlock("alice", seq, 100 + seq, "a" + std::to_string(seq) + "\n"));
+    REQUIRE(a.appendBlock("m.txt", only_a.back()));
+    REQUIRE(b.appendBlock("m.txt", only_a.back()));
+  }
+  only_b.push_back(makeBlock("bob", 1, 150, "b1\n"));
+  REQUIRE(b.appendBlock("m.txt", only_b.back()));
+  CompactionPolicy policy;
+  policy.min_age_ms = 0;
+  REQUIRE(a.compactFile("m.txt", policy) > 0);
+
+  FileSnapshot snap_a = a.pinFile("m.txt");
+  FileSnapshot snap_b = b.pinFile("m.txt");
+  REQUIRE(snap_a->listHash() != snap_b->listHash());
+
+  MergePlan plan = planMerge({digestsOf(snap_a), digestsOf(snap_b)});
+  REQUIRE(plan.covered > 0);  // b's plain alice blocks are inside a's extent
+  REQUIRE(plan.missing[0].size() == 1);
+  REQUIRE(plan.missing[0][0] == only_b[0].block_id);
+  REQUIRE_FALSE(plan.in_sync[0]);
+  REQUIRE_FALSE(plan.in_sync[1]);
+
+  // Ship each replica only the blocks it lacks
+  auto gather = [&](const std::vector<uint64_t>& ids) {
+    std::vector<FileBlock> blocks;
+    for (uint64_t id : ids) {
+      size_t pos;
+      if (snap_a->findBlock(id, pos)) {
+        blocks.push_back(snap_a->copyBlock(pos));
+      } else if (snap_b->findBlock(id, pos)) {
+        blocks.push_back(snap_b->copyBlock(pos));
+      }
+    }
+    return blocks;
+  };
+  REQUIRE_FALSE(a.applyMerge("m.txt", plan.block_ids, {}, 7));  // b1 unavailable: no change
+  REQUIRE(a.pinFile("m.txt") == snap_a);
+
+  // An append racing the merge survives at the end
+  FileBlock raced = makeBlock("carol", 1, 500, "late\n");
+  REQUIRE(b.appendBlock("m.txt", raced));
+
+  REQUIRE(a.applyMerge("m.txt", plan.block_ids, gather(plan.missing[0]), 7));
+  REQUIRE(b.applyMerge("m.txt", plan.block_ids, gather(plan.missing[1]), 7));
+
+  std::vector<char> data_a = a.getFile("m.txt");
+  std::vector<char> data_b = b.getFile("m.txt");
+  std::string merged(data_a.begin(), data_a.end());
+  REQUIRE(merged == "shared\na2\na3\na4\na5\na6\nb1\n");
+  REQUIRE(std::string(data_b.begin(), data_b.end()) == merged + "late\n");
+  REQUIRE(a.getFileMetadata("m.txt").version == 7);
+
+  // A merged copy needs no further blocks
+  MergePlan again = planMerge({digestsOf(a.pinFile("m.txt"))});
+  REQUIRE(again.in_sync[0]);
+  REQUIRE(again.block_ids == plan.block_ids);
+}
+
+TEST_CASE("Replicas created from one CREATE merge without duplicating the first block") {
+  FileStore a("./test_storage_a");
+  FileStore b("./test_storage_b");
+  std::vector<char> hello = {'h', 'e', 'l', 'l', 'o'};
+  REQUIRE(a.createFile("c.txt", hello, "creator", 1000));
+  REQUIRE(b.createFile("c.txt", hello, "creator", 1000));
+  REQUIRE(b.appendBlock("c.txt", makeBlock("writer", 1, 1100, "!")));
+
+  MergePlan plan = planMerge({digestsOf(a.pinFile("c.txt")), digestsOf(b.pinFile("c.txt"))});
+  REQUIRE(plan.block_ids.size() == 2);
+  REQUIRE(plan.missing[0].size() == 1);
+  REQUIRE(plan.in_sync[1]);
+
+  FileSnapshot snap_b = b.pinFile("c.txt");
+  size_t pos;
+  REQUIRE(snap_b->findBlock(plan.missing[0][0], pos));
+  REQUIRE(a.applyMerge("c.txt", plan.block_ids, {snap_b->copyBlock(pos)}, 3));
+  std::vector<char> merged = a.getFile("c.txt");
+  REQUIRE(std::string(merged.begin(), merged.end()) == "hello!");
+
+  // An append two replicas stamped differently is still one append to the merge
+  FileStore c("./test_storage_b");
+  REQUIRE(c.createFile("c.txt", hello, "creator", 2000));
+  plan = planMerge({digestsOf(a.pinFile("c.txt")), digestsOf(c.pinFile("c.txt"))});
+  REQUIRE(plan.block_ids.size() == 2);
+  REQUIRE(plan.covered == 1);
+}
+
+TEST_CASE("Replicas holding the same appends share a digest however they compacted them") {
+  FileStore a("./test_storage_a");
+  FileStore b("./test_storage_b");
+  for (FileStore* store : {&a, &b}) {
+    REQUIRE(store->createFile("d.txt", {'x'}, "creator", 1000));
+    for (uint32_t seq = 1; seq <= 6; ++seq) {
+      REQUIRE(store->appendBlock("d.txt", makeBlock("alice", seq, 1000 + seq, "line\n")));
+    }
+  }
+  REQUIRE(a.pinFile("d.txt")->digest() == b.pinFile("d.txt")->digest());
+
+  // Compacting one copy changes its block list, not its content
+  CompactionPolicy policy;
+  policy.min_age_ms = 0;
+  REQUIRE(a.compactFile("d.txt", policy) > 0);
+  FileSnapshot snap_a = a.pinFile("d.txt");
+  FileSnapshot snap_b = b.pinFile("d.txt");
+  REQUIRE(snap_a->listHash() != snap_b->listHash());
+  REQUIRE(snap_a->contentHash() == snap_b->contentHash());
+  REQUIRE(snap_a->digest() == snap_b->digest());
+
+  // A missing append shows until the other copy has it too
+  REQUIRE(b.appendBlock("d.txt", makeBlock("bob", 1, 2000, "b\n")));
+  REQUIRE(a.pinFile("d.txt")->digest() != b.pinFile("d.txt")->digest());
+  REQUIRE(a.appendBlock("d.txt", makeBlock("bob", 1, 2000, "b\n")));
+  REQUIRE(a.pinFile("d.txt")->digest() == b.pinFile("d.txt")->digest());
+}
+
+TEST_CASE("A truncation point holds on compacted replicas and through merges") {
+  FileStore coordinator("./test_storage_a");
+  FileStore compacted("./test_storage_b");
+  FileStore missed("./test_storage_c");
+  std::vector<FileBlock> appended;
+  for (uint32_t seq = 1; seq <= 8; ++seq) {
+    appended.push_back(makeBlock("alice", seq, 100 + seq, "e" + std::to_string(seq) + "\n"));
+  }
+  for (FileStore* store : {&coordinator, &compacted, &missed}) {
+    REQUIRE(store->createFile("t.txt", {}, "creator"));
+    for (size_t i = 0; i < 4; ++i) {
+      REQUIRE(store->appendBlock("t.txt", appended[i]));
+    }
+  }
+  // One replica folds the first half into an extent before the rest arrives
+  CompactionPolicy compaction;
+  compaction.min_age_ms = 0;
+  REQUIRE(compacted.compactFile("t.txt", compaction) == 3);
+  for (FileStore* store : {&coordinator, &compacted, &missed}) {
+    for (size_t i = 4; i < appended.size(); ++i) {
+      REQUIRE(store->appendBlock("t.txt", appended[i]));
+    }
+  }
+
+  RetentionPolicy policy;
+  policy.max_blocks = 4;
+  coordinator.setRetentionPolicy("t.txt", policy);
+  uint64_t cut = 0;
+  REQUIRE(coordinator.applyRetention("t.txt", 0, cut) == 4);
+  REQUIRE(cut == appended[3].timestamp);
+
+  // The cut is found even though no block of the compacted copy ends at it
+  REQUIRE(compacted.truncateThrough("t.txt", cut) == 1);
+  REQUIRE(compacted.getFile("t.txt") == coordinator.getFile("t.txt"));
+
+  // A replica that missed the truncation can't bring the expired blocks back
+  FileSnapshot stale = missed.pinFile("t.txt");
+  MergePlan plan = planMerge({digestsOf(coordinator.pinFile("t.txt")), digestsOf(stale)},
+                             coordinator.pinFile("t.txt")->truncated_through);
+  REQUIRE(plan.expired == 4);
+  REQUIRE(plan.block_ids.size() == 4);
+  REQUIRE(plan.in_sync[0]);
+
+  std::vector<uint64_t> stale_ids(stale->metadata.block_ids.begin(),
+                                  stale->metadata.block_ids.end());
+  REQUIRE(coordinator.applyMerge("t.txt", stale_ids, stale->copyBlocks(), 9));
+  std::vector<char> data = coordinator.getFile("t.txt");
+  REQUIRE(std::string(data.begin(), data.end()) == "e5\ne6\ne7\ne8\n");
+}
+
+TEST_CASE("Read repair fills a lagging replica and leaves diverged ones alone") {
+  FileStore fresh("./test_storage_a");
+  FileStore lagging("./test_storage_b");
+  std::vector<FileBlock> blocks;
+  for (uint32_t seq = 1; seq <= 4; ++seq) {
+    blocks.push_back(makeBlock("alice", seq, 100 + seq, "r" + std::to_string(seq) + "\n"));
+  }
+  REQUIRE(fresh.createFile("r.txt", {}, "creator"));
+  REQUIRE(lagging.createFile("r.txt", {}, "creator"));
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    REQUIRE(fresh.appendBlock("r.txt", blocks[i]));
+    if (i != 2) REQUIRE(lagging.appendBlock("r.txt", blocks[i]));
+  }
+
+  FileSnapshot snap = fresh.pinFile("r.txt");
+  std::vector<uint64_t> fresh_ids;
+  for (size_t i = 0; i < snap->blockCount(); ++i) {
+    fresh_ids.push_back(snap->blockAt(i).block_id);
+  }
+
+  std::vector<uint64_t> missing = planReadRepair(fresh_ids, digestsOf(lagging.pinFile("r.txt")));
+  REQUIRE(missing == std::vector<uint64_t>{blocks[2].block_id});
+  REQUIRE(planReadRepair(fresh_ids, digestsOf(snap)).empty());
+  REQUIRE(planReadRepair(fresh_ids, {}).size() == fresh_ids.size());
+
+  REQUIRE(lagging.applyMerge("r.txt", fresh_ids, {blocks[2]}, snap->metadata.version));
+  REQUIRE(lagging.getFile("r.txt") == fresh.getFile("r.txt"));
+  REQUIRE(lagging.pinFile("r.txt")->listHash() == snap->listHash());
+
+  // A copy with a block the reader never saw diverged: that takes a merge
+  REQUIRE(lagging.appendBlock("r.txt", makeBlock("bob", 1, 200, "b\n")));
+  REQUIRE(planReadRepair(fresh_ids, digestsOf(lagging.pinFile("r.txt"))).empty());
+}
+
+TEST_CASE("FileStore reports version changes to its listener") {
+  FileStore a("./test_storage_a");
+  FileStore b("./test_storage_b");
+  std::vector<std::pair<std::string, uint64_t>> changes;
+  a.setChangeListener([&](const std::string& filename, const FileSnapshot& version) {
+    changes.emplace_back(filename, version ? version->digest() : 0);
+  });
+
+  FileBlock block = makeBlock("alice", 1, 100, "x");
+  for (FileStore* store : {&a, &b}) {
+    REQUIRE(store->createFile("d.txt", {}, "creator"));
+    REQUIRE(store->appendBlock("d.txt", block));
+  }
+  REQUIRE(changes.size() == 2);
+  REQUIRE(changes.back().second == b.pinFile("d.txt")->digest());
+
+  // The running list hash matches a full rehash after a dropped prefix
+  for (uint32_t seq = 2; seq <= 5; seq++) {
+    REQUIRE(a.appendBlock("d.txt", makeBlock("alice", seq, 99 + seq, "y")));
+  }
+  REQUIRE(a.truncateThrough("d.txt", block.timestamp) == 1);
+  auto rehash = [](const FileSnapshot& snapshot) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < snapshot->blockCount(); i++) {
+      hash = FileVersion::extendListHash(hash, snapshot->blockAt(i).block_id);
+    }
+    return hash;
+  };
+  REQUIRE(a.pinFile("d.txt")->listHash() == rehash(a.pinFile("d.txt")));
+  REQUIRE(a.truncateThrough("d.txt", 102) == 2);
+  REQUIRE(a.appendBlock("d.txt", makeBlock("alice", 6, 105, "y")));
+  FileSnapshot snapshot = a.pinFile("d.txt");
+  REQUIRE(snapshot->blockCount() == 3);
+  REQUIRE(snapshot->listHash() == rehash(snapshot));
+
+  REQUIRE(a.deleteFile("d.txt"));
+  REQUIRE(changes.back() == std::make_pair(std::string("d.txt"), uint64_t(0)));
+  a.setChangeListener({});
+}
@@ -0,0 +1,85 @@
+#include <string>
+#include <unordered_map>
+
+#include "catch_amalgamated.hpp"
+#include "flat_hash_map.hpp"
+#include "message.hpp"
+
+TEST_CASE("FlatHashMap insert, find and erase") {
+  FlatHashMap<uint64_t, int> map;
+  REQUIRE(map.empty());
+  REQUIRE(map.find(42) == map.end());
+
+  map[42] = 7;
+  auto [it, inserted] = map.emplace(43, 8);
+  REQUIRE(inserted);
+  REQUIRE(it->second == 8);
+
+  auto again = map.emplace(43, 9);
+  REQUIRE_FALSE(again.second);
+  REQUIRE(again.first->second == 8);
+
+  REQUIRE(map.size() == 2);
+  REQUIRE(map.find(42)->second == 7);
+  REQUIRE(map.erase(42) == 1);
+  REQUIRE(map.erase(42) == 0);
+  REQUIRE(map.find(42) == map.end());
+  REQUIRE(map.size() == 1);
+}
+
+TEST_CASE("FlatHashMap grows and matches std::unordered_map") {
+  FlatHashMap<uint64_t, uint64_t> map;
+  std::unordered_map<uint64_t, uint64_t> reference;
+
+  for (uint64_t i = 0; i < 10000; ++i) {
+    map[i * 7919] = i;
+    reference[i * 7919] = i;
+  }
+  // Interleave erases so tombstones get reused
+  for (uint64_t i = 0; i < 10000; i += 3) {
+    map.erase(i * 7919);
+    reference.erase(i * 7919);
+  }
+  for (uint64_t i = 10000; i < 12000; ++i) {
+    map[i * 7919] = i;
+    reference[i * 7919] = i;
+  }
+
+  REQUIRE(map.size() == reference.size());
+  for (const auto& [key, value] : reference) {
+    auto it = map.find(key);
+    REQUIRE(it != map.end());
+    REQUIRE(it->second == value);
+  }
+
+  size_t iterated = 0;
+  for (const auto& entry : map) {
+    REQUIRE(reference.count(entry.first) == 1);
+    ++iterated;
+  }
+  REQUIRE(iterated == reference.size());
+}
+
+TEST_CASE("FlatHashMap with string and NodeId keys") {
+  FlatHashMap<std::string, FlatHashMap<std::string, int>> nested;
+  nested["client"]["file.txt"] = 1;
+  nested["client"]["other.txt"] = 2;
+  REQUIRE(nested["client"].size() == 2);
+
+  FlatHashMap<std::string, FlatHashMap<std::string, int>> copy = nested;
+  copy["client"].erase("file.txt");
+  REQUIRE(nested["client"].size() == 2);
+  REQUIRE(copy["client"].size() == 1);
+
+  FlatHashMap<NodeId, int> nodes;
+  NodeId a = NodeId::createNewNode("localhost", "1000");
+  NodeId b = NodeId::createNewNode("localhost", "1001");
+  nodes.emplace(a, 1);
+  nodes.emplace(b, 2);
+  REQUIRE(nodes.find(a)->second == 1);
+  REQUIRE(nodes.find(b)->second == 2);
+
+  FlatHashMap<NodeId, int> moved = std::move(nodes);
+  REQUIRE(moved.size() == 2);
+  REQUIRE(nodes.empty());
+}
@@ -0,0 +1,103 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "group_commit.hpp"
+
+struct Flushed {
+  std::string filename;
+  FileId file_id;
+  std::vector<uint64_t> request_ids;
+};
+
+static GroupCommitter::Append makeAppend(uint64_t request_id, size_t bytes = 10) {
+  GroupCommitter::Append append;
+  append.block.client_id = "client";
+  append.block.sequence_num = static_cast<uint32_t>(request_id);
+  append.block.data.assign(bytes, 'x');
+  append.block.size = bytes;
+  append.block.block_id = request_id;
+  append.client = {};
+  append.request_id = request_id;
+  return append;
+}
+
+static GroupCommitter::FlushFn recordInto(std::vector<Flushed>& flushed) {
+  return [&flushed](std::vector<GroupCommitter::Group>& groups) {
+    for (const auto& group : groups) {
+      Flushed entry{group.hydfs_filename, group.file_id, {}};
+      for (const auto& append : group.appends) {
+        entry.request_ids.push_back(append.request_id);
+      }
+      flushed.push_back(entry);
+    }
+  };
+}
+
+TEST_CASE("Group commit batches a file's appends until its window passes") {
+  std::vector<Flushed> flushed;
+  GroupCommitter committer(recordInto(flushed), std::chrono::milliseconds(20));
+
+  for (uint64_t i = 1; i <= 5; i++) {
+    committer.add("a.log", 1, makeAppend(i));
+  }
+  committer.add("b.log", 2, makeAppend(6));
+  REQUIRE(committer.runOnce() == 0);  // still inside the window
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  REQUIRE(committer.runOnce() == 6);
+  REQUIRE(flushed.size() == 2);
+  REQUIRE(flushed[0].filename == "a.log");
+  REQUIRE(flushed[0].request_ids == std::vector<uint64_t>{1, 2, 3, 4, 5});
+  REQUIRE(flushed[1].file_id == 2);
+  REQUIRE(committer.stats().groups == 2);
+  REQUIRE(committer.stats().appends == 6);
+}
+
+TEST_CASE("Group commit seals full groups and keeps each file in order") {
+  std::vector<Flushed> flushed;
+  GroupCommitter committer(recordInto(flushed), std::chrono::seconds(10), 1000, 3);
+
+  // The count cap seals a group of three; the fourth append opens the next one
+  for (uint64_t i = 1; i <= 4; i++) {
+    committer.add("a.log", 1, makeAppend(i));
+  }
+  // The byte cap seals a group once the next block would not fit
+  committer.add("b.log", 2, makeAppend(10, 600));
+  committer.add("b.log", 2, makeAppend(11, 600));
+
+  REQUIRE(committer.runOnce() == 4);
+  REQUIRE(flushed.size() == 2);
+  REQUIRE(flushed[0].request_ids == std::vector<uint64_t>{1, 2, 3});
+  REQUIRE(flushed[1].request_ids == std::vector<uint64_t>{10});
+
+  // Flushing everything commits the open groups oldest first
+  REQUIRE(committer.runOnce(true) == 2);
+  REQUIRE(flushed.size() == 4);
+  REQUIRE(flushed[2].request_ids == std::vector<uint64_t>{4});
+  REQUIRE(flushed[3].request_ids == std::vector<uint64_t>{11});
+}
+
+TEST_CASE("Group commit flusher commits in the background and drains on stop") {
+  std::vector<Flushed> flushed;
+  GroupCommitter committer(recordInto(flushed), std::chrono::milliseconds(1));
+  committer.start();
+  committer.add("a.log", 1, makeAppend(1));
+  committer.add("a.log", 1, makeAppend(2));
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (committer.stats().appends < 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  REQUIRE(committer.stats().appends == 2);
+
+  // Appends queued behind a long window are committed by stop()
+  GroupCommitter slow(recordInto(flushed), std::chrono::seconds(10));
+  slow.start();
+  slow.add("c.log", 3, makeAppend(3));
+  slow.stop();
+  REQUIRE(slow.stats().appends == 1);
+  committer.stop();
+}
@@ -0,0 +1,166 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "hinted_handoff.hpp"
+
+static FileBlock makeBlock(uint32_t sequence_num, size_t size) {
+  FileBlock block;
+  block.client_id = "client";
+  block.sequence_num = sequence_num;
+  block.timestamp = 1000 + sequence_num;
+  block.data.assign(size, 'h');
+  block.size = size;
+  block.block_id = FileBlock::generateBlockId(block.client_id, block.timestamp, sequence_num);
+  return block;
+}
+
+TEST_CASE("Hinted handoff replays queued blocks in order once the replica is back") {
+  const std::string dir = "./test_hints";
+  std::filesystem::remove_all(dir);
+  NodeId replica = NodeId::createNewNode("localhost", "9200");
+
+  std::atomic<bool> alive{false};
+  std::vector<std::vector<HintedHandoff::Hint>> batches;
+  HintedHandoff hints(
+      dir,
+      [&](const NodeId& target, const std::vector<HintedHandoff::Hint>& batch) {
+        if (!(target == replica)) return false;
+        batches.push_back(batch);
+        return true;
+      },
+      [&](const NodeId&) { return alive.load(); }, 0);
+
+  for (uint32_t i = 0; i < 40; i++) {
+    REQUIRE(hints.addHint(replica, "file" + std::to_string(i % 3), makeBlock(i, 500)));
+  }
+  REQUIRE(hints.hasHints(replica));
+  REQUIRE_FALSE(hints.addHint(replica, "huge", makeBlock(99, 8000)));  // never fits a batch
+
+  // Nothing moves while the replica is unreachable
+  REQUIRE(hints.runOnce() == 0);
+  REQUIRE(batches.empty());
+  REQUIRE(hints.progress().pending == 40);
+
+  alive = true;
+  REQUIRE(hints.runOnce() == 40);
+  REQUIRE_FALSE(hints.hasHints(replica));
+  REQUIRE(batches.size() > 1);
+
+  uint32_t next = 0;
+  for (const auto& batch : batches) {
+    size_t batch_bytes = 0;
+    for (const auto& hint : batch) {
+      REQUIRE(hint.block.sequence_num == next);
+      REQUIRE(hint.hydfs_filename == "file" + std::to_string(next % 3));
+      batch_bytes += sizeof(uint32_t) + hint.hydfs_filename.size() + hint.block.serializedSize();
+      next++;
+    }
+    REQUIRE(batch_bytes <= HintedHandoff::kBatchBytes);
+  }
+  REQUIRE(next == 40);
+
+  HintedHandoff::Progress progress = hints.progress();
+  REQUIRE(progress.pending == 0);
+  REQUIRE(progress.replayed == 40);
+  REQUIRE(progress.dropped == 1);
+  REQUIRE(std::filesystem::is_empty(dir));  // replayed hints leave no log behind
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Hinted handoff survives a restart and retries failed batches") {
+  const std::string dir = "./test_hints_durable";
+  std::filesystem::remove_all(dir);
+  NodeId replica = NodeId::createNewNode("localhost", "9201");
+  NodeId other = NodeId::createNewNode("localhost", "9202");
+
+  {
+    HintedHandoff hints(
+        dir, [](const NodeId&, const std::vector<HintedHandoff::Hint>&) { return false; },
+        [](const NodeId&) { return true; }, 0);
+    for (uint32_t i = 0; i < 10; i++) {
+      REQUIRE(hints.addHint(replica, "log.txt", makeBlock(i, 100)));
+    }
+    REQUIRE(hints.addHint(other, "log.txt", makeBlock(50, 100)));
+
+    // Delivery fails: the hints stay queued
+    REQUIRE(hints.runOnce() == 0);
+    REQUIRE(hints.progress().pending == 11);
+  }
+
+  // Cut the last record short, as a crash mid-append would
+  std::string log_path = dir + "/localhost_9201_" + std::to_string(replica.time) + ".hints";
+  REQUIRE(std::filesystem::exists(log_path));
+  std::filesystem::resize_file(log_path, std::filesystem::file_size(log_path) - 3);
+
+  std::vector<HintedHandoff::Hint> delivered;
+  HintedHandoff restarted(
+      dir,
+      [&](const NodeId& target, const std::vector<HintedHandoff::Hint>& batch) {
+        if (target == replica) delivered.insert(delivered.end(), batch.begin(), batch.end());
+        return true;
+      },
+      [&](const NodeId& node_id) { return node_id == replica; }, 0);
+  REQUIRE(restarted.progress().pending == 10);
+
+  REQUIRE(restarted.runOnce() == 9);
+  REQUIRE(delivered.size() == 9);
+  for (uint32_t i = 0; i < delivered.size(); i++) {
+    REQUIRE(delivered[i].block.sequence_num == i);
+    REQUIRE(delivered[i].block.data == std::vector<char>(100, 'h'));
+  }
+
+  // A replica that left the ring loses its hints
+  REQUIRE(restarted.hasHints(other));
+  restarted.discard(other);
+  REQUIRE_FALSE(restarted.hasHints(other));
+  REQUIRE(std::filesystem::is_empty(dir));
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Hinted handoff turns unacknowledged sends into hints") {
+  const std::string dir = "./test_hints_acks";
+  std::filesystem::remove_all(dir);
+  NodeId replica = NodeId::createNewNode("localhost", "9203");
+
+  std::vector<uint32_t> delivered;
+  HintedHandoff hints(
+      dir,
+      [&](const NodeId&, const std::vector<HintedHandoff::Hint>& batch) {
+        for (const auto& hint : batch) delivered.push_back(hint.block.sequence_num);
+        return true;
+      },
+      [](const NodeId&) { return true; }, 0, std::chrono::seconds(1),
+      std::chrono::milliseconds(20));
+  size_t passes = 0;
+  hints.setOnExpire([&] { passes++; });
+
+  hints.expectAck(1, replica, {{"file", makeBlock(1, 10)}});
+  hints.expectAck(2, replica, {{"file", makeBlock(2, 10)}});
+  hints.acknowledge(1);
+  REQUIRE(hints.progress().awaiting_ack == 1);
+
+  // Not expired yet
+  REQUIRE(hints.runOnce() == 0);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  REQUIRE(hints.runOnce() == 1);
+  REQUIRE(delivered == std::vector<uint32_t>{2});
+  REQUIRE(hints.progress().awaiting_ack == 0);
+  REQUIRE(passes == 2);  // every pass, not just those that expired something
+
+  // A partial ack queues the blocks past the replica's high-water mark right away
+  hints.expectAck(3, replica, {{"a", makeBlock(3, 10)}, {"b", makeBlock(4, 10)}});
+  hints.acknowledge(3, 1);
+  REQUIRE(hints.hasHints(replica));
+  REQUIRE(hints.runOnce() == 1);
+  REQUIRE(delivered == std::vector<uint32_t>{2, 4});
+
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,55 @@
+#include <string>
+
+#include "catch_amalgamated.hpp"
+#include "file_store.hpp"
+#include "intern_table.hpp"
+
+// Every name lands in the same bucket, forcing the table to tell them apart by the name
+struct CollidingHash {
+  size_t operator()(const std::string&) const { return 42; }
+};
+
+TEST_CASE("Intern table hands out dense handles and resolves them back") {
+  InternTable names;
+  REQUIRE(names.intern("a.log") == 1);
+  REQUIRE(names.intern("b.log") == 2);
+  REQUIRE(names.intern("a.log") == 1);
+  REQUIRE(names.size() == 2);
+  REQUIRE(names.name(2) == "b.log");
+  REQUIRE(names.name(0).empty());
+  REQUIRE(names.name(3).empty());
+
+  // Lookups by name don't register it
+  FileId file_id = 0;
+  REQUIRE(names.find("b.log", file_id));
+  REQUIRE(file_id == 2);
+  REQUIRE_FALSE(names.find("c.log", file_id));
+  REQUIRE(names.size() == 2);
+}
+
+TEST_CASE("Intern table keeps filenames apart when their hashes collide") {
+  BasicInternTable<CollidingHash> names;
+  FileId first = names.intern("first.log");
+  FileId second = names.intern("second.log");
+  REQUIRE(first != second);
+  REQUIRE(names.intern("second.log") == second);
+  REQUIRE(names.name(first) == "first.log");
+  REQUIRE(names.name(second) == "second.log");
+  FileId file_id = 0;
+  REQUIRE_FALSE(names.find("third.log", file_id));
+}
+
+TEST_CASE("FileStore keys files by exact name, not by name hash") {
+  FileStore store("./test_storage");
+  REQUIRE(store.createFile("x.log", {'x'}, "creator"));
+  REQUIRE(store.createFile("y.log", {'y'}, "creator"));
+  REQUIRE_FALSE(store.createFile("x.log", {'z'}, "creator"));
+
+  FileId x = 0, y = 0;
+  REQUIRE(store.fileNames().find("x.log", x));
+  REQUIRE(store.fileNames().find("y.log", y));
+  REQUIRE(x != y);
+  REQUIRE(store.pinFile(y)->metadata.hydfs_filename == "y.log");
+  REQUIRE_FALSE(store.pinFile("z.log"));
+  REQUIRE_FALSE(store.fileNames().find("z.log", x));  // misses don't register names
+}
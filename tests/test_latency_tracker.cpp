@@ -0,0 +1,30 @@
+#include <chrono>
+
+#include "catch_amalgamated.hpp"
+#include "latency_tracker.hpp"
+
+using std::chrono::microseconds;
+
+TEST_CASE("Latency tracker answers percentiles over a sliding window") {
+  LatencyTracker tracker(100);
+  REQUIRE(tracker.percentile(95, microseconds(500)) == microseconds(500));
+
+  for (int i = 1; i <= 100; i++) {
+    tracker.record(microseconds(i * 10));
+  }
+  REQUIRE(tracker.samples() == 100);
+  REQUIRE(tracker.percentile(50, microseconds(0)) == microseconds(500));
+  REQUIRE(tracker.percentile(95, microseconds(0)) == microseconds(950));
+  REQUIRE(tracker.percentile(100, microseconds(0)) == microseconds(1000));
+  REQUIRE(tracker.percentile(0, microseconds(0)) == microseconds(10));
+
+  // Too few samples to trust: the fallback answers
+  REQUIRE(tracker.percentile(95, microseconds(7), 200) == microseconds(7));
+
+  // New samples push the oldest out of the window
+  for (int i = 0; i < 100; i++) {
+    tracker.record(microseconds(5));
+  }
+  REQUIRE(tracker.samples() == 100);
+  REQUIRE(tracker.percentile(99, microseconds(0)) == microseconds(5));
+}
@@ -0,0 +1,96 @@
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "merkle_tree.hpp"
+
+// Leaves whose range-restricted hashes differ, found by descending from the root
+static std::vector<size_t> differingLeaves(const MerkleTree& a, const MerkleTree& b,
+                                           const RingRange& range) {
+  std::vector<size_t> frontier = {0};
+  for (size_t level = 0; level < MerkleTree::kDepth; level++) {
+    std::vector<size_t> next;
+    for (size_t index : frontier) {
+      if (a.hash(level, index, range) == b.hash(level, index, range)) continue;
+      for (size_t child = 0; child < MerkleTree::kFanout; child++) {
+        next.push_back(index * MerkleTree::kFanout + child);
+      }
+    }
+    frontier = std::move(next);
+  }
+  std::vector<size_t> leaves;
+  for (size_t leaf : frontier) {
+    if (a.hash(MerkleTree::kDepth, leaf, range) != b.hash(MerkleTree::kDepth, leaf, range)) {
+      leaves.push_back(leaf);
+    }
+  }
+  return leaves;
+}
+
+TEST_CASE("RingRange wraps past zero") {
+  RingRange plain{100, 200};
+  REQUIRE_FALSE(plain.contains(100));
+  REQUIRE(plain.contains(101));
+  REQUIRE(plain.contains(200));
+  REQUIRE_FALSE(plain.contains(201));
+
+  RingRange wrapped{UINT64_MAX - 10, 5};
+  REQUIRE(wrapped.contains(UINT64_MAX));
+  REQUIRE(wrapped.contains(0));
+  REQUIRE(wrapped.contains(5));
+  REQUIRE_FALSE(wrapped.contains(6));
+  REQUIRE_FALSE(wrapped.contains(UINT64_MAX - 10));
+
+  REQUIRE((RingRange{7, 7}.contains(12345)));
+}
+
+TEST_CASE("MerkleTree updates incrementally and compares by range") {
+  MerkleTree a;
+  MerkleTree b;
+  RingRange whole{0, 0};
+  const uint64_t step = UINT64_MAX / 1000;
+  for (uint64_t i = 0; i < 1000; i++) {
+    std::string name = "file" + std::to_string(i);
+    a.update(name, i * step, i + 1);
+    b.update(name, i * step, i + 1);
+  }
+  REQUIRE(a.hash(0, 0, whole) == b.hash(0, 0, whole));
+  REQUIRE(a.hash(0, 0, whole) != 0);
+
+  // Changing and restoring a digest is undone exactly
+  uint64_t root = a.hash(0, 0, whole);
+  a.update("file10", 10 * step, 999999);
+  REQUIRE(a.hash(0, 0, whole) != root);
+  a.update("file10", 10 * step, 11);
+  REQUIRE(a.hash(0, 0, whole) == root);
+
+  // One diverged file shows up as exactly its leaf
+  b.update("file500", 500 * step, 42);
+  std::vector<size_t> leaves = differingLeaves(a, b, whole);
+  REQUIRE(leaves.size() == 1);
+  REQUIRE(leaves[0] == MerkleTree::leafOf(500 * step));
+  std::vector<MerkleTree::Entry> entries = b.leafEntries(leaves[0], whole);
+  bool found = false;
+  for (const auto& entry : entries) {
+    found |= entry.name == "file500" && entry.digest == 42;
+  }
+  REQUIRE(found);
+
+  // A range that excludes the diverged file matches even though the trees differ
+  RingRange lower{UINT64_MAX - 5, 400 * step};
+  REQUIRE(a.hash(0, 0, lower) == b.hash(0, 0, lower));
+  RingRange upper{400 * step, 600 * step};
+  REQUIRE(a.hash(0, 0, upper) != b.hash(0, 0, upper));
+
+  // Files outside a range don't affect it: b also stores another range's files
+  b.update("file500", 500 * step, 501);
+  b.update("elsewhere", 900 * step + 1, 7);
+  REQUIRE(a.hash(0, 0, upper) == b.hash(0, 0, upper));
+  REQUIRE(a.hash(0, 0, whole) != b.hash(0, 0, whole));
+
+  // Removing an entry restores the tree
+  b.update("elsewhere", 900 * step + 1, 0);
+  REQUIRE(a.hash(0, 0, whole) == b.hash(0, 0, whole));
+  b.clear();
+  REQUIRE(b.hash(0, 0, whole) == 0);
+}
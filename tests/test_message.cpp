@@ -3,6 +3,7 @@
 #include <cstring>
 
 #include "catch_amalgamated.hpp"
+#include "file_metadata.hpp"
 #include "message.hpp"
 
 TEST_CASE("NodeId serialization round-trip") {
@@ -270,3 +271,169 @@ TEST_CASE("All node statuses serialization") {
     REQUIRE(deserialized.status == status);
   }
 }
+
+TEST_CASE("Consistency levels size quorums and survive append and get messages") {
+  REQUIRE(requiredReplicas(ConsistencyLevel::ONE, 3) == 1);
+  REQUIRE(requiredReplicas(ConsistencyLevel::QUORUM, 3) == 2);
+  REQUIRE(requiredReplicas(ConsistencyLevel::QUORUM, 4) == 3);
+  REQUIRE(requiredReplicas(ConsistencyLevel::ALL, 3) == 3);
+  REQUIRE(requiredReplicas(ConsistencyLevel::ALL, 0) == 1);
+
+  ConsistencyLevel level = ConsistencyLevel::ONE;
+  REQUIRE(parseConsistencyLevel("Quorum", level));
+  REQUIRE(level == ConsistencyLevel::QUORUM);
+  REQUIRE_FALSE(parseConsistencyLevel("most", level));
+  REQUIRE(level == ConsistencyLevel::QUORUM);
+
+  AppendFileRequest req;
+  req.hydfs_filename = "log.txt";
+  req.local_filename = "local.txt";
+  req.client_id = 42;
+  req.sequence_num = 3;
+  req.data = {'a', 'b', 'c'};
+  req.data_size = req.data.size();
+  req.request_id = 77;
+  req.consistency = ConsistencyLevel::ALL;
+
+  char buffer[256];
+  size_t size = req.serialize(buffer, sizeof(buffer));
+  AppendFileRequest decoded = AppendFileRequest::deserialize(buffer, size);
+  REQUIRE(decoded.data == req.data);
+  REQUIRE(decoded.request_id == 77);
+  REQUIRE(decoded.consistency == ConsistencyLevel::ALL);
+
+  AppendFileResponse resp;
+  resp.success = false;
+  resp.error_message = "Not enough replicas acknowledged the block";
+  resp.block_id = 9;
+  resp.request_id = 77;
+  resp.acks = 2;
+  size = resp.serialize(buffer, sizeof(buffer));
+  AppendFileResponse decoded_resp = AppendFileResponse::deserialize(buffer, size);
+  REQUIRE_FALSE(decoded_resp.success);
+  REQUIRE(decoded_resp.request_id == 77);
+  REQUIRE(decoded_resp.acks == 2);
+
+  // A failed quorum read still carries its request ID back to the reader
+  GetFileResponse miss;
+  miss.success = false;
+  miss.request_id = 78;
+  miss.error_message = "File not found";
+  miss.metadata.hydfs_filename = "log.txt";
+  miss.metadata.file_id = FileMetadata::generateFileId("log.txt");
+  size = miss.serialize(buffer, sizeof(buffer));
+  REQUIRE(GetFileResponse::deserialize(buffer, size).request_id == 78);
+}
+
+TEST_CASE("Replication batches carry several files and ack with a high-water mark") {
+  ReplicateBlocksMessage msg;
+  msg.request_id = 12;
+  for (const std::string name : {"a.log", "b.log"}) {
+    ReplicatedFile file;
+    file.hydfs_filename = name;
+    for (uint32_t seq = 1; seq <= 3; seq++) {
+      FileBlock block;
+      block.client_id = "client";
+      block.sequence_num = seq;
+      block.timestamp = 1000 + seq;
+      block.data.assign(seq, 'x');
+      block.size = block.data.size();
+      block.block_id = FileBlock::generateBlockId(block.client_id, block.timestamp, seq);
+      file.blocks.push_back(block);
+    }
+    msg.files.push_back(file);
+  }
+
+  char buffer[1024];
+  size_t size = msg.serialize(buffer, sizeof(buffer));
+  ReplicateBlocksMessage decoded = ReplicateBlocksMessage::deserialize(buffer, size);
+  REQUIRE(decoded.request_id == 12);
+  REQUIRE(decoded.files.size() == 2);
+  REQUIRE(decoded.blockCount() == 6);
+  REQUIRE(decoded.files[1].hydfs_filename == "b.log");
+  REQUIRE(decoded.files[1].blocks[2].block_id == msg.files[1].blocks[2].block_id);
+  REQUIRE(decoded.files[1].blocks[2].data == msg.files[1].blocks[2].data);
+
+  // The ack is a fixed 12 bytes however many blocks the batch held
+  ReplicateBlocksAck ack;
+  ack.request_id = 12;
+  ack.applied = 3;
+  size = ack.serialize(buffer, sizeof(buffer));
+  REQUIRE(size == 12);
+  ReplicateBlocksAck decoded_ack = ReplicateBlocksAck::deserialize(buffer, size);
+  REQUIRE(decoded_ack.request_id == 12);
+  REQUIRE(decoded_ack.applied == 3);
+}
+
+TEST_CASE("Chained replication batches carry their route and client replies") {
+  ReplicateBlocksMessage msg;
+  msg.request_id = 5;
+  msg.chained = true;
+  msg.head = NodeId::createNewNode("head", "9000");
+  msg.chain = {NodeId::createNewNode("middle", "9001"), NodeId::createNewNode("tail", "9002")};
+  msg.stored_by = 1;
+
+  ReplicatedFile file;
+  file.hydfs_filename = "chain.log";
+  FileBlock block;
+  block.client_id = "client";
+  block.sequence_num = 1;
+  block.timestamp = 1000;
+  block.data = {'a'};
+  block.size = 1;
+  block.block_id = FileBlock::generateBlockId(block.client_id, block.timestamp, 1);
+  file.blocks = {block, block};
+  file.replies = {ChainReply{}, ChainReply{0x7f000001, 4000, 99, 3}};
+  msg.files.push_back(file);
+
+  char buffer[1024];
+  size_t size = msg.serialize(buffer, sizeof(buffer));
+  ReplicateBlocksMessage decoded = ReplicateBlocksMessage::deserialize(buffer, size);
+  REQUIRE(decoded.chained);
+  REQUIRE(decoded.head == msg.head);
+  REQUIRE(decoded.chain.size() == 2);
+  REQUIRE(decoded.chain[1] == msg.chain[1]);
+  REQUIRE(decoded.stored_by == 1);
+  REQUIRE(decoded.files[0].replies.size() == 2);
+  REQUIRE(decoded.files[0].replies[0].client_port == 0);
+  REQUIRE(decoded.files[0].replies[1].client_ip == 0x7f000001);
+  REQUIRE(decoded.files[0].replies[1].client_port == 4000);
+  REQUIRE(decoded.files[0].replies[1].needed == 3);
+  REQUIRE(decoded.files[0].replies[1].request_id == 99);
+
+  // Star batches leave the route out
+  msg.chained = false;
+  size_t star_size = msg.serialize(buffer, sizeof(buffer));
+  REQUIRE(star_size < size);
+  REQUIRE_FALSE(ReplicateBlocksMessage::deserialize(buffer, star_size).chained);
+}
+
+TEST_CASE("Merge update pages carry their position and acks list the pages still owed") {
+  MergeUpdateMessage msg;
+  msg.hydfs_filename = "merged.log";
+  msg.request_id = 31;
+  msg.new_version = 4;
+  msg.page = 2;
+  msg.page_count = 5;
+  msg.merged_block_ids = {7, 8, 9};
+  msg.commit = true;
+
+  char buffer[1024];
+  size_t size = msg.serialize(buffer, sizeof(buffer));
+  MergeUpdateMessage decoded = MergeUpdateMessage::deserialize(buffer, size);
+  REQUIRE(decoded.page == 2);
+  REQUIRE(decoded.page_count == 5);
+  REQUIRE(decoded.merged_block_ids == msg.merged_block_ids);
+  REQUIRE(decoded.commit);
+
+  MergeUpdateAck ack;
+  ack.hydfs_filename = "merged.log";
+  ack.request_id = 31;
+  ack.success = false;
+  ack.missing_pages = {0, 3};
+  size = ack.serialize(buffer, sizeof(buffer));
+  MergeUpdateAck decoded_ack = MergeUpdateAck::deserialize(buffer, size);
+  REQUIRE(decoded_ack.request_id == 31);
+  REQUIRE_FALSE(decoded_ack.success);
+  REQUIRE(decoded_ack.missing_pages == std::vector<uint32_t>{0, 3});
+}
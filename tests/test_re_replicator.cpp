@@ -0,0 +1,74 @@
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "re_replicator.hpp"
+
+TEST_CASE("ReReplicator sends each under-replicated file from one survivor") {
+  std::vector<NodeId> nodes;
+  for (int i = 0; i < 6; i++) {
+    nodes.push_back(NodeId::createNewNode("localhost", std::to_string(9000 + i)));
+  }
+  const NodeId& removed = nodes[2];
+
+  // Replica sets before the failure
+  ConsistentHashRing before;
+  for (const auto& node : nodes) before.addNode(node);
+  std::vector<std::string> files;
+  for (int i = 0; i < 200; i++) files.push_back("file" + std::to_string(i));
+
+  ConsistentHashRing after;
+  for (const auto& node : nodes) {
+    if (!(node == removed)) after.addNode(node);
+  }
+
+  FileStore store("./test_storage");
+  for (const auto& file : files) REQUIRE(store.createFile(file, {'x'}, "creator"));
+
+  size_t expected_total = 0;
+  size_t planned_total = 0;
+  for (const auto& self : nodes) {
+    if (self == removed) continue;
+    std::mutex mtx;
+    std::vector<std::pair<std::string, NodeId>> sent;
+    ReReplicator replicator(store, after, self, [&](const std::string& file, const NodeId& to) {
+      std::lock_guard<std::mutex> lock(mtx);
+      sent.emplace_back(file, to);
+      return true;
+    });
+
+    std::vector<std::pair<std::string, NodeId>> plan = replicator.planTransfers(removed);
+    for (const auto& [file, target] : plan) {
+      std::vector<NodeId> old_replicas = before.getFileReplicas(file, 3);
+      std::vector<NodeId> new_replicas = after.getFileReplicas(file, 3);
+      REQUIRE(new_replicas[0] == self);
+      REQUIRE(target == new_replicas[2]);
+      bool was_replica = false;
+      for (const auto& node : old_replicas) {
+        was_replica |= node == removed;
+        REQUIRE_FALSE(node == target);
+      }
+      REQUIRE(was_replica);
+    }
+    planned_total += plan.size();
+
+    REQUIRE(replicator.onNodeRemoved(removed) == plan.size());
+    for (int i = 0; i < 200 && replicator.progress().pending > 0; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE(replicator.progress().completed == plan.size());
+    REQUIRE(sent.size() == plan.size());
+  }
+
+  // Every file that lost a replica is sent exactly once across the survivors
+  for (const auto& file : files) {
+    for (const auto& node : before.getFileReplicas(file, 3)) {
+      expected_total += node == removed;
+    }
+  }
+  REQUIRE(planned_total == expected_total);
+  REQUIRE(expected_total > 0);
+}
@@ -0,0 +1,77 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "read_cache.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static ReadCache::Entry makeEntry(uint32_t version, size_t size, Clock::time_point expiry) {
+  ReadCache::Entry entry;
+  entry.version = version;
+  entry.block_ids = {version};
+  entry.data.assign(size, 'c');
+  entry.lease_expiry = expiry;
+  return entry;
+}
+
+TEST_CASE("Read cache serves entries only while their lease holds") {
+  ReadCache cache;
+  auto now = Clock::now();
+  REQUIRE(cache.put(1, makeEntry(3, 10, now + std::chrono::seconds(2)), now));
+
+  ReadCache::Entry entry;
+  REQUIRE(cache.get(1, entry, now + std::chrono::seconds(1)));
+  REQUIRE(entry.version == 3);
+  REQUIRE(entry.data.size() == 10);
+
+  // An expired lease is a miss and drops the entry
+  REQUIRE_FALSE(cache.get(1, entry, now + std::chrono::seconds(3)));
+  REQUIRE_FALSE(cache.get(1, entry, now));
+  ReadCache::Stats stats = cache.stats();
+  REQUIRE(stats.hits == 1);
+  REQUIRE(stats.misses == 2);
+  REQUIRE(stats.entries == 0);
+}
+
+TEST_CASE("Read cache invalidation beats replies to earlier reads") {
+  ReadCache cache;
+  auto issued = Clock::now();
+  auto lease = issued + std::chrono::seconds(5);
+  REQUIRE(cache.put(7, makeEntry(1, 10, lease), issued));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  cache.invalidate(7);
+  ReadCache::Entry entry;
+  REQUIRE_FALSE(cache.get(7, entry));
+  REQUIRE(cache.stats().invalidations == 1);
+
+  // The reply to a read sent before the change may carry the old copy
+  REQUIRE_FALSE(cache.put(7, makeEntry(1, 10, lease), issued));
+
+  // A read issued after the invalidation is cached again
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  REQUIRE(cache.put(7, makeEntry(2, 10, lease), Clock::now()));
+  REQUIRE(cache.get(7, entry));
+  REQUIRE(entry.version == 2);
+}
+
+TEST_CASE("Read cache evicts least recently used files past its capacity") {
+  ReadCache cache(100);
+  auto now = Clock::now();
+  auto lease = now + std::chrono::seconds(5);
+  REQUIRE(cache.put(1, makeEntry(1, 40, lease), now));
+  REQUIRE(cache.put(2, makeEntry(1, 40, lease), now));
+
+  ReadCache::Entry entry;
+  REQUIRE(cache.get(1, entry, now));  // file 1 is now the most recently used
+  REQUIRE(cache.put(3, makeEntry(1, 40, lease), now));
+
+  REQUIRE(cache.get(1, entry, now));
+  REQUIRE_FALSE(cache.get(2, entry, now));
+  REQUIRE(cache.get(3, entry, now));
+  REQUIRE(cache.stats().bytes == 80);
+
+  REQUIRE_FALSE(cache.put(4, makeEntry(1, 101, lease), now));  // never fits
+}
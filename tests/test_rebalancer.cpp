@@ -0,0 +1,128 @@
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "rebalancer.hpp"
+
+TEST_CASE("Rebalancer moves only files whose replica set gained the new node") {
+  std::vector<NodeId> nodes;
+  for (int i = 0; i < 6; i++) {
+    nodes.push_back(NodeId::createNewNode("localhost", std::to_string(9100 + i)));
+  }
+  const NodeId& added = nodes[4];
+
+  ConsistentHashRing before;
+  ConsistentHashRing after;
+  for (const auto& node : nodes) {
+    if (!(node == added)) before.addNode(node);
+    after.addNode(node);
+  }
+
+  FileStore store("./test_storage");
+  std::vector<std::string> files;
+  for (int i = 0; i < 200; i++) {
+    files.push_back("file" + std::to_string(i));
+    REQUIRE(store.createFile(files.back(), std::vector<char>(100, 'x'), "creator"));
+  }
+
+  size_t planned_total = 0;
+  for (const auto& self : nodes) {
+    if (self == added) continue;
+    std::mutex mtx;
+    std::vector<std::pair<std::string, NodeId>> sent;
+    std::vector<std::pair<std::string, NodeId>> dropped;
+    Rebalancer rebalancer(
+        store, after, self,
+        [&](const std::string& file, const NodeId& to) {
+          std::lock_guard<std::mutex> lock(mtx);
+          sent.emplace_back(file, to);
+          return true;
+        },
+        [&](const std::string& file, const NodeId& from) {
+          std::lock_guard<std::mutex> lock(mtx);
+          dropped.emplace_back(file, from);
+        },
+        0);
+
+    std::vector<Rebalancer::Move> moves = rebalancer.planMoves(added);
+    for (const auto& move : moves) {
+      std::vector<NodeId> old_replicas = before.getFileReplicas(move.filename, 3);
+      REQUIRE(old_replicas[0] == self);
+      REQUIRE(move.displaced_valid);
+      REQUIRE(move.displaced == old_replicas[2]);
+      REQUIRE(move.bytes == 100);
+    }
+    planned_total += moves.size();
+
+    REQUIRE(rebalancer.onNodeAdded(added) == moves.size());
+    for (int i = 0; i < 200 && rebalancer.progress().pending > 0; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    Rebalancer::Progress progress = rebalancer.progress();
+    REQUIRE(progress.moved == moves.size());
+    REQUIRE(progress.bytes_moved == moves.size() * 100);
+    REQUIRE(sent.size() == moves.size());
+    REQUIRE(dropped.size() == moves.size());
+    for (const auto& [file, to] : sent) {
+      REQUIRE(to == added);
+    }
+    for (const auto& [file, from] : dropped) {
+      for (const auto& node : after.getFileReplicas(file, 3)) {
+        REQUIRE_FALSE(node == from);  // it really left the replica set
+      }
+    }
+  }
+
+  // Exactly the files whose replica set now includes the new node move, once each
+  size_t expected_total = 0;
+  for (const auto& file : files) {
+    for (const auto& node : after.getFileReplicas(file, 3)) {
+      expected_total += node == added;
+    }
+  }
+  REQUIRE(planned_total == expected_total);
+  REQUIRE(expected_total > 0);
+}
+
+TEST_CASE("Rebalancer paces moves to the bandwidth cap") {
+  NodeId self = NodeId::createNewNode("localhost", "9200");
+  NodeId added = NodeId::createNewNode("localhost", "9201");
+  ConsistentHashRing ring;
+  ring.addNode(self);
+  ring.addNode(added);
+
+  FileStore store("./test_storage");
+  for (int i = 0; i < 4; i++) {
+    REQUIRE(store.createFile("paced" + std::to_string(i), std::vector<char>(1000, 'x'), "c"));
+  }
+
+  // The transfer paces its pages through the rebalancer's throttle, as the handler does
+  std::shared_ptr<BandwidthThrottle> throttle;
+  Rebalancer rebalancer(
+      store, ring, self,
+      [&](const std::string&, const NodeId&) {
+        return throttle->acquire(500) && throttle->acquire(500);
+      },
+      [](const std::string&, const NodeId&) {}, 20000);
+  throttle = rebalancer.throttle();
+  size_t queued = rebalancer.onNodeAdded(added);
+  REQUIRE(queued > 1);
+
+  // 1000 bytes at 20000 bytes/s is 50ms per move after the first
+  auto start = std::chrono::steady_clock::now();
+  while (rebalancer.progress().pending > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  REQUIRE(elapsed >= std::chrono::milliseconds(50 * (queued - 1) - 10));
+  REQUIRE(rebalancer.progress().moved == queued);
+
+  // Stopping the throttle fails waiting transfers instead of holding them
+  throttle->setBandwidthCap(1);
+  throttle->stop();
+  REQUIRE_FALSE(throttle->acquire(1000));
+}
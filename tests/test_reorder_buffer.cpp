@@ -0,0 +1,119 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "append_log.hpp"
+#include "catch_amalgamated.hpp"
+#include "reorder_buffer.hpp"
+
+static FileBlock makeBlock(uint64_t block_id) {
+  FileBlock block;
+  block.client_id = "client";
+  block.block_id = block_id;
+  block.data = {'x'};
+  block.size = 1;
+  return block;
+}
+
+// A batch of `count` blocks of one file starting at `lsn`, numbered by `head`
+static ReorderBuffer::Batch makeBatch(const NodeId& head, int file_number, uint64_t lsn,
+                                      size_t count) {
+  ReorderBuffer::Batch batch{};
+  batch.msg.request_id = lsn;
+  batch.msg.head = head;
+  ReplicatedFile file;
+  file.hydfs_filename = "file" + std::to_string(file_number);
+  file.lsn = lsn;
+  for (size_t i = 0; i < count; i++) {
+    file.blocks.push_back(makeBlock(lsn + i));
+  }
+  batch.msg.files.push_back(file);
+  return batch;
+}
+
+static std::vector<uint64_t> requestIds(const std::vector<ReorderBuffer::Batch>& batches) {
+  std::vector<uint64_t> ids;
+  for (const auto& batch : batches) ids.push_back(batch.msg.request_id);
+  return ids;
+}
+
+TEST_CASE("Append log stamps consecutive LSNs per file and keeps recent block IDs") {
+  AppendLog log(4);
+  REQUIRE(log.stamp(1, {makeBlock(10), makeBlock(11)}) == 1);
+  REQUIRE(log.stamp(2, {makeBlock(20)}) == 1);
+  REQUIRE(log.stamp(1, {makeBlock(12), makeBlock(13), makeBlock(14)}) == 3);
+
+  std::vector<uint64_t> ids;
+  REQUIRE(log.range(1, 3, 5, ids));
+  REQUIRE(ids == std::vector<uint64_t>{12, 13});
+
+  // Only the last four IDs are kept, and LSNs not stamped yet can't be asked for
+  REQUIRE_FALSE(log.range(1, 1, 3, ids));
+  REQUIRE(log.range(1, 2, 6, ids));
+  REQUIRE(ids == std::vector<uint64_t>{11, 12, 13, 14});
+  REQUIRE_FALSE(log.range(1, 5, 7, ids));
+  REQUIRE_FALSE(log.range(3, 1, 2, ids));
+}
+
+TEST_CASE("Reorder buffer applies a file's batches in LSN order and reports the gap") {
+  NodeId head = NodeId::createNewNode("head", "9000");
+  ReorderBuffer buffer(std::chrono::milliseconds(0));
+
+  REQUIRE(requestIds(buffer.offer(makeBatch(head, 1, 1, 2))) == std::vector<uint64_t>{1});
+
+  // LSNs 3-4 are missing: the next batches wait, and only that range is asked for
+  REQUIRE(buffer.offer(makeBatch(head, 1, 6, 1)).empty());
+  REQUIRE(buffer.offer(makeBatch(head, 1, 5, 1)).empty());
+  auto gaps = buffer.gaps();
+  REQUIRE(gaps.size() == 1);
+  REQUIRE(gaps[0].head == head);
+  REQUIRE(gaps[0].from_lsn == 3);
+  REQUIRE(gaps[0].to_lsn == 5);
+
+  // Other files are not held up
+  REQUIRE(requestIds(buffer.offer(makeBatch(head, 2, 1, 1))) == std::vector<uint64_t>{1});
+
+  // Filling the gap releases everything behind it, in order
+  REQUIRE(requestIds(buffer.offer(makeBatch(head, 1, 3, 2))) ==
+          std::vector<uint64_t>{3, 5, 6});
+  REQUIRE(buffer.gaps().empty());
+  REQUIRE(buffer.stats().held == 0);
+  REQUIRE(buffer.stats().reordered == 2);
+
+  // A duplicate of an applied batch passes straight through, marked as already delivered
+  // so the store skips its blocks without looking for them
+  auto duplicate = buffer.offer(makeBatch(head, 1, 1, 2));
+  REQUIRE(duplicate.size() == 1);
+  REQUIRE(duplicate[0].delivered == std::vector<size_t>{2});
+
+  // A resend that overlaps the stream's end is delivered only up to it
+  auto overlap = buffer.offer(makeBatch(head, 1, 6, 3));
+  REQUIRE(overlap.size() == 1);
+  REQUIRE(overlap[0].delivered == std::vector<size_t>{1});
+  REQUIRE(requestIds(buffer.offer(makeBatch(head, 1, 9, 1))) == std::vector<uint64_t>{9});
+}
+
+TEST_CASE("Reorder buffer skips ranges the head no longer has and batches held too long") {
+  NodeId head = NodeId::createNewNode("head", "9000");
+  ReorderBuffer buffer(std::chrono::milliseconds(0), std::chrono::milliseconds(20));
+
+  // The head answers a gap it can't fill with an empty entry at the end of the range
+  REQUIRE(buffer.offer(makeBatch(head, 1, 4, 1)).empty());
+  auto skip = makeBatch(head, 1, 4, 0);
+  skip.msg.request_id = 0;
+  REQUIRE(requestIds(buffer.offer(skip)) == std::vector<uint64_t>{0, 4});
+
+  // A gap nobody fills is given up on after the hold limit
+  REQUIRE(buffer.offer(makeBatch(head, 1, 9, 1)).empty());
+  REQUIRE(buffer.releaseStale().empty());
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  REQUIRE(requestIds(buffer.releaseStale()) == std::vector<uint64_t>{9});
+  REQUIRE(buffer.stats().skipped == 1);
+  REQUIRE(requestIds(buffer.offer(makeBatch(head, 1, 10, 1))) == std::vector<uint64_t>{10});
+
+  // A new head numbers the file from 1 again
+  NodeId next_head = NodeId::createNewNode("other", "9001");
+  REQUIRE(requestIds(buffer.offer(makeBatch(next_head, 1, 1, 1))) == std::vector<uint64_t>{1});
+  REQUIRE(buffer.offer(makeBatch(next_head, 1, 3, 1)).empty());
+}
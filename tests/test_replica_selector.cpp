@@ -0,0 +1,69 @@
+#include <chrono>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "replica_selector.hpp"
+
+using std::chrono::microseconds;
+
+TEST_CASE("Replica selector tracks RTT averages and outstanding requests") {
+  ReplicaSelector selector(0.5, microseconds(1000));
+  NodeId a = NodeId::createNewNode("localhost", "9300");
+  NodeId b = NodeId::createNewNode("localhost", "9301");
+
+  // Unknown peers start at the prior; the first sample replaces it
+  REQUIRE(selector.expectedLatency(a) == 1000);
+  selector.observeRtt(a, microseconds(400));
+  REQUIRE(selector.expectedLatency(a) == 400);
+  selector.observeRtt(a, microseconds(200));
+  REQUIRE(selector.expectedLatency(a) == 300);
+
+  // Each outstanding request scales the estimate
+  selector.onSend(a);
+  selector.onSend(a);
+  REQUIRE(selector.expectedLatency(a) == 900);
+  selector.onReply(a, microseconds(300));
+  REQUIRE(selector.expectedLatency(a) == 600);
+  selector.onTimeout(a, microseconds(2300));
+  REQUIRE(selector.expectedLatency(a) == 1300);
+
+  // A cancelled request stops counting without touching the average
+  selector.onSend(a);
+  REQUIRE(selector.expectedLatency(a) == 2600);
+  selector.onCancel(a);
+  REQUIRE(selector.expectedLatency(a) == 1300);
+  selector.onCancel(a);
+  REQUIRE(selector.expectedLatency(a) == 1300);
+
+  selector.observeRtt(b, microseconds(50));
+  selector.forget(b);
+  REQUIRE(selector.expectedLatency(b) == 1000);
+}
+
+TEST_CASE("Replica selector never leads with the slowest of three replicas") {
+  ReplicaSelector selector;
+  NodeId fast = NodeId::createNewNode("localhost", "9310");
+  NodeId medium = NodeId::createNewNode("localhost", "9311");
+  NodeId slow = NodeId::createNewNode("localhost", "9312");
+  selector.observeRtt(fast, microseconds(100));
+  selector.observeRtt(medium, microseconds(500));
+  selector.observeRtt(slow, microseconds(5000));
+
+  size_t fast_first = 0;
+  for (int i = 0; i < 200; i++) {
+    std::vector<NodeId> order = selector.order({slow, medium, fast});
+    REQUIRE(order.size() == 3);
+    REQUIRE_FALSE(order[0] == slow);  // it loses every pairing
+    REQUIRE(order.back() == slow);    // fallbacks follow expected latency
+    if (order[0] == fast) fast_first++;
+  }
+  // Power of two choices spreads load: the medium replica still leads sometimes
+  REQUIRE(fast_first > 100);
+  REQUIRE(fast_first < 200);
+
+  // A backlog of outstanding requests makes the fastest replica lose its pairings
+  for (int i = 0; i < 20; i++) selector.onSend(fast);
+  for (int i = 0; i < 50; i++) {
+    REQUIRE_FALSE(selector.order({fast, medium})[0] == fast);
+  }
+}